@@ -0,0 +1,126 @@
+// Microbenchmark for the qualifier-scanner keyword classification.
+//
+// Compares the perfect-hash table in EastConstKeywords.h against the string
+// compare chain it replaced (isConstToken / isVolatileToken /
+// isRestrictToken / isIgnorableSpecifierToken), evaluated in the same order
+// collectQualifierTokens() used. Usage:
+//   east-const-keyword-bench [iterations]
+
+#include <EastConstKeywords.h>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool legacyIsIgnorable(llvm::StringRef Text) {
+  return Text == "constexpr" || Text == "consteval" || Text == "constinit" ||
+         Text == "static" || Text == "inline" || Text == "extern" ||
+         Text == "register" || Text == "thread_local" || Text == "mutable" ||
+         Text == "friend" || Text == "typedef";
+}
+
+bool legacyIsConst(llvm::StringRef Text) {
+  return Text == "const" || Text == "__const" || Text == "__const__";
+}
+
+bool legacyIsVolatile(llvm::StringRef Text) {
+  return Text == "volatile" || Text == "__volatile" || Text == "__volatile__";
+}
+
+bool legacyIsRestrict(llvm::StringRef Text) {
+  return Text == "restrict" || Text == "__restrict" || Text == "__restrict__";
+}
+
+EastConstKeywordClass legacyClassify(llvm::StringRef Text) {
+  if (legacyIsConst(Text))
+    return EastConstKeywordClass::Const;
+  if (legacyIsVolatile(Text))
+    return EastConstKeywordClass::Volatile;
+  if (legacyIsRestrict(Text))
+    return EastConstKeywordClass::Restrict;
+  if (legacyIsIgnorable(Text))
+    return EastConstKeywordClass::IgnorableSpecifier;
+  return EastConstKeywordClass::Other;
+}
+
+// Identifier mix resembling a lookbehind window: mostly type and variable
+// names, with the occasional qualifier or storage class.
+std::vector<std::string> buildCorpus(size_t Count) {
+  const std::vector<std::string> Common = {
+      "std",      "vector",   "string",    "int",      "unsigned", "char",
+      "Value",    "size_t",   "iterator",  "T",        "operator", "auto",
+      "return",   "template", "typename",  "nullptr",  "Config",   "buffer",
+      "constant", "constrain", "statics",  "externals"};
+  const std::vector<std::string> Keywords = {
+      "const",   "volatile",     "restrict", "__restrict", "static",
+      "inline",  "constexpr",    "extern",   "mutable",    "typedef",
+      "friend",  "thread_local", "__const",  "register",   "constinit"};
+
+  std::mt19937 Rng(0xEA57C0);
+  std::uniform_int_distribution<int> Percent(0, 99);
+  std::vector<std::string> Corpus;
+  Corpus.reserve(Count);
+  for (size_t I = 0; I < Count; ++I) {
+    const auto &Pool = Percent(Rng) < 25 ? Keywords : Common;
+    Corpus.push_back(Pool[Rng() % Pool.size()]);
+  }
+  return Corpus;
+}
+
+template <typename Classifier>
+double timeClassifier(const std::vector<llvm::StringRef> &Corpus,
+                      unsigned Iterations, Classifier Classify,
+                      unsigned &Checksum) {
+  auto Start = std::chrono::steady_clock::now();
+  unsigned Sum = 0;
+  for (unsigned Iter = 0; Iter < Iterations; ++Iter)
+    for (llvm::StringRef Text : Corpus)
+      Sum += static_cast<unsigned>(Classify(Text));
+  auto End = std::chrono::steady_clock::now();
+  Checksum = Sum;
+  double Nanos = std::chrono::duration<double, std::nano>(End - Start).count();
+  return Nanos / (static_cast<double>(Corpus.size()) * Iterations);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned Iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+  if (Iterations == 0)
+    Iterations = 1;
+
+  std::vector<std::string> Storage = buildCorpus(1 << 16);
+  std::vector<llvm::StringRef> Corpus(Storage.begin(), Storage.end());
+
+  for (llvm::StringRef Text : Corpus) {
+    if (legacyClassify(Text) != classifyEastConstKeyword(Text)) {
+      llvm::errs() << "classification mismatch for '" << Text << "'\n";
+      return 1;
+    }
+  }
+
+  unsigned LegacySum = 0;
+  unsigned TableSum = 0;
+  double LegacyNs =
+      timeClassifier(Corpus, Iterations, legacyClassify, LegacySum);
+  double TableNs = timeClassifier(
+      Corpus, Iterations,
+      [](llvm::StringRef Text) { return classifyEastConstKeyword(Text); },
+      TableSum);
+
+  llvm::outs() << "tokens/iteration: " << Corpus.size()
+               << ", iterations: " << Iterations << "\n";
+  llvm::outs() << llvm::format("compare chain: %8.2f ns/token\n", LegacyNs);
+  llvm::outs() << llvm::format("hash table:    %8.2f ns/token\n", TableNs);
+  llvm::outs() << llvm::format("speedup:       %8.2fx\n",
+                               TableNs > 0 ? LegacyNs / TableNs : 0.0);
+  return LegacySum == TableSum ? 0 : 1;
+}
@@ -57,10 +57,10 @@ function(_integration_collect_compile_flags OUTPUT_VAR)
   set(${OUTPUT_VAR} "${_compile_flags}" PARENT_SCOPE)
 endfunction()
 
-# Fills the EAST_CONST_TEST_{COMPILE_FLAGS,TOOL_ARGS,TIDY_ARGS,CLANG_TIDY_PATH}_JSON variables used by config.json from flags/tidy path.
-# Takes ${COMPILE_FLAGS:LIST} and CLANG_TIDY_PATH as arguments.
+# Fills the EAST_CONST_TEST_{COMPILE_FLAGS,TOOL_ARGS,TIDY_ARGS,CLANG_TIDY_PATH,CLANG_PATH}_JSON variables used by config.json from flags/tool paths.
+# Takes ${COMPILE_FLAGS:LIST}, CLANG_TIDY_PATH and CLANG_PATH as arguments.
 # Sets:
-function(_integration_populate_config_variables COMPILE_FLAGS CLANG_TIDY_PATH)
+function(_integration_populate_config_variables COMPILE_FLAGS CLANG_TIDY_PATH CLANG_PATH)
   _integration_list_to_json(_compile_flags_json ${COMPILE_FLAGS})
   set(EAST_CONST_TEST_COMPILE_FLAGS_JSON "${_compile_flags_json}" PARENT_SCOPE)
 
@@ -78,6 +78,15 @@ function(_integration_populate_config_variables COMPILE_FLAGS CLANG_TIDY_PATH)
 
   _integration_escape_json_string(_clang_tidy_json "${_clang_tidy_value}")
   set(EAST_CONST_TEST_CLANG_TIDY_PATH_JSON "${_clang_tidy_json}" PARENT_SCOPE)
+
+  if(CLANG_PATH)
+    set(_clang_value "${CLANG_PATH}")
+  else()
+    set(_clang_value "clang++")
+  endif()
+
+  _integration_escape_json_string(_clang_json "${_clang_value}")
+  set(EAST_CONST_TEST_CLANG_PATH_JSON "${_clang_json}" PARENT_SCOPE)
 endfunction()
 
 # Generates config.json at CONFIG_PATH from SOURCE_DIR/tests/integration/config.json.in.
@@ -135,11 +144,11 @@ function(_integration_register_ctest_entries CASE_LIST PYTHON_EXECUTABLE SCRIPT_
 endfunction()
 
 # Generate the config for integration testing.
-# Takes BUILD_DIR, SOURCE_DIR, PYTHON_EXECUTABLE, optional CLANG_TIDY_PATH as arguments.
+# Takes BUILD_DIR, SOURCE_DIR, PYTHON_EXECUTABLE, optional CLANG_TIDY_PATH and CLANG_PATH as arguments.
 # Generates config.json, registers CTest entries.
 function(configure_integration_harness)
   set(options)
-  set(oneValueArgs BUILD_DIR SOURCE_DIR PYTHON_EXECUTABLE CLANG_TIDY_PATH)
+  set(oneValueArgs BUILD_DIR SOURCE_DIR PYTHON_EXECUTABLE CLANG_TIDY_PATH CLANG_PATH)
   cmake_parse_arguments(HARNESS "" "${oneValueArgs}" "" ${ARGN})
 
   if(NOT HARNESS_BUILD_DIR OR NOT HARNESS_SOURCE_DIR OR NOT HARNESS_PYTHON_EXECUTABLE)
@@ -159,7 +168,7 @@ function(configure_integration_harness)
   _integration_collect_compile_flags(_integration_compile_flags)
 
   set(EAST_CONST_TEST_CONFIG_PATH "${HARNESS_BUILD_DIR}/tests/integration/config.json")
-  _integration_populate_config_variables("${_integration_compile_flags}" "${HARNESS_CLANG_TIDY_PATH}")
+  _integration_populate_config_variables("${_integration_compile_flags}" "${HARNESS_CLANG_TIDY_PATH}" "${HARNESS_CLANG_PATH}")
   _integration_write_config_file("${HARNESS_SOURCE_DIR}" "${EAST_CONST_TEST_CONFIG_PATH}")
 
   set(INTEGRATION_SCRIPT "${HARNESS_SOURCE_DIR}/tests/integration/run_integration_tests.py")
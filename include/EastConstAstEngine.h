@@ -0,0 +1,146 @@
+#ifndef EAST_CONST_AST_ENGINE_H
+#define EAST_CONST_AST_ENGINE_H
+
+#include <EastConstMemoryGovernor.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class EastConstFileSystemCache;
+class EastConstTimingHistory;
+
+// Strips what differs between otherwise identical compiles: the compiler,
+// the input file, the output and dependency-file options.
+std::vector<std::string>
+normalizeEastConstCompileFlags(const clang::tooling::CompileCommand &Command);
+// The argument naming Command's input, found by absolute path so that
+// `src/a.cpp` matches a Filename of `/project/src/a.cpp`; Filename itself
+// when no argument names it. A pooled file's SourceManager names then match
+// what a fresh driver run would produce.
+std::string
+eastConstInputArgument(const clang::tooling::CompileCommand &Command);
+// The language the driver compiles Command's input as, by driver type name
+// ("c", "c++", "objective-c++-header", ...): -x if given, else the
+// extension, read as C++ by a C++ driver (clang++, --driver-mode=g++).
+// Empty when the extension is unknown.
+std::string
+eastConstInputLanguage(const clang::tooling::CompileCommand &Command);
+
+// Answers every lookup with one compile command, so ClangTool parses a
+// file under exactly that configuration.
+class EastConstSingleCommandDatabase
+    : public clang::tooling::CompilationDatabase {
+public:
+  explicit EastConstSingleCommandDatabase(
+      clang::tooling::CompileCommand Command)
+      : Command(std::move(Command)) {}
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef) const override {
+    return {Command};
+  }
+
+private:
+  clang::tooling::CompileCommand Command;
+};
+
+struct EastConstAstEngineOptions {
+  // Worker threads; 0 uses every core.
+  unsigned Jobs = 0;
+  // Stat and content cache shared by all workers; null reads from disk.
+  EastConstFileSystemCache *FileSystemCache = nullptr;
+  // Build the compiler invocation once per group of files that share a
+  // directory and normalized flags, and reuse it (and the FileManager) for
+  // the rest of the group; only the main file changes between them.
+  bool PoolInvocations = true;
+  // Parse each (file, effective configuration) pair once: repeated source
+  // paths and compile commands that differ only in code-generation flags
+  // (optimization, debug info, PIC, warnings) or in how include paths are
+  // spelled are skipped. Distinct configurations of one file are each
+  // parsed and report their shared sites again; add them with
+  // addEastConstFix so each fix is applied once.
+  bool DeduplicateConfigurations = true;
+  // When set, files are started longest-expected-first using these timings
+  // (new files are estimated from size and #include count) and every
+  // file's time, summed over its configurations, is recorded back into it.
+  EastConstTimingHistory *History = nullptr;
+  // Holds workers back from starting another file while the system is short
+  // of memory, expecting each file to peak where the history says it did.
+  // Running files' growth is measured from this process's resident set.
+  std::optional<EastConstMemoryGovernorOptions> Memory;
+  // Called on the worker thread that finished the last configuration of a
+  // file, with that worker's index and the file's absolute path; Success is
+  // false if any of its configurations failed.
+  std::function<void(unsigned Worker, llvm::StringRef Source,
+                     llvm::StringRef File, bool Success)>
+      OnFileDone;
+  // No parse starts after this, or once *Stop is set; the rest are counted
+  // in Stats.Unstarted.
+  std::optional<std::chrono::steady_clock::time_point> Deadline;
+  const std::atomic<bool> *Stop = nullptr;
+};
+
+struct EastConstAstEngineStats {
+  unsigned Workers = 0;
+  // Parses scheduled, one per distinct (file, configuration) pair.
+  unsigned TranslationUnits = 0;
+  // Parses avoided: sources listed more than once, and compile commands
+  // equivalent to one already scheduled.
+  unsigned DuplicateSources = 0;
+  unsigned DuplicateCommands = 0;
+  unsigned Failed = 0;
+  // Groups of files sharing directory and normalized flags.
+  unsigned InvocationGroups = 0;
+  // Driver runs (argument parsing and invocation setup); with pooling this
+  // is about one per group and worker instead of one per file.
+  unsigned DriverRuns = 0;
+  // Files that ran on a pooled invocation without going through the driver.
+  unsigned PooledUnits = 0;
+  // Files whose expected cost came from the timing history.
+  unsigned TimedUnits = 0;
+  // Times a worker waited for memory before starting its next file.
+  unsigned MemoryThrottled = 0;
+  // Parses left when Options.Deadline passed or Options.Stop was set.
+  unsigned Unstarted = 0;
+  double Seconds = 0;
+  // Summed per-file wall time across workers; BusySeconds / (Seconds *
+  // Workers) is how close the run came to perfect load balance.
+  double BusySeconds = 0;
+
+  double utilization() const {
+    return Seconds <= 0 || Workers == 0 ? 0.0
+                                        : BusySeconds / (Seconds * Workers);
+  }
+};
+
+// Returns the action factory worker Worker runs. Called once per worker on
+// the calling thread before any parsing starts, so each worker can own its
+// MatchFinder and checker.
+using EastConstWorkerFactory =
+    std::function<clang::tooling::FrontendActionFactory &(unsigned Worker)>;
+
+// Parses Sources on a pool of worker threads, each pulling the next file
+// when it finishes one. Every worker keeps its own working directory over
+// Options.FileSystemCache, so headers are stat'ed and read once per run
+// rather than once per TU. Without a timing history, files of one invocation
+// group are queued next to each other so a worker mostly stays within the
+// group it pooled. Returns 0 when every file parsed.
+int runEastConstAstEngine(
+    const clang::tooling::CompilationDatabase &Compilations,
+    llvm::ArrayRef<std::string> Sources,
+    const EastConstAstEngineOptions &Options,
+    const EastConstWorkerFactory &FactoryFor, EastConstAstEngineStats &Stats);
+
+#endif // EAST_CONST_AST_ENGINE_H
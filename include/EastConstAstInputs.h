@@ -0,0 +1,49 @@
+#ifndef EAST_CONST_AST_INPUTS_H
+#define EAST_CONST_AST_INPUTS_H
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <string>
+#include <vector>
+
+// A serialized AST (clang -emit-ast output) to check instead of parsing.
+struct EastConstAstInput {
+  std::string AstPath;
+  // Source the AST was built from, when known. Used to reparse if the AST
+  // no longer matches the files on disk.
+  std::string SourcePath;
+};
+
+bool isEastConstAstFile(llvm::StringRef Path);
+
+// Looks for an AST the build emitted next to Source's object file: for
+// `-o dir/foo.o` that is dir/foo.ast or dir/foo.o.ast. Returns an empty
+// string when there is none.
+std::string findBuildAstFor(
+    const clang::tooling::CompilationDatabase &Compilations,
+    llvm::StringRef Source);
+
+struct EastConstAstStats {
+  unsigned Loaded = 0;
+  // ASTs rejected because a recorded input changed (or unreadable).
+  unsigned Stale = 0;
+  unsigned Reparsed = 0;
+};
+
+// Runs Factory on each AST. Clang verifies every input file the AST
+// recorded before deserializing: by size and modification time, and where
+// those changed, by content for ASTs built with
+// -fvalidate-ast-input-files-content (a checkout that only touched a header
+// keeps its ASTs). A stale AST with a known source is reparsed from
+// Compilations instead, one without is reported as an error. Returns 0 when
+// every input was checked.
+int runEastConstAstInputs(
+    llvm::ArrayRef<EastConstAstInput> Inputs,
+    const clang::tooling::CompilationDatabase &Compilations,
+    clang::tooling::FrontendActionFactory &Factory, EastConstAstStats &Stats);
+
+#endif // EAST_CONST_AST_INPUTS_H
@@ -0,0 +1,77 @@
+#ifndef EAST_CONST_CHECKPOINT_H
+#define EAST_CONST_CHECKPOINT_H
+
+#include <clang/Tooling/Core/Replacement.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A file an earlier run finished, as read back from the checkpoint.
+struct EastConstCheckpointEntry {
+  std::string File;
+  bool Success = true;
+  // Whether a later record says the run applied these fixes already.
+  bool Applied = false;
+  // xxh3 of the file as it was parsed, or as the fixes left it once
+  // applied.
+  std::uint64_t ContentHash = 0;
+  std::vector<clang::tooling::Replacement> Replacements;
+};
+
+// Append-only record of the files a run has finished and the fixes found in
+// them, so a run that is stopped or killed can be resumed where it left off.
+// Every record carries its length and a hash and is synced to disk before
+// record() returns; on resume, a record torn by a crash is cut off and
+// everything before it is kept. Records also carry a hash of the file they
+// name, and a file that changed since is not resumed but parsed again.
+class EastConstCheckpoint {
+public:
+  EastConstCheckpoint() = default;
+  EastConstCheckpoint(const EastConstCheckpoint &) = delete;
+  EastConstCheckpoint &operator=(const EastConstCheckpoint &) = delete;
+
+  // Opens Path for appending. With Resume, first reads what earlier runs
+  // recorded there (a missing file is an empty checkpoint); without it, the
+  // file is started over. Returns false if the file cannot be read or
+  // written.
+  bool open(llvm::StringRef Path, bool Resume);
+
+  const std::vector<EastConstCheckpointEntry> &resumed() const {
+    return Resumed;
+  }
+  bool isDone(llvm::StringRef File) const { return Done.contains(File); }
+  // Bytes of a torn record dropped from the end of the file on resume.
+  std::uint64_t droppedBytes() const { return Dropped; }
+  // Recorded files left out on resume because they changed since.
+  unsigned staleFiles() const { return Stale; }
+
+  // Records that File (an absolute path), as it is on disk now, is
+  // finished. Thread-safe.
+  bool record(llvm::StringRef File, bool Success,
+              llvm::ArrayRef<clang::tooling::Replacement> Replacements);
+  // Records that File's fixes were written to disk, leaving Contents, so a
+  // resumed run does not apply them a second time.
+  bool markApplied(llvm::StringRef File, llvm::StringRef Contents);
+
+private:
+  // Writes Bytes at the end and syncs them to disk.
+  bool append(llvm::StringRef Bytes);
+
+  std::mutex Lock;
+  int FD = -1;
+  std::unique_ptr<llvm::raw_fd_ostream> OS;
+  std::vector<EastConstCheckpointEntry> Resumed;
+  llvm::StringSet<> Done;
+  std::uint64_t Dropped = 0;
+  unsigned Stale = 0;
+};
+
+#endif // EAST_CONST_CHECKPOINT_H
@@ -0,0 +1,81 @@
+#ifndef EAST_CONST_DIFF_H
+#define EAST_CONST_DIFF_H
+
+#include <clang/Tooling/Core/Replacement.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Writes the unified diff that applying Replaces (sorted by offset and
+// non-overlapping, as clang::tooling::Replacements keeps them) to Original
+// would produce, with Context lines around each change. Hunks are computed
+// from the replacements and Original alone; the new contents are never
+// materialized. Label names the file in the ---/+++ lines, which get git's
+// a/ and b/ prefixes. Writes nothing when Replaces is empty.
+void writeEastConstUnifiedDiff(llvm::raw_ostream &OS, llvm::StringRef Label,
+                               llvm::StringRef Original,
+                               llvm::ArrayRef<clang::tooling::Replacement>
+                                   Replaces,
+                               unsigned Context = 3);
+
+// Streams per-file diffs as files finish, in a fixed order, so the output
+// does not depend on which worker finished first: a file's diff is written
+// once every file before it in the order has finished or been given up on.
+class EastConstDiffWriter {
+public:
+  // Order lists the keys complete() will be called with; paths are shown
+  // relative to BaseDir when under it.
+  EastConstDiffWriter(llvm::raw_ostream &OS,
+                      std::vector<std::string> Order,
+                      llvm::StringRef BaseDir);
+
+  // Records that the file Key stands for is done and File (an absolute
+  // path) gets Replaces, and writes whatever the order now allows.
+  // Thread-safe.
+  void complete(llvm::StringRef Key, llvm::StringRef File,
+                llvm::ArrayRef<clang::tooling::Replacement> Replaces);
+  // Writes every file still held back, in order, skipping keys that never
+  // completed.
+  void finish();
+  // Writes File's diff now unless it was written already. Thread-safe.
+  bool write(llvm::StringRef File,
+             llvm::ArrayRef<clang::tooling::Replacement> Replaces);
+  bool isWritten(llvm::StringRef File) const;
+
+  unsigned filesWritten() const;
+  // Files whose original could not be read.
+  unsigned failures() const;
+
+private:
+  struct Pending {
+    bool Done = false;
+    std::string File;
+    std::vector<clang::tooling::Replacement> Replaces;
+  };
+
+  bool writeLocked(llvm::StringRef File,
+                   llvm::ArrayRef<clang::tooling::Replacement> Replaces);
+  void drainLocked();
+
+  llvm::raw_ostream &OS;
+  std::string BaseDir;
+  mutable std::mutex Lock;
+  std::vector<Pending> Queue;
+  llvm::StringMap<std::size_t> Position;
+  // Queue entries past this were completed without being in the order.
+  std::size_t Ordered = 0;
+  std::size_t Next = 0;
+  llvm::StringSet<> Written;
+  unsigned Files = 0;
+  unsigned Failed = 0;
+};
+
+#endif // EAST_CONST_DIFF_H
@@ -12,8 +12,10 @@
 
 #include <llvm/ADT/DenseSet.h>
 
+#include <array>
 #include <cstddef>
 #include <functional>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -26,14 +28,119 @@ using ReplacementHandler =
     std::function<void(const clang::SourceManager &, CharSourceRange,
                        llvm::StringRef)>;
 
-void setQuietMode(bool Enabled);
-bool isQuietMode();
+// Declaration categories the checker distinguishes. Each qualifier site is
+// attributed to the declaration that owns it, so `std::vector<const int> V;`
+// counts as a Variable site.
+enum class EastConstDeclKind : unsigned {
+  Variable,
+  Parameter,
+  ReturnType,
+  Field,
+  Typedef,
+  TypeAlias,
+  TemplateArgument,
+  NonTypeTemplateParm,
+  Count
+};
+
+llvm::StringRef getEastConstDeclKindName(EastConstDeclKind Kind);
+
+// One west-const site, reported as soon as its fix is built.
+struct EastConstSite {
+  // Absolute path.
+  std::string File;
+  // Of the first west qualifier, 1-based.
+  unsigned Line = 0;
+  unsigned Column = 0;
+  EastConstDeclKind Kind = EastConstDeclKind::Variable;
+  // The replacements moving the qualifiers east; empty in check-only mode.
+  std::vector<clang::tooling::Replacement> Fix;
+};
+
+using EastConstSiteHandler = std::function<void(const EastConstSite &)>;
+
+// West-const sites found, indexed by EastConstDeclKind.
+using EastConstSiteCounts =
+    std::array<unsigned, static_cast<std::size_t>(EastConstDeclKind::Count)>;
+// West-const sites found in one file: the kind of each, by file offset.
+using EastConstSiteKinds = std::map<unsigned, EastConstDeclKind>;
+
+// Tallies Sites by kind.
+EastConstSiteCounts countEastConstSites(const EastConstSiteKinds &Sites);
+
+// Per-checker tunables. Every EastConstChecker owns a copy, so checkers with
+// different settings can run concurrently on separate threads.
+struct EastConstCheckerOptions {
+  static constexpr unsigned AllDeclKinds =
+      (1u << static_cast<unsigned>(EastConstDeclKind::Count)) - 1;
+
+  // Suppresses the checker's own diagnostic logging.
+  bool Quiet = false;
+  // Bytes scanned backwards from a type's start when looking for west
+  // qualifier tokens.
+  unsigned LookbehindBytes = 2048;
+  // Bytes of a qualified type's spelling inspected for `auto`/`decltype`
+  // before switching to the spelling-based fallback.
+  unsigned FallbackWindowBytes = 96;
+  // Bitmask of EastConstDeclKind values to rewrite.
+  unsigned EnabledDeclKinds = AllDeclKinds;
+  // Count the sites found in each main file (see getSiteCounts()).
+  bool CountSites = false;
+  // Only find sites: no insertion point, suffix or replacement is computed
+  // and the handler is never called.
+  bool CheckOnly = false;
+  // Ignore the rest of a translation unit after its first site.
+  bool FailFast = false;
+
+  bool isEnabled(EastConstDeclKind Kind) const {
+    return (EnabledDeclKinds & (1u << static_cast<unsigned>(Kind))) != 0;
+  }
+  void setEnabled(EastConstDeclKind Kind, bool Enabled) {
+    unsigned Bit = 1u << static_cast<unsigned>(Kind);
+    EnabledDeclKinds = Enabled ? (EnabledDeclKinds | Bit)
+                               : (EnabledDeclKinds & ~Bit);
+  }
+};
+
+// Parses a comma-separated list of decl kind names ("variable,parameter",
+// "all", "none") into an EnabledDeclKinds mask. Returns false on unknown
+// names.
+bool parseEastConstDeclKinds(llvm::StringRef Spec, unsigned &Mask);
+
+// Adds Rep to Fixes unless Fixes already holds the same replacement. Every
+// configuration a file is parsed in reports the same fixes again, and
+// Replacements::add would merge two equal insertions into one inserting
+// the text twice.
+llvm::Error addEastConstFix(clang::tooling::Replacements &Fixes,
+                            const clang::tooling::Replacement &Rep);
 
 // Checker class
 class EastConstChecker : public MatchFinder::MatchCallback {
 public:
-  explicit EastConstChecker(ReplacementHandler Handler);
+  // OnSite, when set, is called once per site after its replacements were
+  // passed to Handler.
+  explicit EastConstChecker(ReplacementHandler Handler,
+                            EastConstCheckerOptions Options = {},
+                            EastConstSiteHandler OnSite = nullptr);
   void run(const MatchFinder::MatchResult &Result) override;
+  void onStartOfTranslationUnit() override;
+
+  const EastConstCheckerOptions &getOptions() const { return Options; }
+  // With Options.CountSites, the sites found in each file so far, keyed by
+  // absolute path. Counted whether or not the handler builds a fix, and
+  // once per site however many configurations of the file this checker
+  // parses.
+  const std::map<std::string, EastConstSiteCounts> &getSiteCounts() const {
+    return SiteCounts;
+  }
+  // The same sites by offset, for merging the counts of several checkers.
+  const std::map<std::string, EastConstSiteKinds> &getCountedSites() const {
+    return CountedSites;
+  }
+  void clearSiteCounts() {
+    SiteCounts.clear();
+    CountedSites.clear();
+  }
 
 private:
   void processDeclaratorDecl(const DeclaratorDecl *DD, SourceManager &SM,
@@ -77,11 +184,23 @@ private:
       const std::vector<std::string> &Qualifiers) const;
   void addReplacement(const SourceManager &SM, CharSourceRange Range,
                       llvm::StringRef NewText);
+  // Called once for every site before any of its fix is built, and once
+  // after.
+  void noteSite(const SourceManager &SM, SourceLocation Loc);
+  void finishSite(const SourceManager &SM, SourceLocation Loc);
   SourceLocation computeInsertLocation(TypeLoc Unqualified, SourceManager &SM,
                                        const LangOptions &LangOpts) const;
 
   ReplacementHandler ReplacementCallback;
+  EastConstCheckerOptions Options;
+  EastConstDeclKind CurrentDeclKind = EastConstDeclKind::Variable;
   mutable llvm::DenseSet<unsigned> ProcessedQualifierStarts;
+  std::map<std::string, EastConstSiteCounts> SiteCounts;
+  std::map<std::string, EastConstSiteKinds> CountedSites;
+  bool StopTranslationUnit = false;
+  EastConstSiteHandler SiteCallback;
+  // Replacements built for the current site, kept only for SiteCallback.
+  std::vector<clang::tooling::Replacement> SiteFix;
 };
 
 void registerEastConstMatchers(MatchFinder &Finder,
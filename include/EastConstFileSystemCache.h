@@ -0,0 +1,99 @@
+#ifndef EAST_CONST_FILE_SYSTEM_CACHE_H
+#define EAST_CONST_FILE_SYSTEM_CACHE_H
+
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+struct EastConstFileSystemCacheStats {
+  std::uint64_t StatHits = 0;
+  std::uint64_t StatMisses = 0;
+  // Lookups answered from a cached "does not exist" (header search probes
+  // most include directories for every header).
+  std::uint64_t NegativeHits = 0;
+  std::uint64_t ContentHits = 0;
+  std::uint64_t ContentMisses = 0;
+  std::uint64_t ContentBytes = 0;
+  // Reads of files whose contents are not kept (main files).
+  std::uint64_t UncachedReads = 0;
+};
+
+// Process-wide stat and file-content cache shared by every worker, in the
+// style of the dependency scanner's shared cache. Entries are keyed by
+// absolute path and never invalidated, so one cache must not outlive the
+// run that created it: files the tool rewrites afterwards are not seen.
+// Contents are kept for the files worth sharing (headers); each main file
+// is read once per configuration, so callers exclude those with
+// skipContents rather than hold every source of the project in memory.
+class EastConstFileSystemCache {
+public:
+  struct Entry {
+    std::error_code Error;
+    llvm::vfs::Status Status;
+    // Memory-mapped where the underlying file system allows it; null until
+    // some worker opens the file.
+    std::unique_ptr<llvm::MemoryBuffer> Contents;
+  };
+
+  // Returns the entry for Path if its stat result is cached, or null.
+  // Entries are never removed, so the pointer stays valid for the cache's
+  // lifetime.
+  const Entry *lookupStatus(llvm::StringRef Path);
+  // Returns the entry for Path if its contents are cached or it is known
+  // not to exist, or null.
+  const Entry *lookupContents(llvm::StringRef Path);
+  // Record a miss that was answered by the underlying file system. If
+  // another worker stored the same path first, its entry wins.
+  const Entry *storeStatus(llvm::StringRef Path, std::error_code Error,
+                           const llvm::vfs::Status &Status);
+  const Entry *storeContents(llvm::StringRef Path,
+                             const llvm::vfs::Status &Status,
+                             std::unique_ptr<llvm::MemoryBuffer> Contents);
+  // Reads of Path (absolute) go to the underlying file system from now on;
+  // only its stat result is cached.
+  void skipContents(llvm::StringRef Path);
+  // Whether reads of Path are cached; counts the read if not.
+  bool cachesContents(llvm::StringRef Path);
+
+  EastConstFileSystemCacheStats getStats() const;
+  // Paths with an entry, the ones known not to exist included.
+  std::uint64_t size() const { return EntryCount; }
+
+private:
+  static constexpr unsigned ShardCount = 64;
+  struct Shard {
+    mutable std::mutex Lock;
+    llvm::StringMap<std::unique_ptr<Entry>> Entries;
+    llvm::StringSet<> Uncached;
+  };
+  Shard &shardFor(llvm::StringRef Path);
+
+  Shard Shards[ShardCount];
+  std::atomic<std::uint64_t> StatHits{0};
+  std::atomic<std::uint64_t> StatMisses{0};
+  std::atomic<std::uint64_t> NegativeHits{0};
+  std::atomic<std::uint64_t> ContentHits{0};
+  std::atomic<std::uint64_t> ContentMisses{0};
+  std::atomic<std::uint64_t> ContentBytes{0};
+  std::atomic<std::uint64_t> UncachedReads{0};
+  std::atomic<std::uint64_t> EntryCount{0};
+};
+
+// One worker's view of Cache. It keeps its own working directory (ClangTool
+// changes it per compile command), so every worker needs its own instance
+// over a physical file system rather than the process-wide real one.
+llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem>
+createEastConstCachingFileSystem(
+    EastConstFileSystemCache &Cache,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> Underlying =
+        llvm::vfs::createPhysicalFileSystem());
+
+#endif // EAST_CONST_FILE_SYSTEM_CACHE_H
@@ -0,0 +1,45 @@
+#ifndef EAST_CONST_FILTER_H
+#define EAST_CONST_FILTER_H
+
+#include <EastConstEnforcer.h>
+#include <EastConstFrontend.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdio>
+#include <string>
+
+// Rewrites Code as the contents of FileName, compiled with the first
+// command Compilations has for it, through an EastConstRewriter. The source
+// is never written; only the headers it includes are read from disk.
+// Returns false, with Output left as Code, if it does not parse.
+bool rewriteEastConstBuffer(
+    const clang::tooling::CompilationDatabase &Compilations,
+    llvm::StringRef FileName, llvm::StringRef Code,
+    const EastConstCheckerOptions &CheckerOptions,
+    const EastConstFrontendOptions &FrontendOptions, std::string &Output);
+
+// A framed stream carries many sources, each as "<bytes> <file name>\n"
+// followed by that many bytes; without a name, the assumed one applies.
+// Answers use the same framing. Returns false at the end of In; Error is
+// set when the stream ended inside a frame or a header is malformed.
+bool readEastConstFrame(std::FILE *In, std::string &FileName,
+                        std::string &Contents, std::string &Error);
+void writeEastConstFrame(llvm::raw_ostream &OS, llvm::StringRef FileName,
+                         llvm::StringRef Contents);
+
+// Reads source from In and writes the rewritten source to Out: all of In as
+// one file named AssumeFileName, or, with Framed, frame by frame, answering
+// each before reading the next. Frames compiled with the same flags share
+// one rewriter, so headers are read once per stream. A source that does
+// not parse is passed through unchanged and makes the result 1.
+int runEastConstFilter(std::FILE *In, llvm::raw_ostream &Out,
+                       const clang::tooling::CompilationDatabase &Compilations,
+                       llvm::StringRef AssumeFileName, bool Framed,
+                       const EastConstCheckerOptions &CheckerOptions,
+                       const EastConstFrontendOptions &FrontendOptions);
+
+#endif // EAST_CONST_FILTER_H
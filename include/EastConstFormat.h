@@ -0,0 +1,44 @@
+#ifndef EAST_CONST_FORMAT_H
+#define EAST_CONST_FORMAT_H
+
+#include <clang/Format/Format.h>
+#include <clang/Tooling/Core/Replacement.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Error.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Reformats only the lines the fixes touched, so a moved qualifier does not
+// leave odd spacing behind and nothing else in the file changes. The
+// .clang-format style that applies to a file is looked up once per
+// directory and extension.
+class EastConstRangeFormatter {
+public:
+  // FallbackStyle applies where no .clang-format file is found, as for
+  // clang-format's --fallback-style.
+  explicit EastConstRangeFormatter(std::string FallbackStyle = "LLVM");
+
+  // Returns Fixes with the reformatting of the lines they touch merged in,
+  // still relative to Code, the original contents of File. Thread-safe.
+  llvm::Expected<clang::tooling::Replacements>
+  format(llvm::StringRef File, llvm::StringRef Code,
+         const clang::tooling::Replacements &Fixes);
+  // The same for fixes against File as it is on disk.
+  llvm::Expected<std::vector<clang::tooling::Replacement>>
+  formatFile(llvm::StringRef File,
+             llvm::ArrayRef<clang::tooling::Replacement> Fixes);
+
+private:
+  llvm::Expected<clang::format::FormatStyle> styleFor(llvm::StringRef File);
+
+  std::string FallbackStyle;
+  std::mutex Lock;
+  llvm::StringMap<clang::format::FormatStyle> Styles;
+};
+
+#endif // EAST_CONST_FORMAT_H
@@ -0,0 +1,90 @@
+#ifndef EAST_CONST_FRONTEND_H
+#define EAST_CONST_FRONTEND_H
+
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+// How much of each translation unit the frontend builds. The checker only
+// rewrites the main file, so everything else is parsed just far enough to
+// resolve the types the main file uses.
+struct EastConstFrontendOptions {
+  // Lean profile: skip function bodies outside the main file, drop warning
+  // diagnostics and leave the AST to process teardown (DisableFree).
+  bool Fast = false;
+  // Also skip main-file function bodies, leaving only the API surface
+  // (signatures, members, aliases) for the checker. Implies Fast.
+  bool SkipMainFileBodies = false;
+  // Called after each parse, on the thread that ran it, with the absolute
+  // paths of the main file and of every non-system file the preprocessor
+  // entered (the files -MD would list).
+  std::function<void(llvm::StringRef MainFile,
+                     llvm::ArrayRef<std::string> Files)>
+      OnDependencies;
+
+  bool skipsBodies() const { return Fast || SkipMainFileBodies; }
+};
+
+// Builds the action factory for Finder's matchers. With the default options
+// this behaves like newFrontendActionFactory(&Finder).
+//
+// DisableFree hands every AST to the process instead of freeing it after
+// the TU, so memory grows with the number of TUs one tool run parses.
+std::unique_ptr<clang::tooling::FrontendActionFactory>
+newEastConstActionFactory(clang::ast_matchers::MatchFinder &Finder,
+                          const EastConstFrontendOptions &Options);
+
+// Records the invocation ClangTool built for a file, and the FileManager
+// and diagnostic consumer it ran with, before handing it to Inner (which
+// may still adjust it). Files with the same flags and directory can then
+// skip the driver: see runEastConstInvocationFor.
+class EastConstCapturingFactory
+    : public clang::tooling::FrontendActionFactory {
+public:
+  explicit EastConstCapturingFactory(FrontendActionFactory &Inner)
+      : Inner(Inner) {}
+
+  std::unique_ptr<clang::FrontendAction> create() override {
+    return Inner.create();
+  }
+
+  bool
+  runInvocation(std::shared_ptr<clang::CompilerInvocation> Invocation,
+                clang::FileManager *Files,
+                std::shared_ptr<clang::PCHContainerOperations> PCHContainerOps,
+                clang::DiagnosticConsumer *DiagConsumer) override;
+
+  // Whether one invocation for one input was captured; the driver may have
+  // failed before building it.
+  bool captured() const;
+
+  std::shared_ptr<clang::CompilerInvocation> Captured;
+  clang::FileManager *CapturedFiles = nullptr;
+  clang::DiagnosticConsumer *CapturedDiagConsumer = nullptr;
+
+private:
+  FrontendActionFactory &Inner;
+};
+
+// Runs Factory on a copy of Invocation with MainFile (as the driver would
+// name it) swapped in as the only input, in Directory, in the language its
+// extension implies. Everything per-TU
+// (CompilerInstance, SourceManager, Preprocessor, AST) is still created
+// fresh; only the driver and the FileManager are skipped. MainBuffer, if
+// given, replaces MainFile's contents.
+bool runEastConstInvocationFor(
+    clang::tooling::FrontendActionFactory &Factory,
+    const clang::CompilerInvocation &Invocation, llvm::StringRef MainFile,
+    llvm::StringRef Directory, clang::FileManager *Files,
+    std::shared_ptr<clang::PCHContainerOperations> PCHContainerOps,
+    clang::DiagnosticConsumer *DiagConsumer,
+    std::unique_ptr<llvm::MemoryBuffer> MainBuffer = nullptr);
+
+#endif // EAST_CONST_FRONTEND_H
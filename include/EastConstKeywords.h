@@ -0,0 +1,153 @@
+#ifndef EAST_CONST_KEYWORDS_H
+#define EAST_CONST_KEYWORDS_H
+
+#include <llvm/ADT/StringRef.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Classification of the identifiers the qualifier scanner cares about. The raw
+// lexer never resolves keywords, so every token in the lookbehind window
+// arrives as a raw_identifier and has to be classified by spelling.
+enum class EastConstKeywordClass : unsigned char {
+  Other,
+  Const,
+  Volatile,
+  Restrict,
+  IgnorableSpecifier,
+};
+
+namespace east_const_detail {
+
+struct KeywordEntry {
+  const char *Spelling;
+  std::size_t Length;
+  EastConstKeywordClass Class;
+};
+
+constexpr std::size_t constLength(const char *Text) {
+  std::size_t Length = 0;
+  while (Text[Length] != '\0')
+    ++Length;
+  return Length;
+}
+
+constexpr KeywordEntry keyword(const char *Spelling,
+                               EastConstKeywordClass Class) {
+  return {Spelling, constLength(Spelling), Class};
+}
+
+constexpr std::array<KeywordEntry, 20> Keywords = {{
+    keyword("const", EastConstKeywordClass::Const),
+    keyword("__const", EastConstKeywordClass::Const),
+    keyword("__const__", EastConstKeywordClass::Const),
+    keyword("volatile", EastConstKeywordClass::Volatile),
+    keyword("__volatile", EastConstKeywordClass::Volatile),
+    keyword("__volatile__", EastConstKeywordClass::Volatile),
+    keyword("restrict", EastConstKeywordClass::Restrict),
+    keyword("__restrict", EastConstKeywordClass::Restrict),
+    keyword("__restrict__", EastConstKeywordClass::Restrict),
+    keyword("constexpr", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("consteval", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("constinit", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("static", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("inline", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("extern", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("register", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("thread_local", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("mutable", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("friend", EastConstKeywordClass::IgnorableSpecifier),
+    keyword("typedef", EastConstKeywordClass::IgnorableSpecifier),
+}};
+
+constexpr std::size_t MinKeywordLength = 5;
+constexpr std::size_t MaxKeywordLength = 12;
+constexpr std::size_t KeywordTableSize = 32;
+
+// Length, last character and middle character separate every entry above;
+// buildKeywordTable() rejects the set at compile time if that ever stops
+// being true.
+constexpr std::size_t keywordHash(const char *Text, std::size_t Length) {
+  return (Length + 10 * static_cast<unsigned char>(Text[Length - 1]) +
+          static_cast<unsigned char>(Text[Length / 2])) %
+         KeywordTableSize;
+}
+
+// Byte-order independent 4-byte load; compilers fold it into a single move.
+constexpr std::uint32_t loadWord(const char *Text) {
+  return static_cast<std::uint32_t>(static_cast<unsigned char>(Text[0])) |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(Text[1])) << 8 |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(Text[2])) << 16 |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(Text[3])) << 24;
+}
+
+// For 5 <= Length <= 12 the head, middle and tail words cover every byte, so
+// comparing the three words and the length is an exact string compare.
+struct KeywordSlot {
+  std::uint32_t Head = 0;
+  std::uint32_t Middle = 0;
+  std::uint32_t Tail = 0;
+  unsigned char Length = 0;
+  EastConstKeywordClass Class = EastConstKeywordClass::Other;
+};
+
+struct KeywordTable {
+  std::array<KeywordSlot, KeywordTableSize> Slots{};
+  bool Collision = false;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+  KeywordTable Table;
+  for (const KeywordEntry &Entry : Keywords) {
+    KeywordSlot &Slot = Table.Slots[keywordHash(Entry.Spelling, Entry.Length)];
+    if (Slot.Length != 0)
+      Table.Collision = true;
+    Slot.Head = loadWord(Entry.Spelling);
+    Slot.Middle = loadWord(Entry.Spelling + Entry.Length / 2 - 2);
+    Slot.Tail = loadWord(Entry.Spelling + Entry.Length - 4);
+    Slot.Length = static_cast<unsigned char>(Entry.Length);
+    Slot.Class = Entry.Class;
+  }
+  return Table;
+}
+
+constexpr KeywordTable KeywordLookup = buildKeywordTable();
+static_assert(!KeywordLookup.Collision,
+              "keyword hash is no longer perfect; adjust keywordHash()");
+
+// Probed instead of the real spelling when the length is out of range, so the
+// lookup never reads out of bounds and never branches on the input.
+constexpr char OutOfRangeProbe[MinKeywordLength + 1] = "#####";
+
+} // namespace east_const_detail
+
+// Classifies an identifier spelling with one table probe. The lookup is
+// branch-free: qualifier scans see an unpredictable mix of keywords and
+// ordinary identifiers, so mispredictions would otherwise dominate.
+inline EastConstKeywordClass classifyEastConstKeyword(llvm::StringRef Text) {
+  using namespace east_const_detail;
+  const std::size_t Length = Text.size();
+  const std::uintptr_t InRange =
+      static_cast<std::uintptr_t>(Length - MinKeywordLength <=
+                                  MaxKeywordLength - MinKeywordLength);
+  const std::uintptr_t Mask = ~InRange + 1;
+  const char *Probe = reinterpret_cast<const char *>(
+      (reinterpret_cast<std::uintptr_t>(Text.data()) & Mask) |
+      (reinterpret_cast<std::uintptr_t>(OutOfRangeProbe) & ~Mask));
+  const std::size_t ProbeLength =
+      (Length & Mask) | (MinKeywordLength & ~Mask);
+
+  const KeywordSlot &Slot =
+      KeywordLookup.Slots[keywordHash(Probe, ProbeLength)];
+  const std::uint32_t Diff =
+      (loadWord(Probe) ^ Slot.Head) |
+      (loadWord(Probe + ProbeLength / 2 - 2) ^ Slot.Middle) |
+      (loadWord(Probe + ProbeLength - 4) ^ Slot.Tail);
+  const unsigned Match = static_cast<unsigned>(Diff == 0) &
+                         static_cast<unsigned>(Slot.Length == Length);
+  return static_cast<EastConstKeywordClass>(
+      static_cast<unsigned>(Slot.Class) * Match);
+}
+
+#endif // EAST_CONST_KEYWORDS_H
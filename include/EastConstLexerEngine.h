@@ -0,0 +1,77 @@
+#ifndef EAST_CONST_LEXER_ENGINE_H
+#define EAST_CONST_LEXER_ENGINE_H
+
+#include <EastConstEnforcer.h>
+
+#include <clang/Basic/LangOptions.h>
+#include <clang/Tooling/Core/Replacement.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// A west-const site found by the raw-lexer heuristics. Offsets are byte
+// offsets into the scanned buffer.
+struct LexerEngineSite {
+  // Start of the moved qualifiers: the first `const`, or the first
+  // qualifier when there is none. Both engines move from there on, so this
+  // matches the first removal offset the semantic checker reports.
+  unsigned QualifierOffset = 0;
+  // (offset, length) of each run of qualifiers removed, with the space
+  // after it; specifiers between the runs (`const static volatile`) stay,
+  // as they do in the checker.
+  std::vector<std::pair<unsigned, unsigned>> Removals;
+  unsigned InsertOffset = 0;
+  std::string Suffix;
+  unsigned Line = 0;
+  unsigned Column = 0;
+  EastConstDeclKind Kind = EastConstDeclKind::Variable;
+  // Set when the token context does not pin down a declaration (macro
+  // prefixes, casts, vexing-parse shapes, template arguments in
+  // expressions). Such sites are reported but never rewritten.
+  bool NeedsSemanticCheck = false;
+  llvm::StringRef AmbiguityReason;
+};
+
+// Returns the language options the lexer engine uses when none are given:
+// C++20 tokenization rules with line comments and alternative operators.
+clang::LangOptions getLexerEngineLangOptions();
+
+// Scans Code for west-const declarations without building an AST. Covers
+// simple declarations, function parameters and return types, class members,
+// typedef/using aliases and template arguments. Sites whose decl kind is
+// disabled in Options are dropped.
+std::vector<LexerEngineSite>
+scanWestConstSites(llvm::StringRef FileName, llvm::StringRef Code,
+                   const clang::LangOptions &LangOpts,
+                   const EastConstCheckerOptions &Options = {});
+
+// Converts the unambiguous sites into replacements for FilePath. Sites
+// flagged NeedsSemanticCheck are skipped unless IncludeAmbiguous is set.
+clang::tooling::Replacements
+buildLexerEngineReplacements(llvm::StringRef FilePath,
+                             llvm::ArrayRef<LexerEngineSite> Sites,
+                             bool IncludeAmbiguous = false);
+
+// Agreement between lexer sites and the qualifier offsets the semantic
+// checker removed for the same file.
+struct LexerEngineAgreement {
+  unsigned Confirmed = 0;         // unambiguous lexer site, checker agrees
+  unsigned FalsePositives = 0;    // unambiguous lexer site, checker disagrees
+  unsigned AmbiguousConfirmed = 0;
+  unsigned AmbiguousRejected = 0;
+  unsigned Missed = 0;            // checker site the lexer did not report
+
+  LexerEngineAgreement &operator+=(const LexerEngineAgreement &Other);
+  // Fraction of sites (from either side) on which both engines agree.
+  double agreementRatio() const;
+};
+
+LexerEngineAgreement
+compareLexerEngineSites(llvm::ArrayRef<LexerEngineSite> Sites,
+                        llvm::ArrayRef<unsigned> CheckerOffsets);
+
+#endif // EAST_CONST_LEXER_ENGINE_H
@@ -0,0 +1,85 @@
+#ifndef EAST_CONST_LOGGING_H
+#define EAST_CONST_LOGGING_H
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <atomic>
+#include <string>
+
+// Levels are ordered by verbosity; a message is emitted when its level is at
+// or below both the compile-time ceiling and the runtime threshold.
+enum class EastConstLogLevel : unsigned {
+  Off = 0,
+  Error = 1,
+  Warning = 2,
+  Info = 3,
+  Debug = 4,
+  Trace = 5,
+};
+
+// Compile-time ceiling. Builds can pass -DEAST_CONST_MAX_LOG_LEVEL=3 to strip
+// debug/trace call sites entirely.
+#ifndef EAST_CONST_MAX_LOG_LEVEL
+#define EAST_CONST_MAX_LOG_LEVEL 5
+#endif
+
+void setEastConstLogLevel(EastConstLogLevel Level);
+EastConstLogLevel getEastConstLogLevel();
+
+// Parses "off", "error", "warning", "info", "debug" or "trace". Returns false
+// and leaves Level untouched for anything else.
+bool parseEastConstLogLevel(llvm::StringRef Name, EastConstLogLevel &Level);
+
+// Redirects flushed output (defaults to llvm::errs()). Passing nullptr restores
+// the default sink. The sink is shared by every thread and written under a
+// lock, one flushed buffer at a time.
+void setEastConstLogSink(llvm::raw_ostream *Sink);
+
+// Writes the calling thread's pending messages to the sink. Buffers are also
+// flushed when they grow past a threshold, when an error is logged, and when
+// the owning thread exits.
+void flushEastConstLog();
+
+namespace east_const_detail {
+extern std::atomic<unsigned> RuntimeLogLevel;
+std::string &threadLogBuffer();
+} // namespace east_const_detail
+
+inline bool isEastConstLogEnabled(EastConstLogLevel Level) {
+  if (static_cast<unsigned>(Level) > EAST_CONST_MAX_LOG_LEVEL)
+    return false;
+  return static_cast<unsigned>(Level) <=
+         east_const_detail::RuntimeLogLevel.load(std::memory_order_relaxed);
+}
+
+// Appends one line to the calling thread's log buffer. Construct only after
+// isEastConstLogEnabled() returned true; EAST_CONST_LOG does that for you.
+class EastConstLogRecord {
+public:
+  explicit EastConstLogRecord(EastConstLogLevel Level);
+  ~EastConstLogRecord();
+
+  EastConstLogRecord(const EastConstLogRecord &) = delete;
+  EastConstLogRecord &operator=(const EastConstLogRecord &) = delete;
+
+  llvm::raw_ostream &stream() { return Stream; }
+
+private:
+  EastConstLogLevel Level;
+  llvm::raw_string_ostream Stream;
+};
+
+// Streams the arguments into a log line only when Level is enabled, so
+// expensive expressions (type printing, location formatting) cost nothing
+// otherwise:
+//   EAST_CONST_LOG(Trace, "type '" << QT.getAsString() << "'");
+#define EAST_CONST_LOG(Level, ...)                                             \
+  do {                                                                         \
+    if (::isEastConstLogEnabled(::EastConstLogLevel::Level)) {                 \
+      ::EastConstLogRecord EastConstLogRecordInstance(                         \
+          ::EastConstLogLevel::Level);                                         \
+      EastConstLogRecordInstance.stream() << __VA_ARGS__;                      \
+    }                                                                          \
+  } while (false)
+
+#endif // EAST_CONST_LOGGING_H
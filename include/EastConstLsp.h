@@ -0,0 +1,93 @@
+#ifndef EAST_CONST_LSP_H
+#define EAST_CONST_LSP_H
+
+#include <EastConstEnforcer.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+// Reads one "Content-Length: <bytes>\r\n\r\n<body>" message, the base
+// protocol of the Language Server Protocol. Returns false at the end of In;
+// Error is set when the stream ended inside a message or its header is
+// malformed.
+bool readEastConstLspMessage(std::FILE *In, std::string &Body,
+                             std::string &Error);
+void writeEastConstLspMessage(llvm::raw_ostream &OS,
+                              const llvm::json::Value &Message);
+
+struct EastConstLspStats {
+  unsigned Analyses = 0;
+  // Analyses that matched the whole main file: a document's first, and
+  // every one after its preamble had to be rebuilt.
+  unsigned FullAnalyses = 0;
+  unsigned PreamblesBuilt = 0;
+  // Analyses skipped because the document did not parse; its edited lines
+  // stay pending and the previous diagnostics are kept.
+  unsigned Unparsed = 0;
+  double LastMilliseconds = 0;
+};
+
+// Serves west-const diagnostics and "move qualifier east" quick fixes to an
+// editor. Each open document keeps its compiler invocation and a preamble
+// (its leading #includes, precompiled in memory), so an edit reparses only
+// the document itself. The checker then matches only the top-level
+// declarations (namespace members, not namespaces) that contain an edited
+// line; diagnostics elsewhere are kept from earlier analyses, moved by the
+// lines the edit added or removed. An edit the preamble cannot absorb
+// rebuilds it and matches the whole document again.
+class EastConstLspServer {
+public:
+  // Messages to the client go to Out. Documents are compiled with the
+  // commands Compilations has for them.
+  EastConstLspServer(const clang::tooling::CompilationDatabase &Compilations,
+                     EastConstCheckerOptions CheckerOptions,
+                     llvm::raw_ostream &Out);
+  ~EastConstLspServer();
+  EastConstLspServer(const EastConstLspServer &) = delete;
+  EastConstLspServer &operator=(const EastConstLspServer &) = delete;
+
+  // Handles one request or notification. Returns false once the client
+  // sent "exit".
+  bool handle(const llvm::json::Value &Message);
+  // The status to exit with: 0 if "shutdown" came before "exit".
+  int exitCode() const { return ShutdownRequested ? 0 : 1; }
+
+  EastConstLspStats getStats() const { return Stats; }
+
+private:
+  struct Document;
+
+  void reply(const llvm::json::Value &Id, llvm::json::Value Result);
+  void replyError(const llvm::json::Value &Id, int Code,
+                  llvm::StringRef Message);
+  void didOpen(const llvm::json::Object &Params);
+  void didChange(const llvm::json::Object &Params);
+  void didClose(const llvm::json::Object &Params);
+  llvm::json::Value codeAction(const llvm::json::Object &Params);
+  void analyze(Document &Doc);
+  void publish(const Document &Doc);
+
+  const clang::tooling::CompilationDatabase &Compilations;
+  EastConstCheckerOptions CheckerOptions;
+  llvm::raw_ostream &Out;
+  llvm::StringMap<std::unique_ptr<Document>> Documents;
+  bool ShutdownRequested = false;
+  EastConstLspStats Stats;
+};
+
+// Serves In (a client's standard output) until it sends "exit" or closes
+// the stream, answering on Out. Returns the status to exit with.
+int runEastConstLspServer(
+    std::FILE *In, llvm::raw_ostream &Out,
+    const clang::tooling::CompilationDatabase &Compilations,
+    const EastConstCheckerOptions &CheckerOptions);
+
+#endif // EAST_CONST_LSP_H
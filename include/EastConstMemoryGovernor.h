@@ -0,0 +1,84 @@
+#ifndef EAST_CONST_MEMORY_GOVERNOR_H
+#define EAST_CONST_MEMORY_GOVERNOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+// Memory the system can still hand out without swapping (MemAvailable), or
+// std::nullopt where that is not known.
+std::optional<std::uint64_t> getEastConstAvailableMemory();
+// Resident set of process Pid (0 = this process), or 0 where not known.
+std::uint64_t getEastConstResidentBytes(long Pid = 0);
+// Resets this process's peak resident set to its current one, so the next
+// getEastConstPeakResidentBytes() covers only what ran in between. Returns
+// false where the kernel cannot do that.
+bool resetEastConstPeakResident();
+// Peak resident set of this process, or 0 where not known.
+std::uint64_t getEastConstPeakResidentBytes();
+
+struct EastConstMemoryGovernorOptions {
+  // Memory to leave to the rest of the machine.
+  std::uint64_t ReserveBytes = std::uint64_t(1) << 30;
+  // Assumed peak of a file with no recorded peak.
+  std::uint64_t DefaultUnitBytes = std::uint64_t(256) << 20;
+  // How often a held-back start looks at the system again even if no file
+  // finished, so memory freed elsewhere is put to use.
+  std::chrono::milliseconds RecheckInterval{100};
+  // Where to read the system's available memory; std::nullopt disables
+  // throttling. Tests substitute their own.
+  std::function<std::optional<std::uint64_t>()> AvailableBytes =
+      getEastConstAvailableMemory;
+};
+
+struct EastConstMemoryGovernorStats {
+  // Times starting a unit was held back for memory.
+  unsigned Throttled = 0;
+  unsigned PeakRunning = 0;
+};
+
+// Decides when another translation unit may start. A unit is admitted when
+// the memory available, less what the running units are still expected to
+// grow by, leaves room for its expected peak and the reserve. Running units'
+// growth is their expected peaks minus what the resident probe says they
+// already hold. A unit is always admitted when nothing else runs, so the run
+// never stalls on a file bigger than the machine.
+class EastConstMemoryGovernor {
+public:
+  // ResidentProbe returns the memory the running units hold now, beyond what
+  // the workers held when idle; without one, running units are assumed to
+  // need all of their expected peak still.
+  explicit EastConstMemoryGovernor(
+      EastConstMemoryGovernorOptions Options,
+      std::function<std::uint64_t()> ResidentProbe = nullptr);
+
+  // Starts a unit expected to peak at Bytes if it fits.
+  bool tryStart(std::uint64_t Bytes);
+  // Waits until the unit fits. Thread-safe.
+  void start(std::uint64_t Bytes);
+  void finish(std::uint64_t Bytes);
+
+  unsigned running() const;
+  // Peak to assume for a file; Recorded when the history has one.
+  std::uint64_t expectedBytes(std::optional<std::uint64_t> Recorded) const;
+  EastConstMemoryGovernorStats getStats() const;
+
+private:
+  bool fitsLocked(std::uint64_t Bytes);
+
+  EastConstMemoryGovernorOptions Options;
+  std::function<std::uint64_t()> ResidentProbe;
+  mutable std::mutex Lock;
+  std::condition_variable Finished;
+  unsigned Running = 0;
+  std::uint64_t Outstanding = 0;
+  // Whether the last tryStart() was refused; a caller retrying one unit
+  // counts as one throttled start.
+  bool Holding = false;
+  EastConstMemoryGovernorStats Stats;
+};
+
+#endif // EAST_CONST_MEMORY_GOVERNOR_H
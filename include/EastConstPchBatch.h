@@ -0,0 +1,77 @@
+#ifndef EAST_CONST_PCH_BATCH_H
+#define EAST_CONST_PCH_BATCH_H
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <string>
+#include <vector>
+
+// Returns the `#include` lines that open Code, stopping at the first line
+// that is neither an include, a comment, blank, nor `#pragma once`.
+// Conditional directives end the prefix because their outcome depends on
+// the including file.
+std::vector<std::string> extractLeadingIncludes(llvm::StringRef Code);
+
+// Translation units that share a compiler, language, compile flags and a
+// leading include block.
+struct EastConstPchGroup {
+  std::string Key;
+  std::vector<std::string> Sources;
+  std::vector<std::string> IncludeLines;
+  std::string Directory;
+  // The compiler the members are compiled with; its name can pick the
+  // target and the driver mode, so the PCH is built with it too.
+  std::string Driver;
+  // The header type of the members' language, passed to -x for the prefix:
+  // c-header, c++-header, objective-c++-header, ...
+  std::string HeaderLanguage;
+  // Compile flags without the compiler, inputs, outputs and dependency-file
+  // options.
+  std::vector<std::string> Flags;
+  // Set when the prefix has quoted includes; they resolve relative to this
+  // directory, so it is part of the key.
+  std::string QuoteDirectory;
+};
+
+// Groups Sources by compiler, language, compile flags and leading includes.
+// Sources that share their prefix with no other file, have none, or are in
+// a language without a header type land in Ungrouped.
+std::vector<EastConstPchGroup>
+planEastConstPchGroups(const clang::tooling::CompilationDatabase &Compilations,
+                       llvm::ArrayRef<std::string> Sources,
+                       std::vector<std::string> &Ungrouped);
+
+struct EastConstPchStats {
+  unsigned Groups = 0;
+  unsigned TranslationUnits = 0;
+  unsigned GroupedUnits = 0;
+  // Grouped units that parsed on a PCH found valid in the cache.
+  unsigned CachedUnits = 0;
+  unsigned PchBuilt = 0;
+  unsigned PchFailed = 0;
+  double BuildSeconds = 0;
+  // Prefix parse time avoided: the PCH build time of each group times its
+  // members, less the builds paid for in this run.
+  double EstimatedSavedSeconds = 0;
+
+  double hitRate() const {
+    return GroupedUnits == 0 ? 0.0
+                             : static_cast<double>(CachedUnits) / GroupedUnits;
+  }
+};
+
+// Runs Factory over Sources. Each group is parsed on top of a PCH of its
+// include prefix, kept in CacheDir and reused while none of the headers it
+// was built from change. Returns the ClangTool status: 0 when every run
+// succeeded.
+int runEastConstPchBatch(const clang::tooling::CompilationDatabase &Compilations,
+                         llvm::ArrayRef<std::string> Sources,
+                         llvm::StringRef CacheDir,
+                         clang::tooling::FrontendActionFactory &Factory,
+                         EastConstPchStats &Stats);
+
+#endif // EAST_CONST_PCH_BATCH_H
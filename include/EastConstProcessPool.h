@@ -0,0 +1,98 @@
+#ifndef EAST_CONST_PROCESS_POOL_H
+#define EAST_CONST_PROCESS_POOL_H
+
+#include <EastConstMemoryGovernor.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct EastConstProcessPoolOptions {
+  // Worker processes; 0 uses every core.
+  unsigned Workers = 0;
+  // A worker is replaced by a fresh process after this many units (0 =
+  // never), returning whatever its heap fragmented into to the system...
+  unsigned RecycleAfterUnits = 0;
+  // ...or as soon as its resident set grows past this many bytes (0 =
+  // never; only measured where /proc is available).
+  std::uint64_t RecycleAboveRssBytes = 0;
+  // How many more times a unit is handed to a fresh worker after the
+  // worker running it died.
+  unsigned CrashRetries = 1;
+  // A worker still on one unit after this long is killed and the unit
+  // counts as crashed, retries included (0 = no limit).
+  std::chrono::milliseconds UnitTimeout{0};
+  // Holds back new units while the system is short of memory; the running
+  // units' growth is measured from each worker's resident set.
+  std::optional<EastConstMemoryGovernorOptions> Memory;
+  // Recorded peak of each unit (parallel to the units; 0 or missing means
+  // unknown) for the governor.
+  std::vector<std::uint64_t> UnitPeakBytes;
+  // No unit is handed out after this, or once *Stop is set; the rest count
+  // as Stats.Unstarted.
+  std::optional<std::chrono::steady_clock::time_point> Deadline;
+  const std::atomic<bool> *Stop = nullptr;
+};
+
+struct EastConstCrashedUnit {
+  std::string Unit;
+  // How the last worker running it ended, e.g. "signal 11".
+  std::string Reason;
+  // Whether a retry completed it.
+  bool Recovered = false;
+};
+
+struct EastConstProcessPoolStats {
+  unsigned Workers = 0;
+  unsigned Units = 0;
+  // Units whose task reported failure or whose workers crashed on every
+  // attempt.
+  unsigned Failed = 0;
+  unsigned WorkersStarted = 0;
+  unsigned Recycled = 0;
+  // Includes the workers killed for Options.UnitTimeout.
+  unsigned Crashes = 0;
+  unsigned TimedOut = 0;
+  // Times handing out a unit waited for memory.
+  unsigned MemoryThrottled = 0;
+  // Units left when Options.Deadline passed or Options.Stop was set.
+  unsigned Unstarted = 0;
+  std::vector<EastConstCrashedUnit> CrashedUnits;
+  double Seconds = 0;
+};
+
+// Runs in a worker process. Output is handed back to the parent verbatim.
+using EastConstProcessTask =
+    std::function<bool(llvm::StringRef Unit, std::string &Output)>;
+// Runs in the parent as each unit completes; Seconds is the wall time from
+// handing the unit out to receiving its result, and PeakBytes how far the
+// worker's resident set grew while on it (0 where not measurable). Units
+// that crashed on every attempt produce no result.
+using EastConstProcessResultHandler = std::function<void(
+    llvm::StringRef Unit, bool Success, llvm::StringRef Output, double Seconds,
+    std::uint64_t PeakBytes)>;
+
+// Whether this platform can fork worker processes.
+bool isEastConstProcessPoolSupported();
+
+// Forks a pool of worker processes and feeds them Units over pipes, one at
+// a time, in order. Each worker inherits the caller's state at fork time,
+// so Task may use anything set up beforehand; the caller must not have
+// other threads running. A worker that dies mid-unit, or is killed for
+// running past Options.UnitTimeout, is replaced, and its unit is retried on
+// the new worker up to Options.CrashRetries times.
+// Returns 0 when every unit succeeded.
+int runEastConstProcessPool(llvm::ArrayRef<std::string> Units,
+                            const EastConstProcessPoolOptions &Options,
+                            const EastConstProcessTask &Task,
+                            const EastConstProcessResultHandler &OnResult,
+                            EastConstProcessPoolStats &Stats);
+
+#endif // EAST_CONST_PROCESS_POOL_H
@@ -0,0 +1,58 @@
+#ifndef EAST_CONST_REPORT_H
+#define EAST_CONST_REPORT_H
+
+#include <EastConstEnforcer.h>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+enum class EastConstReportFormat { Text, Ndjson, Sarif };
+
+// Accepts "text", "ndjson" and "sarif".
+bool parseEastConstReportFormat(llvm::StringRef Name,
+                                EastConstReportFormat &Format);
+
+// One NDJSON record: {"file", "line", "column", "kind", "fix": [{"offset",
+// "length", "text"}]}, without the trailing newline.
+std::string formatEastConstSiteRecord(const EastConstSite &Site);
+// Reads a record formatEastConstSiteRecord() wrote.
+bool parseEastConstSiteRecord(llvm::StringRef Record, EastConstSite &Site);
+
+// Writes sites to OS as they are reported: one NDJSON line each, or as the
+// results of a SARIF 2.1.0 log. Nothing is kept per site; the SARIF log is
+// opened on construction and closed by finish().
+class EastConstReportWriter {
+public:
+  EastConstReportWriter(llvm::raw_ostream &OS, EastConstReportFormat Format);
+  ~EastConstReportWriter();
+  EastConstReportWriter(const EastConstReportWriter &) = delete;
+  EastConstReportWriter &operator=(const EastConstReportWriter &) = delete;
+
+  // Thread-safe.
+  void add(const EastConstSite &Site);
+  void finish();
+
+  unsigned size() const;
+
+private:
+  // Site.Column counted in UTF-16 code units, as SARIF columns are; the
+  // checker counts bytes. Reads each site's file once, keeping its
+  // non-ASCII lines in NonAsciiLines.
+  unsigned utf16Column(const EastConstSite &Site);
+
+  llvm::raw_ostream &OS;
+  EastConstReportFormat Format;
+  mutable std::mutex Lock;
+  std::unique_ptr<llvm::json::OStream> Sarif;
+  unsigned Results = 0;
+  llvm::StringMap<std::map<unsigned, std::string>> NonAsciiLines;
+};
+
+#endif // EAST_CONST_REPORT_H
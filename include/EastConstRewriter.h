@@ -0,0 +1,118 @@
+#ifndef EAST_CONST_REWRITER_H
+#define EAST_CONST_REWRITER_H
+
+#include <EastConstEnforcer.h>
+#include <EastConstFileSystemCache.h>
+#include <EastConstFrontend.h>
+
+#include <clang/Tooling/Core/Replacement.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct EastConstRewriterOptions {
+  // Compiler flags every buffer is parsed with, without the compiler, the
+  // input or an output.
+  std::vector<std::string> Flags = {"-std=c++17"};
+  // Where relative file names and include paths resolve; empty is the
+  // current directory.
+  std::string Directory;
+  // Sites are returned, never printed: Checker.Quiet is implied.
+  EastConstCheckerOptions Checker;
+  // Frontend.Fast leaves every AST to process teardown, which a rewriter
+  // that lives as long as its process cannot afford beyond a few buffers.
+  EastConstFrontendOptions Frontend;
+  // Once the shared stat cache holds this many paths, it and every parse
+  // context's FileManager start over, so a rewriter fed an endless stream
+  // of buffers (--stdin=framed) does not keep every lookup it ever made,
+  // "not found" included. 0 keeps them for the rewriter's lifetime.
+  std::uint64_t CacheEntryLimit = 100000;
+};
+
+struct EastConstBuffer {
+  // Decides the language and where quoted includes are found; need not
+  // exist.
+  std::string FileName;
+  std::string Code;
+};
+
+struct EastConstRewriteResult {
+  // Whether the buffer parsed. Otherwise Code is the input and Edits is
+  // empty.
+  bool Success = false;
+  std::string Code;
+  // Relative to the input buffer.
+  std::vector<clang::tooling::Replacement> Edits;
+};
+
+struct EastConstRewriterStats {
+  unsigned Buffers = 0;
+  unsigned Failed = 0;
+  // Buffers that went through the driver to build their invocation; the
+  // rest copied one built earlier.
+  unsigned DriverRuns = 0;
+};
+
+// Rewrites source buffers in process, for callers with many small inputs
+// (code generators). The context outlives the buffers: each thread's parse
+// context runs the driver once and then only copies the invocation it
+// built and swaps the main buffer, keeping its FileManager, and headers
+// are read from disk (or the mapped files) once for all threads, so a
+// header changed on disk afterwards is not seen until the cache starts
+// over (see CacheEntryLimit). Nothing is written.
+class EastConstRewriter {
+public:
+  explicit EastConstRewriter(EastConstRewriterOptions Options = {});
+  ~EastConstRewriter();
+  EastConstRewriter(const EastConstRewriter &) = delete;
+  EastConstRewriter &operator=(const EastConstRewriter &) = delete;
+
+  // Makes Contents visible at Path (relative to Options.Directory) to every
+  // buffer parsed afterwards, e.g. a header the generator has not written
+  // out. Contexts that may have looked for Path are retired, including the
+  // ones in use. Must not run while a buffer is being parsed: the mapped
+  // files are read without a lock.
+  void mapFile(llvm::StringRef Path, llvm::StringRef Contents);
+
+  // Rewrites Code as the contents of FileName. Thread-safe.
+  EastConstRewriteResult rewrite(llvm::StringRef FileName,
+                                 llvm::StringRef Code);
+  // Rewrites Inputs on Jobs threads (0 uses every core); results are in
+  // input order.
+  std::vector<EastConstRewriteResult>
+  rewriteAll(llvm::ArrayRef<EastConstBuffer> Inputs, unsigned Jobs = 0);
+
+  EastConstRewriterStats getStats() const;
+
+private:
+  struct Context;
+
+  std::unique_ptr<Context> acquire();
+  void release(std::unique_ptr<Context> Released);
+  std::string absolutePath(llvm::StringRef FileName) const;
+
+  EastConstRewriterOptions Options;
+  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> Mapped;
+  std::mutex Lock;
+  // Guarded by Lock. Contexts share the cache of the generation they were
+  // created in and keep it alive; one from an older generation is dropped
+  // when released.
+  std::shared_ptr<EastConstFileSystemCache> Cache;
+  unsigned Generation = 0;
+  // Parse contexts not in use; one per thread that rewrote concurrently.
+  std::vector<std::unique_ptr<Context>> Idle;
+  std::atomic<unsigned> Buffers{0};
+  std::atomic<unsigned> Failed{0};
+  std::atomic<unsigned> DriverRuns{0};
+};
+
+#endif // EAST_CONST_REWRITER_H
@@ -0,0 +1,70 @@
+#ifndef EAST_CONST_SAMPLING_H
+#define EAST_CONST_SAMPLING_H
+
+#include <EastConstEnforcer.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How many files to sample: a fraction of the population ("0.05" or "5%")
+// or a fixed count ("200").
+struct EastConstSampleSize {
+  double Fraction = 0;
+  unsigned Count = 0;
+
+  // Files to sample out of Population; at least one unless it is empty.
+  std::size_t resolve(std::size_t Population) const;
+};
+
+bool parseEastConstSampleSize(llvm::StringRef Spec, EastConstSampleSize &Size);
+
+// The stratum of File: its first path component below Root, or "." for
+// files directly in Root.
+std::string getEastConstSampleStratum(llvm::StringRef File,
+                                      llvm::StringRef Root);
+// Deepest directory containing every one of Files (absolute paths).
+std::string getEastConstCommonDirectory(llvm::ArrayRef<std::string> Files);
+
+// Picks Size of Files, stratified by Strata (parallel to Files). Each
+// stratum gets two files when Size allows, so its variance can be
+// estimated, and the rest in proportion to its size. Within a stratum,
+// files are taken in an order fixed by Seed and each file's path, so a
+// sample depends only on the seed and the files, not on their order.
+// Returns indices into Files in ascending order.
+std::vector<std::size_t>
+pickEastConstStratifiedSample(llvm::ArrayRef<std::string> Files,
+                              llvm::ArrayRef<std::string> Strata,
+                              std::size_t Size, std::uint64_t Seed);
+
+struct EastConstStratumSample {
+  std::string Name;
+  std::size_t Population = 0;
+  // Site counts of each sampled file that parsed.
+  std::vector<EastConstSiteCounts> Observations;
+};
+
+struct EastConstEstimate {
+  double Total = 0;
+  // Half-width of the confidence interval around Total.
+  double HalfWidth = 0;
+  // False when a stratum had too few parsed files to estimate its variance;
+  // HalfWidth then leaves that stratum out.
+  bool Bounded = true;
+};
+
+// Extrapolates the population total of Measure with the stratified
+// estimator: the sum of each stratum's mean times its size, with a normal
+// interval of Z standard errors (1.96 for 95%) that includes the finite
+// population correction, so a census has no uncertainty.
+EastConstEstimate estimateEastConstTotal(
+    llvm::ArrayRef<EastConstStratumSample> Strata,
+    llvm::function_ref<double(const EastConstSiteCounts &)> Measure,
+    double Z = 1.96);
+
+#endif // EAST_CONST_SAMPLING_H
@@ -0,0 +1,62 @@
+#ifndef EAST_CONST_TIMING_HISTORY_H
+#define EAST_CONST_TIMING_HISTORY_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Per-file parse and analysis times and peak memory from earlier runs, used
+// to start the slowest translation units first and to keep the memory of the
+// ones running within what the machine has. Stored as one
+// `<seconds>\t<peak-bytes>\t<path>` line per file (older files without the
+// peak column still load); unreadable lines are ignored so a damaged file
+// only costs the estimates it held.
+class EastConstTimingHistory {
+public:
+  // Loads Path if it exists. Returns false only when it exists but cannot
+  // be read.
+  bool load(llvm::StringRef Path);
+  // Writes every known entry, including files this run did not touch.
+  // Replaces Path atomically so a concurrent run never reads half a file.
+  bool save(llvm::StringRef Path) const;
+
+  std::optional<double> lookup(llvm::StringRef File) const;
+  // Additional memory the file needed at its peak, when it was measured.
+  std::optional<std::uint64_t> lookupPeakBytes(llvm::StringRef File) const;
+  // Thread-safe; called by workers as they finish files. A PeakBytes of 0
+  // (not measured) keeps the peak recorded earlier.
+  void record(llvm::StringRef File, double Seconds,
+              std::uint64_t PeakBytes = 0);
+
+  std::size_t size() const;
+
+private:
+  struct Entry {
+    double Seconds = 0;
+    std::uint64_t PeakBytes = 0;
+  };
+
+  mutable std::mutex Lock;
+  llvm::StringMap<Entry> Entries;
+};
+
+// Relative parse cost of a file nobody has timed yet, from its size and
+// #include count. Only the ratio between files matters; the scheduler
+// scales it by what timed files cost per unit.
+double estimateEastConstParseCost(llvm::StringRef Code);
+
+// Expected seconds for each of Files (absolute paths): the recorded time
+// when there is one, otherwise the file's estimated cost scaled by what the
+// timed files cost per unit. Timed receives how many came from History.
+std::vector<double>
+expectEastConstParseSeconds(llvm::ArrayRef<std::string> Files,
+                            const EastConstTimingHistory &History,
+                            unsigned &Timed);
+
+#endif // EAST_CONST_TIMING_HISTORY_H
@@ -0,0 +1,118 @@
+#ifndef EAST_CONST_VERIFY_H
+#define EAST_CONST_VERIFY_H
+
+#include <EastConstEnforcer.h>
+#include <EastConstFrontend.h>
+
+#include <clang/AST/ASTContext.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Core/Replacement.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/ThreadPool.h>
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A declaration written in the main file and the canonical type it has.
+struct EastConstDeclType {
+  // Qualified name; empty for unnamed parameters.
+  std::string Name;
+  std::string Type;
+  // Main-file offsets of the first and last token.
+  unsigned Begin = 0;
+  unsigned End = 0;
+};
+
+// The variables, parameters, fields, functions, typedefs, aliases,
+// non-type template parameters and explicit specializations written in
+// Context's main file, in traversal order.
+std::vector<EastConstDeclType>
+collectEastConstDeclTypes(clang::ASTContext &Context);
+
+// Records collectEastConstDeclTypes() for every translation unit Finder
+// runs on, keyed by the main file's absolute path, so a verification can
+// compare against the AST the fixes were built from.
+class EastConstDeclTypeRecorder
+    : public clang::ast_matchers::MatchFinder::MatchCallback {
+public:
+  void run(const clang::ast_matchers::MatchFinder::MatchResult &Result)
+      override;
+  // Hands over and forgets what was recorded for File.
+  std::optional<std::vector<EastConstDeclType>> take(llvm::StringRef File);
+
+private:
+  std::map<std::string, std::vector<EastConstDeclType>> Recorded;
+};
+
+void registerEastConstDeclTypeRecorder(
+    clang::ast_matchers::MatchFinder &Finder,
+    EastConstDeclTypeRecorder *Recorder);
+
+struct EastConstVerification {
+  std::string File;
+  // Whether the fixed file compiled.
+  bool Reparsed = false;
+  // Declarations that contain a fix and whose types were compared.
+  unsigned Compared = 0;
+  std::vector<std::string> Mismatches;
+  // Replacements a second pass over the fixed file still produced.
+  unsigned Leftover = 0;
+
+  bool passed() const {
+    return Reparsed && Mismatches.empty() && Leftover == 0;
+  }
+};
+
+// Applies Fix to File in memory, reparses the result through an overlay
+// file system (nothing is written) and checks that every declaration
+// containing a fix kept its canonical type and that the checker finds
+// nothing more to fix. Each compile command of File is checked on its own,
+// before against after; configurations the original does not compile in
+// are skipped. Original is the declarations of the AST the fix was built
+// from, used when File has a single compile command; otherwise the file on
+// disk is parsed again.
+EastConstVerification verifyEastConstFix(
+    const clang::tooling::CompilationDatabase &Compilations,
+    llvm::StringRef File, llvm::ArrayRef<clang::tooling::Replacement> Fix,
+    const EastConstCheckerOptions &CheckerOptions,
+    const EastConstFrontendOptions &FrontendOptions,
+    const std::vector<EastConstDeclType> *Original = nullptr);
+
+// Runs verifyEastConstFix() on its own threads, so files are verified while
+// the rest of the run is still parsing.
+class EastConstVerifier {
+public:
+  EastConstVerifier(const clang::tooling::CompilationDatabase &Compilations,
+                    const EastConstCheckerOptions &CheckerOptions,
+                    const EastConstFrontendOptions &FrontendOptions,
+                    unsigned Jobs);
+  EastConstVerifier(const EastConstVerifier &) = delete;
+  EastConstVerifier &operator=(const EastConstVerifier &) = delete;
+
+  // Thread-safe. A file submitted before is not verified again.
+  void submit(llvm::StringRef File,
+              std::vector<clang::tooling::Replacement> Fix,
+              std::optional<std::vector<EastConstDeclType>> Original =
+                  std::nullopt);
+  bool isSubmitted(llvm::StringRef File) const;
+  // Waits for every submitted file; results are ordered by path.
+  std::vector<EastConstVerification> wait();
+
+private:
+  const clang::tooling::CompilationDatabase &Compilations;
+  EastConstCheckerOptions CheckerOptions;
+  EastConstFrontendOptions FrontendOptions;
+  llvm::DefaultThreadPool Pool;
+  mutable std::mutex Lock;
+  llvm::StringSet<> Submitted;
+  std::vector<EastConstVerification> Results;
+};
+
+#endif // EAST_CONST_VERIFY_H
@@ -0,0 +1,162 @@
+#ifndef EAST_CONST_WATCH_H
+#define EAST_CONST_WATCH_H
+
+#include <EastConstEnforcer.h>
+#include <EastConstFrontend.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Whether this platform can watch files for changes (inotify).
+bool isEastConstFileWatchSupported();
+
+// Reports writes, creations, deletions and renames of a set of files. It
+// watches their directories rather than the files themselves, since editors
+// and build tools often replace a file by renaming a new one over it.
+class EastConstFileWatcher {
+public:
+  EastConstFileWatcher();
+  ~EastConstFileWatcher();
+  EastConstFileWatcher(const EastConstFileWatcher &) = delete;
+  EastConstFileWatcher &operator=(const EastConstFileWatcher &) = delete;
+
+  bool isValid() const { return FD >= 0; }
+  // Watches Files (absolute paths) too. Returns false if a directory could
+  // not be watched.
+  bool watch(llvm::ArrayRef<std::string> Files);
+  // Blocks until a watched file changes, then keeps collecting changes
+  // until none arrived for Settle, so one save (or a build writing many
+  // headers) is reported once. Returns the changed files, sorted, or
+  // nothing once *Stop is set.
+  std::vector<std::string> wait(std::chrono::milliseconds Settle,
+                                const std::atomic<bool> *Stop = nullptr);
+
+private:
+  // Adds the watched files events name to Changed; false if events were
+  // lost and every file has to be assumed changed.
+  bool drain(std::set<std::string> &Changed);
+
+  int FD = -1;
+  // Watch descriptor to directory.
+  std::map<int, std::string> Directories;
+  llvm::StringSet<> WatchedDirectories;
+  llvm::StringSet<> Files;
+};
+
+// Which translation units read which files, as the preprocessor saw them on
+// their last parse.
+class EastConstDependencyGraph {
+public:
+  // Replaces what Source read. Thread-safe.
+  void record(llvm::StringRef Source, llvm::ArrayRef<std::string> Files);
+  // The sources whose last parse read any of Changed, sorted.
+  std::vector<std::string>
+  affected(llvm::ArrayRef<std::string> Changed) const;
+  // Every file some source read, sorted.
+  std::vector<std::string> files() const;
+
+private:
+  mutable std::mutex Lock;
+  std::map<std::string, std::vector<std::string>> Reads;
+  std::map<std::string, std::set<std::string>> ReadBy;
+};
+
+struct EastConstWatchOptions {
+  // Worker threads per round; 0 uses every core.
+  unsigned Jobs = 0;
+  // Write each round's fixes to the files, as -fix does. The change events
+  // of those writes are ignored.
+  bool Fix = false;
+  // How long the files must stay unchanged before a round starts.
+  std::chrono::milliseconds Settle{200};
+  // Rounds to run after the first before returning; 0 runs until *Stop is
+  // set.
+  unsigned MaxRounds = 0;
+  const std::atomic<bool> *Stop = nullptr;
+};
+
+struct EastConstWatchStats {
+  unsigned Rounds = 0;
+  // Parses over all rounds.
+  unsigned Analyzed = 0;
+  // Of the latest results of every source, cached or not.
+  unsigned Sites = 0;
+  unsigned FilesWithSites = 0;
+  unsigned Failed = 0;
+};
+
+// The state --watch keeps between rounds: every source's latest sites and
+// the files its last parse read. A round parses only the sources it is
+// given and keeps every other source's results.
+class EastConstWatchSession {
+public:
+  EastConstWatchSession(
+      const clang::tooling::CompilationDatabase &Compilations,
+      llvm::ArrayRef<std::string> Sources,
+      const EastConstCheckerOptions &CheckerOptions,
+      const EastConstFrontendOptions &FrontendOptions,
+      const EastConstWatchOptions &Options, llvm::raw_ostream &Out);
+  EastConstWatchSession(const EastConstWatchSession &) = delete;
+  EastConstWatchSession &operator=(const EastConstWatchSession &) = delete;
+
+  const std::vector<std::string> &sources() const { return Sources; }
+  // Parses Sources (absolute paths), replacing their results, writes their
+  // fixes when asked to, and prints their sites and the totals. Returns
+  // false if one did not parse.
+  bool analyze(llvm::ArrayRef<std::string> Sources);
+  // The sources that read one of Changed or are one of them, sorted.
+  std::vector<std::string>
+  affected(llvm::ArrayRef<std::string> Changed) const;
+  // Drops from Changed the files that still hold what applyFixes wrote to
+  // them, so -fix does not trigger a round of its own.
+  void dropOwnWrites(std::vector<std::string> &Changed);
+  // Every source and every file a source read.
+  std::vector<std::string> watchedFiles() const;
+  EastConstWatchStats getStats() const;
+
+private:
+  struct Result {
+    bool Success = true;
+    std::vector<EastConstSite> Sites;
+  };
+
+  void applyFixes(llvm::ArrayRef<std::string> Sources);
+
+  const clang::tooling::CompilationDatabase &Compilations;
+  std::vector<std::string> Sources;
+  EastConstCheckerOptions CheckerOptions;
+  EastConstFrontendOptions FrontendOptions;
+  EastConstWatchOptions Options;
+  llvm::raw_ostream &Out;
+  EastConstDependencyGraph Dependencies;
+  std::map<std::string, Result> Results;
+  // xxh3 of what applyFixes last wrote to each file.
+  std::map<std::string, uint64_t> Written;
+  unsigned Rounds = 0;
+  unsigned Analyzed = 0;
+};
+
+// Analyzes Sources, then watches them and every header they include, and
+// re-analyzes just the sources a change reaches, printing each round to
+// Out. Returns when Options.MaxRounds is reached or *Options.Stop is set.
+int runEastConstWatch(const clang::tooling::CompilationDatabase &Compilations,
+                      llvm::ArrayRef<std::string> Sources,
+                      const EastConstCheckerOptions &CheckerOptions,
+                      const EastConstFrontendOptions &FrontendOptions,
+                      const EastConstWatchOptions &Options,
+                      llvm::raw_ostream &Out);
+
+#endif // EAST_CONST_WATCH_H
@@ -0,0 +1,476 @@
+#include <EastConstAstEngine.h>
+#include <EastConstFileSystemCache.h>
+#include <EastConstFrontend.h>
+#include <EastConstLogging.h>
+#include <EastConstMemoryGovernor.h>
+#include <EastConstTimingHistory.h>
+
+#include <clang/Driver/ToolChain.h>
+#include <clang/Driver/Types.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/PCHContainerOperations.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+std::string absolutePath(StringRef Directory, StringRef Path) {
+  SmallString<256> Result(Path);
+  if (!sys::path::is_absolute(Result)) {
+    Result = Directory;
+    sys::path::append(Result, Path);
+  }
+  sys::fs::make_absolute(Result);
+  sys::path::remove_dots(Result, /*remove_dot_dot=*/true);
+  return Result.str().str();
+}
+
+// Flags that only change code generation or diagnostics. They still
+// define a few macros (__OPTIMIZE__, __PIC__, __PIE__), but declarations
+// do not depend on those in practice, so configurations differing only here
+// are parsed once.
+bool isCodeGenOnlyFlag(StringRef Flag) {
+  if (Flag.starts_with("-W"))
+    return !Flag.starts_with("-Wp,");
+  return Flag.starts_with("-O") || Flag.starts_with("-g") ||
+         Flag.starts_with("-fvisibility") ||
+         Flag.starts_with("-fstack-protector") ||
+         Flag.starts_with("-fdiagnostics-") ||
+         llvm::is_contained({"-fPIC", "-fpic", "-fPIE", "-fpie", "-fno-pic",
+                             "-fno-pie", "-fno-PIC", "-fno-PIE", "-pipe",
+                             "-ffunction-sections", "-fdata-sections",
+                             "-fomit-frame-pointer", "-fno-omit-frame-pointer",
+                             "-fcolor-diagnostics", "-fno-color-diagnostics"},
+                            Flag);
+}
+
+// Identifies what the preprocessor and parser see for one compile: the
+// file, and the flags with code-generation-only options dropped and
+// include paths made absolute, so the same configuration spelled from two
+// build directories matches.
+std::string effectiveConfigurationKey(const CompileCommand &Command) {
+  static constexpr StringRef PathFlags[] = {
+      "-I", "-isystem", "-iquote", "-idirafter", "-include", "-imacros",
+      "-include-pch", "-isysroot", "--sysroot"};
+  std::string Key = absolutePath(Command.Directory, Command.Filename);
+  Key += '\1';
+  std::vector<std::string> Flags = normalizeEastConstCompileFlags(Command);
+  for (std::size_t I = 0; I < Flags.size(); ++I) {
+    StringRef Flag = Flags[I];
+    if (isCodeGenOnlyFlag(Flag))
+      continue;
+    bool Joined = false;
+    for (StringRef PathFlag : PathFlags) {
+      if (Flag == PathFlag && I + 1 < Flags.size()) {
+        Key += Flag.str() + '\0' +
+               absolutePath(Command.Directory, Flags[++I]) + '\0';
+        Joined = true;
+        break;
+      }
+      if (PathFlag == "-I" && Flag.starts_with("-I") && Flag.size() > 2) {
+        Key += "-I" + absolutePath(Command.Directory, Flag.drop_front(2)) +
+               '\0';
+        Joined = true;
+        break;
+      }
+    }
+    if (!Joined)
+      Key += Flag.str() + '\0';
+  }
+  return Key;
+}
+
+struct WorkItem {
+  std::string Source;
+  // Absent when the database has no command for Source; ClangTool then
+  // reports the error as usual.
+  std::optional<CompileCommand> Command;
+  // Index into the invocation groups, or NoGroup for files that go
+  // through the driver on their own.
+  std::size_t Group;
+  std::string InputArgument;
+  // Absolute path; the timing history key.
+  std::string File;
+  double ExpectedSeconds = 0;
+};
+
+constexpr std::size_t NoGroup = static_cast<std::size_t>(-1);
+
+// A group a worker built an invocation for. The ClangTool is kept alive
+// because it owns the FileManager the group's files share.
+struct PooledGroup {
+  std::size_t Group = NoGroup;
+  // ClangTool keeps a reference to its database.
+  std::unique_ptr<CompilationDatabase> Compilations;
+  std::unique_ptr<ClangTool> Tool;
+  std::shared_ptr<CompilerInvocation> Invocation;
+  FileManager *Files = nullptr;
+  DiagnosticConsumer *DiagConsumer = nullptr;
+};
+
+std::vector<WorkItem> planWorkItems(const CompilationDatabase &Compilations,
+                                    ArrayRef<std::string> Sources,
+                                    const EastConstAstEngineOptions &Options,
+                                    EastConstAstEngineStats &Stats) {
+  std::vector<WorkItem> Items;
+  StringSet<> SeenSources;
+  StringSet<> SeenConfigurations;
+  StringMap<std::size_t> GroupIndex;
+  std::vector<unsigned> GroupSizes;
+  for (const std::string &Source : Sources) {
+    if (Options.DeduplicateConfigurations &&
+        !SeenSources.insert(absolutePath(".", Source)).second) {
+      ++Stats.DuplicateSources;
+      continue;
+    }
+    std::vector<CompileCommand> Commands =
+        Compilations.getCompileCommands(Source);
+    if (Commands.empty()) {
+      Items.push_back({Source, std::nullopt, NoGroup, std::string(),
+                       absolutePath(".", Source)});
+      continue;
+    }
+    // Build systems list a file once per target or variant; each distinct
+    // configuration is parsed once, the rest would only repeat its edits.
+    for (CompileCommand &Command : Commands) {
+      if (Options.DeduplicateConfigurations &&
+          !SeenConfigurations.insert(effectiveConfigurationKey(Command))
+               .second) {
+        ++Stats.DuplicateCommands;
+        continue;
+      }
+      WorkItem Item{Source, std::nullopt, NoGroup,
+                    eastConstInputArgument(Command),
+                    absolutePath(Command.Directory, Command.Filename)};
+      if (Options.PoolInvocations) {
+        // A pooled invocation keeps its driver's defaults and language, so
+        // a C and a C++ file with the same flags must not share one.
+        std::string Key = Command.Directory + '\1' +
+                          (Command.CommandLine.empty()
+                               ? std::string()
+                               : Command.CommandLine.front()) +
+                          '\1' + eastConstInputLanguage(Command) + '\1';
+        for (const std::string &Flag :
+             normalizeEastConstCompileFlags(Command))
+          Key += Flag + '\0';
+        auto Inserted = GroupIndex.try_emplace(Key, GroupSizes.size());
+        if (Inserted.second)
+          GroupSizes.push_back(0);
+        Item.Group = Inserted.first->second;
+        ++GroupSizes[Item.Group];
+      }
+      Item.Command = std::move(Command);
+      Items.push_back(std::move(Item));
+    }
+  }
+
+  // Singleton groups gain nothing from pooling.
+  for (WorkItem &Item : Items)
+    if (Item.Group != NoGroup && GroupSizes[Item.Group] < 2)
+      Item.Group = NoGroup;
+  Stats.InvocationGroups =
+      std::count_if(GroupSizes.begin(), GroupSizes.end(),
+                    [](unsigned Size) { return Size >= 2; });
+
+  if (!Options.History) {
+    // Keep each group's files together so a worker mostly reuses the one
+    // invocation it pooled.
+    std::stable_sort(Items.begin(), Items.end(),
+                     [](const WorkItem &A, const WorkItem &B) {
+                       return A.Group < B.Group;
+                     });
+    return Items;
+  }
+
+  // Longest expected first: the queue is shared, so whichever worker frees
+  // up takes the next most expensive file and the short ones fill the
+  // tail.
+  std::vector<std::string> Files;
+  for (const WorkItem &Item : Items)
+    Files.push_back(Item.File);
+  std::vector<double> Expected =
+      expectEastConstParseSeconds(Files, *Options.History, Stats.TimedUnits);
+  // The history holds each file's time over all its configurations.
+  StringMap<unsigned> Configurations;
+  for (const std::string &File : Files)
+    ++Configurations[File];
+  for (std::size_t I = 0; I < Items.size(); ++I)
+    Items[I].ExpectedSeconds = Expected[I] / Configurations[Files[I]];
+  std::stable_sort(Items.begin(), Items.end(),
+                   [](const WorkItem &A, const WorkItem &B) {
+                     return A.ExpectedSeconds > B.ExpectedSeconds;
+                   });
+  return Items;
+}
+
+} // namespace
+
+std::vector<std::string>
+normalizeEastConstCompileFlags(const CompileCommand &Command) {
+  const std::string Input =
+      absolutePath(Command.Directory, Command.Filename);
+  std::vector<std::string> Flags;
+  const std::vector<std::string> &Args = Command.CommandLine;
+  for (std::size_t I = 1; I < Args.size(); ++I) {
+    StringRef Arg = Args[I];
+    if (Arg == "-o" || Arg == "-MF" || Arg == "-MT" || Arg == "-MQ") {
+      ++I;
+      continue;
+    }
+    if (Arg == "-c" || Arg == "-MD" || Arg == "-MMD" || Arg == "--" ||
+        Arg == "-fsyntax-only")
+      continue;
+    if (!Arg.starts_with("-") &&
+        absolutePath(Command.Directory, Arg) == Input)
+      continue;
+    Flags.push_back(Arg.str());
+  }
+  return Flags;
+}
+
+std::string eastConstInputArgument(const CompileCommand &Command) {
+  const std::string Input =
+      absolutePath(Command.Directory, Command.Filename);
+  for (std::size_t I = Command.CommandLine.size(); I-- > 1;) {
+    StringRef Arg = Command.CommandLine[I];
+    if (!Arg.starts_with("-") &&
+        absolutePath(Command.Directory, Arg) == Input)
+      return Arg.str();
+  }
+  return Command.Filename;
+}
+
+std::string eastConstInputLanguage(const CompileCommand &Command) {
+  namespace types = clang::driver::types;
+  const std::vector<std::string> &Args = Command.CommandLine;
+  bool CXXDriver = false;
+  if (!Args.empty()) {
+    const char *Mode = clang::driver::ToolChain::
+                           getTargetAndModeFromProgramName(Args.front())
+                               .DriverMode;
+    CXXDriver = Mode && StringRef(Mode) == "--driver-mode=g++";
+  }
+  types::ID Type = types::TY_INVALID;
+  for (std::size_t I = 1; I < Args.size(); ++I) {
+    StringRef Arg = Args[I];
+    if (Arg == "-x" && I + 1 < Args.size())
+      Type = types::lookupTypeForTypeSpecifier(Args[++I].c_str());
+    else if (Arg.starts_with("-x") && Arg.size() > 2)
+      Type = types::lookupTypeForTypeSpecifier(Arg.data() + 2);
+    else if (Arg.consume_front("--driver-mode="))
+      CXXDriver = Arg == "g++";
+  }
+  if (Type == types::TY_INVALID) {
+    StringRef Extension = sys::path::extension(Command.Filename);
+    Extension.consume_front(".");
+    Type = types::lookupTypeForExtension(Extension);
+    if (CXXDriver && Type == types::TY_C)
+      Type = types::TY_CXX;
+    else if (CXXDriver && Type == types::TY_CHeader)
+      Type = types::TY_CXXHeader;
+  }
+  return Type == types::TY_INVALID ? std::string()
+                                   : std::string(types::getTypeName(Type));
+}
+
+int runEastConstAstEngine(const CompilationDatabase &Compilations,
+                          ArrayRef<std::string> Sources,
+                          const EastConstAstEngineOptions &Options,
+                          const EastConstWorkerFactory &FactoryFor,
+                          EastConstAstEngineStats &Stats) {
+  std::vector<WorkItem> Items =
+      planWorkItems(Compilations, Sources, Options, Stats);
+  // Headers are what workers share; keeping every main file as well would
+  // hold the whole project in memory until the run ends.
+  if (Options.FileSystemCache)
+    for (const WorkItem &Item : Items)
+      Options.FileSystemCache->skipContents(Item.File);
+  unsigned Workers =
+      hardware_concurrency(Options.Jobs).compute_thread_count();
+  Workers = std::max(1u, std::min<unsigned>(Workers, Items.size()));
+  Stats.Workers = Workers;
+  Stats.TranslationUnits = Items.size();
+
+  std::vector<FrontendActionFactory *> Factories;
+  for (unsigned Worker = 0; Worker < Workers; ++Worker)
+    Factories.push_back(&FactoryFor(Worker));
+
+  std::atomic<std::size_t> Next{0};
+  std::atomic<unsigned> Failed{0};
+  std::atomic<unsigned> DriverRuns{0};
+  std::atomic<unsigned> PooledUnits{0};
+  std::atomic<std::uint64_t> BusyMicroseconds{0};
+  std::atomic<unsigned> Unstarted{0};
+
+  // Configurations of each file still to parse, so OnFileDone fires and
+  // the history records the summed time once per file.
+  std::vector<std::size_t> FileOf(Items.size());
+  std::vector<std::atomic<unsigned>> Remaining;
+  std::vector<std::atomic<bool>> FileFailed;
+  std::vector<std::atomic<std::uint64_t>> FileMicroseconds;
+  if (Options.OnFileDone || Options.History) {
+    StringMap<std::size_t> FileIds;
+    for (std::size_t I = 0; I < Items.size(); ++I)
+      FileOf[I] = FileIds.try_emplace(Items[I].File, FileIds.size())
+                      .first->getValue();
+    Remaining = std::vector<std::atomic<unsigned>>(FileIds.size());
+    FileFailed = std::vector<std::atomic<bool>>(FileIds.size());
+    FileMicroseconds =
+        std::vector<std::atomic<std::uint64_t>>(FileIds.size());
+    for (std::size_t File : FileOf)
+      ++Remaining[File];
+  }
+
+  std::optional<EastConstMemoryGovernor> Governor;
+  if (Options.Memory) {
+    // Workers share this process, so whatever it gained since the start is
+    // attributed to the files in flight.
+    std::uint64_t Baseline = getEastConstResidentBytes();
+    Governor.emplace(*Options.Memory, [Baseline] {
+      std::uint64_t Now = getEastConstResidentBytes();
+      return Now > Baseline ? Now - Baseline : 0;
+    });
+  }
+  auto RunWorker = [&](unsigned Worker) {
+    // ClangTool sets the working directory of its file system for each
+    // compile command; the physical file system keeps it per instance
+    // instead of calling chdir on the whole process.
+    IntrusiveRefCntPtr<vfs::FileSystem> FS =
+        Options.FileSystemCache
+            ? createEastConstCachingFileSystem(*Options.FileSystemCache)
+            : IntrusiveRefCntPtr<vfs::FileSystem>(
+                  vfs::createPhysicalFileSystem());
+    auto PCHContainerOps = std::make_shared<PCHContainerOperations>();
+    FrontendActionFactory &Factory = *Factories[Worker];
+    // Cost ordering interleaves groups, so each worker keeps the few it
+    // used most recently, least recently used first.
+    constexpr std::size_t MaxPooledGroups = 8;
+    std::vector<PooledGroup> PooledGroups;
+
+    for (std::size_t I = Next++; I < Items.size(); I = Next++) {
+      const WorkItem &Item = Items[I];
+      if ((Options.Stop && *Options.Stop) ||
+          (Options.Deadline &&
+           std::chrono::steady_clock::now() >= *Options.Deadline)) {
+        ++Unstarted;
+        continue;
+      }
+      std::uint64_t ExpectedBytes = 0;
+      if (Governor) {
+        ExpectedBytes = Governor->expectedBytes(
+            Options.History ? Options.History->lookupPeakBytes(Item.File)
+                            : std::nullopt);
+        Governor->start(ExpectedBytes);
+      }
+      auto ItemStart = std::chrono::steady_clock::now();
+      auto PooledIt = std::find_if(
+          PooledGroups.begin(), PooledGroups.end(),
+          [&](const PooledGroup &Pooled) {
+            return Item.Group != NoGroup && Pooled.Group == Item.Group;
+          });
+      bool Success;
+      if (PooledIt != PooledGroups.end()) {
+        PooledGroup &Pooled = *PooledIt;
+        // Same flags and directory as the pooled file: copy its invocation
+        // and swap the main file.
+        Success = runEastConstInvocationFor(
+            Factory, *Pooled.Invocation, Item.InputArgument,
+            Item.Command->Directory, Pooled.Files, PCHContainerOps,
+            Pooled.DiagConsumer);
+        ++PooledUnits;
+        std::rotate(PooledIt, std::next(PooledIt), PooledGroups.end());
+      } else {
+        std::unique_ptr<CompilationDatabase> ItemCompilations;
+        if (Item.Command)
+          ItemCompilations =
+              std::make_unique<EastConstSingleCommandDatabase>(*Item.Command);
+        auto Tool = std::make_unique<ClangTool>(
+            ItemCompilations ? *ItemCompilations : Compilations,
+            ArrayRef<std::string>(Item.Source), PCHContainerOps, FS);
+        EastConstCapturingFactory Capture(Factory);
+        Success = Tool->run(&Capture) == 0;
+        ++DriverRuns;
+        // The driver may have failed before building an invocation; then
+        // the next file of the group tries again.
+        if (Item.Group != NoGroup && Capture.captured()) {
+          if (PooledGroups.size() == MaxPooledGroups)
+            PooledGroups.erase(PooledGroups.begin());
+          PooledGroup &Pooled = PooledGroups.emplace_back();
+          Pooled.Group = Item.Group;
+          Pooled.Tool = std::move(Tool);
+          Pooled.Compilations = std::move(ItemCompilations);
+          Pooled.Invocation = std::move(Capture.Captured);
+          Pooled.Files = Capture.CapturedFiles;
+          Pooled.DiagConsumer = Capture.CapturedDiagConsumer;
+        }
+      }
+      if (Governor)
+        Governor->finish(ExpectedBytes);
+      double ItemSeconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - ItemStart)
+                               .count();
+      std::uint64_t ItemMicroseconds =
+          static_cast<std::uint64_t>(ItemSeconds * 1e6);
+      BusyMicroseconds += ItemMicroseconds;
+      if (!Success) {
+        ++Failed;
+        EAST_CONST_LOG(Debug, "Worker " << Worker << " failed on "
+                                        << Item.Source);
+      }
+      if (Options.OnFileDone || Options.History) {
+        std::size_t File = FileOf[I];
+        if (!Success)
+          FileFailed[File] = true;
+        FileMicroseconds[File] += ItemMicroseconds;
+        if (--Remaining[File] == 0) {
+          if (Options.History)
+            Options.History->record(Item.File,
+                                    FileMicroseconds[File] / 1e6);
+          if (Options.OnFileDone)
+            Options.OnFileDone(Worker, Item.Source, Item.File,
+                               !FileFailed[File]);
+        }
+      }
+    }
+  };
+
+  auto Start = std::chrono::steady_clock::now();
+  if (Workers == 1) {
+    RunWorker(0);
+  } else {
+    DefaultThreadPool Pool(hardware_concurrency(Workers));
+    for (unsigned Worker = 0; Worker < Workers; ++Worker)
+      Pool.async([&RunWorker, Worker] { RunWorker(Worker); });
+    Pool.wait();
+  }
+  Stats.Seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - Start)
+          .count();
+  Stats.Failed = Failed;
+  Stats.DriverRuns = DriverRuns;
+  Stats.PooledUnits = PooledUnits;
+  Stats.BusySeconds = BusyMicroseconds / 1e6;
+  Stats.Unstarted = Unstarted;
+  if (Governor)
+    Stats.MemoryThrottled = Governor->getStats().Throttled;
+  return Stats.Failed == 0 ? 0 : 1;
+}
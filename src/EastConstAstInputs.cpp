@@ -0,0 +1,101 @@
+#include <EastConstAstInputs.h>
+#include <EastConstLogging.h>
+
+#include <clang/Basic/Diagnostic.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+std::string outputOf(const CompileCommand &Command) {
+  if (!Command.Output.empty())
+    return Command.Output;
+  const std::vector<std::string> &Args = Command.CommandLine;
+  for (std::size_t I = 0; I + 1 < Args.size(); ++I)
+    if (Args[I] == "-o")
+      return Args[I + 1];
+  for (const std::string &Arg : Args)
+    if (StringRef(Arg).starts_with("-o") && Arg.size() > 2 &&
+        !StringRef(Arg).starts_with("-objc"))
+      return Arg.substr(2);
+  return std::string();
+}
+
+} // namespace
+
+bool isEastConstAstFile(StringRef Path) {
+  return sys::path::extension(Path) == ".ast";
+}
+
+std::string findBuildAstFor(const CompilationDatabase &Compilations,
+                            StringRef Source) {
+  for (const CompileCommand &Command :
+       Compilations.getCompileCommands(Source)) {
+    std::string Output = outputOf(Command);
+    if (Output.empty())
+      continue;
+    SmallString<256> Object(Output);
+    if (!sys::path::is_absolute(Object)) {
+      Object = Command.Directory;
+      sys::path::append(Object, Output);
+    }
+
+    SmallString<256> Replaced(Object);
+    sys::path::replace_extension(Replaced, "ast");
+    if (sys::fs::exists(Replaced))
+      return Replaced.str().str();
+    SmallString<256> Appended(Object);
+    Appended += ".ast";
+    if (sys::fs::exists(Appended))
+      return Appended.str().str();
+  }
+  return std::string();
+}
+
+int runEastConstAstInputs(ArrayRef<EastConstAstInput> Inputs,
+                          const CompilationDatabase &Compilations,
+                          FrontendActionFactory &Factory,
+                          EastConstAstStats &Stats) {
+  int Status = 0;
+  for (const EastConstAstInput &Input : Inputs) {
+    // Language and target options come from the AST itself; the driver only
+    // needs to see an AST input. An input file whose size or modification
+    // time changed still counts as unchanged if the content hash the AST
+    // recorded for it matches.
+    FixedCompilationDatabase AstCompilations(
+        sys::path::parent_path(Input.AstPath),
+        std::vector<std::string>{"-fvalidate-ast-input-files-content"});
+    ClangTool Tool(AstCompilations, {Input.AstPath});
+    IgnoringDiagConsumer Quiet;
+    if (!Input.SourcePath.empty())
+      Tool.setDiagnosticConsumer(&Quiet);
+
+    if (Tool.run(&Factory) == 0) {
+      ++Stats.Loaded;
+      EAST_CONST_LOG(Debug, "Checked serialized AST " << Input.AstPath);
+      continue;
+    }
+
+    ++Stats.Stale;
+    if (Input.SourcePath.empty()) {
+      EAST_CONST_LOG(Error, "Cannot use " << Input.AstPath
+                                          << ": it is out of date with its "
+                                             "sources or unreadable");
+      Status = 1;
+      continue;
+    }
+
+    EAST_CONST_LOG(Info, "AST " << Input.AstPath << " is out of date; "
+                                << "reparsing " << Input.SourcePath);
+    ClangTool SourceTool(Compilations, {Input.SourcePath});
+    ++Stats.Reparsed;
+    if (SourceTool.run(&Factory) != 0)
+      Status = 1;
+  }
+  return Status;
+}
@@ -0,0 +1,202 @@
+#include <EastConstCheckpoint.h>
+#include <EastConstLogging.h>
+
+#include <clang/Tooling/ReplacementsYaml.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/YAMLTraits.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <map>
+#include <optional>
+#include <utility>
+
+#if LLVM_ON_UNIX
+#include <unistd.h>
+#endif
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+constexpr StringLiteral Magic = "east-const-checkpoint 2\n";
+
+// A record is "<xxh3 of the rest> <payload bytes> <kind> <file hash>\n"
+// followed by the payload. For "ok" and "failed" the payload is a
+// TranslationUnitReplacements document naming the file and the file hash
+// is of the file as parsed; for "applied" it is the file's path and the
+// hash is of the file as the fixes left it.
+std::string hashRecord(StringRef Kind, StringRef FileHash,
+                       StringRef Payload) {
+  return utohexstr(xxh3_64bits(Kind) ^ xxh3_64bits(FileHash) ^
+                       xxh3_64bits(Payload),
+                   /*LowerCase=*/true);
+}
+
+std::string makeRecord(StringRef Kind, std::uint64_t FileHash,
+                       StringRef Payload) {
+  std::string Hash = utohexstr(FileHash, /*LowerCase=*/true);
+  return hashRecord(Kind, Hash, Payload) + " " +
+         std::to_string(Payload.size()) + " " + Kind.str() + " " + Hash +
+         "\n" + Payload.str();
+}
+
+// Parses the record at the front of Rest and advances past it; false when
+// the record is incomplete or does not match its hash.
+bool readRecord(StringRef &Rest, StringRef &Kind, std::uint64_t &FileHash,
+                StringRef &Payload) {
+  auto [Header, Body] = Rest.split('\n');
+  if (Header.size() == Rest.size())
+    return false;
+  SmallVector<StringRef, 4> Fields;
+  Header.split(Fields, ' ');
+  std::size_t Size;
+  if (Fields.size() != 4 || Fields[1].getAsInteger(10, Size) ||
+      Fields[3].getAsInteger(16, FileHash) || Body.size() < Size)
+    return false;
+  Kind = Fields[2];
+  Payload = Body.take_front(Size);
+  if (hashRecord(Kind, Fields[3], Payload) != Fields[0])
+    return false;
+  Rest = Body.drop_front(Size);
+  return true;
+}
+
+std::optional<std::uint64_t> hashFile(StringRef File) {
+  auto Buffer = MemoryBuffer::getFile(File, /*IsText=*/false,
+                                      /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return std::nullopt;
+  return xxh3_64bits((*Buffer)->getBuffer());
+}
+
+bool syncFile(int FD) {
+#if LLVM_ON_UNIX
+  return ::fsync(FD) == 0;
+#else
+  (void)FD;
+  return true;
+#endif
+}
+
+} // namespace
+
+bool EastConstCheckpoint::open(StringRef Path, bool Resume) {
+  std::uint64_t Valid = 0;
+  bool Existing = Resume && sys::fs::exists(Path);
+  std::unique_ptr<MemoryBuffer> Buffer;
+  if (Existing) {
+    auto BufferOrError = MemoryBuffer::getFile(
+        Path, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!BufferOrError) {
+      EAST_CONST_LOG(Error, "Cannot read checkpoint "
+                                << Path << ": "
+                                << BufferOrError.getError().message());
+      return false;
+    }
+    Buffer = std::move(*BufferOrError);
+    StringRef Contents = Buffer->getBuffer();
+    if (!Contents.starts_with(Magic) && !Magic.starts_with(Contents)) {
+      EAST_CONST_LOG(Error, Path << " is not an east-const checkpoint");
+      return false;
+    }
+    // Killed before even the header was written.
+    Existing = Contents.starts_with(Magic);
+  }
+  if (Existing) {
+    StringRef Contents = Buffer->getBuffer();
+    StringRef Rest = Contents.drop_front(Magic.size());
+    StringRef Kind, Payload;
+    std::uint64_t FileHash;
+    std::vector<EastConstCheckpointEntry> Entries;
+    std::map<std::string, std::size_t> Latest;
+    while (readRecord(Rest, Kind, FileHash, Payload)) {
+      if (Kind == "applied") {
+        auto It = Latest.find(Payload.str());
+        if (It != Latest.end()) {
+          Entries[It->second].Applied = true;
+          Entries[It->second].ContentHash = FileHash;
+        }
+        continue;
+      }
+      TranslationUnitReplacements TUR;
+      yaml::Input YAML(Payload);
+      YAML >> TUR;
+      if (YAML.error())
+        continue;
+      EastConstCheckpointEntry Entry;
+      Entry.File = TUR.MainSourceFile;
+      Entry.Success = Kind == "ok";
+      Entry.ContentHash = FileHash;
+      Entry.Replacements = std::move(TUR.Replacements);
+      Latest[Entry.File] = Entries.size();
+      Entries.push_back(std::move(Entry));
+    }
+    Valid = Contents.size() - Rest.size();
+    Dropped = Rest.size();
+    // Offsets into a file that changed since no longer fit it; such files
+    // are parsed again.
+    for (std::size_t I = 0; I < Entries.size(); ++I) {
+      EastConstCheckpointEntry &Entry = Entries[I];
+      if (Latest[Entry.File] != I)
+        continue;
+      if (hashFile(Entry.File) != Entry.ContentHash) {
+        ++Stale;
+        continue;
+      }
+      Done.insert(Entry.File);
+      Resumed.push_back(std::move(Entry));
+    }
+  }
+
+  std::error_code EC = sys::fs::openFileForWrite(
+      Path, FD, sys::fs::CD_OpenAlways, sys::fs::OF_None);
+  if (!EC && (EC = sys::fs::resize_file(FD, Valid)))
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  if (EC) {
+    EAST_CONST_LOG(Error, "Cannot write checkpoint " << Path << ": "
+                                                     << EC.message());
+    return false;
+  }
+  OS = std::make_unique<raw_fd_ostream>(FD, /*shouldClose=*/true);
+  OS->seek(Valid);
+  if (!Existing)
+    return append(Magic);
+  return true;
+}
+
+bool EastConstCheckpoint::record(StringRef File, bool Success,
+                                 ArrayRef<Replacement> Replacements) {
+  TranslationUnitReplacements TUR;
+  TUR.MainSourceFile = File.str();
+  TUR.Replacements.assign(Replacements.begin(), Replacements.end());
+  std::string Payload;
+  raw_string_ostream Out(Payload);
+  yaml::Output YAML(Out);
+  YAML << TUR;
+  // A file that cannot be read is recorded under a hash nothing matches,
+  // so it is parsed again on resume.
+  std::uint64_t FileHash = hashFile(File).value_or(0);
+  return append(makeRecord(Success ? "ok" : "failed", FileHash, Out.str()));
+}
+
+bool EastConstCheckpoint::markApplied(StringRef File, StringRef Contents) {
+  return append(makeRecord("applied", xxh3_64bits(Contents), File));
+}
+
+bool EastConstCheckpoint::append(StringRef Bytes) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  *OS << Bytes;
+  OS->flush();
+  if (OS->has_error() || !syncFile(FD)) {
+    OS->clear_error();
+    EAST_CONST_LOG(Error, "Cannot append to the checkpoint");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,268 @@
+#include <EastConstDiff.h>
+#include <EastConstLogging.h>
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+#include <algorithm>
+#include <utility>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+// Line boundaries of a buffer; the last line may lack its newline.
+class LineIndex {
+public:
+  explicit LineIndex(StringRef Text) : Text(Text) {
+    if (Text.empty())
+      return;
+    Starts.push_back(0);
+    for (std::size_t I = 0; I + 1 < Text.size(); ++I)
+      if (Text[I] == '\n')
+        Starts.push_back(I + 1);
+  }
+
+  std::size_t size() const { return Starts.size(); }
+  // The line holding Offset; offsets past the end belong to the last line.
+  std::size_t lineOf(std::size_t Offset) const {
+    Offset = std::min(Offset, Text.size() - 1);
+    return std::upper_bound(Starts.begin(), Starts.end(), Offset) -
+           Starts.begin() - 1;
+  }
+  std::size_t begin(std::size_t Line) const { return Starts[Line]; }
+  std::size_t end(std::size_t Line) const {
+    return Line + 1 < Starts.size() ? Starts[Line + 1] : Text.size();
+  }
+  StringRef line(std::size_t Line) const {
+    return Text.slice(begin(Line), end(Line));
+  }
+
+private:
+  StringRef Text;
+  std::vector<std::size_t> Starts;
+};
+
+// Original lines [First, Last] become NewText.
+struct Change {
+  std::size_t First;
+  std::size_t Last;
+  std::string NewText;
+};
+
+std::vector<StringRef> splitLines(StringRef Text) {
+  std::vector<StringRef> Lines;
+  while (!Text.empty()) {
+    std::size_t End = Text.find('\n');
+    End = End == StringRef::npos ? Text.size() : End + 1;
+    Lines.push_back(Text.take_front(End));
+    Text = Text.drop_front(End);
+  }
+  return Lines;
+}
+
+void writeLine(raw_ostream &OS, char Prefix, StringRef Line) {
+  OS << Prefix << Line;
+  if (!Line.ends_with("\n"))
+    OS << "\n\\ No newline at end of file\n";
+}
+
+// Unified diff ranges name the line before an empty range.
+void writeRange(raw_ostream &OS, char Sign, std::size_t Start,
+                std::size_t Count) {
+  OS << Sign << (Count == 0 ? Start - 1 : Start) << "," << Count;
+}
+
+} // namespace
+
+void writeEastConstUnifiedDiff(raw_ostream &OS, StringRef Label,
+                               StringRef Original,
+                               ArrayRef<Replacement> Replaces,
+                               unsigned Context) {
+  if (Replaces.empty())
+    return;
+  StringRef Separator = Label.starts_with("/") ? "" : "/";
+  OS << "--- a" << Separator << Label << "\n+++ b" << Separator << Label
+     << "\n";
+
+  if (Original.empty()) {
+    std::string NewText;
+    for (const Replacement &Rep : Replaces)
+      NewText += Rep.getReplacementText();
+    std::vector<StringRef> Added = splitLines(NewText);
+    OS << "@@ -0,0 +1," << Added.size() << " @@\n";
+    for (StringRef Line : Added)
+      writeLine(OS, '+', Line);
+    return;
+  }
+
+  // Replacements on the same lines form one change; only the changed lines
+  // are rebuilt.
+  LineIndex Lines(Original);
+  std::vector<Change> Changes;
+  std::size_t Cursor = 0;
+  for (const Replacement &Rep : Replaces) {
+    std::size_t Offset = std::min<std::size_t>(Rep.getOffset(),
+                                               Original.size());
+    std::size_t End =
+        std::min<std::size_t>(Offset + Rep.getLength(), Original.size());
+    std::size_t First = Lines.lineOf(Offset);
+    std::size_t Last = End > Offset ? Lines.lineOf(End - 1) : First;
+    if (Changes.empty() || First > Changes.back().Last) {
+      if (!Changes.empty())
+        Changes.back().NewText +=
+            Original.slice(Cursor, Lines.end(Changes.back().Last));
+      Changes.push_back({First, Last, std::string()});
+      Cursor = Lines.begin(First);
+    }
+    Change &Current = Changes.back();
+    Current.Last = std::max(Current.Last, Last);
+    Current.NewText += Original.slice(Cursor, Offset);
+    Current.NewText += Rep.getReplacementText();
+    Cursor = std::max(Cursor, End);
+  }
+  Changes.back().NewText +=
+      Original.slice(Cursor, Lines.end(Changes.back().Last));
+
+  // Changes closer than twice the context share a hunk.
+  long Delta = 0;
+  for (std::size_t I = 0; I < Changes.size();) {
+    std::size_t J = I + 1;
+    while (J < Changes.size() &&
+           Changes[J].First <= Changes[J - 1].Last + 2 * Context + 1)
+      ++J;
+    std::size_t Start =
+        Changes[I].First > Context ? Changes[I].First - Context : 0;
+    std::size_t Stop =
+        std::min(Changes[J - 1].Last + Context, Lines.size() - 1);
+
+    std::vector<std::vector<StringRef>> Added;
+    std::size_t OldCount = Stop - Start + 1;
+    std::size_t NewCount = OldCount;
+    for (std::size_t K = I; K < J; ++K) {
+      Added.push_back(splitLines(Changes[K].NewText));
+      NewCount = NewCount - (Changes[K].Last - Changes[K].First + 1) +
+                 Added.back().size();
+    }
+    OS << "@@ ";
+    writeRange(OS, '-', Start + 1, OldCount);
+    OS << " ";
+    writeRange(OS, '+', Start + 1 + Delta, NewCount);
+    OS << " @@\n";
+
+    std::size_t Line = Start;
+    for (std::size_t K = I; K < J; ++K) {
+      for (; Line < Changes[K].First; ++Line)
+        writeLine(OS, ' ', Lines.line(Line));
+      for (; Line <= Changes[K].Last; ++Line)
+        writeLine(OS, '-', Lines.line(Line));
+      for (StringRef New : Added[K - I])
+        writeLine(OS, '+', New);
+    }
+    for (; Line <= Stop; ++Line)
+      writeLine(OS, ' ', Lines.line(Line));
+
+    Delta += static_cast<long>(NewCount) - static_cast<long>(OldCount);
+    I = J;
+  }
+}
+
+EastConstDiffWriter::EastConstDiffWriter(raw_ostream &OS,
+                                         std::vector<std::string> Order,
+                                         StringRef BaseDir)
+    : OS(OS), BaseDir(BaseDir.str()) {
+  for (const std::string &Key : Order)
+    if (Position.try_emplace(Key, Queue.size()).second)
+      Queue.emplace_back();
+  Ordered = Queue.size();
+}
+
+void EastConstDiffWriter::complete(StringRef Key, StringRef File,
+                                   ArrayRef<Replacement> Replaces) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Position.find(Key);
+  if (It == Position.end()) {
+    // Not in the order: held back until finish(), sorted by file there.
+    Position.try_emplace(Key, Queue.size());
+    Queue.emplace_back();
+    It = Position.find(Key);
+  }
+  Pending &Entry = Queue[It->getValue()];
+  Entry.Done = true;
+  Entry.File = File.str();
+  Entry.Replaces.assign(Replaces.begin(), Replaces.end());
+  drainLocked();
+}
+
+void EastConstDiffWriter::finish() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  std::vector<std::size_t> Rest;
+  for (; Next < Queue.size(); ++Next)
+    if (Queue[Next].Done)
+      Rest.push_back(Next);
+  // Keys outside the order go last, by file.
+  auto Unordered =
+      std::partition_point(Rest.begin(), Rest.end(),
+                           [&](std::size_t I) { return I < Ordered; });
+  std::stable_sort(Unordered, Rest.end(), [&](std::size_t A, std::size_t B) {
+    return Queue[A].File < Queue[B].File;
+  });
+  for (std::size_t I : Rest) {
+    writeLocked(Queue[I].File, Queue[I].Replaces);
+    Queue[I].Replaces.clear();
+  }
+}
+
+bool EastConstDiffWriter::write(StringRef File,
+                                ArrayRef<Replacement> Replaces) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return writeLocked(File, Replaces);
+}
+
+bool EastConstDiffWriter::isWritten(StringRef File) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Written.contains(File);
+}
+
+unsigned EastConstDiffWriter::filesWritten() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Files;
+}
+
+unsigned EastConstDiffWriter::failures() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Failed;
+}
+
+void EastConstDiffWriter::drainLocked() {
+  for (; Next < Ordered && Queue[Next].Done; ++Next) {
+    writeLocked(Queue[Next].File, Queue[Next].Replaces);
+    Queue[Next].Replaces.clear();
+  }
+}
+
+bool EastConstDiffWriter::writeLocked(StringRef File,
+                                      ArrayRef<Replacement> Replaces) {
+  if (Replaces.empty() || !Written.insert(File).second)
+    return true;
+  // Mapped, not read: the diff walks the original in place.
+  auto BufferOrError = MemoryBuffer::getFile(File, /*IsText=*/false,
+                                             /*RequiresNullTerminator=*/false);
+  if (!BufferOrError) {
+    EAST_CONST_LOG(Error, "Cannot read " << File << " for the diff: "
+                                         << BufferOrError.getError().message());
+    ++Failed;
+    return false;
+  }
+  StringRef Label = File;
+  if (!BaseDir.empty() && Label.starts_with(BaseDir) &&
+      Label.size() > BaseDir.size() &&
+      sys::path::is_separator(Label[BaseDir.size()]))
+    Label = Label.drop_front(BaseDir.size() + 1);
+  writeEastConstUnifiedDiff(OS, Label, (*BufferOrError)->getBuffer(),
+                            Replaces);
+  OS.flush();
+  ++Files;
+  return true;
+}
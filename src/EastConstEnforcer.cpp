@@ -1,7 +1,12 @@
 #include <EastConstEnforcer.h>
+#include <EastConstKeywords.h>
+#include <EastConstLogging.h>
 
 #include <clang/Lex/Lexer.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/Error.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include <algorithm>
@@ -14,50 +19,130 @@ using namespace clang;
 using namespace clang::tooling;
 using namespace llvm;
 
-namespace {
-bool QuietModeFlag = false;
+llvm::StringRef getEastConstDeclKindName(EastConstDeclKind Kind) {
+  switch (Kind) {
+  case EastConstDeclKind::Variable:
+    return "variable";
+  case EastConstDeclKind::Parameter:
+    return "parameter";
+  case EastConstDeclKind::ReturnType:
+    return "return";
+  case EastConstDeclKind::Field:
+    return "field";
+  case EastConstDeclKind::Typedef:
+    return "typedef";
+  case EastConstDeclKind::TypeAlias:
+    return "alias";
+  case EastConstDeclKind::TemplateArgument:
+    return "template-argument";
+  case EastConstDeclKind::NonTypeTemplateParm:
+    return "non-type-template-parameter";
+  case EastConstDeclKind::Count:
+    break;
+  }
+  return "unknown";
+}
+
+bool parseEastConstDeclKinds(llvm::StringRef Spec, unsigned &Mask) {
+  unsigned Result = 0;
+  llvm::SmallVector<llvm::StringRef, 8> Names;
+  Spec.split(Names, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (llvm::StringRef Name : Names) {
+    Name = Name.trim();
+    if (Name == "all") {
+      Result |= EastConstCheckerOptions::AllDeclKinds;
+      continue;
+    }
+    if (Name == "none")
+      continue;
+
+    bool Known = false;
+    for (unsigned I = 0; I < static_cast<unsigned>(EastConstDeclKind::Count);
+         ++I) {
+      if (Name == getEastConstDeclKindName(static_cast<EastConstDeclKind>(I))) {
+        Result |= 1u << I;
+        Known = true;
+        break;
+      }
+    }
+    if (!Known)
+      return false;
+  }
+  Mask = Result;
+  return true;
 }
 
-void setQuietMode(bool Enabled) { QuietModeFlag = Enabled; }
-bool isQuietMode() { return QuietModeFlag; }
+EastConstSiteCounts countEastConstSites(const EastConstSiteKinds &Sites) {
+  EastConstSiteCounts Counts{};
+  for (const auto &OffsetAndKind : Sites)
+    ++Counts[static_cast<std::size_t>(OffsetAndKind.second)];
+  return Counts;
+}
 
-EastConstChecker::EastConstChecker(ReplacementHandler Handler)
-  : ReplacementCallback(std::move(Handler)) {}
+llvm::Error addEastConstFix(Replacements &Fixes, const Replacement &Rep) {
+  if (std::binary_search(Fixes.begin(), Fixes.end(), Rep))
+    return llvm::Error::success();
+  return Fixes.add(Rep);
+}
+
+EastConstChecker::EastConstChecker(ReplacementHandler Handler,
+                                   EastConstCheckerOptions Options,
+                                   EastConstSiteHandler OnSite)
+  : ReplacementCallback(std::move(Handler)), Options(std::move(Options)),
+    SiteCallback(std::move(OnSite)) {}
+
+void EastConstChecker::onStartOfTranslationUnit() {
+  // Raw location encodings are only meaningful within one translation unit.
+  ProcessedQualifierStarts.clear();
+  StopTranslationUnit = false;
+}
 
 void EastConstChecker::run(const MatchFinder::MatchResult &Result) {
+  if (StopTranslationUnit)
+    return;
   if (!Result.Context || !Result.SourceManager)
     return;
 
   SourceManager &SM = *Result.SourceManager;
   const LangOptions &LangOpts = Result.Context->getLangOpts();
 
+  auto beginDecl = [this](EastConstDeclKind Kind) {
+    CurrentDeclKind = Kind;
+    return Options.isEnabled(Kind);
+  };
+
   const auto *Var = Result.Nodes.getNodeAs<VarDecl>("varDecl");
   if (!Var)
     Var = Result.Nodes.getNodeAs<VarDecl>("constVar");
-  if (Var)
+  if (Var && beginDecl(EastConstDeclKind::Variable))
     processDeclaratorDecl(Var, SM, LangOpts);
 
   if (const auto *Field = Result.Nodes.getNodeAs<FieldDecl>("fieldDecl"))
-    processDeclaratorDecl(Field, SM, LangOpts);
+    if (beginDecl(EastConstDeclKind::Field))
+      processDeclaratorDecl(Field, SM, LangOpts);
 
   if (const auto *Func = Result.Nodes.getNodeAs<FunctionDecl>("functionDecl"))
     processFunctionDecl(Func, SM, LangOpts);
 
   if (const auto *Typedef = Result.Nodes.getNodeAs<TypedefDecl>("typedefDecl"))
-    processTypedefDecl(Typedef, SM, LangOpts);
+    if (beginDecl(EastConstDeclKind::Typedef))
+      processTypedefDecl(Typedef, SM, LangOpts);
 
   if (const auto *Alias = Result.Nodes.getNodeAs<TypeAliasDecl>("aliasDecl"))
-    processTypedefDecl(Alias, SM, LangOpts);
+    if (beginDecl(EastConstDeclKind::TypeAlias))
+      processTypedefDecl(Alias, SM, LangOpts);
 
   if (const auto *ClassSpec =
           Result.Nodes.getNodeAs<ClassTemplateSpecializationDecl>(
               "classTemplateSpec"))
-    processClassTemplateSpec(ClassSpec, SM, LangOpts);
+    if (beginDecl(EastConstDeclKind::TemplateArgument))
+      processClassTemplateSpec(ClassSpec, SM, LangOpts);
 
   if (const auto *NTTP =
           Result.Nodes.getNodeAs<NonTypeTemplateParmDecl>(
               "nonTypeTemplateParm"))
-    processDeclaratorDecl(NTTP, SM, LangOpts);
+    if (beginDecl(EastConstDeclKind::NonTypeTemplateParm))
+      processDeclaratorDecl(NTTP, SM, LangOpts);
 }
 
 void EastConstChecker::processDeclaratorDecl(const DeclaratorDecl *DD,
@@ -107,17 +192,29 @@ void EastConstChecker::processFunctionDecl(const FunctionDecl *FD,
   if (SM.isInSystemHeader(Loc) || !SM.isWrittenInMainFile(Loc))
     return;
 
+  const bool ReturnEnabled = Options.isEnabled(EastConstDeclKind::ReturnType);
+  const bool ParamsEnabled = Options.isEnabled(EastConstDeclKind::Parameter);
+
   if (TypeSourceInfo *TSI = FD->getTypeSourceInfo()) {
     TypeLoc TL = TSI->getTypeLoc();
     if (auto FnTL = TL.getAs<FunctionTypeLoc>()) {
-      processTypeLoc(FnTL.getReturnLoc(), SM, LangOpts);
-      for (unsigned I = 0; I < FnTL.getNumParams(); ++I)
-        processDeclaratorDecl(FnTL.getParam(I), SM, LangOpts);
+      if (ReturnEnabled) {
+        CurrentDeclKind = EastConstDeclKind::ReturnType;
+        processTypeLoc(FnTL.getReturnLoc(), SM, LangOpts);
+      }
+      if (ParamsEnabled) {
+        CurrentDeclKind = EastConstDeclKind::Parameter;
+        for (unsigned I = 0; I < FnTL.getNumParams(); ++I)
+          processDeclaratorDecl(FnTL.getParam(I), SM, LangOpts);
+      }
       return;
     }
   }
 
   // Fallback when no TypeSourceInfo is available.
+  if (!ParamsEnabled)
+    return;
+  CurrentDeclKind = EastConstDeclKind::Parameter;
   for (const ParmVarDecl *Param : FD->parameters())
     processDeclaratorDecl(Param, SM, LangOpts);
 }
@@ -146,7 +243,7 @@ void EastConstChecker::processClassTemplateSpec(
 
 void EastConstChecker::processTypeLoc(TypeLoc TL, SourceManager &SM,
                                       const LangOptions &LangOpts) {
-  for (TypeLoc Current = TL; !Current.isNull();
+  for (TypeLoc Current = TL; !Current.isNull() && !StopTranslationUnit;
        Current = Current.getNextTypeLoc()) {
     SourceLocation Begin = Current.getBeginLoc();
     if (Begin.isInvalid())
@@ -166,10 +263,10 @@ void EastConstChecker::processTypeLoc(TypeLoc TL, SourceManager &SM,
       for (unsigned I = 0; I < TemplateTL.getNumArgs(); ++I) {
         TemplateArgumentLoc ArgLoc = TemplateTL.getArgLoc(I);
         if (!ArgLoc.getTypeSourceInfo()) {
-          if (!isQuietMode()) {
-            llvm::errs() << "Missing type source info for template argument at "
-                         << ArgLoc.getSourceRange().printToString(SM) << "\n";
-          }
+          if (!Options.Quiet)
+            EAST_CONST_LOG(Debug,
+                           "Missing type source info for template argument at "
+                               << ArgLoc.getSourceRange().printToString(SM));
           continue;
         }
         processTypeLoc(ArgLoc.getTypeSourceInfo()->getTypeLoc(), SM,
@@ -194,15 +291,14 @@ void EastConstChecker::processTypeLoc(TypeLoc TL, SourceManager &SM,
 }
 
 namespace {
-bool tokenMatchesIdentifier(const Token &Tok, llvm::StringRef Name) {
-  if (!Tok.isOneOf(tok::identifier, tok::raw_identifier))
-    return false;
-  return llvm::StringRef(Tok.getLiteralData(), Tok.getLength()) == Name;
-}
-
-bool isIgnorableSpecifierToken(const Token &Tok) {
-  tok::TokenKind Kind = Tok.getKind();
-  switch (Kind) {
+EastConstKeywordClass classifyToken(const Token &Tok) {
+  switch (Tok.getKind()) {
+  case tok::kw_const:
+    return EastConstKeywordClass::Const;
+  case tok::kw_volatile:
+    return EastConstKeywordClass::Volatile;
+  case tok::kw_restrict:
+    return EastConstKeywordClass::Restrict;
   case tok::kw_constexpr:
   case tok::kw_consteval:
   case tok::kw_constinit:
@@ -214,75 +310,82 @@ bool isIgnorableSpecifierToken(const Token &Tok) {
   case tok::kw_mutable:
   case tok::kw_friend:
   case tok::kw_typedef:
-    return true;
+    return EastConstKeywordClass::IgnorableSpecifier;
+  case tok::raw_identifier:
+    return classifyEastConstKeyword(Tok.getRawIdentifier());
+  case tok::identifier:
+    if (const IdentifierInfo *II = Tok.getIdentifierInfo())
+      return classifyEastConstKeyword(II->getName());
+    return EastConstKeywordClass::Other;
   default:
-    break;
+    return EastConstKeywordClass::Other;
   }
-
-  return tokenMatchesIdentifier(Tok, "constexpr") ||
-         tokenMatchesIdentifier(Tok, "consteval") ||
-         tokenMatchesIdentifier(Tok, "constinit") ||
-         tokenMatchesIdentifier(Tok, "static") ||
-         tokenMatchesIdentifier(Tok, "inline") ||
-         tokenMatchesIdentifier(Tok, "extern") ||
-         tokenMatchesIdentifier(Tok, "register") ||
-         tokenMatchesIdentifier(Tok, "thread_local") ||
-         tokenMatchesIdentifier(Tok, "mutable") ||
-         tokenMatchesIdentifier(Tok, "friend") ||
-         tokenMatchesIdentifier(Tok, "typedef");
 }
 
-bool isConstToken(const Token &Tok) {
-  if (Tok.is(tok::kw_const))
-    return true;
-  return tokenMatchesIdentifier(Tok, "const") ||
-         tokenMatchesIdentifier(Tok, "__const") ||
-         tokenMatchesIdentifier(Tok, "__const__");
-}
-
-bool isVolatileToken(const Token &Tok) {
-  if (Tok.is(tok::kw_volatile))
-    return true;
-  return tokenMatchesIdentifier(Tok, "volatile") ||
-         tokenMatchesIdentifier(Tok, "__volatile") ||
-         tokenMatchesIdentifier(Tok, "__volatile__");
-}
+// Splits the removal range [Begin, End) at the specifiers inside it, so
+// `const static volatile int` loses `const ` and `volatile ` but keeps
+// `static `. The lexer engine removes the same runs.
+std::vector<CharSourceRange> splitAtSpecifiers(const SourceManager &SM,
+                                               const LangOptions &LangOpts,
+                                               SourceLocation Begin,
+                                               SourceLocation End) {
+  std::vector<CharSourceRange> Runs;
+  std::pair<FileID, unsigned> Start = SM.getDecomposedLoc(Begin);
+  bool Invalid = false;
+  StringRef Buffer = SM.getBufferData(Start.first, &Invalid);
+  if (Invalid) {
+    Runs.push_back(CharSourceRange::getCharRange(Begin, End));
+    return Runs;
+  }
+  unsigned EndOffset = SM.getFileOffset(End);
 
-bool isRestrictToken(const Token &Tok) {
-  if (Tok.is(tok::kw_restrict))
-    return true;
-  return tokenMatchesIdentifier(Tok, "restrict") ||
-         tokenMatchesIdentifier(Tok, "__restrict") ||
-         tokenMatchesIdentifier(Tok, "__restrict__");
+  Lexer Lex(SM.getLocForStartOfFile(Start.first), LangOpts, Buffer.begin(),
+            Buffer.begin() + Start.second, Buffer.end());
+  SourceLocation RunBegin = Begin;
+  Token Tok;
+  while (true) {
+    Lex.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof) || SM.getFileOffset(Tok.getLocation()) >= EndOffset)
+      break;
+    bool Specifier =
+        classifyToken(Tok) == EastConstKeywordClass::IgnorableSpecifier;
+    if (Specifier && RunBegin.isValid()) {
+      Runs.push_back(
+          CharSourceRange::getCharRange(RunBegin, Tok.getLocation()));
+      RunBegin = SourceLocation();
+    } else if (!Specifier && RunBegin.isInvalid()) {
+      RunBegin = Tok.getLocation();
+    }
+  }
+  if (RunBegin.isValid())
+    Runs.push_back(CharSourceRange::getCharRange(RunBegin, End));
+  return Runs;
 }
 } // namespace
 
 void EastConstChecker::processQualifiedTypeLoc(QualifiedTypeLoc QTL,
                                                SourceManager &SM,
                                                const LangOptions &LangOpts) {
-  if (QTL.isNull())
+  if (QTL.isNull() || StopTranslationUnit)
     return;
 
   Qualifiers Quals = QTL.getType().getLocalQualifiers();
   if (!Quals.hasConst() && !Quals.hasVolatile() && !Quals.hasRestrict())
     return;
-  if (!isQuietMode()) {
-    std::string TypeDesc = QTL.getType().getAsString();
-    if (TypeDesc.find("Foo::") != std::string::npos) {
-      llvm::errs() << "Processing qualified type '" << TypeDesc << "' at "
-                   << QTL.getSourceRange().printToString(SM) << "\n";
-    }
-  }
+  if (!Options.Quiet)
+    EAST_CONST_LOG(Trace, "Processing qualified type '"
+                              << QTL.getType().getAsString() << "' at "
+                              << QTL.getSourceRange().printToString(SM));
 
   TypeLoc Unqualified = QTL.getUnqualifiedLoc();
   if (Unqualified.isNull())
     return;
-  if (!isQuietMode()) {
+  if (!Options.Quiet && isEastConstLogEnabled(EastConstLogLevel::Trace)) {
     if (auto TypedefTL = Unqualified.getAs<TypedefTypeLoc>()) {
-      SourceLocation NameLoc = TypedefTL.getNameLoc();
-      llvm::errs() << "Typedef loc "
-                   << NameLoc.printToString(SM) << " for type '"
-                   << TypedefTL.getType().getAsString() << "'\n";
+      EAST_CONST_LOG(Trace, "Typedef loc "
+                                << TypedefTL.getNameLoc().printToString(SM)
+                                << " for type '"
+                                << TypedefTL.getType().getAsString() << "'");
     }
   }
 
@@ -316,22 +419,20 @@ void EastConstChecker::processQualifiedTypeLoc(QualifiedTypeLoc QTL,
   if (UseSpellingFallback) {
     if (!findQualifierRangeFromSpelling(QTL, SM, LangOpts, QualBegin,
                                         RemovalEnd, MovedQualifiers)) {
-      if (!isQuietMode()) {
-        llvm::errs() << "Failed to find qualifier range for type '"
-                     << QTL.getType().getAsString() << "' at "
-                     << QTL.getSourceRange().printToString(SM) << "\n";
-      }
+      if (!Options.Quiet)
+        EAST_CONST_LOG(Trace, "Failed to find qualifier range for type '"
+                                  << QTL.getType().getAsString() << "' at "
+                                  << QTL.getSourceRange().printToString(SM));
       return;
     }
   } else {
     if (!findQualifierRange(QTL, SM, LangOpts, QualBegin, RemovalEnd,
                             MovedQualifiers)) {
-      if (!isQuietMode()) {
-        llvm::errs() << "Failed to find qualifier range for type '"
-                     << QTL.getType().getAsString() << "' at "
-                     << Unqualified.getSourceRange().printToString(SM)
-                     << "\n";
-      }
+      if (!Options.Quiet)
+        EAST_CONST_LOG(Trace,
+                       "Failed to find qualifier range for type '"
+                           << QTL.getType().getAsString() << "' at "
+                           << Unqualified.getSourceRange().printToString(SM));
       return;
     }
   }
@@ -340,9 +441,15 @@ void EastConstChecker::processQualifiedTypeLoc(QualifiedTypeLoc QTL,
   if (!ProcessedQualifierStarts.insert(QualKey).second)
     return;
 
-  CharSourceRange RemoveRange =
-      CharSourceRange::getCharRange(QualBegin, RemovalEnd);
-  addReplacement(SM, RemoveRange, "");
+  noteSite(SM, QualBegin);
+  if (Options.CheckOnly) {
+    finishSite(SM, QualBegin);
+    return;
+  }
+
+  for (CharSourceRange RemoveRange :
+       splitAtSpecifiers(SM, LangOpts, QualBegin, RemovalEnd))
+    addReplacement(SM, RemoveRange, "");
 
   SourceLocation InsertLoc;
   if (UseSpellingFallback) {
@@ -351,16 +458,15 @@ void EastConstChecker::processQualifiedTypeLoc(QualifiedTypeLoc QTL,
   } else {
     InsertLoc = computeInsertLocation(QTL.getUnqualifiedLoc(), SM, LangOpts);
   }
-  if (InsertLoc.isInvalid())
-    return;
-
-  std::string Suffix = buildQualifierSuffix(MovedQualifiers);
-  if (Suffix.empty())
-    return;
-
-  CharSourceRange InsertRange =
-      CharSourceRange::getCharRange(InsertLoc, InsertLoc);
-  addReplacement(SM, InsertRange, Suffix);
+  std::string Suffix;
+  if (InsertLoc.isValid())
+    Suffix = buildQualifierSuffix(MovedQualifiers);
+  if (!Suffix.empty()) {
+    CharSourceRange InsertRange =
+        CharSourceRange::getCharRange(InsertLoc, InsertLoc);
+    addReplacement(SM, InsertRange, Suffix);
+  }
+  finishSite(SM, QualBegin);
 }
 
 bool EastConstChecker::findQualifierRange(
@@ -404,8 +510,6 @@ std::string EastConstChecker::buildQualifierSuffix(
 void EastConstChecker::addReplacement(const SourceManager &SM,
                                       CharSourceRange Range,
                                       llvm::StringRef NewText) {
-  if (!ReplacementCallback)
-    return;
   if (Range.isInvalid())
     return;
 
@@ -413,7 +517,53 @@ void EastConstChecker::addReplacement(const SourceManager &SM,
   if (Loc.isInvalid())
     return;
 
-  ReplacementCallback(SM, Range, NewText);
+  if (SiteCallback)
+    SiteFix.emplace_back(SM, Range, NewText);
+  if (ReplacementCallback)
+    ReplacementCallback(SM, Range, NewText);
+}
+
+namespace {
+std::string absoluteFileName(const SourceManager &SM, SourceLocation Loc) {
+  SmallString<256> Path(SM.getFilename(SM.getFileLoc(Loc)));
+  if (Path.empty())
+    return std::string();
+  SM.getFileManager().makeAbsolutePath(Path);
+  sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return Path.str().str();
+}
+} // namespace
+
+void EastConstChecker::noteSite(const SourceManager &SM, SourceLocation Loc) {
+  if (Options.FailFast)
+    StopTranslationUnit = true;
+  SiteFix.clear();
+  if (!Options.CountSites)
+    return;
+  std::string Path = absoluteFileName(SM, Loc);
+  if (Path.empty())
+    return;
+  unsigned Offset = SM.getFileOffset(SM.getFileLoc(Loc));
+  if (!CountedSites[Path].emplace(Offset, CurrentDeclKind).second)
+    return;
+  EastConstSiteCounts &Counts = SiteCounts[Path];
+  ++Counts[static_cast<std::size_t>(CurrentDeclKind)];
+}
+
+void EastConstChecker::finishSite(const SourceManager &SM, SourceLocation Loc) {
+  if (!SiteCallback)
+    return;
+  EastConstSite Site;
+  Site.File = absoluteFileName(SM, Loc);
+  if (Site.File.empty())
+    return;
+  SourceLocation FileLoc = SM.getFileLoc(Loc);
+  Site.Line = SM.getSpellingLineNumber(FileLoc);
+  Site.Column = SM.getSpellingColumnNumber(FileLoc);
+  Site.Kind = CurrentDeclKind;
+  Site.Fix = std::move(SiteFix);
+  SiteFix.clear();
+  SiteCallback(Site);
 }
 
 SourceLocation EastConstChecker::computeInsertLocation(TypeLoc Unqualified,
@@ -497,7 +647,7 @@ bool EastConstChecker::shouldUseSpellingFallback(QualifiedTypeLoc QTL,
   if (!BeginPtr || !EndPtr || EndPtr <= BeginPtr)
     return true;
 
-  const size_t MaxLookahead = 96;
+  const size_t MaxLookahead = Options.FallbackWindowBytes;
   const char *ScanEnd = BeginPtr + MaxLookahead;
   if (ScanEnd > EndPtr)
     ScanEnd = EndPtr;
@@ -711,6 +861,12 @@ bool EastConstChecker::fixDanglingQualifierTokens(
   if (!ProcessedQualifierStarts.insert(QualKey).second)
     return false;
 
+  noteSite(SM, QualBegin);
+  if (Options.CheckOnly) {
+    finishSite(SM, QualBegin);
+    return true;
+  }
+
   SourceLocation RemovalEnd = TypeBegin;
   CharSourceRange RemoveRange =
       CharSourceRange::getCharRange(QualBegin, RemovalEnd);
@@ -722,16 +878,15 @@ bool EastConstChecker::fixDanglingQualifierTokens(
 
   SourceLocation InsertLoc =
       Lexer::getLocForEndOfToken(TypeEnd, 0, SM, LangOpts);
-  if (InsertLoc.isInvalid())
-    return true;
-
-  std::string Suffix = buildQualifierSuffix(Keywords);
-  if (Suffix.empty())
-    return true;
-
-  CharSourceRange InsertRange =
-      CharSourceRange::getCharRange(InsertLoc, InsertLoc);
-  addReplacement(SM, InsertRange, Suffix);
+  std::string Suffix;
+  if (InsertLoc.isValid())
+    Suffix = buildQualifierSuffix(Keywords);
+  if (!Suffix.empty()) {
+    CharSourceRange InsertRange =
+        CharSourceRange::getCharRange(InsertLoc, InsertLoc);
+    addReplacement(SM, InsertRange, Suffix);
+  }
+  finishSite(SM, QualBegin);
 
   return true;
 }
@@ -779,7 +934,8 @@ bool EastConstChecker::collectQualifierTokens(
 
   ptrdiff_t Offset = BasePtr - FileStart;
   ptrdiff_t Lookbehind =
-      std::min<ptrdiff_t>(Offset, static_cast<ptrdiff_t>(2048));
+      std::min<ptrdiff_t>(Offset,
+                          static_cast<ptrdiff_t>(Options.LookbehindBytes));
   const char *LexStartPtr = BasePtr - Lookbehind;
 
   Lexer Lex(SM.getLocForStartOfFile(FID), LangOpts, FileStart, LexStartPtr,
@@ -816,8 +972,9 @@ bool EastConstChecker::collectQualifierTokens(
 
   for (auto It = Tokens.rbegin(); It != Tokens.rend(); ++It) {
     tok::TokenKind Kind = It->getKind();
+    EastConstKeywordClass Class = classifyToken(*It);
 
-    if (isConstToken(*It) && Quals.hasConst()) {
+    if (Class == EastConstKeywordClass::Const && Quals.hasConst()) {
       QualifierTokens.push_back(
           {SM.getFileLoc(It->getLocation()), "const"});
       Quals.removeConst();
@@ -825,7 +982,7 @@ bool EastConstChecker::collectQualifierTokens(
       continue;
     }
 
-    if (isVolatileToken(*It) && Quals.hasVolatile()) {
+    if (Class == EastConstKeywordClass::Volatile && Quals.hasVolatile()) {
       QualifierTokens.push_back(
           {SM.getFileLoc(It->getLocation()), "volatile"});
       Quals.removeVolatile();
@@ -833,7 +990,7 @@ bool EastConstChecker::collectQualifierTokens(
       continue;
     }
 
-    if (isRestrictToken(*It) && Quals.hasRestrict()) {
+    if (Class == EastConstKeywordClass::Restrict && Quals.hasRestrict()) {
       QualifierTokens.push_back(
           {SM.getFileLoc(It->getLocation()), "restrict"});
       Quals.removeRestrict();
@@ -847,7 +1004,7 @@ bool EastConstChecker::collectQualifierTokens(
       continue;
     }
 
-    if (isIgnorableSpecifierToken(*It)) {
+    if (Class == EastConstKeywordClass::IgnorableSpecifier) {
       if (!EncounteredMovable)
         RemovalBound = SM.getFileLoc(It->getLocation());
       continue;
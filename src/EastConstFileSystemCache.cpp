@@ -0,0 +1,217 @@
+#include <EastConstFileSystemCache.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+
+using namespace llvm;
+
+namespace {
+
+// Serves a cached buffer. The buffer belongs to the shared cache; each open
+// hands out a non-owning view of it.
+class CachedFile : public vfs::File {
+public:
+  CachedFile(vfs::Status Status, const MemoryBuffer &Contents)
+      : Status(std::move(Status)), Contents(Contents) {}
+
+  ErrorOr<vfs::Status> status() override { return Status; }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t, bool RequiresNullTerminator,
+            bool) override {
+    return MemoryBuffer::getMemBuffer(Contents.getMemBufferRef(),
+                                      RequiresNullTerminator);
+  }
+
+  std::error_code close() override { return {}; }
+
+private:
+  vfs::Status Status;
+  const MemoryBuffer &Contents;
+};
+
+class CachingFileSystem : public vfs::ProxyFileSystem {
+public:
+  CachingFileSystem(EastConstFileSystemCache &Cache,
+                    IntrusiveRefCntPtr<vfs::FileSystem> Underlying)
+      : ProxyFileSystem(std::move(Underlying)), Cache(Cache) {}
+
+  ErrorOr<vfs::Status> status(const Twine &Path) override {
+    SmallString<256> Key;
+    if (!cacheKey(Path, Key))
+      return ProxyFileSystem::status(Path);
+
+    const EastConstFileSystemCache::Entry *Entry = Cache.lookupStatus(Key);
+    if (!Entry) {
+      ErrorOr<vfs::Status> Result = ProxyFileSystem::status(Key);
+      Entry = Cache.storeStatus(Key, Result.getError(),
+                                Result ? *Result : vfs::Status());
+    }
+    if (Entry->Error)
+      return Entry->Error;
+    return vfs::Status::copyWithNewName(Entry->Status, Path);
+  }
+
+  ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const Twine &Path) override {
+    SmallString<256> Key;
+    if (!cacheKey(Path, Key) || !Cache.cachesContents(Key))
+      return ProxyFileSystem::openFileForRead(Path);
+
+    if (const auto *Entry = Cache.lookupContents(Key)) {
+      if (Entry->Error)
+        return Entry->Error;
+      return std::make_unique<CachedFile>(
+          vfs::Status::copyWithNewName(Entry->Status, Path), *Entry->Contents);
+    }
+
+    ErrorOr<std::unique_ptr<vfs::File>> File =
+        ProxyFileSystem::openFileForRead(Key);
+    if (!File) {
+      Cache.storeStatus(Key, File.getError(), vfs::Status());
+      return File.getError();
+    }
+    ErrorOr<vfs::Status> Status = (*File)->status();
+    if (!Status || !Status->isRegularFile())
+      return File;
+    // getBuffer memory-maps files large enough to benefit; contents are
+    // assumed stable for the run, like the dependency scanner assumes.
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = (*File)->getBuffer(
+        Key, Status->getSize(), /*RequiresNullTerminator=*/true,
+        /*IsVolatile=*/false);
+    if (!Buffer)
+      return Buffer.getError();
+    const auto *Entry = Cache.storeContents(Key, *Status, std::move(*Buffer));
+    return std::make_unique<CachedFile>(
+        vfs::Status::copyWithNewName(Entry->Status, Path), *Entry->Contents);
+  }
+
+private:
+  // Resolves Path against this worker's working directory so workers in
+  // different directories share entries.
+  bool cacheKey(const Twine &Path, SmallVectorImpl<char> &Key) const {
+    Path.toVector(Key);
+    if (makeAbsolute(Key))
+      return false;
+    sys::path::remove_dots(Key, /*remove_dot_dot=*/true);
+    return true;
+  }
+
+  EastConstFileSystemCache &Cache;
+};
+
+} // namespace
+
+EastConstFileSystemCache::Shard &
+EastConstFileSystemCache::shardFor(StringRef Path) {
+  return Shards[xxh3_64bits(Path) % ShardCount];
+}
+
+const EastConstFileSystemCache::Entry *
+EastConstFileSystemCache::lookupStatus(StringRef Path) {
+  Shard &S = shardFor(Path);
+  const Entry *Found = nullptr;
+  {
+    std::lock_guard<std::mutex> Guard(S.Lock);
+    auto It = S.Entries.find(Path);
+    if (It != S.Entries.end())
+      Found = It->second.get();
+  }
+  if (Found) {
+    ++StatHits;
+    if (Found->Error)
+      ++NegativeHits;
+  }
+  return Found;
+}
+
+const EastConstFileSystemCache::Entry *
+EastConstFileSystemCache::lookupContents(StringRef Path) {
+  Shard &S = shardFor(Path);
+  std::lock_guard<std::mutex> Guard(S.Lock);
+  auto It = S.Entries.find(Path);
+  if (It == S.Entries.end())
+    return nullptr;
+  const Entry *Found = It->second.get();
+  if (Found->Error)
+    ++NegativeHits;
+  else if (Found->Contents)
+    ++ContentHits;
+  else
+    return nullptr;
+  return Found;
+}
+
+const EastConstFileSystemCache::Entry *
+EastConstFileSystemCache::storeStatus(StringRef Path, std::error_code Error,
+                                      const vfs::Status &Status) {
+  ++StatMisses;
+  Shard &S = shardFor(Path);
+  std::lock_guard<std::mutex> Guard(S.Lock);
+  std::unique_ptr<Entry> &Slot = S.Entries[Path];
+  if (!Slot) {
+    ++EntryCount;
+    Slot = std::make_unique<Entry>();
+    Slot->Error = Error;
+    Slot->Status = Status;
+  }
+  return Slot.get();
+}
+
+const EastConstFileSystemCache::Entry *EastConstFileSystemCache::storeContents(
+    StringRef Path, const vfs::Status &Status,
+    std::unique_ptr<MemoryBuffer> Contents) {
+  ++ContentMisses;
+  Shard &S = shardFor(Path);
+  std::lock_guard<std::mutex> Guard(S.Lock);
+  std::unique_ptr<Entry> &Slot = S.Entries[Path];
+  if (!Slot) {
+    ++EntryCount;
+    Slot = std::make_unique<Entry>();
+    Slot->Status = Status;
+  }
+  // Contents are set at most once; readers only see them through
+  // lookupContents, under the shard lock.
+  if (!Slot->Contents) {
+    ContentBytes += Contents->getBufferSize();
+    Slot->Contents = std::move(Contents);
+  }
+  return Slot.get();
+}
+
+void EastConstFileSystemCache::skipContents(StringRef Path) {
+  Shard &S = shardFor(Path);
+  std::lock_guard<std::mutex> Guard(S.Lock);
+  S.Uncached.insert(Path);
+}
+
+bool EastConstFileSystemCache::cachesContents(StringRef Path) {
+  Shard &S = shardFor(Path);
+  bool Skipped;
+  {
+    std::lock_guard<std::mutex> Guard(S.Lock);
+    Skipped = S.Uncached.contains(Path);
+  }
+  if (Skipped)
+    ++UncachedReads;
+  return !Skipped;
+}
+
+EastConstFileSystemCacheStats EastConstFileSystemCache::getStats() const {
+  EastConstFileSystemCacheStats Stats;
+  Stats.StatHits = StatHits;
+  Stats.StatMisses = StatMisses;
+  Stats.NegativeHits = NegativeHits;
+  Stats.ContentHits = ContentHits;
+  Stats.ContentMisses = ContentMisses;
+  Stats.ContentBytes = ContentBytes;
+  Stats.UncachedReads = UncachedReads;
+  return Stats;
+}
+
+IntrusiveRefCntPtr<vfs::FileSystem>
+createEastConstCachingFileSystem(EastConstFileSystemCache &Cache,
+                                 IntrusiveRefCntPtr<vfs::FileSystem> Underlying) {
+  return makeIntrusiveRefCnt<CachingFileSystem>(Cache, std::move(Underlying));
+}
@@ -0,0 +1,185 @@
+#include <EastConstFilter.h>
+#include <EastConstAstEngine.h>
+#include <EastConstLogging.h>
+#include <EastConstRewriter.h>
+
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+// Reads In to the end.
+bool readAll(std::FILE *In, std::string &Contents) {
+  Contents.clear();
+  char Chunk[1 << 16];
+  std::size_t Read;
+  while ((Read = std::fread(Chunk, 1, sizeof(Chunk), In)) > 0)
+    Contents.append(Chunk, Read);
+  return !std::ferror(In);
+}
+
+// One rewriter per configuration the sources are compiled with, so that a
+// framed stream of sources sharing their flags runs the driver once.
+class FilterRewriters {
+public:
+  FilterRewriters(const CompilationDatabase &Compilations,
+                  const EastConstCheckerOptions &CheckerOptions,
+                  const EastConstFrontendOptions &FrontendOptions)
+      : Compilations(Compilations), CheckerOptions(CheckerOptions),
+        FrontendOptions(FrontendOptions) {}
+
+  bool rewrite(StringRef FileName, StringRef Code, std::string &Output) {
+    Output = Code.str();
+    SmallString<256> Path(FileName);
+    sys::fs::make_absolute(Path);
+    sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+    std::vector<CompileCommand> Commands =
+        Compilations.getCompileCommands(Path);
+    if (Commands.empty()) {
+      EAST_CONST_LOG(Error, "No compile command for " << Path);
+      return false;
+    }
+    EastConstRewriteResult Result =
+        rewriterFor(Commands.front()).rewrite(Path, Code);
+    if (!Result.Success)
+      return false;
+    Output = std::move(Result.Code);
+    return true;
+  }
+
+private:
+  EastConstRewriter &rewriterFor(const CompileCommand &Command) {
+    // The rewriter takes the flags without the compiler, the input or an
+    // output.
+    CommandLineArguments Arguments = getClangStripDependencyFileAdjuster()(
+        getClangStripOutputAdjuster()(Command.CommandLine, Command.Filename),
+        Command.Filename);
+    // The input may be spelled relative to the directory while Filename is
+    // absolute, or the other way round.
+    const std::string Input = eastConstInputArgument(Command);
+    EastConstRewriterOptions Options;
+    Options.Flags.clear();
+    for (std::size_t I = 1; I < Arguments.size(); ++I)
+      if (Arguments[I] != Input)
+        Options.Flags.push_back(Arguments[I]);
+    SmallString<256> Directory(Command.Directory);
+    sys::fs::make_absolute(Directory);
+    Options.Directory = Directory.str().str();
+    Options.Checker = CheckerOptions;
+    Options.Frontend = FrontendOptions;
+
+    std::string Key = Options.Directory;
+    for (const std::string &Flag : Options.Flags)
+      Key += '\0' + Flag;
+    std::unique_ptr<EastConstRewriter> &Rewriter = Rewriters[Key];
+    if (!Rewriter)
+      Rewriter = std::make_unique<EastConstRewriter>(std::move(Options));
+    return *Rewriter;
+  }
+
+  const CompilationDatabase &Compilations;
+  const EastConstCheckerOptions &CheckerOptions;
+  const EastConstFrontendOptions &FrontendOptions;
+  std::map<std::string, std::unique_ptr<EastConstRewriter>> Rewriters;
+};
+
+} // namespace
+
+bool rewriteEastConstBuffer(const CompilationDatabase &Compilations,
+                            StringRef FileName, StringRef Code,
+                            const EastConstCheckerOptions &CheckerOptions,
+                            const EastConstFrontendOptions &FrontendOptions,
+                            std::string &Output) {
+  FilterRewriters Rewriters(Compilations, CheckerOptions, FrontendOptions);
+  return Rewriters.rewrite(FileName, Code, Output);
+}
+
+bool readEastConstFrame(std::FILE *In, std::string &FileName,
+                        std::string &Contents, std::string &Error) {
+  Error.clear();
+  std::string Header;
+  int C;
+  while ((C = std::fgetc(In)) != EOF && C != '\n')
+    Header += static_cast<char>(C);
+  if (C == EOF) {
+    if (!Header.empty() || std::ferror(In))
+      Error = "the stream ended inside a frame header";
+    return false;
+  }
+  auto [Size, Name] = StringRef(Header).split(' ');
+  std::size_t Bytes;
+  if (Size.getAsInteger(10, Bytes)) {
+    Error = "malformed frame header '" + Header + "'";
+    return false;
+  }
+  FileName = Name.str();
+  Contents.resize(Bytes);
+  if (Bytes > 0 && std::fread(&Contents[0], 1, Bytes, In) != Bytes) {
+    Error = "the stream ended inside the frame of '" + FileName + "'";
+    return false;
+  }
+  return true;
+}
+
+void writeEastConstFrame(raw_ostream &OS, StringRef FileName,
+                         StringRef Contents) {
+  OS << Contents.size();
+  if (!FileName.empty())
+    OS << ' ' << FileName;
+  OS << '\n' << Contents;
+}
+
+int runEastConstFilter(std::FILE *In, raw_ostream &Out,
+                       const CompilationDatabase &Compilations,
+                       StringRef AssumeFileName, bool Framed,
+                       const EastConstCheckerOptions &CheckerOptions,
+                       const EastConstFrontendOptions &FrontendOptions) {
+  FilterRewriters Rewriters(Compilations, CheckerOptions, FrontendOptions);
+  std::string Code;
+  std::string Output;
+  if (!Framed) {
+    if (!readAll(In, Code)) {
+      EAST_CONST_LOG(Error, "Cannot read standard input");
+      return 1;
+    }
+    bool Success = Rewriters.rewrite(AssumeFileName, Code, Output);
+    Out << Output;
+    Out.flush();
+    return Success ? 0 : 1;
+  }
+
+  int Status = 0;
+  unsigned Frames = 0;
+  std::string FileName;
+  std::string Error;
+  while (readEastConstFrame(In, FileName, Code, Error)) {
+    ++Frames;
+    StringRef Name = FileName.empty() ? AssumeFileName : StringRef(FileName);
+    if (!Rewriters.rewrite(Name, Code, Output)) {
+      EAST_CONST_LOG(Error, "Passed frame " << Frames << " (" << Name
+                                            << ") through unchanged");
+      Status = 1;
+    }
+    // The writer on the other end may wait for this answer before it
+    // sends the next file.
+    writeEastConstFrame(Out, FileName, Output);
+    Out.flush();
+  }
+  if (!Error.empty()) {
+    EAST_CONST_LOG(Error, "Framed input: " << Error);
+    return 1;
+  }
+  EAST_CONST_LOG(Info, "Rewrote " << Frames << " framed sources");
+  return Status;
+}
@@ -0,0 +1,69 @@
+#include <EastConstFormat.h>
+
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+#include <utility>
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace llvm;
+
+EastConstRangeFormatter::EastConstRangeFormatter(std::string FallbackStyle)
+    : FallbackStyle(std::move(FallbackStyle)) {}
+
+Expected<Replacements>
+EastConstRangeFormatter::format(StringRef File, StringRef Code,
+                                const Replacements &Fixes) {
+  if (Fixes.empty())
+    return Fixes;
+  Expected<std::string> Fixed = applyAllReplacements(Code, Fixes);
+  if (!Fixed)
+    return Fixed.takeError();
+  Expected<format::FormatStyle> Style = styleFor(File);
+  if (!Style)
+    return Style.takeError();
+  // Only the lines holding an affected range are formatted.
+  Replacements Formatting =
+      format::reformat(*Style, *Fixed, Fixes.getAffectedRanges(), File);
+  return Fixes.merge(Formatting);
+}
+
+Expected<std::vector<Replacement>>
+EastConstRangeFormatter::formatFile(StringRef File,
+                                    ArrayRef<Replacement> Fixes) {
+  if (Fixes.empty())
+    return std::vector<Replacement>();
+  auto Buffer = MemoryBuffer::getFile(File);
+  if (!Buffer)
+    return errorCodeToError(Buffer.getError());
+  Replacements Replaces;
+  for (const Replacement &Rep : Fixes)
+    if (Error Err = Replaces.add(Rep))
+      return std::move(Err);
+  Expected<Replacements> Formatted =
+      format(File, (*Buffer)->getBuffer(), Replaces);
+  if (!Formatted)
+    return Formatted.takeError();
+  return std::vector<Replacement>(Formatted->begin(), Formatted->end());
+}
+
+Expected<format::FormatStyle>
+EastConstRangeFormatter::styleFor(StringRef File) {
+  // Which section of a .clang-format applies depends on the language,
+  // which clang-format guesses from the extension.
+  std::string Key = (sys::path::parent_path(File) + "\n" +
+                     sys::path::extension(File))
+                        .str();
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Styles.find(Key);
+  if (It != Styles.end())
+    return It->second;
+  Expected<format::FormatStyle> Style =
+      format::getStyle("file", File, FallbackStyle);
+  if (!Style)
+    return Style.takeError();
+  Styles.try_emplace(Key, *Style);
+  return Style;
+}
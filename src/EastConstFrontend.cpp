@@ -0,0 +1,187 @@
+#include <EastConstFrontend.h>
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/Decl.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Frontend/MultiplexConsumer.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Path.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace clang;
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+
+namespace {
+
+std::string absolutePath(FileManager &Files, llvm::StringRef Name) {
+  llvm::SmallString<256> Path(Name);
+  Files.makeAbsolutePath(Path);
+  llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return Path.str().str();
+}
+
+// Answers the parser's "may I skip this body?" question. With
+// SkipFunctionBodies set the parser asks for every body; the default
+// consumer answers yes, which would also hide the main file's locals.
+class BodySkippingConsumer : public MultiplexConsumer {
+public:
+  BodySkippingConsumer(std::vector<std::unique_ptr<ASTConsumer>> Consumers,
+                       const SourceManager &SM, bool SkipMainFileBodies)
+      : MultiplexConsumer(std::move(Consumers)), SM(SM),
+        SkipMainFileBodies(SkipMainFileBodies) {}
+
+  bool shouldSkipFunctionBody(Decl *D) override {
+    if (SkipMainFileBodies)
+      return true;
+    return !SM.isInMainFile(SM.getExpansionLoc(D->getLocation()));
+  }
+
+private:
+  const SourceManager &SM;
+  bool SkipMainFileBodies;
+};
+
+class EastConstFrontendAction : public ASTFrontendAction {
+public:
+  EastConstFrontendAction(MatchFinder &Finder,
+                          const EastConstFrontendOptions &Options)
+      : Finder(Finder), Options(Options) {}
+
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef) override {
+    if (Options.OnDependencies) {
+      // The preprocessor exists already; the instance only keeps the
+      // collector alive as long as itself.
+      Dependencies = std::make_shared<DependencyCollector>();
+      Dependencies->attachToPreprocessor(CI.getPreprocessor());
+      CI.addDependencyCollector(Dependencies);
+    }
+    if (!Options.skipsBodies())
+      return Finder.newASTConsumer();
+    std::vector<std::unique_ptr<ASTConsumer>> Consumers;
+    Consumers.push_back(Finder.newASTConsumer());
+    return std::make_unique<BodySkippingConsumer>(
+        std::move(Consumers), CI.getSourceManager(),
+        Options.SkipMainFileBodies);
+  }
+
+  void EndSourceFileAction() override {
+    if (!Dependencies)
+      return;
+    FileManager &Files = getCompilerInstance().getFileManager();
+    std::vector<std::string> Paths;
+    for (const std::string &Dependency : Dependencies->getDependencies())
+      Paths.push_back(absolutePath(Files, Dependency));
+    Options.OnDependencies(absolutePath(Files, getCurrentFile()), Paths);
+    Dependencies.reset();
+  }
+
+private:
+  MatchFinder &Finder;
+  EastConstFrontendOptions Options;
+  std::shared_ptr<DependencyCollector> Dependencies;
+};
+
+class EastConstActionFactory : public FrontendActionFactory {
+public:
+  EastConstActionFactory(MatchFinder &Finder,
+                         const EastConstFrontendOptions &Options)
+      : Finder(Finder), Options(Options) {}
+
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<EastConstFrontendAction>(Finder, Options);
+  }
+
+  // ToolInvocation resets DisableFree on every invocation it builds, so the
+  // profile has to be applied here rather than through command-line flags.
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    if (Options.skipsBodies()) {
+      FrontendOptions &FrontendOpts = Invocation->getFrontendOpts();
+      FrontendOpts.SkipFunctionBodies = true;
+      FrontendOpts.DisableFree = true;
+      Invocation->getDiagnosticOpts().IgnoreWarnings = true;
+    }
+    return FrontendActionFactory::runInvocation(
+        std::move(Invocation), Files, std::move(PCHContainerOps),
+        DiagConsumer);
+  }
+
+private:
+  MatchFinder &Finder;
+  EastConstFrontendOptions Options;
+};
+
+} // namespace
+
+std::unique_ptr<FrontendActionFactory>
+newEastConstActionFactory(MatchFinder &Finder,
+                          const EastConstFrontendOptions &Options) {
+  return std::make_unique<EastConstActionFactory>(Finder, Options);
+}
+
+bool EastConstCapturingFactory::runInvocation(
+    std::shared_ptr<CompilerInvocation> Invocation, FileManager *Files,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    DiagnosticConsumer *DiagConsumer) {
+  Captured = std::make_shared<CompilerInvocation>(*Invocation);
+  CapturedFiles = Files;
+  CapturedDiagConsumer = DiagConsumer;
+  return Inner.runInvocation(std::move(Invocation), Files,
+                             std::move(PCHContainerOps), DiagConsumer);
+}
+
+bool EastConstCapturingFactory::captured() const {
+  return Captured && Captured->getFrontendOpts().Inputs.size() == 1;
+}
+
+bool runEastConstInvocationFor(
+    FrontendActionFactory &Factory, const CompilerInvocation &Invocation,
+    llvm::StringRef MainFile, llvm::StringRef Directory, FileManager *Files,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    DiagnosticConsumer *DiagConsumer,
+    std::unique_ptr<llvm::MemoryBuffer> MainBuffer) {
+  auto Copy = std::make_shared<CompilerInvocation>(Invocation);
+  FrontendOptions &FrontendOpts = Copy->getFrontendOpts();
+  // MainFile's extension decides its language, as it does for the driver.
+  // Only when the pooled file's own extension did not decide its language
+  // either (-x, or a C++ driver reading .c) is that forced language kept.
+  // The copied LangOptions stay the pooled file's, so callers pool only
+  // files with the same driver and language.
+  const FrontendInputFile &Pooled = FrontendOpts.Inputs.front();
+  InputKind Kind = Pooled.getKind();
+  auto KindOf = [](llvm::StringRef File) {
+    llvm::StringRef Extension = llvm::sys::path::extension(File);
+    Extension.consume_front(".");
+    return FrontendOptions::getInputKindForExtension(Extension);
+  };
+  InputKind MainKind = KindOf(MainFile);
+  if (MainKind.getLanguage() != Language::Unknown &&
+      (!Pooled.isFile() ||
+       KindOf(Pooled.getFile()).getLanguage() == Kind.getLanguage()))
+    Kind = MainKind;
+  FrontendOpts.Inputs.clear();
+  FrontendOpts.Inputs.emplace_back(MainFile, Kind);
+  Copy->getCodeGenOpts().MainFileName =
+      llvm::sys::path::filename(MainFile).str();
+  // The source manager takes the buffer over.
+  if (MainBuffer)
+    Copy->getPreprocessorOpts().addRemappedFile(MainFile,
+                                                MainBuffer.release());
+  Files->getVirtualFileSystem().setCurrentWorkingDirectory(Directory);
+  return Factory.runInvocation(std::move(Copy), Files,
+                               std::move(PCHContainerOps), DiagConsumer);
+}
@@ -0,0 +1,1058 @@
+#include <EastConstLexerEngine.h>
+#include <EastConstKeywords.h>
+
+#include <clang/Basic/SourceManager.h>
+#include <clang/Lex/Lexer.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/Error.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace clang;
+using namespace llvm;
+
+namespace {
+
+struct RawToken {
+  tok::TokenKind Kind = tok::unknown;
+  unsigned Offset = 0;
+  unsigned Length = 0;
+  StringRef Text;
+  EastConstKeywordClass Class = EastConstKeywordClass::Other;
+
+  bool is(tok::TokenKind K) const { return Kind == K; }
+  template <typename... Ts> bool isOneOf(Ts... Ks) const {
+    return ((Kind == Ks) || ...);
+  }
+  bool isWord(StringRef Word) const {
+    return Kind == tok::raw_identifier && Text == Word;
+  }
+  bool isQualifier() const {
+    return Class == EastConstKeywordClass::Const ||
+           Class == EastConstKeywordClass::Volatile ||
+           Class == EastConstKeywordClass::Restrict;
+  }
+  bool isSpecifier() const {
+    return Class == EastConstKeywordClass::IgnorableSpecifier;
+  }
+  unsigned end() const { return Offset + Length; }
+};
+
+bool isBuiltinTypeWord(StringRef Text) {
+  return StringSwitch<bool>(Text)
+      .Cases("void", "bool", "char", "wchar_t", "char8_t", "char16_t",
+             "char32_t", true)
+      .Cases("short", "int", "long", "signed", "unsigned", "float", "double",
+             true)
+      .Cases("__int128", "_Bool", "__int64", "__int32", true)
+      .Default(false);
+}
+
+// Words that can never start or name a type in a declaration.
+bool isReservedWord(StringRef Text) {
+  return StringSwitch<bool>(Text)
+      .Cases("return", "new", "delete", "operator", "sizeof", "alignof",
+             "throw", "case", "goto", true)
+      .Cases("if", "else", "for", "while", "do", "switch", "try", "catch",
+             true)
+      .Cases("this", "true", "false", "nullptr", "namespace", "using",
+             "template", "typename", true)
+      .Cases("public", "private", "protected", "default", "break",
+             "continue", "asm", true)
+      .Cases("co_return", "co_await", "co_yield", "static_assert",
+             "noexcept", "explicit", "virtual", "override", "final", true)
+      .Cases("struct", "class", "union", "enum", "decltype", "auto",
+             "requires", "concept", true)
+      .Cases("static_cast", "const_cast", "dynamic_cast", "reinterpret_cast",
+             true)
+      .Default(false);
+}
+
+bool isNameToken(const RawToken &Tok) {
+  return Tok.Kind == tok::raw_identifier &&
+         Tok.Class == EastConstKeywordClass::Other &&
+         !isBuiltinTypeWord(Tok.Text) && !isReservedWord(Tok.Text);
+}
+
+enum class ScopeKind { Namespace, Class, Enum, Block, Init };
+enum class ParenKind { Params, Control, Other };
+
+struct StatementState {
+  bool SeenClassKey = false;
+  bool SeenNamespace = false;
+  bool SeenEnum = false;
+  bool SeenEquals = false;
+  bool SeenParenGroup = false;
+};
+
+struct Bracket {
+  tok::TokenKind Open = tok::unknown;
+  ScopeKind Scope = ScopeKind::Block;
+  ParenKind Paren = ParenKind::Other;
+  bool TemplateParams = false;
+  bool CastTarget = false;
+  // Token index of the opening bracket.
+  size_t OpenIndex = 0;
+  // Statement state of the enclosing level, restored when a brace closes.
+  StatementState Saved;
+};
+
+struct TypeExtent {
+  unsigned EndOffset = 0;
+  size_t Next = 0;
+  // The type ended inside a `>>` token; Next still points at that token.
+  bool SplitAngle = false;
+};
+
+struct DeclaratorShape {
+  bool Named = false;
+  bool Function = false;
+  bool ParenDeclarator = false;
+  // Index of the token after the declarator name (the `(` for functions).
+  size_t After = 0;
+};
+
+struct Classification {
+  EastConstDeclKind Kind = EastConstDeclKind::Variable;
+  bool Ambiguous = false;
+  StringRef Reason;
+};
+
+class SiteScanner {
+public:
+  SiteScanner(std::vector<RawToken> Tokens, const EastConstCheckerOptions &Opts)
+      : Tokens(std::move(Tokens)), Options(Opts) {}
+
+  std::vector<LexerEngineSite> run() {
+    for (size_t I = 0; I < Tokens.size(); ++I) {
+      if (Tokens[I].isQualifier() &&
+          (I == 0 || !Tokens[I - 1].isQualifier()))
+        considerSite(I);
+      advance(I);
+    }
+    return std::move(Sites);
+  }
+
+private:
+  const RawToken *tokenAt(size_t I) const {
+    return I < Tokens.size() ? &Tokens[I] : nullptr;
+  }
+
+  bool atStatementLevel() const { return Stack.size() == StatementDepth; }
+
+  void resetStatement() {
+    Statement = StatementState();
+    StatementDepth = Stack.size();
+  }
+
+  void popStrayAngles() {
+    while (!Stack.empty() && Stack.back().Open == tok::less)
+      Stack.pop_back();
+  }
+
+  void popUntil(tok::TokenKind Open) {
+    while (!Stack.empty()) {
+      tok::TokenKind Top = Stack.back().Open;
+      Stack.pop_back();
+      if (Top == Open)
+        return;
+    }
+  }
+
+  ScopeKind classifyBrace(size_t I) const {
+    const RawToken *Prev = I > 0 ? &Tokens[I - 1] : nullptr;
+    if (Statement.SeenNamespace)
+      return ScopeKind::Namespace;
+    if (Prev && Prev->is(tok::string_literal) && I >= 2 &&
+        Tokens[I - 2].isWord("extern"))
+      return ScopeKind::Namespace;
+    if (Statement.SeenEnum)
+      return ScopeKind::Enum;
+    if (Statement.SeenClassKey && !Statement.SeenParenGroup &&
+        !Statement.SeenEquals)
+      return ScopeKind::Class;
+    if (!Prev)
+      return ScopeKind::Block;
+    switch (Prev->Kind) {
+    case tok::equal:
+    case tok::comma:
+    case tok::l_paren:
+    case tok::l_brace:
+    case tok::l_square:
+      return Prev->is(tok::l_brace) && atStatementLevel() ? ScopeKind::Block
+                                                           : ScopeKind::Init;
+    case tok::r_paren:
+    case tok::r_square:
+    case tok::r_brace:
+    case tok::semi:
+    case tok::colon:
+      return ScopeKind::Block;
+    default:
+      break;
+    }
+    if (Prev->isQualifier())
+      return ScopeKind::Block;
+    if (Prev->Kind == tok::raw_identifier &&
+        StringSwitch<bool>(Prev->Text)
+            .Cases("noexcept", "override", "final", "mutable", "try", "else",
+                   "do", true)
+            .Default(false))
+      return ScopeKind::Block;
+    if (Prev->Kind == tok::raw_identifier && Statement.SeenParenGroup)
+      return ScopeKind::Block;
+    return ScopeKind::Init;
+  }
+
+  ParenKind classifyParen(size_t I) const {
+    if (I == 0)
+      return ParenKind::Other;
+    const RawToken &Prev = Tokens[I - 1];
+    if (Prev.Kind == tok::raw_identifier) {
+      if (StringSwitch<bool>(Prev.Text)
+              .Cases("for", "if", "while", "switch", "catch", true)
+              .Default(false))
+        return ParenKind::Control;
+      if (isNameToken(Prev) || isBuiltinTypeWord(Prev.Text))
+        return ParenKind::Params;
+      return ParenKind::Other;
+    }
+    if (Prev.isOneOf(tok::greater, tok::greatergreater, tok::r_square,
+                     tok::r_paren))
+      return ParenKind::Params;
+    // Overloaded operators: `operator=(`, `operator<(`, ...
+    if (I >= 2 && Tokens[I - 2].isWord("operator"))
+      return ParenKind::Params;
+    return ParenKind::Other;
+  }
+
+  bool opensTemplateArgs(size_t I) const {
+    if (I == 0)
+      return false;
+    const RawToken &Prev = Tokens[I - 1];
+    return Prev.isWord("template") || isNameToken(Prev) ||
+           Prev.isWord("static_cast") || Prev.isWord("const_cast") ||
+           Prev.isWord("dynamic_cast") || Prev.isWord("reinterpret_cast");
+  }
+
+  void advance(size_t I) {
+    const RawToken &Tok = Tokens[I];
+    switch (Tok.Kind) {
+    case tok::l_brace: {
+      popStrayAngles();
+      Bracket B;
+      B.Open = tok::l_brace;
+      B.Scope = classifyBrace(I);
+      B.Saved = Statement;
+      Stack.push_back(B);
+      resetStatement();
+      return;
+    }
+    case tok::r_brace: {
+      StatementState Outer;
+      ScopeKind Closed = ScopeKind::Block;
+      while (!Stack.empty()) {
+        Bracket Top = Stack.back();
+        Stack.pop_back();
+        if (Top.Open == tok::l_brace) {
+          Outer = Top.Saved;
+          Closed = Top.Scope;
+          break;
+        }
+      }
+      if (Closed == ScopeKind::Class || Closed == ScopeKind::Enum ||
+          Closed == ScopeKind::Init) {
+        Statement = Outer;
+        StatementDepth = Stack.size();
+      } else {
+        resetStatement();
+      }
+      return;
+    }
+    case tok::semi:
+      popStrayAngles();
+      if (Stack.empty() || Stack.back().Open == tok::l_brace)
+        resetStatement();
+      return;
+    case tok::l_paren: {
+      Bracket B;
+      B.Open = tok::l_paren;
+      B.Paren = classifyParen(I);
+      Stack.push_back(B);
+      return;
+    }
+    case tok::r_paren:
+      popUntil(tok::l_paren);
+      if (atStatementLevel())
+        Statement.SeenParenGroup = true;
+      return;
+    case tok::l_square: {
+      Bracket B;
+      B.Open = tok::l_square;
+      Stack.push_back(B);
+      return;
+    }
+    case tok::r_square:
+      popUntil(tok::l_square);
+      return;
+    case tok::less:
+      if (opensTemplateArgs(I)) {
+        Bracket B;
+        B.Open = tok::less;
+        B.OpenIndex = I;
+        B.TemplateParams = Tokens[I - 1].isWord("template");
+        B.CastTarget = !B.TemplateParams && !isNameToken(Tokens[I - 1]);
+        Stack.push_back(B);
+      }
+      return;
+    case tok::greater:
+    case tok::greatergreater: {
+      unsigned Levels = Tok.is(tok::greater) ? 1 : 2;
+      while (Levels-- > 0 && !Stack.empty() &&
+             Stack.back().Open == tok::less) {
+        if (Stack.back().TemplateParams)
+          TemplateHeaderEnds.insert(I);
+        Stack.pop_back();
+      }
+      return;
+    }
+    case tok::equal:
+      if (atStatementLevel())
+        Statement.SeenEquals = true;
+      return;
+    case tok::raw_identifier:
+      if (!atStatementLevel())
+        return;
+      if (Tok.Text == "class" || Tok.Text == "struct" || Tok.Text == "union")
+        Statement.SeenClassKey = true;
+      else if (Tok.Text == "namespace")
+        Statement.SeenNamespace = true;
+      else if (Tok.Text == "enum")
+        Statement.SeenEnum = true;
+      return;
+    default:
+      return;
+    }
+  }
+
+  // Consumes `< ... >` starting at the `<` at index I. Returns false when the
+  // list is not closed before a statement boundary.
+  bool consumeAngles(size_t &I, TypeExtent &Extent) const {
+    int Depth = 0;
+    int ParenDepth = 0;
+    for (; I < Tokens.size(); ++I) {
+      const RawToken &Tok = Tokens[I];
+      switch (Tok.Kind) {
+      case tok::less:
+        if (ParenDepth == 0)
+          ++Depth;
+        break;
+      case tok::greater:
+        if (ParenDepth == 0 && --Depth == 0) {
+          Extent.EndOffset = Tok.end();
+          Extent.Next = I + 1;
+          return true;
+        }
+        break;
+      case tok::greatergreater:
+        if (ParenDepth != 0)
+          break;
+        if (Depth == 1) {
+          Extent.EndOffset = Tok.Offset + 1;
+          Extent.Next = I;
+          Extent.SplitAngle = true;
+          return true;
+        }
+        Depth -= 2;
+        if (Depth == 0) {
+          Extent.EndOffset = Tok.end();
+          Extent.Next = I + 1;
+          return true;
+        }
+        break;
+      case tok::l_paren:
+        ++ParenDepth;
+        break;
+      case tok::r_paren:
+        if (--ParenDepth < 0)
+          return false;
+        break;
+      case tok::semi:
+      case tok::l_brace:
+      case tok::r_brace:
+      case tok::eof:
+        return false;
+      default:
+        break;
+      }
+    }
+    return false;
+  }
+
+  bool consumeParens(size_t &I) const {
+    int Depth = 0;
+    for (; I < Tokens.size(); ++I) {
+      if (Tokens[I].is(tok::l_paren))
+        ++Depth;
+      else if (Tokens[I].is(tok::r_paren) && --Depth == 0)
+        return true;
+      else if (Tokens[I].isOneOf(tok::semi, tok::l_brace, tok::r_brace))
+        return false;
+    }
+    return false;
+  }
+
+  // Parses the type specifier that follows a qualifier run.
+  bool parseType(size_t I, TypeExtent &Extent) const {
+    const RawToken *Tok = tokenAt(I);
+    if (!Tok)
+      return false;
+
+    if (Tok->isWord("typename") || Tok->isWord("struct") ||
+        Tok->isWord("class") || Tok->isWord("union") ||
+        Tok->isWord("enum")) {
+      Tok = tokenAt(++I);
+      if (!Tok)
+        return false;
+    }
+
+    if (Tok->Kind == tok::raw_identifier && isBuiltinTypeWord(Tok->Text)) {
+      while (I + 1 < Tokens.size() && Tokens[I + 1].Kind == tok::raw_identifier &&
+             isBuiltinTypeWord(Tokens[I + 1].Text))
+        ++I;
+      Extent.EndOffset = Tokens[I].end();
+      Extent.Next = I + 1;
+      return true;
+    }
+
+    if (Tok->isWord("auto")) {
+      Extent.EndOffset = Tok->end();
+      Extent.Next = I + 1;
+      return true;
+    }
+
+    if (Tok->isWord("decltype") || Tok->isWord("__typeof__") ||
+        Tok->isWord("typeof")) {
+      size_t Close = I + 1;
+      if (!tokenAt(Close) || !Tokens[Close].is(tok::l_paren) ||
+          !consumeParens(Close))
+        return false;
+      Extent.EndOffset = Tokens[Close].end();
+      Extent.Next = Close + 1;
+      return true;
+    }
+
+    if (Tok->is(tok::coloncolon))
+      Tok = tokenAt(++I);
+    while (Tok && isNameToken(*Tok)) {
+      Extent.EndOffset = Tok->end();
+      Extent.Next = I + 1;
+      const RawToken *Next = tokenAt(I + 1);
+      if (Next && Next->is(tok::less)) {
+        size_t AngleIndex = I + 1;
+        if (!consumeAngles(AngleIndex, Extent))
+          return false;
+        if (Extent.SplitAngle)
+          return true;
+        I = Extent.Next - 1;
+        Next = tokenAt(I + 1);
+      }
+      if (!Next || !Next->is(tok::coloncolon))
+        return true;
+      // `Name::*` introduces a member pointer declarator, not a nested name.
+      const RawToken *AfterScope = tokenAt(I + 2);
+      if (!AfterScope || AfterScope->is(tok::star))
+        return true;
+      I += 2;
+      if (AfterScope->isWord("template"))
+        ++I;
+      Tok = tokenAt(I);
+    }
+    return Extent.EndOffset != 0 && Extent.Next != 0;
+  }
+
+  bool looksLikeInitializer(size_t OpenParen) const {
+    const RawToken *Inside = tokenAt(OpenParen + 1);
+    if (!Inside)
+      return false;
+    if (Inside->isOneOf(tok::numeric_constant, tok::string_literal,
+                        tok::char_constant, tok::minus, tok::l_brace,
+                        tok::amp, tok::exclaim))
+      return true;
+    return Inside->isWord("true") || Inside->isWord("false") ||
+           Inside->isWord("nullptr") || Inside->isWord("this");
+  }
+
+  bool parseDeclarator(const TypeExtent &Type, DeclaratorShape &Shape) const {
+    if (Type.SplitAngle)
+      return true;
+
+    size_t I = Type.Next;
+    while (const RawToken *Tok = tokenAt(I)) {
+      if (Tok->isOneOf(tok::star, tok::amp, tok::ampamp, tok::ellipsis) ||
+          Tok->isQualifier()) {
+        ++I;
+        continue;
+      }
+      // Member pointer: `Class::*`.
+      if (isNameToken(*Tok) && tokenAt(I + 1) &&
+          Tokens[I + 1].is(tok::coloncolon) && tokenAt(I + 2) &&
+          Tokens[I + 2].is(tok::star)) {
+        I += 3;
+        continue;
+      }
+      break;
+    }
+
+    const RawToken *Tok = tokenAt(I);
+    if (!Tok)
+      return false;
+
+    if (isNameToken(*Tok) || Tok->isWord("operator") || Tok->is(tok::tilde)) {
+      Shape.Named = true;
+      while (true) {
+        const RawToken *Cur = tokenAt(I);
+        if (!Cur)
+          return false;
+        if (Cur->isWord("operator")) {
+          // Skip the operator's spelling up to its parameter list.
+          ++I;
+          while (tokenAt(I) && !Tokens[I].is(tok::l_paren))
+            ++I;
+          if (tokenAt(I) && tokenAt(I + 1) && Tokens[I + 1].is(tok::r_paren) &&
+              tokenAt(I + 2) && Tokens[I + 2].is(tok::l_paren))
+            I += 2; // operator()
+          break;
+        }
+        if (Cur->is(tok::tilde))
+          ++I;
+        if (!tokenAt(I) || !isNameToken(Tokens[I]))
+          return false;
+        ++I;
+        if (tokenAt(I) && Tokens[I].is(tok::less)) {
+          TypeExtent Ignored;
+          size_t Angle = I;
+          if (!consumeAngles(Angle, Ignored) || Ignored.SplitAngle)
+            return false;
+          I = Ignored.Next;
+        }
+        if (tokenAt(I) && Tokens[I].is(tok::coloncolon)) {
+          ++I;
+          continue;
+        }
+        break;
+      }
+      Shape.After = I;
+      Shape.Function = tokenAt(I) && Tokens[I].is(tok::l_paren);
+      return true;
+    }
+
+    if (Tok->is(tok::l_paren)) {
+      Shape.ParenDeclarator = true;
+      Shape.After = I;
+      return true;
+    }
+
+    return Tok->isOneOf(tok::greater, tok::greatergreater, tok::comma,
+                        tok::r_paren, tok::l_square, tok::equal, tok::semi,
+                        tok::colon, tok::l_brace);
+  }
+
+  // Scope of the innermost brace among the first Depth stack entries.
+  ScopeKind innermostScope(size_t Depth) const {
+    for (size_t I = Depth; I > 0; --I)
+      if (Stack[I - 1].Open == tok::l_brace)
+        return Stack[I - 1].Scope;
+    return ScopeKind::Namespace;
+  }
+
+  static bool isTypeArgumentList(const Bracket &B) {
+    return B.Open == tok::less && !B.TemplateParams && !B.CastTarget;
+  }
+
+  bool classifyStatementLevel(const DeclaratorShape &Shape, bool SawTypedef,
+                              bool SawStatic, size_t Depth,
+                              Classification &Result) const {
+    if (Depth != 0 && Stack[Depth - 1].Open != tok::l_brace)
+      return false;
+    ScopeKind Scope = innermostScope(Depth);
+    if (Scope == ScopeKind::Enum || Scope == ScopeKind::Init)
+      return false;
+    if (!Shape.Named && !Shape.ParenDeclarator)
+      return false;
+
+    if (SawTypedef) {
+      Result.Kind = EastConstDeclKind::Typedef;
+    } else if (Shape.Function && Scope != ScopeKind::Block &&
+               !looksLikeInitializer(Shape.After)) {
+      Result.Kind = EastConstDeclKind::ReturnType;
+    } else if (Scope == ScopeKind::Class && !SawStatic) {
+      Result.Kind = EastConstDeclKind::Field;
+    } else {
+      Result.Kind = EastConstDeclKind::Variable;
+    }
+
+    if (Shape.ParenDeclarator) {
+      Result.Ambiguous = true;
+      Result.Reason = "parenthesized declarator";
+    }
+    return true;
+  }
+
+  // Finds the index of the token closing the innermost open `<`, scanning
+  // forward from I.
+  size_t findAngleClose(size_t I) const {
+    int Depth = 1;
+    int ParenDepth = 0;
+    for (; I < Tokens.size(); ++I) {
+      const RawToken &Tok = Tokens[I];
+      if (Tok.is(tok::l_paren))
+        ++ParenDepth;
+      else if (Tok.is(tok::r_paren))
+        --ParenDepth;
+      else if (ParenDepth == 0 && Tok.is(tok::less))
+        ++Depth;
+      else if (ParenDepth == 0 && Tok.is(tok::greater) && --Depth == 0)
+        return I;
+      else if (ParenDepth == 0 && Tok.is(tok::greatergreater) &&
+               (Depth -= 2) <= 0)
+        return I;
+      else if (Tok.isOneOf(tok::semi, tok::l_brace, tok::r_brace))
+        break;
+    }
+    return Tokens.size() - 1;
+  }
+
+  // Walks back from I over qualifiers, specifiers and [[attributes]] to the
+  // first token of the decl-specifier sequence.
+  size_t findContextStart(size_t I, bool &SawTypedef, bool &SawStatic) const {
+    size_t Begin = I;
+    while (Begin > 0) {
+      const RawToken &Prev = Tokens[Begin - 1];
+      if (Prev.isSpecifier() || Prev.isQualifier() ||
+          Prev.isWord("virtual") || Prev.isWord("explicit")) {
+        SawTypedef |= Prev.Text == "typedef";
+        SawStatic |= Prev.Text == "static";
+        --Begin;
+        continue;
+      }
+      if (Prev.is(tok::r_square) && Begin >= 2 &&
+          Tokens[Begin - 2].is(tok::r_square)) {
+        size_t Open = Begin - 2;
+        int Depth = 0;
+        bool Found = false;
+        while (true) {
+          if (Tokens[Open].is(tok::r_square))
+            ++Depth;
+          else if (Tokens[Open].is(tok::l_square) && --Depth == 0) {
+            Found = true;
+            break;
+          }
+          if (Open == 0)
+            break;
+          --Open;
+        }
+        if (!Found || Open == 0 || !Tokens[Open - 1].is(tok::l_square))
+          break;
+        Begin = Open - 1;
+        continue;
+      }
+      break;
+    }
+    return Begin;
+  }
+
+  // The checker attributes a qualifier inside template arguments to the
+  // declaration that owns the outermost template-id, so classify that
+  // template-id's type as though it were the site. Depth counts the stack
+  // entries up to and including the innermost `<`.
+  bool classifyTemplateOwner(size_t Depth, Classification &Result) const {
+    while (Depth >= 2) {
+      const Bracket &Below = Stack[Depth - 2];
+      if (isTypeArgumentList(Below)) {
+        --Depth;
+        continue;
+      }
+      // A function type inside template arguments: `function<void(const T)>`.
+      if (Below.Open == tok::l_paren && Below.Paren == ParenKind::Params &&
+          Depth >= 3 && isTypeArgumentList(Stack[Depth - 3])) {
+        Depth -= 2;
+        continue;
+      }
+      break;
+    }
+
+    const Bracket &Angle = Stack[Depth - 1];
+    size_t TypeStart = Angle.OpenIndex - 1;
+    while (TypeStart >= 2 && Tokens[TypeStart - 1].is(tok::coloncolon) &&
+           isNameToken(Tokens[TypeStart - 2]))
+      TypeStart -= 2;
+    if (TypeStart >= 1 && Tokens[TypeStart - 1].is(tok::coloncolon))
+      --TypeStart;
+    bool ClassKey = false;
+    if (TypeStart >= 1) {
+      const RawToken &Key = Tokens[TypeStart - 1];
+      ClassKey = Key.isWord("struct") || Key.isWord("class") ||
+                 Key.isWord("union");
+      if (ClassKey || Key.isWord("typename") || Key.isWord("enum"))
+        --TypeStart;
+    }
+
+    size_t Close = findAngleClose(Angle.OpenIndex + 1);
+    const RawToken *AfterClose = tokenAt(Close + 1);
+    // Explicit or partial specialization: `struct X<const int> {`.
+    if (ClassKey && AfterClose &&
+        AfterClose->isOneOf(tok::l_brace, tok::colon)) {
+      Result.Kind = EastConstDeclKind::TemplateArgument;
+      return true;
+    }
+    if (AfterClose && AfterClose->is(tok::l_paren) &&
+        innermostScope(Depth - 1) == ScopeKind::Block) {
+      Result.Kind = EastConstDeclKind::TemplateArgument;
+      Result.Ambiguous = true;
+      Result.Reason = "template arguments in an expression";
+      return true;
+    }
+
+    bool SawTypedef = false;
+    bool SawStatic = false;
+    size_t Begin = findContextStart(TypeStart, SawTypedef, SawStatic);
+    TypeExtent Type;
+    DeclaratorShape Shape;
+    if (!parseType(TypeStart, Type) || !parseDeclarator(Type, Shape))
+      return false;
+    return classify(Begin, Shape, SawTypedef, SawStatic, Depth - 1, Result);
+  }
+
+  // Classifies a type whose decl-specifier sequence starts at Begin, looking
+  // only at the first Depth entries of the bracket stack.
+  bool classify(size_t Begin, const DeclaratorShape &Shape, bool SawTypedef,
+                bool SawStatic, size_t Depth, Classification &Result) const {
+    const RawToken *Prev = Begin > 0 ? &Tokens[Begin - 1] : nullptr;
+    const Bracket *Top = Depth == 0 ? nullptr : &Stack[Depth - 1];
+
+    bool StatementStart =
+        !Prev || Prev->isOneOf(tok::semi, tok::l_brace, tok::r_brace) ||
+        (Prev->is(tok::greater) && TemplateHeaderEnds.count(Begin - 1));
+    if (!StatementStart && Prev->is(tok::colon) && Begin >= 2) {
+      const RawToken &Label = Tokens[Begin - 2];
+      StatementStart = Label.isWord("public") || Label.isWord("private") ||
+                       Label.isWord("protected");
+    }
+    if (StatementStart)
+      return classifyStatementLevel(Shape, SawTypedef, SawStatic, Depth,
+                                    Result);
+
+    if (Top && Top->Open == tok::l_paren &&
+        Prev->isOneOf(tok::l_paren, tok::comma)) {
+      switch (Top->Paren) {
+      case ParenKind::Control:
+        if (!Shape.Named)
+          return false;
+        Result.Kind = EastConstDeclKind::Variable;
+        break;
+      case ParenKind::Params:
+        if (Depth >= 2 && isTypeArgumentList(Stack[Depth - 2]))
+          return classifyTemplateOwner(Depth - 1, Result);
+        Result.Kind = EastConstDeclKind::Parameter;
+        break;
+      case ParenKind::Other:
+        Result.Kind = EastConstDeclKind::Variable;
+        Result.Ambiguous = true;
+        Result.Reason = "type inside expression parentheses";
+        return true;
+      }
+      if (Shape.ParenDeclarator) {
+        Result.Ambiguous = true;
+        Result.Reason = "parenthesized declarator";
+      }
+      return true;
+    }
+
+    if (Top && Top->Open == tok::less && Prev->isOneOf(tok::less, tok::comma)) {
+      if (Top->TemplateParams) {
+        Result.Kind = EastConstDeclKind::NonTypeTemplateParm;
+        return true;
+      }
+      if (Top->CastTarget) {
+        Result.Kind = EastConstDeclKind::TemplateArgument;
+        Result.Ambiguous = true;
+        Result.Reason = "cast target type";
+        return true;
+      }
+      return classifyTemplateOwner(Depth, Result);
+    }
+
+    if (Prev->is(tok::arrow) && (Shape.Named || Shape.Function))
+      return false;
+    if (Prev->is(tok::arrow)) {
+      Result.Kind = EastConstDeclKind::ReturnType;
+      return true;
+    }
+
+    if (Prev->is(tok::equal)) {
+      if (Begin >= 3 && isNameToken(Tokens[Begin - 2]) &&
+          Tokens[Begin - 3].isWord("using")) {
+        Result.Kind = EastConstDeclKind::TypeAlias;
+        return true;
+      }
+      if (Top && Top->Open == tok::less && Top->TemplateParams) {
+        Result.Kind = EastConstDeclKind::TemplateArgument;
+        Result.Ambiguous = true;
+        Result.Reason = "default template argument";
+        return true;
+      }
+      return false;
+    }
+
+    if ((isNameToken(*Prev) || Prev->is(tok::r_paren)) && Shape.Named) {
+      Result.Kind = EastConstDeclKind::Variable;
+      Result.Ambiguous = true;
+      Result.Reason = "unexpanded macro before qualifier";
+      return true;
+    }
+
+    return false;
+  }
+
+  void considerSite(size_t I) {
+    size_t LastQualifier = I;
+    bool SawTypedef = false;
+    bool SawStatic = false;
+
+    size_t J = I;
+    for (; J < Tokens.size(); ++J) {
+      const RawToken &Tok = Tokens[J];
+      if (Tok.isQualifier()) {
+        LastQualifier = J;
+        continue;
+      }
+      if (Tok.isSpecifier()) {
+        SawTypedef |= Tok.Text == "typedef";
+        SawStatic |= Tok.Text == "static";
+        continue;
+      }
+      break;
+    }
+
+    TypeExtent Type;
+    if (!parseType(J, Type))
+      return;
+
+    DeclaratorShape Shape;
+    if (!parseDeclarator(Type, Shape))
+      return;
+
+    size_t Begin = findContextStart(I, SawTypedef, SawStatic);
+    Classification Result;
+    if (!classify(Begin, Shape, SawTypedef, SawStatic, Stack.size(), Result))
+      return;
+    if (!Options.isEnabled(Result.Kind))
+      return;
+
+    // Like the checker, move from the first `const` on; qualifiers west of
+    // it (`volatile const int`) stay where they are.
+    size_t First = I;
+    for (size_t K = I; K <= LastQualifier; ++K) {
+      if (Tokens[K].Class == EastConstKeywordClass::Const) {
+        First = K;
+        break;
+      }
+    }
+
+    LexerEngineSite Site;
+    std::string Suffix;
+    for (size_t K = First; K <= LastQualifier; ++K) {
+      if (!Tokens[K].isQualifier())
+        continue;
+      // A qualifier run ends at the next specifier or at the type.
+      if (K == First || !Tokens[K - 1].isQualifier())
+        Site.Removals.emplace_back(Tokens[K].Offset, 0);
+      Site.Removals.back().second =
+          Tokens[K + 1].Offset - Site.Removals.back().first;
+      switch (Tokens[K].Class) {
+      case EastConstKeywordClass::Const:
+        Suffix += " const";
+        break;
+      case EastConstKeywordClass::Volatile:
+        Suffix += " volatile";
+        break;
+      case EastConstKeywordClass::Restrict:
+        Suffix += " restrict";
+        break;
+      default:
+        break;
+      }
+    }
+
+    Site.QualifierOffset = Tokens[First].Offset;
+    Site.InsertOffset = Type.EndOffset;
+    Site.Suffix = std::move(Suffix);
+    Site.Kind = Result.Kind;
+    Site.NeedsSemanticCheck = Result.Ambiguous;
+    Site.AmbiguityReason = Result.Reason;
+    Sites.push_back(std::move(Site));
+  }
+  std::vector<RawToken> Tokens;
+  const EastConstCheckerOptions &Options;
+  std::vector<Bracket> Stack;
+  StatementState Statement;
+  size_t StatementDepth = 0;
+  llvm::DenseSet<size_t> TemplateHeaderEnds;
+  std::vector<LexerEngineSite> Sites;
+};
+
+std::vector<RawToken> lexTokens(const SourceManager &SM, FileID FID,
+                                const LangOptions &LangOpts) {
+  std::vector<RawToken> Tokens;
+  llvm::MemoryBufferRef Buffer = SM.getBufferOrFake(FID);
+  Lexer Lex(FID, Buffer, SM, LangOpts);
+  Lex.SetCommentRetentionState(false);
+
+  bool InDirective = false;
+  Token Tok;
+  while (true) {
+    Lex.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      break;
+    if (Tok.isAtStartOfLine())
+      InDirective = Tok.is(tok::hash);
+    if (InDirective)
+      continue;
+
+    RawToken Raw;
+    Raw.Kind = Tok.getKind();
+    Raw.Offset = SM.getFileOffset(Tok.getLocation());
+    Raw.Length = Tok.getLength();
+    if (Tok.is(tok::raw_identifier)) {
+      Raw.Text = Tok.getRawIdentifier();
+      Raw.Class = classifyEastConstKeyword(Raw.Text);
+    } else {
+      Raw.Text = Buffer.getBuffer().substr(Raw.Offset, Raw.Length);
+    }
+    Tokens.push_back(Raw);
+  }
+
+  RawToken End;
+  End.Kind = tok::eof;
+  End.Offset = static_cast<unsigned>(Buffer.getBufferSize());
+  Tokens.push_back(End);
+  return Tokens;
+}
+
+} // namespace
+
+clang::LangOptions getLexerEngineLangOptions() {
+  LangOptions LangOpts;
+  LangOpts.CPlusPlus = 1;
+  LangOpts.CPlusPlus11 = 1;
+  LangOpts.CPlusPlus14 = 1;
+  LangOpts.CPlusPlus17 = 1;
+  LangOpts.CPlusPlus20 = 1;
+  LangOpts.LineComment = 1;
+  LangOpts.Bool = 1;
+  LangOpts.CXXOperatorNames = 1;
+  LangOpts.DigitSeparators = 1;
+  return LangOpts;
+}
+
+std::vector<LexerEngineSite>
+scanWestConstSites(llvm::StringRef FileName, llvm::StringRef Code,
+                   const clang::LangOptions &LangOpts,
+                   const EastConstCheckerOptions &Options) {
+  SourceManagerForFile SMForFile(FileName, Code);
+  SourceManager &SM = SMForFile.get();
+  FileID FID = SM.getMainFileID();
+
+  SiteScanner Scanner(lexTokens(SM, FID, LangOpts), Options);
+  std::vector<LexerEngineSite> Sites = Scanner.run();
+  for (LexerEngineSite &Site : Sites) {
+    Site.Line = SM.getLineNumber(FID, Site.QualifierOffset);
+    Site.Column = SM.getColumnNumber(FID, Site.QualifierOffset);
+  }
+  return Sites;
+}
+
+clang::tooling::Replacements
+buildLexerEngineReplacements(llvm::StringRef FilePath,
+                             llvm::ArrayRef<LexerEngineSite> Sites,
+                             bool IncludeAmbiguous) {
+  tooling::Replacements Result;
+  for (const LexerEngineSite &Site : Sites) {
+    if (Site.NeedsSemanticCheck && !IncludeAmbiguous)
+      continue;
+    if (Site.Suffix.empty())
+      continue;
+    // Insertions go first so a removal ending at the insertion point cannot
+    // shadow them.
+    std::vector<tooling::Replacement> Fix;
+    Fix.emplace_back(FilePath, Site.InsertOffset, 0, Site.Suffix);
+    for (const auto &[Offset, Length] : Site.Removals)
+      Fix.emplace_back(FilePath, Offset, Length, "");
+
+    size_t Added = 0;
+    for (; Added < Fix.size(); ++Added) {
+      if (llvm::Error Err = Result.add(Fix[Added])) {
+        llvm::consumeError(std::move(Err));
+        break;
+      }
+    }
+    if (Added == Fix.size())
+      continue;
+    // A site is fixed whole or not at all: a half-applied fix would delete
+    // a qualifier without reinserting it. Conflicts are rare, so rebuild
+    // the set without this site's replacements only when one happens.
+    tooling::Replacements Kept;
+    for (const tooling::Replacement &Rep : Result)
+      if (std::find(Fix.begin(), Fix.begin() + Added, Rep) ==
+          Fix.begin() + Added)
+        llvm::cantFail(Kept.add(Rep));
+    Result = std::move(Kept);
+  }
+  return Result;
+}
+
+LexerEngineAgreement &
+LexerEngineAgreement::operator+=(const LexerEngineAgreement &Other) {
+  Confirmed += Other.Confirmed;
+  FalsePositives += Other.FalsePositives;
+  AmbiguousConfirmed += Other.AmbiguousConfirmed;
+  AmbiguousRejected += Other.AmbiguousRejected;
+  Missed += Other.Missed;
+  return *this;
+}
+
+double LexerEngineAgreement::agreementRatio() const {
+  unsigned Agreed = Confirmed + AmbiguousConfirmed;
+  unsigned Total = Agreed + FalsePositives + Missed;
+  return Total == 0 ? 1.0 : static_cast<double>(Agreed) / Total;
+}
+
+LexerEngineAgreement
+compareLexerEngineSites(llvm::ArrayRef<LexerEngineSite> Sites,
+                        llvm::ArrayRef<unsigned> CheckerOffsets) {
+  llvm::DenseSet<unsigned> Checker(CheckerOffsets.begin(),
+                                   CheckerOffsets.end());
+  llvm::DenseSet<unsigned> Seen;
+  LexerEngineAgreement Result;
+  for (const LexerEngineSite &Site : Sites) {
+    bool Agrees = Checker.count(Site.QualifierOffset) != 0;
+    // The checker removes the same runs, one replacement each.
+    Seen.insert(Site.QualifierOffset);
+    for (const auto &Removal : Site.Removals)
+      Seen.insert(Removal.first);
+    if (Site.NeedsSemanticCheck)
+      ++(Agrees ? Result.AmbiguousConfirmed : Result.AmbiguousRejected);
+    else
+      ++(Agrees ? Result.Confirmed : Result.FalsePositives);
+  }
+  for (unsigned Offset : Checker)
+    if (!Seen.count(Offset))
+      ++Result.Missed;
+  return Result;
+}
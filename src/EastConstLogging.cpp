@@ -0,0 +1,90 @@
+#include <EastConstLogging.h>
+
+#include <llvm/ADT/StringSwitch.h>
+
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace {
+
+// Buffers are handed to the sink once they reach this size so a long run does
+// not hold megabytes of log text per thread.
+constexpr size_t FlushThreshold = 16 * 1024;
+
+std::mutex SinkMutex;
+llvm::raw_ostream *SinkOverride = nullptr;
+
+void writeToSink(std::string &Buffer) {
+  if (Buffer.empty())
+    return;
+  std::lock_guard<std::mutex> Lock(SinkMutex);
+  llvm::raw_ostream &OS = SinkOverride ? *SinkOverride : llvm::errs();
+  OS << Buffer;
+  OS.flush();
+  Buffer.clear();
+}
+
+struct ThreadLogBuffer {
+  std::string Text;
+  ~ThreadLogBuffer() { writeToSink(Text); }
+};
+
+ThreadLogBuffer &getThreadLogBuffer() {
+  thread_local ThreadLogBuffer Buffer;
+  return Buffer;
+}
+
+} // namespace
+
+namespace east_const_detail {
+std::atomic<unsigned> RuntimeLogLevel{
+    static_cast<unsigned>(EastConstLogLevel::Info)};
+
+std::string &threadLogBuffer() { return getThreadLogBuffer().Text; }
+} // namespace east_const_detail
+
+void setEastConstLogLevel(EastConstLogLevel Level) {
+  east_const_detail::RuntimeLogLevel.store(static_cast<unsigned>(Level),
+                                           std::memory_order_relaxed);
+}
+
+EastConstLogLevel getEastConstLogLevel() {
+  return static_cast<EastConstLogLevel>(
+      east_const_detail::RuntimeLogLevel.load(std::memory_order_relaxed));
+}
+
+bool parseEastConstLogLevel(llvm::StringRef Name, EastConstLogLevel &Level) {
+  auto Parsed = llvm::StringSwitch<std::optional<EastConstLogLevel>>(
+                    Name.lower())
+                    .Case("off", EastConstLogLevel::Off)
+                    .Case("error", EastConstLogLevel::Error)
+                    .Case("warning", EastConstLogLevel::Warning)
+                    .Case("info", EastConstLogLevel::Info)
+                    .Case("debug", EastConstLogLevel::Debug)
+                    .Case("trace", EastConstLogLevel::Trace)
+                    .Default(std::nullopt);
+  if (!Parsed)
+    return false;
+  Level = *Parsed;
+  return true;
+}
+
+void setEastConstLogSink(llvm::raw_ostream *Sink) {
+  flushEastConstLog();
+  std::lock_guard<std::mutex> Lock(SinkMutex);
+  SinkOverride = Sink;
+}
+
+void flushEastConstLog() { writeToSink(getThreadLogBuffer().Text); }
+
+EastConstLogRecord::EastConstLogRecord(EastConstLogLevel Level)
+    : Level(Level), Stream(east_const_detail::threadLogBuffer()) {}
+
+EastConstLogRecord::~EastConstLogRecord() {
+  Stream.flush();
+  std::string &Buffer = east_const_detail::threadLogBuffer();
+  Buffer.push_back('\n');
+  if (Level <= EastConstLogLevel::Error || Buffer.size() >= FlushThreshold)
+    flushEastConstLog();
+}
@@ -0,0 +1,805 @@
+#include <EastConstLsp.h>
+#include <EastConstLogging.h>
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/AST/DeclCXX.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Frontend/PrecompiledPreamble.h>
+#include <clang/Lex/PreprocessorOptions.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace clang;
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+// JSON-RPC error codes.
+constexpr int ParseError = -32700;
+constexpr int InvalidRequest = -32600;
+constexpr int MethodNotFound = -32601;
+
+// LSP positions are 0-based; characters count UTF-16 code units.
+struct Position {
+  int Line = 0;
+  int Character = 0;
+};
+
+bool operator<(const Position &LHS, const Position &RHS) {
+  return std::tie(LHS.Line, LHS.Character) <
+         std::tie(RHS.Line, RHS.Character);
+}
+
+struct Range {
+  Position Begin;
+  Position End;
+};
+
+// 0-based, inclusive.
+struct LineRange {
+  int First = 0;
+  int Last = 0;
+
+  bool overlaps(const LineRange &Other) const {
+    return First <= Other.Last && Other.First <= Last;
+  }
+};
+
+struct TextEdit {
+  Range Where;
+  std::string NewText;
+};
+
+// A site as published: where its diagnostic points and the edits of its
+// quick fix, in the coordinates of the document's current text.
+struct LspSite {
+  Range Where;
+  // Every line the site and its fix touch.
+  LineRange Lines;
+  EastConstDeclKind Kind = EastConstDeclKind::Variable;
+  std::vector<TextEdit> Fix;
+
+  void shift(int Delta) {
+    Where.Begin.Line += Delta;
+    Where.End.Line += Delta;
+    Lines.First += Delta;
+    Lines.Last += Delta;
+    for (TextEdit &Edit : Fix) {
+      Edit.Where.Begin.Line += Delta;
+      Edit.Where.End.Line += Delta;
+    }
+  }
+};
+
+unsigned utf8SequenceLength(unsigned char Lead) {
+  return Lead < 0xC0 ? 1 : Lead < 0xE0 ? 2 : Lead < 0xF0 ? 3 : 4;
+}
+
+// Characters beyond the basic multilingual plane take two UTF-16 units.
+unsigned utf16Units(unsigned SequenceLength) {
+  return SequenceLength == 4 ? 2 : 1;
+}
+
+Position offsetToPosition(StringRef Text, std::size_t Offset) {
+  StringRef Before = Text.take_front(Offset);
+  std::size_t LineStart = Before.rfind('\n');
+  LineStart = LineStart == StringRef::npos ? 0 : LineStart + 1;
+  Position Result;
+  Result.Line = static_cast<int>(Before.count('\n'));
+  for (std::size_t I = LineStart; I < Before.size();) {
+    unsigned Length = utf8SequenceLength(Before[I]);
+    Result.Character += utf16Units(Length);
+    I += Length;
+  }
+  return Result;
+}
+
+// Positions past the end of a line or of the text are clamped to it, as
+// the protocol asks.
+std::size_t positionToOffset(StringRef Text, Position Where) {
+  std::size_t Start = 0;
+  for (int Line = 0; Line < Where.Line; ++Line) {
+    std::size_t Newline = Text.find('\n', Start);
+    if (Newline == StringRef::npos)
+      return Text.size();
+    Start = Newline + 1;
+  }
+  std::size_t End = std::min(Text.find('\n', Start), Text.size());
+  std::size_t Offset = Start;
+  for (int Units = 0; Offset < End && Units < Where.Character;) {
+    unsigned Length = utf8SequenceLength(Text[Offset]);
+    Units += utf16Units(Length);
+    Offset += Length;
+  }
+  return std::min(Offset, End);
+}
+
+json::Value toJSON(const Position &Where) {
+  return json::Object{{"line", Where.Line}, {"character", Where.Character}};
+}
+
+json::Value toJSON(const Range &Where) {
+  return json::Object{{"start", toJSON(Where.Begin)},
+                      {"end", toJSON(Where.End)}};
+}
+
+bool fromJSON(const json::Value &Value, Position &Where, json::Path Path) {
+  json::ObjectMapper Mapper(Value, Path);
+  return Mapper && Mapper.map("line", Where.Line) &&
+         Mapper.map("character", Where.Character);
+}
+
+bool fromJSON(const json::Value &Value, Range &Where, json::Path Path) {
+  json::ObjectMapper Mapper(Value, Path);
+  return Mapper && Mapper.map("start", Where.Begin) &&
+         Mapper.map("end", Where.End);
+}
+
+std::optional<Range> parseRange(const json::Value *Value) {
+  Range Where;
+  json::Path::Root Root;
+  if (!Value || !fromJSON(*Value, Where, Root))
+    return std::nullopt;
+  return Where;
+}
+
+// file:///dir/a%20b.cpp names /dir/a b.cpp.
+std::optional<std::string> uriToPath(StringRef Uri) {
+  if (!Uri.consume_front("file://"))
+    return std::nullopt;
+  std::string Path;
+  for (std::size_t I = 0; I < Uri.size(); ++I) {
+    unsigned Byte;
+    if (Uri[I] == '%' && I + 2 < Uri.size() &&
+        !Uri.substr(I + 1, 2).getAsInteger(16, Byte)) {
+      Path += static_cast<char>(Byte);
+      I += 2;
+      continue;
+    }
+    Path += Uri[I];
+  }
+  // Windows drives come as file:///C:/dir.
+  if (Path.size() > 2 && Path[0] == '/' && isAlpha(Path[1]) && Path[2] == ':')
+    Path.erase(0, 1);
+  SmallString<256> Normalized(Path);
+  sys::path::remove_dots(Normalized, /*remove_dot_dot=*/true);
+  return Normalized.str().str();
+}
+
+LspSite toLspSite(StringRef Text, const EastConstSite &Site) {
+  std::size_t Begin = positionToOffset(
+                          Text, {static_cast<int>(Site.Line) - 1, 0}) +
+                      Site.Column - 1;
+  std::size_t End = Begin;
+  LspSite Result;
+  Result.Kind = Site.Kind;
+  for (const Replacement &Rep : Site.Fix) {
+    Begin = std::min<std::size_t>(Begin, Rep.getOffset());
+    End = std::max<std::size_t>(End, Rep.getOffset() + Rep.getLength());
+    Result.Fix.push_back(
+        {{offsetToPosition(Text, Rep.getOffset()),
+          offsetToPosition(Text, Rep.getOffset() + Rep.getLength())},
+         Rep.getReplacementText().str()});
+  }
+  Result.Where = {offsetToPosition(Text, Begin), offsetToPosition(Text, End)};
+  Result.Lines = {Result.Where.Begin.Line, Result.Where.End.Line};
+  return Result;
+}
+
+json::Value toDiagnostic(const LspSite &Site) {
+  return json::Object{
+      {"range", toJSON(Site.Where)},
+      // Warning.
+      {"severity", 2},
+      {"source", "east-const"},
+      {"code", getEastConstDeclKindName(Site.Kind)},
+      {"message", "move qualifier east of the declarator"}};
+}
+
+// Keeps the invocation the driver builds for a document, and the directory
+// it compiles in, without parsing anything.
+class InvocationCapture : public FrontendActionFactory {
+public:
+  std::unique_ptr<FrontendAction> create() override { return nullptr; }
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Captured,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations>,
+                     DiagnosticConsumer *) override {
+    Invocation = std::move(Captured);
+    if (ErrorOr<std::string> Cwd =
+            Files->getVirtualFileSystem().getCurrentWorkingDirectory())
+      Directory = *Cwd;
+    return true;
+  }
+
+  std::shared_ptr<CompilerInvocation> Invocation;
+  std::string Directory;
+};
+
+// Collects the main file's top-level declarations as the parser hands them
+// over (the preamble's never are), then runs the matchers over just those
+// that contain a line of Scope, or over all of them without one.
+class ScopedMatchConsumer : public ASTConsumer {
+public:
+  ScopedMatchConsumer(CompilerInstance &CI, MatchFinder &Finder,
+                      const std::vector<LineRange> *Scope,
+                      std::vector<LineRange> &Matched, bool &Parsed)
+      : CI(CI), Finder(Finder), Scope(Scope), Matched(Matched),
+        Parsed(Parsed) {}
+
+  bool HandleTopLevelDecl(DeclGroupRef Group) override {
+    for (Decl *D : Group)
+      collect(D);
+    return true;
+  }
+
+  void HandleTranslationUnit(ASTContext &Context) override {
+    // As in the compiler plugin: no fixes for code the compiler did not
+    // understand.
+    if (CI.getDiagnostics().hasErrorOccurred())
+      return;
+    Parsed = true;
+    std::vector<Decl *> Roots;
+    for (Decl *D : TopLevel) {
+      LineRange Lines = linesOf(*D);
+      if (Scope && none_of(*Scope, [&](const LineRange &Edited) {
+            return Edited.overlaps(Lines);
+          }))
+        continue;
+      Roots.push_back(D);
+      Matched.push_back(Lines);
+    }
+    if (Roots.empty())
+      return;
+    Context.setTraversalScope(Roots);
+    Finder.matchAST(Context);
+  }
+
+private:
+  void collect(Decl *D) {
+    const SourceManager &SM = CI.getSourceManager();
+    if (!SM.isWrittenInMainFile(SM.getExpansionLoc(D->getLocation())))
+      return;
+    // A namespace may span the whole file; its members are scoped one by
+    // one.
+    if (isa<NamespaceDecl, LinkageSpecDecl, ExportDecl>(D)) {
+      for (Decl *Member : cast<DeclContext>(D)->decls())
+        collect(Member);
+      return;
+    }
+    TopLevel.push_back(D);
+  }
+
+  LineRange linesOf(const Decl &D) const {
+    const SourceManager &SM = CI.getSourceManager();
+    SourceRange Extent = D.getSourceRange();
+    return {static_cast<int>(SM.getExpansionLineNumber(Extent.getBegin())) -
+                1,
+            static_cast<int>(SM.getExpansionLineNumber(Extent.getEnd())) - 1};
+  }
+
+  CompilerInstance &CI;
+  MatchFinder &Finder;
+  const std::vector<LineRange> *Scope;
+  std::vector<LineRange> &Matched;
+  bool &Parsed;
+  std::vector<Decl *> TopLevel;
+};
+
+class ScopedMatchAction : public ASTFrontendAction {
+public:
+  ScopedMatchAction(MatchFinder &Finder, const std::vector<LineRange> *Scope,
+                    std::vector<LineRange> &Matched, bool &Parsed)
+      : Finder(Finder), Scope(Scope), Matched(Matched), Parsed(Parsed) {}
+
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef) override {
+    return std::make_unique<ScopedMatchConsumer>(CI, Finder, Scope, Matched,
+                                                 Parsed);
+  }
+
+private:
+  MatchFinder &Finder;
+  const std::vector<LineRange> *Scope;
+  std::vector<LineRange> &Matched;
+  bool &Parsed;
+};
+
+class ScopedMatchFactory : public FrontendActionFactory {
+public:
+  ScopedMatchFactory(MatchFinder &Finder, const std::vector<LineRange> *Scope,
+                     std::vector<LineRange> &Matched, bool &Parsed)
+      : Finder(Finder), Scope(Scope), Matched(Matched), Parsed(Parsed) {}
+
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<ScopedMatchAction>(Finder, Scope, Matched,
+                                               Parsed);
+  }
+
+private:
+  MatchFinder &Finder;
+  const std::vector<LineRange> *Scope;
+  std::vector<LineRange> &Matched;
+  bool &Parsed;
+};
+
+} // namespace
+
+struct EastConstLspServer::Document {
+  std::string Uri;
+  std::string Path;
+  std::string Text;
+  std::int64_t Version = 0;
+  // Built by the driver on the first analysis; copied for every later one.
+  std::shared_ptr<CompilerInvocation> Invocation;
+  std::string Directory;
+  bool NoCommand = false;
+  bool Analyzed = false;
+  std::optional<PrecompiledPreamble> Preamble;
+  std::vector<LspSite> Sites;
+  // Lines edited since the last analysis; ignored while Full is set.
+  std::vector<LineRange> Dirty;
+  bool Full = true;
+
+  // Applies one entry of a didChange's contentChanges.
+  void edit(const json::Object &Change);
+};
+
+void EastConstLspServer::Document::edit(const json::Object &Change) {
+  std::optional<StringRef> NewText = Change.getString("text");
+  if (!NewText)
+    return;
+  std::optional<Range> Where = parseRange(Change.get("range"));
+  if (!Where) {
+    Text = NewText->str();
+    Sites.clear();
+    Dirty.clear();
+    Full = true;
+    return;
+  }
+  std::size_t Begin = positionToOffset(Text, Where->Begin);
+  std::size_t End = std::max(Begin, positionToOffset(Text, Where->End));
+  Text.replace(Begin, End - Begin, NewText->str());
+
+  // Sites on the replaced lines are dropped for the next analysis to find
+  // again; everything below moves by the lines the edit added or removed.
+  LineRange Replaced{Where->Begin.Line, Where->End.Line};
+  int Added = static_cast<int>(NewText->count('\n'));
+  int Delta = Added - (Replaced.Last - Replaced.First);
+  llvm::erase_if(Sites, [&](const LspSite &Site) {
+    return Site.Lines.overlaps(Replaced);
+  });
+  for (LspSite &Site : Sites)
+    if (Site.Lines.First > Replaced.Last)
+      Site.shift(Delta);
+
+  LineRange Edited{Replaced.First, Replaced.First + Added};
+  std::vector<LineRange> Moved;
+  for (const LineRange &Earlier : Dirty) {
+    if (Earlier.Last < Replaced.First) {
+      Moved.push_back(Earlier);
+    } else if (Earlier.First > Replaced.Last) {
+      Moved.push_back({Earlier.First + Delta, Earlier.Last + Delta});
+    } else {
+      Edited.First = std::min(Edited.First, Earlier.First);
+      if (Earlier.Last > Replaced.Last)
+        Edited.Last = std::max(Edited.Last, Earlier.Last + Delta);
+    }
+  }
+  Moved.push_back(Edited);
+  Dirty = std::move(Moved);
+}
+
+EastConstLspServer::EastConstLspServer(const CompilationDatabase &Compilations,
+                                       EastConstCheckerOptions CheckerOptions,
+                                       raw_ostream &Out)
+    : Compilations(Compilations), CheckerOptions(std::move(CheckerOptions)),
+      Out(Out) {
+  // Sites are published, never printed, and every one needs its fix.
+  this->CheckerOptions.Quiet = true;
+  this->CheckerOptions.CheckOnly = false;
+  this->CheckerOptions.CountSites = false;
+  this->CheckerOptions.FailFast = false;
+}
+
+EastConstLspServer::~EastConstLspServer() = default;
+
+bool EastConstLspServer::handle(const json::Value &Message) {
+  const json::Object *Object = Message.getAsObject();
+  if (!Object) {
+    replyError(nullptr, InvalidRequest, "expected a JSON-RPC object");
+    return true;
+  }
+  std::optional<StringRef> Method = Object->getString("method");
+  // A response; the server sends no requests, so none is expected.
+  if (!Method)
+    return true;
+  if (*Method == "exit")
+    return false;
+  json::Object NoParams;
+  const json::Object *Params = Object->getObject("params");
+  if (!Params)
+    Params = &NoParams;
+
+  const json::Value *Id = Object->get("id");
+  if (!Id) {
+    if (*Method == "textDocument/didOpen")
+      didOpen(*Params);
+    else if (*Method == "textDocument/didChange")
+      didChange(*Params);
+    else if (*Method == "textDocument/didClose")
+      didClose(*Params);
+    // Any other notification ("initialized", "$/...") needs nothing.
+    return true;
+  }
+
+  if (*Method == "initialize") {
+    reply(*Id,
+          json::Object{
+              {"capabilities",
+               json::Object{
+                   // Incremental changes.
+                   {"textDocumentSync",
+                    json::Object{{"openClose", true}, {"change", 2}}},
+                   {"codeActionProvider",
+                    json::Object{
+                        {"codeActionKinds", json::Array{"quickfix"}}}}}},
+              {"serverInfo", json::Object{{"name", "east-const-enforcer"}}}});
+  } else if (*Method == "shutdown") {
+    ShutdownRequested = true;
+    reply(*Id, nullptr);
+  } else if (*Method == "textDocument/codeAction") {
+    reply(*Id, codeAction(*Params));
+  } else {
+    replyError(*Id, MethodNotFound,
+               "unsupported method '" + Method->str() + "'");
+  }
+  return true;
+}
+
+void EastConstLspServer::reply(const json::Value &Id, json::Value Result) {
+  writeEastConstLspMessage(Out, json::Object{{"jsonrpc", "2.0"},
+                                             {"id", Id},
+                                             {"result", std::move(Result)}});
+}
+
+void EastConstLspServer::replyError(const json::Value &Id, int Code,
+                                    StringRef Message) {
+  writeEastConstLspMessage(
+      Out, json::Object{{"jsonrpc", "2.0"},
+                        {"id", Id},
+                        {"error", json::Object{{"code", Code},
+                                               {"message", Message.str()}}}});
+}
+
+void EastConstLspServer::didOpen(const json::Object &Params) {
+  const json::Object *TextDocument = Params.getObject("textDocument");
+  if (!TextDocument)
+    return;
+  std::optional<StringRef> Uri = TextDocument->getString("uri");
+  std::optional<StringRef> Text = TextDocument->getString("text");
+  if (!Uri || !Text)
+    return;
+  std::optional<std::string> Path = uriToPath(*Uri);
+  if (!Path) {
+    EAST_CONST_LOG(Warning, "Ignoring " << *Uri << ": not a file URI");
+    return;
+  }
+  auto Opened = std::make_unique<Document>();
+  Opened->Uri = Uri->str();
+  Opened->Path = std::move(*Path);
+  Opened->Text = Text->str();
+  Opened->Version = TextDocument->getInteger("version").value_or(0);
+  Document &Doc = *Opened;
+  Documents[*Uri] = std::move(Opened);
+  analyze(Doc);
+  publish(Doc);
+}
+
+void EastConstLspServer::didChange(const json::Object &Params) {
+  const json::Object *TextDocument = Params.getObject("textDocument");
+  const json::Array *Changes = Params.getArray("contentChanges");
+  if (!TextDocument || !Changes)
+    return;
+  std::optional<StringRef> Uri = TextDocument->getString("uri");
+  auto It = Uri ? Documents.find(*Uri) : Documents.end();
+  if (It == Documents.end()) {
+    EAST_CONST_LOG(Warning, "Ignoring a change to a document not open");
+    return;
+  }
+  Document &Doc = *It->second;
+  if (std::optional<std::int64_t> Version = TextDocument->getInteger("version"))
+    Doc.Version = *Version;
+  for (const json::Value &Change : *Changes)
+    if (const json::Object *Object = Change.getAsObject())
+      Doc.edit(*Object);
+  analyze(Doc);
+  publish(Doc);
+}
+
+void EastConstLspServer::didClose(const json::Object &Params) {
+  const json::Object *TextDocument = Params.getObject("textDocument");
+  std::optional<StringRef> Uri =
+      TextDocument ? TextDocument->getString("uri") : std::nullopt;
+  if (!Uri || !Documents.erase(*Uri))
+    return;
+  // Clear what the editor shows for it.
+  writeEastConstLspMessage(
+      Out, json::Object{{"jsonrpc", "2.0"},
+                        {"method", "textDocument/publishDiagnostics"},
+                        {"params", json::Object{{"uri", Uri->str()},
+                                                {"diagnostics",
+                                                 json::Array{}}}}});
+}
+
+json::Value EastConstLspServer::codeAction(const json::Object &Params) {
+  json::Array Actions;
+  const json::Object *TextDocument = Params.getObject("textDocument");
+  std::optional<StringRef> Uri =
+      TextDocument ? TextDocument->getString("uri") : std::nullopt;
+  std::optional<Range> Requested = parseRange(Params.get("range"));
+  auto It = Uri ? Documents.find(*Uri) : Documents.end();
+  if (It == Documents.end() || !Requested)
+    return Actions;
+  const Document &Doc = *It->second;
+  for (const LspSite &Site : Doc.Sites) {
+    if (Site.Fix.empty() || Site.Where.End < Requested->Begin ||
+        Requested->End < Site.Where.Begin)
+      continue;
+    json::Array Edits;
+    for (const TextEdit &Edit : Site.Fix)
+      Edits.push_back(json::Object{{"range", toJSON(Edit.Where)},
+                                   {"newText", Edit.NewText}});
+    json::Object Changes;
+    Changes[Doc.Uri] = std::move(Edits);
+    Actions.push_back(json::Object{
+        {"title", "Move qualifier east"},
+        {"kind", "quickfix"},
+        {"isPreferred", true},
+        {"diagnostics", json::Array{toDiagnostic(Site)}},
+        {"edit", json::Object{{"changes", std::move(Changes)}}}});
+  }
+  return Actions;
+}
+
+void EastConstLspServer::analyze(Document &Doc) {
+  auto Start = std::chrono::steady_clock::now();
+  auto PCHContainerOps = std::make_shared<PCHContainerOperations>();
+  IgnoringDiagConsumer Diagnostics;
+  if (!Doc.Invocation) {
+    if (Doc.NoCommand)
+      return;
+    ClangTool Tool(Compilations, {Doc.Path}, PCHContainerOps,
+                   vfs::createPhysicalFileSystem());
+    Tool.mapVirtualFile(Doc.Path, Doc.Text);
+    Tool.setDiagnosticConsumer(&Diagnostics);
+    InvocationCapture Capture;
+    if (Tool.run(&Capture) != 0 || !Capture.Invocation) {
+      EAST_CONST_LOG(Error, "Cannot build a compile command for "
+                                << Doc.Path << "; it gets no diagnostics");
+      Doc.NoCommand = true;
+      return;
+    }
+    Doc.Invocation = std::move(Capture.Invocation);
+    Doc.Directory = std::move(Capture.Directory);
+  }
+
+  IntrusiveRefCntPtr<vfs::FileSystem> FS = vfs::createPhysicalFileSystem();
+  if (!Doc.Directory.empty())
+    FS->setCurrentWorkingDirectory(Doc.Directory);
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBufferCopy(Doc.Text, Doc.Path);
+  PreambleBounds Bounds = ComputePreambleBounds(
+      Doc.Invocation->getLangOpts(), Buffer->getMemBufferRef(),
+      /*MaxLines=*/0);
+  bool Reusable = Doc.Preamble
+                      ? Doc.Preamble->CanReuse(*Doc.Invocation,
+                                               Buffer->getMemBufferRef(),
+                                               Bounds, *FS)
+                      : Doc.Analyzed && Bounds.Size == 0;
+  if (!Reusable) {
+    // The includes changed (or a header on disk did): every declaration
+    // may now mean something else.
+    Doc.Preamble.reset();
+    Doc.Full = true;
+    if (Bounds.Size > 0) {
+      IntrusiveRefCntPtr<DiagnosticsEngine> PreambleDiagnostics =
+          CompilerInstance::createDiagnostics(
+              *FS, Doc.Invocation->getDiagnosticOpts(), &Diagnostics,
+              /*ShouldOwnClient=*/false);
+      PreambleCallbacks Callbacks;
+      ErrorOr<PrecompiledPreamble> Built = PrecompiledPreamble::Build(
+          *Doc.Invocation, Buffer.get(), Bounds, *PreambleDiagnostics, FS,
+          PCHContainerOps, /*StoreInMemory=*/true, /*StoragePath=*/"",
+          Callbacks);
+      ++Stats.PreamblesBuilt;
+      if (Built)
+        Doc.Preamble.emplace(std::move(*Built));
+      else
+        EAST_CONST_LOG(Warning, "Cannot build the preamble of "
+                                    << Doc.Path << ": "
+                                    << Built.getError().message()
+                                    << "; parsing its includes every time");
+    }
+  }
+  Doc.Analyzed = true;
+
+  auto Invocation = std::make_shared<CompilerInvocation>(*Doc.Invocation);
+  if (Doc.Preamble)
+    Doc.Preamble->AddImplicitPreamble(*Invocation, FS, Buffer.get());
+  // The source manager takes the buffer over.
+  Invocation->getPreprocessorOpts().addRemappedFile(Doc.Path,
+                                                    Buffer.release());
+  auto Files = makeIntrusiveRefCnt<FileManager>(FileSystemOptions(), FS);
+
+  std::vector<EastConstSite> Found;
+  EastConstChecker Checker(nullptr, CheckerOptions,
+                           [&](const EastConstSite &Site) {
+                             Found.push_back(Site);
+                           });
+  MatchFinder Finder;
+  registerEastConstMatchers(Finder, &Checker);
+  std::vector<LineRange> Matched;
+  bool Parsed = false;
+  ScopedMatchFactory Factory(Finder, Doc.Full ? nullptr : &Doc.Dirty,
+                             Matched, Parsed);
+  Factory.runInvocation(std::move(Invocation), Files.get(), PCHContainerOps,
+                        &Diagnostics);
+  ++Stats.Analyses;
+  if (!Parsed) {
+    // Keep the edited lines pending until the document parses again.
+    ++Stats.Unparsed;
+    EAST_CONST_LOG(Debug, Doc.Path << " does not parse; keeping its "
+                                      "diagnostics");
+    return;
+  }
+
+  if (Doc.Full) {
+    ++Stats.FullAnalyses;
+    Doc.Sites.clear();
+  } else {
+    llvm::erase_if(Doc.Sites, [&](const LspSite &Site) {
+      return any_of(Matched, [&](const LineRange &Lines) {
+        return Lines.overlaps(Site.Lines);
+      });
+    });
+  }
+  for (const EastConstSite &Site : Found)
+    Doc.Sites.push_back(toLspSite(Doc.Text, Site));
+  llvm::sort(Doc.Sites, [](const LspSite &LHS, const LspSite &RHS) {
+    return LHS.Where.Begin < RHS.Where.Begin;
+  });
+  Stats.LastMilliseconds =
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - Start)
+          .count();
+  std::string Scope = Doc.Full ? std::string("whole file")
+                               : std::to_string(Matched.size()) +
+                                     " declarations";
+  EAST_CONST_LOG(Debug, "Analyzed " << Doc.Path << " (" << Scope << ") in "
+                                    << llvm::format("%.1f",
+                                                    Stats.LastMilliseconds)
+                                    << " ms");
+  Doc.Dirty.clear();
+  Doc.Full = false;
+}
+
+void EastConstLspServer::publish(const Document &Doc) {
+  json::Array Diagnostics;
+  for (const LspSite &Site : Doc.Sites)
+    Diagnostics.push_back(toDiagnostic(Site));
+  writeEastConstLspMessage(
+      Out, json::Object{{"jsonrpc", "2.0"},
+                        {"method", "textDocument/publishDiagnostics"},
+                        {"params", json::Object{{"uri", Doc.Uri},
+                                                {"version", Doc.Version},
+                                                {"diagnostics",
+                                                 std::move(Diagnostics)}}}});
+}
+
+bool readEastConstLspMessage(std::FILE *In, std::string &Body,
+                             std::string &Error) {
+  Error.clear();
+  std::optional<std::size_t> Length;
+  bool InHeader = false;
+  while (true) {
+    std::string Line;
+    int C;
+    while ((C = std::fgetc(In)) != EOF && C != '\n')
+      Line += static_cast<char>(C);
+    if (C == EOF) {
+      if (InHeader || !Line.empty() || std::ferror(In))
+        Error = "the stream ended inside a message header";
+      return false;
+    }
+    InHeader = true;
+    StringRef Header = StringRef(Line).rtrim('\r');
+    if (Header.empty())
+      break;
+    auto [Name, Value] = Header.split(':');
+    // Content-Type is the only other header and changes nothing.
+    if (!Name.trim().equals_insensitive("Content-Length"))
+      continue;
+    std::size_t Bytes;
+    if (Value.trim().getAsInteger(10, Bytes)) {
+      Error = "malformed header '" + Header.str() + "'";
+      return false;
+    }
+    Length = Bytes;
+  }
+  if (!Length) {
+    Error = "a message without Content-Length";
+    return false;
+  }
+  Body.resize(*Length);
+  if (*Length > 0 && std::fread(&Body[0], 1, *Length, In) != *Length) {
+    Error = "the stream ended inside a message";
+    return false;
+  }
+  return true;
+}
+
+void writeEastConstLspMessage(raw_ostream &OS, const json::Value &Message) {
+  std::string Body;
+  raw_string_ostream BodyStream(Body);
+  BodyStream << Message;
+  BodyStream.flush();
+  OS << "Content-Length: " << Body.size() << "\r\n\r\n" << Body;
+  // The client waits for each message as a whole.
+  OS.flush();
+}
+
+int runEastConstLspServer(std::FILE *In, raw_ostream &Out,
+                          const CompilationDatabase &Compilations,
+                          const EastConstCheckerOptions &CheckerOptions) {
+  EastConstLspServer Server(Compilations, CheckerOptions, Out);
+  std::string Body;
+  std::string Error;
+  while (readEastConstLspMessage(In, Body, Error)) {
+    Expected<json::Value> Message = json::parse(Body);
+    if (!Message) {
+      std::string Reason = toString(Message.takeError());
+      EAST_CONST_LOG(Warning, "Dropped a message that is not JSON: "
+                                  << Reason);
+      writeEastConstLspMessage(
+          Out, json::Object{{"jsonrpc", "2.0"},
+                            {"id", nullptr},
+                            {"error", json::Object{{"code", ParseError},
+                                                   {"message", Reason}}}});
+      continue;
+    }
+    if (!Server.handle(*Message))
+      return Server.exitCode();
+  }
+  if (!Error.empty())
+    EAST_CONST_LOG(Error, "LSP input: " << Error);
+  // The client went away without "exit".
+  return 1;
+}
@@ -0,0 +1,155 @@
+#include <EastConstMemoryGovernor.h>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#if LLVM_ON_UNIX
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+namespace {
+
+// Reads a "<Key>: <n> kB" line from a /proc status-style file.
+std::optional<std::uint64_t> readKilobytesField(const char *Path,
+                                                StringRef Key) {
+  auto Buffer = MemoryBuffer::getFileAsStream(Path);
+  if (!Buffer)
+    return std::nullopt;
+  SmallVector<StringRef, 0> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    if (!Line.consume_front(Key) || !Line.consume_front(":"))
+      continue;
+    Line = Line.trim();
+    Line.consume_back("kB");
+    std::uint64_t Kilobytes;
+    if (Line.trim().getAsInteger(10, Kilobytes))
+      return std::nullopt;
+    return Kilobytes * 1024;
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+std::optional<std::uint64_t> getEastConstAvailableMemory() {
+  return readKilobytesField("/proc/meminfo", "MemAvailable");
+}
+
+std::uint64_t getEastConstResidentBytes(long Pid) {
+#if LLVM_ON_UNIX
+  std::string Path = Pid == 0 ? std::string("/proc/self/statm")
+                              : "/proc/" + std::to_string(Pid) + "/statm";
+  auto Statm = MemoryBuffer::getFileAsStream(Path);
+  if (!Statm)
+    return 0;
+  SmallVector<StringRef, 2> Fields;
+  (*Statm)->getBuffer().split(Fields, ' ', 2, /*KeepEmpty=*/false);
+  std::uint64_t Pages;
+  if (Fields.size() < 2 || Fields[1].trim().getAsInteger(10, Pages))
+    return 0;
+  return Pages * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+#else
+  (void)Pid;
+  return 0;
+#endif
+}
+
+bool resetEastConstPeakResident() {
+  // Writing 5 to clear_refs resets VmHWM (Linux 4.0 and later).
+  std::error_code EC;
+  raw_fd_ostream OS("/proc/self/clear_refs", EC, sys::fs::OF_Append);
+  if (EC)
+    return false;
+  OS << "5";
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return false;
+  }
+  return true;
+}
+
+std::uint64_t getEastConstPeakResidentBytes() {
+  return readKilobytesField("/proc/self/status", "VmHWM").value_or(0);
+}
+
+EastConstMemoryGovernor::EastConstMemoryGovernor(
+    EastConstMemoryGovernorOptions Options,
+    std::function<std::uint64_t()> ResidentProbe)
+    : Options(std::move(Options)), ResidentProbe(std::move(ResidentProbe)) {}
+
+bool EastConstMemoryGovernor::fitsLocked(std::uint64_t Bytes) {
+  if (Running == 0)
+    return true;
+  std::optional<std::uint64_t> Available =
+      Options.AvailableBytes ? Options.AvailableBytes() : std::nullopt;
+  if (!Available)
+    return true;
+  std::uint64_t Resident = ResidentProbe ? ResidentProbe() : 0;
+  std::uint64_t StillGrowing = Outstanding > Resident ? Outstanding - Resident
+                                                      : 0;
+  return *Available >= Options.ReserveBytes + StillGrowing + Bytes;
+}
+
+bool EastConstMemoryGovernor::tryStart(std::uint64_t Bytes) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (!fitsLocked(Bytes)) {
+    if (!Holding)
+      ++Stats.Throttled;
+    Holding = true;
+    return false;
+  }
+  Holding = false;
+  ++Running;
+  Outstanding += Bytes;
+  Stats.PeakRunning = std::max(Stats.PeakRunning, Running);
+  return true;
+}
+
+void EastConstMemoryGovernor::start(std::uint64_t Bytes) {
+  std::unique_lock<std::mutex> Guard(Lock);
+  if (!fitsLocked(Bytes)) {
+    ++Stats.Throttled;
+    do
+      Finished.wait_for(Guard, Options.RecheckInterval);
+    while (!fitsLocked(Bytes));
+  }
+  ++Running;
+  Outstanding += Bytes;
+  Stats.PeakRunning = std::max(Stats.PeakRunning, Running);
+}
+
+void EastConstMemoryGovernor::finish(std::uint64_t Bytes) {
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    --Running;
+    Outstanding -= std::min(Outstanding, Bytes);
+  }
+  Finished.notify_all();
+}
+
+unsigned EastConstMemoryGovernor::running() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Running;
+}
+
+std::uint64_t EastConstMemoryGovernor::expectedBytes(
+    std::optional<std::uint64_t> Recorded) const {
+  return Recorded.value_or(Options.DefaultUnitBytes);
+}
+
+EastConstMemoryGovernorStats EastConstMemoryGovernor::getStats() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Stats;
+}
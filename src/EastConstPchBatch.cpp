@@ -0,0 +1,413 @@
+#include <EastConstPchBatch.h>
+#include <EastConstAstEngine.h>
+#include <EastConstLogging.h>
+
+#include <clang/Driver/Types.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <utility>
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+std::string absolutePath(StringRef Directory, StringRef Path) {
+  SmallString<256> Result(Path);
+  if (!sys::path::is_absolute(Result)) {
+    Result = Directory;
+    sys::path::append(Result, Path);
+  }
+  sys::fs::make_absolute(Result);
+  sys::path::remove_dots(Result, /*remove_dot_dot=*/true);
+  return Result.str().str();
+}
+
+// The header type for the language Command compiles its input as, or an
+// empty string when that language has none.
+std::string headerLanguageFor(const CompileCommand &Command) {
+  namespace types = clang::driver::types;
+  std::string Language = eastConstInputLanguage(Command);
+  if (Language.empty())
+    return std::string();
+  types::ID Type = types::lookupHeaderTypeForSourceType(
+      types::lookupTypeForTypeSpecifier(Language.c_str()));
+  if (Type == types::TY_INVALID || !types::onlyPrecompileType(Type))
+    return std::string();
+  return types::getTypeName(Type);
+}
+
+std::string hashKey(StringRef Key) {
+  std::string Hex;
+  raw_string_ostream OS(Hex);
+  OS << format_hex_no_prefix(xxh3_64bits(Key), 16);
+  OS.flush();
+  return Hex;
+}
+
+class AllDependencyCollector : public DependencyCollector {
+public:
+  bool needSystemDependencies() override { return true; }
+};
+
+class RecordingGeneratePchAction : public GeneratePCHAction {
+public:
+  explicit RecordingGeneratePchAction(
+      std::shared_ptr<DependencyCollector> Collector)
+      : Collector(std::move(Collector)) {}
+
+protected:
+  bool BeginSourceFileAction(CompilerInstance &CI) override {
+    Collector->attachToPreprocessor(CI.getPreprocessor());
+    return GeneratePCHAction::BeginSourceFileAction(CI);
+  }
+
+private:
+  std::shared_ptr<DependencyCollector> Collector;
+};
+
+class PchBuildActionFactory : public FrontendActionFactory {
+public:
+  explicit PchBuildActionFactory(std::shared_ptr<DependencyCollector> Collector)
+      : Collector(std::move(Collector)) {}
+
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<RecordingGeneratePchAction>(Collector);
+  }
+
+private:
+  std::shared_ptr<DependencyCollector> Collector;
+};
+
+struct PchPaths {
+  std::string Header;
+  std::string Pch;
+  std::string Deps;
+};
+
+PchPaths pchPathsFor(StringRef CacheDir, StringRef Key) {
+  auto Join = [&](StringRef Extension) {
+    SmallString<256> Path(CacheDir);
+    sys::path::append(Path, Key + Extension);
+    return Path.str().str();
+  };
+  return {Join(".h"), Join(".pch"), Join(".deps")};
+}
+
+// The deps file records the build time and the size and modification time
+// of every file the PCH was built from:
+//   build-seconds 1.25
+//   <size> <mtime> <path>
+bool isPchFresh(const PchPaths &Paths, double &BuildSeconds) {
+  if (!sys::fs::exists(Paths.Pch))
+    return false;
+  auto Deps = MemoryBuffer::getFile(Paths.Deps);
+  if (!Deps)
+    return false;
+
+  StringRef Rest = (*Deps)->getBuffer();
+  StringRef Header;
+  std::tie(Header, Rest) = Rest.split('\n');
+  if (!Header.consume_front("build-seconds ") ||
+      Header.trim().getAsDouble(BuildSeconds))
+    return false;
+
+  while (!Rest.empty()) {
+    StringRef Line;
+    std::tie(Line, Rest) = Rest.split('\n');
+    if (Line.empty())
+      continue;
+    StringRef SizeText, MTimeText, Path;
+    std::tie(SizeText, Line) = Line.split(' ');
+    std::tie(MTimeText, Path) = Line.split(' ');
+    uint64_t Size = 0;
+    int64_t MTime = 0;
+    if (SizeText.getAsInteger(10, Size) || MTimeText.getAsInteger(10, MTime))
+      return false;
+    sys::fs::file_status Status;
+    if (sys::fs::status(Path, Status) || Status.getSize() != Size ||
+        Status.getLastModificationTime().time_since_epoch().count() != MTime)
+      return false;
+  }
+  return true;
+}
+
+bool writeDeps(const PchPaths &Paths, StringRef Directory,
+               ArrayRef<std::string> Dependencies, double BuildSeconds) {
+  std::error_code EC;
+  raw_fd_ostream OS(Paths.Deps, EC, sys::fs::OF_Text);
+  if (EC)
+    return false;
+  OS << "build-seconds " << format("%.6f", BuildSeconds) << "\n";
+  for (const std::string &Dependency : Dependencies) {
+    std::string Path = absolutePath(Directory, Dependency);
+    sys::fs::file_status Status;
+    if (sys::fs::status(Path, Status))
+      continue;
+    OS << Status.getSize() << " "
+       << Status.getLastModificationTime().time_since_epoch().count() << " "
+       << Path << "\n";
+  }
+  OS.close();
+  return !OS.has_error();
+}
+
+bool buildPch(const EastConstPchGroup &Group, const PchPaths &Paths,
+              double &BuildSeconds) {
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(Paths.Header, EC, sys::fs::OF_Text);
+    if (EC) {
+      EAST_CONST_LOG(Warning, "Cannot write PCH prefix " << Paths.Header
+                                                         << ": "
+                                                         << EC.message());
+      return false;
+    }
+    for (const std::string &Line : Group.IncludeLines)
+      OS << Line << "\n";
+  }
+
+  std::vector<std::string> Args = Group.Flags;
+  if (!Group.QuoteDirectory.empty()) {
+    Args.push_back("-iquote");
+    Args.push_back(Group.QuoteDirectory);
+  }
+  Args.insert(Args.end(), {"-x", Group.HeaderLanguage, "-o", Paths.Pch});
+  FixedCompilationDatabase Database(Group.Directory, Args);
+  ClangTool Tool(Database, {Paths.Header});
+  // The defaults force -fsyntax-only and strip -o; the PCH job needs both
+  // the emit action and the output path.
+  Tool.clearArgumentsAdjusters();
+  if (!Group.Driver.empty())
+    Tool.appendArgumentsAdjuster(
+        [Driver = Group.Driver](const CommandLineArguments &Args, StringRef) {
+          CommandLineArguments Result = Args;
+          Result.front() = Driver;
+          return Result;
+        });
+
+  auto Collector = std::make_shared<AllDependencyCollector>();
+  PchBuildActionFactory Factory(Collector);
+  auto Start = std::chrono::steady_clock::now();
+  int Result = Tool.run(&Factory);
+  BuildSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - Start)
+          .count();
+  if (Result != 0 || !sys::fs::exists(Paths.Pch)) {
+    sys::fs::remove(Paths.Pch);
+    return false;
+  }
+  if (!writeDeps(Paths, Group.Directory, Collector->getDependencies(),
+                 BuildSeconds)) {
+    EAST_CONST_LOG(Warning, "Cannot record PCH dependencies in "
+                                << Paths.Deps
+                                << "; the PCH will be rebuilt next run");
+    sys::fs::remove(Paths.Deps);
+  }
+  return true;
+}
+
+} // namespace
+
+std::vector<std::string> extractLeadingIncludes(StringRef Code) {
+  std::vector<std::string> Includes;
+  bool InBlockComment = false;
+  while (!Code.empty()) {
+    StringRef Line;
+    std::tie(Line, Code) = Code.split('\n');
+    Line = Line.trim();
+    if (InBlockComment) {
+      std::size_t End = Line.find("*/");
+      if (End == StringRef::npos)
+        continue;
+      InBlockComment = false;
+      Line = Line.drop_front(End + 2).trim();
+    }
+    while (Line.starts_with("/*")) {
+      std::size_t End = Line.find("*/", 2);
+      if (End == StringRef::npos) {
+        InBlockComment = true;
+        Line = StringRef();
+        break;
+      }
+      Line = Line.drop_front(End + 2).trim();
+    }
+    if (Line.empty() || Line.starts_with("//"))
+      continue;
+    if (!Line.consume_front("#"))
+      break;
+    Line = Line.ltrim();
+    if (Line.consume_front("pragma")) {
+      if (Line.trim() == "once")
+        continue;
+      break;
+    }
+    if (!Line.consume_front("include"))
+      break;
+    Line = Line.trim();
+    std::size_t Comment = Line.find("//");
+    if (Comment != StringRef::npos)
+      Line = Line.take_front(Comment).rtrim();
+    // Macro includes depend on definitions made by the including file.
+    if (!Line.starts_with("<") && !Line.starts_with("\""))
+      break;
+    Includes.push_back(("#include " + Line).str());
+  }
+  return Includes;
+}
+
+std::vector<EastConstPchGroup>
+planEastConstPchGroups(const CompilationDatabase &Compilations,
+                       ArrayRef<std::string> Sources,
+                       std::vector<std::string> &Ungrouped) {
+  std::map<std::string, EastConstPchGroup> ByKey;
+  for (const std::string &Source : Sources) {
+    std::vector<CompileCommand> Commands =
+        Compilations.getCompileCommands(Source);
+    auto Buffer = MemoryBuffer::getFile(Source);
+    if (Commands.empty() || !Buffer) {
+      Ungrouped.push_back(Source);
+      continue;
+    }
+    std::vector<std::string> Includes =
+        extractLeadingIncludes((*Buffer)->getBuffer());
+    if (Includes.empty()) {
+      Ungrouped.push_back(Source);
+      continue;
+    }
+
+    const CompileCommand &Command = Commands.front();
+    std::string HeaderLanguage = headerLanguageFor(Command);
+    if (HeaderLanguage.empty()) {
+      Ungrouped.push_back(Source);
+      continue;
+    }
+    std::string Driver = Command.CommandLine.empty()
+                             ? std::string()
+                             : Command.CommandLine.front();
+    std::vector<std::string> Flags = normalizeEastConstCompileFlags(Command);
+    std::string QuoteDirectory;
+    for (const std::string &Include : Includes) {
+      if (StringRef(Include).contains('"')) {
+        QuoteDirectory = sys::path::parent_path(
+                             absolutePath(Command.Directory, Source))
+                             .str();
+        break;
+      }
+    }
+
+    std::string Key = Driver + '\1' + HeaderLanguage + '\1';
+    for (const std::string &Flag : Flags)
+      Key += Flag + '\0';
+    Key += '\1' + Command.Directory + '\1' + QuoteDirectory + '\1';
+    for (const std::string &Include : Includes)
+      Key += Include + '\n';
+
+    std::string Hash = hashKey(Key);
+    EastConstPchGroup &Group = ByKey[Hash];
+    if (Group.Sources.empty()) {
+      Group.Key = Hash;
+      Group.IncludeLines = std::move(Includes);
+      Group.Directory = Command.Directory;
+      Group.Driver = std::move(Driver);
+      Group.HeaderLanguage = std::move(HeaderLanguage);
+      Group.Flags = std::move(Flags);
+      Group.QuoteDirectory = std::move(QuoteDirectory);
+    }
+    Group.Sources.push_back(Source);
+  }
+
+  std::vector<EastConstPchGroup> Groups;
+  for (auto &Entry : ByKey) {
+    if (Entry.second.Sources.size() < 2) {
+      Ungrouped.insert(Ungrouped.end(), Entry.second.Sources.begin(),
+                       Entry.second.Sources.end());
+      continue;
+    }
+    Groups.push_back(std::move(Entry.second));
+  }
+  return Groups;
+}
+
+int runEastConstPchBatch(const CompilationDatabase &Compilations,
+                         ArrayRef<std::string> Sources, StringRef CacheDir,
+                         FrontendActionFactory &Factory,
+                         EastConstPchStats &Stats) {
+  Stats.TranslationUnits += Sources.size();
+  // Each tool run resolves paths against its compile command's directory.
+  SmallString<256> AbsoluteCacheDir(CacheDir);
+  sys::fs::make_absolute(AbsoluteCacheDir);
+  CacheDir = AbsoluteCacheDir;
+  if (std::error_code EC = sys::fs::create_directories(CacheDir)) {
+    EAST_CONST_LOG(Warning, "Cannot create PCH cache " << CacheDir << ": "
+                                                       << EC.message()
+                                                       << "; parsing without");
+    ClangTool Tool(Compilations, Sources);
+    return Tool.run(&Factory);
+  }
+
+  std::vector<std::string> Ungrouped;
+  std::vector<EastConstPchGroup> Groups =
+      planEastConstPchGroups(Compilations, Sources, Ungrouped);
+
+  int Status = 0;
+  for (const EastConstPchGroup &Group : Groups) {
+    ++Stats.Groups;
+    Stats.GroupedUnits += Group.Sources.size();
+    PchPaths Paths = pchPathsFor(CacheDir, Group.Key);
+
+    double BuildSeconds = 0;
+    bool Cached = isPchFresh(Paths, BuildSeconds);
+    if (Cached) {
+      Stats.CachedUnits += Group.Sources.size();
+      EAST_CONST_LOG(Debug, "Reusing PCH " << Paths.Pch << " for "
+                                           << Group.Sources.size()
+                                           << " files");
+    } else if (buildPch(Group, Paths, BuildSeconds)) {
+      ++Stats.PchBuilt;
+      Stats.BuildSeconds += BuildSeconds;
+      Stats.EstimatedSavedSeconds -= BuildSeconds;
+      EAST_CONST_LOG(Debug, "Built PCH " << Paths.Pch << " in "
+                                         << format("%.3f", BuildSeconds)
+                                         << "s");
+    } else {
+      ++Stats.PchFailed;
+      EAST_CONST_LOG(Warning, "Could not build a PCH for "
+                                  << Group.Sources.size()
+                                  << " files sharing " << Paths.Header
+                                  << "; parsing them without one");
+      ClangTool Tool(Compilations, Group.Sources);
+      Status |= Tool.run(&Factory);
+      continue;
+    }
+
+    ClangTool Tool(Compilations, Group.Sources);
+    Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(
+        {"-include-pch", Paths.Pch}, ArgumentInsertPosition::BEGIN));
+    if (!Group.QuoteDirectory.empty())
+      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(
+          {"-iquote", Group.QuoteDirectory}, ArgumentInsertPosition::BEGIN));
+    Status |= Tool.run(&Factory);
+    Stats.EstimatedSavedSeconds += BuildSeconds * Group.Sources.size();
+  }
+
+  if (!Ungrouped.empty()) {
+    ClangTool Tool(Compilations, Ungrouped);
+    Status |= Tool.run(&Factory);
+  }
+  return Status;
+}
@@ -0,0 +1,210 @@
+#include <EastConstEnforcer.h>
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendPluginRegistry.h>
+#include <clang/Tooling/Core/Replacement.h>
+#include <clang/Tooling/ReplacementsYaml.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/YAMLTraits.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Path made absolute against the current directory, without "." and ".."
+// components, so fixes match those of other tools and translation units.
+std::string absolutePath(StringRef Path) {
+  SmallString<256> Absolute(Path);
+  sys::fs::make_absolute(Absolute);
+  sys::path::remove_dots(Absolute, /*remove_dot_dot=*/true);
+  return Absolute.str().str();
+}
+
+struct PluginSettings {
+  EastConstCheckerOptions CheckerOptions;
+  // Directory receiving one clang-apply-replacements YAML file per
+  // translation unit; empty to only diagnose.
+  std::string FixDir;
+};
+
+// Runs the checker on the compiler's own AST once the main action has
+// parsed the translation unit. Each west qualifier becomes a warning with
+// fix-its attached, mirroring the clang-tidy check.
+class EastConstPluginConsumer : public ASTConsumer {
+public:
+  EastConstPluginConsumer(CompilerInstance &CI, const PluginSettings &Settings)
+      : Diags(CI.getDiagnostics()), FixDir(Settings.FixDir),
+        Checker([this](const SourceManager &SM, CharSourceRange Range,
+                       StringRef NewText) {
+          handleReplacement(SM, Range, NewText);
+        },
+        Settings.CheckerOptions) {
+    MoveDiagID = Diags.getCustomDiagID(
+        DiagnosticsEngine::Warning,
+        "move qualifier east of the declarator [east-const]");
+    StrayDiagID = Diags.getCustomDiagID(
+        DiagnosticsEngine::Warning,
+        "remove stray qualifier token [east-const]");
+    FixFileErrorID = Diags.getCustomDiagID(
+        DiagnosticsEngine::Error, "east-const: cannot write fixes to '%0': %1");
+    registerEastConstMatchers(Finder, &Checker);
+    MatchConsumer = Finder.newASTConsumer();
+  }
+
+  void Initialize(ASTContext &Context) override {
+    MatchConsumer->Initialize(Context);
+  }
+
+  void HandleTranslationUnit(ASTContext &Context) override {
+    // A TU that failed to parse has a partial AST; rewriting it would
+    // produce fixes for code the compiler never understood.
+    if (Diags.hasErrorOccurred())
+      return;
+    MatchConsumer->HandleTranslationUnit(Context);
+    flushPendingRemoval();
+    if (!FixDir.empty())
+      writeFixFile(Context.getSourceManager());
+  }
+
+private:
+  void handleReplacement(const SourceManager &SM, CharSourceRange Range,
+                         StringRef NewText) {
+    if (Range.isInvalid())
+      return;
+    if (!FixDir.empty())
+      Fixes.emplace_back(SM, Range, NewText);
+
+    if (NewText.empty()) {
+      flushPendingRemoval();
+      PendingRemoval = Range;
+      return;
+    }
+
+    auto Builder = Diags.Report(Range.getBegin(), MoveDiagID);
+    if (PendingRemoval) {
+      Builder << FixItHint::CreateRemoval(*PendingRemoval);
+      PendingRemoval.reset();
+    }
+    Builder << FixItHint::CreateReplacement(Range, NewText);
+  }
+
+  void flushPendingRemoval() {
+    if (!PendingRemoval)
+      return;
+    Diags.Report(PendingRemoval->getBegin(), StrayDiagID)
+        << FixItHint::CreateRemoval(*PendingRemoval);
+    PendingRemoval.reset();
+  }
+
+  // Writes <FixDir>/<main-file-name>-<path-hash>.yaml in the format
+  // clang-tidy -export-fixes uses, so clang-apply-replacements can merge
+  // the fixes of a whole build. The hash keeps same-named sources from
+  // different directories apart.
+  void writeFixFile(const SourceManager &SM) {
+    OptionalFileEntryRef MainFile = SM.getFileEntryRefForID(SM.getMainFileID());
+    if (!MainFile)
+      return;
+    std::string MainPath = absolutePath(MainFile->getName());
+
+    SmallString<256> FixPath(FixDir);
+    sys::path::append(FixPath, sys::path::filename(MainPath) + "-" +
+                                   utohexstr(xxh3_64bits(MainPath)) + ".yaml");
+
+    TranslationUnitReplacements TUR;
+    TUR.MainSourceFile = MainPath;
+    // Files are named as the compile command and include search spelled
+    // them, often relative to the build directory.
+    for (const Replacement &Fix : Fixes)
+      TUR.Replacements.push_back(
+          Fix.isApplicable()
+              ? Replacement(absolutePath(Fix.getFilePath()), Fix.getOffset(),
+                            Fix.getLength(), Fix.getReplacementText())
+              : Fix);
+    Fixes.clear();
+
+    if (std::error_code EC = sys::fs::create_directories(FixDir)) {
+      Diags.Report(FixFileErrorID) << FixDir << EC.message();
+      return;
+    }
+    std::error_code EC;
+    raw_fd_ostream OS(FixPath, EC, sys::fs::OF_None);
+    if (EC) {
+      Diags.Report(FixFileErrorID) << FixPath << EC.message();
+      return;
+    }
+    yaml::Output YAML(OS);
+    YAML << TUR;
+  }
+
+  DiagnosticsEngine &Diags;
+  std::string FixDir;
+  unsigned MoveDiagID = 0;
+  unsigned StrayDiagID = 0;
+  unsigned FixFileErrorID = 0;
+  std::optional<CharSourceRange> PendingRemoval;
+  std::vector<Replacement> Fixes;
+  EastConstChecker Checker;
+  MatchFinder Finder;
+  std::unique_ptr<ASTConsumer> MatchConsumer;
+};
+
+class EastConstPluginAction : public PluginASTAction {
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef) override {
+    return std::make_unique<EastConstPluginConsumer>(CI, Settings);
+  }
+
+  // Arguments arrive as -fplugin-arg-east-const-<arg> or
+  // -Xclang -plugin-arg-east-const -Xclang <arg>.
+  bool ParseArgs(const CompilerInstance &CI,
+                 const std::vector<std::string> &Args) override {
+    DiagnosticsEngine &Diags = CI.getDiagnostics();
+    unsigned BadArgID = Diags.getCustomDiagID(
+        DiagnosticsEngine::Error, "east-const: invalid plugin argument '%0'");
+    EastConstCheckerOptions &Options = Settings.CheckerOptions;
+    Options.Quiet = true;
+    for (const std::string &Arg : Args) {
+      auto [Key, Value] = StringRef(Arg).split('=');
+      bool Valid = true;
+      if (Key == "fix-dir")
+        Settings.FixDir = Value.str();
+      else if (Key == "decl-kinds")
+        Valid = parseEastConstDeclKinds(Value, Options.EnabledDeclKinds);
+      else if (Key == "lookbehind-bytes")
+        Valid = !Value.getAsInteger(10, Options.LookbehindBytes);
+      else if (Key == "fallback-window-bytes")
+        Valid = !Value.getAsInteger(10, Options.FallbackWindowBytes);
+      else
+        Valid = false;
+      if (!Valid || (Key == "fix-dir" && Value.empty())) {
+        Diags.Report(BadArgID) << Arg;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Run after the compiler's own action so -fplugin= alone enables the
+  // check without replacing code generation.
+  ActionType getActionType() override { return AddAfterMainAction; }
+
+private:
+  PluginSettings Settings;
+};
+
+} // namespace
+
+static FrontendPluginRegistry::Add<EastConstPluginAction>
+    X("east-const", "Moves west const qualifiers to east const style.");
@@ -0,0 +1,497 @@
+#include <EastConstProcessPool.h>
+#include <EastConstLogging.h>
+#include <EastConstMemoryGovernor.h>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <optional>
+#include <utility>
+
+#if LLVM_ON_UNIX
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+#if LLVM_ON_UNIX
+
+namespace {
+
+bool writeAll(int FD, const void *Data, std::size_t Size) {
+  const char *Bytes = static_cast<const char *>(Data);
+  while (Size > 0) {
+    ssize_t Written = ::write(FD, Bytes, Size);
+    if (Written < 0 && errno == EINTR)
+      continue;
+    if (Written <= 0)
+      return false;
+    Bytes += Written;
+    Size -= Written;
+  }
+  return true;
+}
+
+// False on end of file as well as on errors: a short read means the other
+// side is gone.
+bool readAll(int FD, void *Data, std::size_t Size) {
+  char *Bytes = static_cast<char *>(Data);
+  while (Size > 0) {
+    ssize_t Read = ::read(FD, Bytes, Size);
+    if (Read < 0 && errno == EINTR)
+      continue;
+    if (Read <= 0)
+      return false;
+    Bytes += Read;
+    Size -= Read;
+  }
+  return true;
+}
+
+// Messages are a 32-bit length followed by that many bytes.
+bool writeMessage(int FD, StringRef Message) {
+  std::uint32_t Size = Message.size();
+  return writeAll(FD, &Size, sizeof(Size)) &&
+         writeAll(FD, Message.data(), Message.size());
+}
+
+bool readMessage(int FD, std::string &Message) {
+  std::uint32_t Size;
+  if (!readAll(FD, &Size, sizeof(Size)))
+    return false;
+  Message.resize(Size);
+  return readAll(FD, Message.data(), Size);
+}
+
+void flushOutput() {
+  flushEastConstLog();
+  outs().flush();
+  errs().flush();
+}
+
+// The body of a worker process: answer requests until the parent closes the
+// pipe. Each response is the task's status byte, the worker's resident set
+// after the unit, how far it grew during the unit, and the task's output.
+[[noreturn]] void serveRequests(int Requests, int Responses,
+                                const EastConstProcessTask &Task) {
+  std::string Unit, Output;
+  while (readMessage(Requests, Unit)) {
+    Output.clear();
+    bool PeakReset = resetEastConstPeakResident();
+    std::uint64_t Before = getEastConstResidentBytes();
+    char Status = Task(Unit, Output) ? 1 : 0;
+    flushOutput();
+    std::uint64_t Rss = getEastConstResidentBytes();
+    std::uint64_t Peak = PeakReset ? getEastConstPeakResidentBytes() : 0;
+    Peak = Peak > Before ? Peak - Before : 0;
+    if (!writeAll(Responses, &Status, sizeof(Status)) ||
+        !writeAll(Responses, &Rss, sizeof(Rss)) ||
+        !writeAll(Responses, &Peak, sizeof(Peak)) ||
+        !writeMessage(Responses, Output))
+      break;
+  }
+  flushOutput();
+  // Skip the parent's atexit handlers and static destructors.
+  ::_exit(0);
+}
+
+std::string describeExit(int Status) {
+  if (WIFSIGNALED(Status)) {
+    std::string Reason = "signal " + std::to_string(WTERMSIG(Status));
+    if (const char *Name = ::strsignal(WTERMSIG(Status)))
+      Reason += std::string(" (") + Name + ")";
+    return Reason;
+  }
+  if (WIFEXITED(Status))
+    return "exit status " + std::to_string(WEXITSTATUS(Status));
+  return "unknown status";
+}
+
+struct PendingUnit {
+  std::size_t Index;
+  unsigned Attempts = 0;
+};
+
+struct WorkerProcess {
+  pid_t Pid = -1;
+  int Requests = -1;
+  int Responses = -1;
+  unsigned Units = 0;
+  // Resident set between units; growth beyond it is the current unit's.
+  std::uint64_t IdleRss = 0;
+  std::optional<PendingUnit> Current;
+  std::chrono::steady_clock::time_point Started;
+
+  bool running() const { return Pid > 0; }
+};
+
+class ProcessPool {
+public:
+  ProcessPool(ArrayRef<std::string> Units,
+              const EastConstProcessPoolOptions &Options,
+              const EastConstProcessTask &Task,
+              const EastConstProcessResultHandler &OnResult,
+              EastConstProcessPoolStats &Stats)
+      : Units(Units), Options(Options), Task(Task), OnResult(OnResult),
+        Stats(Stats) {}
+
+  void run() {
+    unsigned Count =
+        hardware_concurrency(Options.Workers).compute_thread_count();
+    Workers.resize(std::max(1u, std::min<unsigned>(Count, Units.size())));
+    Stats.Workers = Workers.size();
+    for (std::size_t I = 0; I < Units.size(); ++I)
+      Queue.push_back({I});
+    if (Options.Memory)
+      Governor.emplace(*Options.Memory, [this] { return unitResidentBytes(); });
+
+    while (!Queue.empty() || Busy > 0) {
+      bool Started = dispatch();
+      if (Busy == 0) {
+        if (Started)
+          continue;
+        // Not a single worker could be started.
+        for (const PendingUnit &Pending : Queue) {
+          EAST_CONST_LOG(Error, "No worker process for "
+                                    << Units[Pending.Index]);
+          ++Stats.Failed;
+        }
+        Queue.clear();
+        break;
+      }
+      waitForResponses();
+    }
+    for (WorkerProcess &Worker : Workers)
+      if (Worker.running())
+        stop(Worker);
+    if (Governor)
+      Stats.MemoryThrottled = Governor->getStats().Throttled;
+  }
+
+private:
+  bool spawn(WorkerProcess &Worker) {
+    int ToWorker[2], FromWorker[2];
+    if (::pipe(ToWorker) != 0)
+      return false;
+    if (::pipe(FromWorker) != 0) {
+      ::close(ToWorker[0]);
+      ::close(ToWorker[1]);
+      return false;
+    }
+    // Anything still buffered would otherwise be written twice.
+    flushOutput();
+    std::uint64_t ParentRss = getEastConstResidentBytes();
+    pid_t Pid = ::fork();
+    if (Pid < 0) {
+      EAST_CONST_LOG(Error, "Cannot fork a worker process: "
+                                << std::strerror(errno));
+      for (int FD : {ToWorker[0], ToWorker[1], FromWorker[0], FromWorker[1]})
+        ::close(FD);
+      return false;
+    }
+    if (Pid == 0) {
+      // A sibling holding our pipe ends open would keep us from seeing
+      // the parent close them.
+      for (WorkerProcess &Other : Workers) {
+        if (Other.running()) {
+          ::close(Other.Requests);
+          ::close(Other.Responses);
+        }
+      }
+      ::close(ToWorker[1]);
+      ::close(FromWorker[0]);
+      serveRequests(ToWorker[0], FromWorker[1], Task);
+    }
+    ::close(ToWorker[0]);
+    ::close(FromWorker[1]);
+    Worker.Pid = Pid;
+    Worker.Requests = ToWorker[1];
+    Worker.Responses = FromWorker[0];
+    Worker.Units = 0;
+    // The fork starts out sharing, and counting, all of our pages.
+    Worker.IdleRss = ParentRss;
+    ++Stats.WorkersStarted;
+    return true;
+  }
+
+  // Closes the worker's pipes, which ends its request loop, and reaps it.
+  int stop(WorkerProcess &Worker) {
+    ::close(Worker.Requests);
+    ::close(Worker.Responses);
+    int Status = 0;
+    while (::waitpid(Worker.Pid, &Status, 0) < 0 && errno == EINTR) {
+    }
+    Worker.Pid = -1;
+    Worker.Requests = Worker.Responses = -1;
+    return Status;
+  }
+
+  // Memory the running units hold beyond their workers' idle size.
+  std::uint64_t unitResidentBytes() const {
+    std::uint64_t Total = 0;
+    for (const WorkerProcess &Worker : Workers) {
+      if (!Worker.Current)
+        continue;
+      std::uint64_t Rss = getEastConstResidentBytes(Worker.Pid);
+      if (Rss > Worker.IdleRss)
+        Total += Rss - Worker.IdleRss;
+    }
+    return Total;
+  }
+
+  std::uint64_t expectedBytes(std::size_t Index) const {
+    std::optional<std::uint64_t> Recorded;
+    if (Index < Options.UnitPeakBytes.size() && Options.UnitPeakBytes[Index])
+      Recorded = Options.UnitPeakBytes[Index];
+    return Governor->expectedBytes(Recorded);
+  }
+
+  // Hands a unit to every idle worker, starting processes as needed, until
+  // the governor holds the next one back. Returns false when a worker could
+  // not be started, or died before taking its first unit.
+  bool dispatch() {
+    bool Started = true;
+    Throttled = false;
+    if (!Queue.empty() &&
+        ((Options.Stop && *Options.Stop) ||
+         (Options.Deadline &&
+          std::chrono::steady_clock::now() >= *Options.Deadline))) {
+      Stats.Unstarted += Queue.size();
+      Queue.clear();
+    }
+    for (WorkerProcess &Worker : Workers) {
+      if (Queue.empty())
+        break;
+      if (Worker.Current)
+        continue;
+      if (Governor && !Governor->tryStart(expectedBytes(Queue.front().Index))) {
+        Throttled = true;
+        break;
+      }
+      if (!Worker.running() && !spawn(Worker)) {
+        if (Governor)
+          Governor->finish(expectedBytes(Queue.front().Index));
+        Started = false;
+        continue;
+      }
+      PendingUnit Pending = Queue.front();
+      Queue.pop_front();
+      if (!writeMessage(Worker.Requests, Units[Pending.Index])) {
+        if (Governor)
+          Governor->finish(expectedBytes(Pending.Index));
+        // Died while idle; the unit never reached it.
+        if (Worker.Units == 0)
+          Started = false;
+        pid_t Pid = Worker.Pid;
+        std::string Reason = describeExit(stop(Worker));
+        EAST_CONST_LOG(Warning,
+                       "Worker process " << Pid << " exited: " << Reason);
+        ++Stats.Crashes;
+        Queue.push_front(Pending);
+        continue;
+      }
+      Worker.Current = Pending;
+      Worker.Started = std::chrono::steady_clock::now();
+      ++Busy;
+    }
+    return Started;
+  }
+
+  void waitForResponses() {
+    std::vector<pollfd> Fds;
+    std::vector<WorkerProcess *> Polled;
+    for (WorkerProcess &Worker : Workers) {
+      if (!Worker.Current)
+        continue;
+      Fds.push_back({Worker.Responses, POLLIN, 0});
+      Polled.push_back(&Worker);
+    }
+    // While held back for memory, look again now and then: memory freed
+    // outside the pool counts too.
+    int Timeout =
+        Throttled ? static_cast<int>(Options.Memory->RecheckInterval.count())
+                  : -1;
+    // Wake up for the first unit to run out of time.
+    bool Timed = Options.UnitTimeout.count() > 0;
+    if (Timed) {
+      auto Now = std::chrono::steady_clock::now();
+      for (const WorkerProcess *Worker : Polled) {
+        auto Left = std::chrono::ceil<std::chrono::milliseconds>(
+            Worker->Started + Options.UnitTimeout - Now);
+        int LeftMs = static_cast<int>(std::max<std::int64_t>(Left.count(), 0));
+        Timeout = Timeout < 0 ? LeftMs : std::min(Timeout, LeftMs);
+      }
+    }
+    if (::poll(Fds.data(), Fds.size(), Timeout) < 0)
+      return; // EINTR; the caller polls again.
+    auto Now = std::chrono::steady_clock::now();
+    for (std::size_t I = 0; I < Fds.size(); ++I) {
+      if (Fds[I].revents & (POLLIN | POLLHUP | POLLERR))
+        receive(*Polled[I]);
+      else if (Timed && Now - Polled[I]->Started >= Options.UnitTimeout)
+        timedOut(*Polled[I]);
+    }
+  }
+
+  // Takes the worker's unit off it.
+  PendingUnit finish(WorkerProcess &Worker) {
+    PendingUnit Pending = *Worker.Current;
+    Worker.Current.reset();
+    --Busy;
+    if (Governor)
+      Governor->finish(expectedBytes(Pending.Index));
+    return Pending;
+  }
+
+  void timedOut(WorkerProcess &Worker) {
+    PendingUnit Pending = finish(Worker);
+    ::kill(Worker.Pid, SIGKILL);
+    ++Stats.TimedOut;
+    crashed(Worker, Pending,
+            "timed out after " +
+                std::to_string(Options.UnitTimeout.count()) + " ms");
+  }
+
+  void receive(WorkerProcess &Worker) {
+    PendingUnit Pending = finish(Worker);
+    StringRef Unit = Units[Pending.Index];
+    double Seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - Worker.Started)
+                         .count();
+
+    char Status;
+    std::uint64_t Rss, Peak;
+    std::string Output;
+    if (!readAll(Worker.Responses, &Status, sizeof(Status)) ||
+        !readAll(Worker.Responses, &Rss, sizeof(Rss)) ||
+        !readAll(Worker.Responses, &Peak, sizeof(Peak)) ||
+        !readMessage(Worker.Responses, Output)) {
+      crashed(Worker, Pending);
+      return;
+    }
+
+    ++Worker.Units;
+    Worker.IdleRss = Rss;
+    if (!Status)
+      ++Stats.Failed;
+    if (Pending.Attempts > 0)
+      crashRecord(Pending.Index).Recovered = true;
+    OnResult(Unit, Status != 0, Output, Seconds, Peak);
+
+    bool Recycle =
+        (Options.RecycleAfterUnits &&
+         Worker.Units >= Options.RecycleAfterUnits) ||
+        (Options.RecycleAboveRssBytes && Rss > Options.RecycleAboveRssBytes);
+    if (Recycle) {
+      EAST_CONST_LOG(Debug, "Recycling worker process "
+                                << Worker.Pid << " after " << Worker.Units
+                                << " units at " << (Rss >> 20) << " MB");
+      stop(Worker);
+      ++Stats.Recycled;
+    }
+  }
+
+  // Reason, if given, replaces how the worker exited.
+  void crashed(WorkerProcess &Worker, PendingUnit Pending,
+               std::string Reason = std::string()) {
+    ++Stats.Crashes;
+    StringRef Unit = Units[Pending.Index];
+    EastConstCrashedUnit &Record = crashRecord(Pending.Index);
+    int Status = stop(Worker);
+    Record.Reason = Reason.empty() ? describeExit(Status) : std::move(Reason);
+    if (Pending.Attempts < Options.CrashRetries) {
+      EAST_CONST_LOG(Warning, "Worker process crashed on "
+                                  << Unit << " (" << Record.Reason
+                                  << "); retrying on a fresh worker");
+      ++Pending.Attempts;
+      Queue.push_back(Pending);
+      return;
+    }
+    EAST_CONST_LOG(Error, "Worker process crashed on "
+                              << Unit << " (" << Record.Reason << ") after "
+                              << Pending.Attempts + 1
+                              << " attempts; skipping it");
+    ++Stats.Failed;
+  }
+
+  EastConstCrashedUnit &crashRecord(std::size_t Index) {
+    auto [It, Inserted] =
+        CrashIndex.try_emplace(Index, Stats.CrashedUnits.size());
+    if (Inserted)
+      Stats.CrashedUnits.push_back({Units[Index], std::string(), false});
+    return Stats.CrashedUnits[It->second];
+  }
+
+  ArrayRef<std::string> Units;
+  const EastConstProcessPoolOptions &Options;
+  const EastConstProcessTask &Task;
+  const EastConstProcessResultHandler &OnResult;
+  EastConstProcessPoolStats &Stats;
+
+  std::vector<WorkerProcess> Workers;
+  std::deque<PendingUnit> Queue;
+  std::map<std::size_t, std::size_t> CrashIndex;
+  std::optional<EastConstMemoryGovernor> Governor;
+  unsigned Busy = 0;
+  // Whether the last dispatch() stopped for memory.
+  bool Throttled = false;
+};
+
+} // namespace
+
+bool isEastConstProcessPoolSupported() { return true; }
+
+int runEastConstProcessPool(ArrayRef<std::string> Units,
+                            const EastConstProcessPoolOptions &Options,
+                            const EastConstProcessTask &Task,
+                            const EastConstProcessResultHandler &OnResult,
+                            EastConstProcessPoolStats &Stats) {
+  Stats.Units = Units.size();
+  if (Units.empty())
+    return 0;
+
+  // A worker dying between our poll and write must surface as a failed
+  // write, not kill the parent.
+  struct sigaction Ignore = {}, Previous;
+  Ignore.sa_handler = SIG_IGN;
+  ::sigaction(SIGPIPE, &Ignore, &Previous);
+
+  auto Start = std::chrono::steady_clock::now();
+  ProcessPool(Units, Options, Task, OnResult, Stats).run();
+  Stats.Seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - Start)
+          .count();
+
+  ::sigaction(SIGPIPE, &Previous, nullptr);
+  return Stats.Failed == 0 ? 0 : 1;
+}
+
+#else
+
+bool isEastConstProcessPoolSupported() { return false; }
+
+int runEastConstProcessPool(ArrayRef<std::string> Units,
+                            const EastConstProcessPoolOptions &,
+                            const EastConstProcessTask &,
+                            const EastConstProcessResultHandler &,
+                            EastConstProcessPoolStats &Stats) {
+  EAST_CONST_LOG(Error,
+                 "Worker processes are not supported on this platform");
+  Stats.Units = Units.size();
+  Stats.Failed = Units.size();
+  return Units.empty() ? 0 : 1;
+}
+
+#endif
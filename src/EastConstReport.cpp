@@ -0,0 +1,284 @@
+#include <EastConstReport.h>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/ConvertUTF.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <string>
+#include <utility>
+
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+constexpr StringLiteral RuleId = "east-const";
+
+// file:// URI of an absolute path, percent-encoding everything outside the
+// unreserved set and '/'.
+std::string fileUri(StringRef Path) {
+  std::string Uri = "file://";
+  if (!Path.starts_with("/"))
+    Uri += "/";
+  for (char C : Path) {
+    if (isAlnum(C) || StringRef("-._~/").contains(C)) {
+      Uri += C;
+    } else {
+      Uri += '%';
+      Uri += hexdigit((static_cast<unsigned char>(C) >> 4) & 0xF);
+      Uri += hexdigit(static_cast<unsigned char>(C) & 0xF);
+    }
+  }
+  return Uri;
+}
+
+// The lines of Text holding a non-ASCII byte, by 1-based number and without
+// their newline.
+std::map<unsigned, std::string> nonAsciiLines(StringRef Text) {
+  std::map<unsigned, std::string> Lines;
+  for (unsigned Number = 1; !Text.empty(); ++Number) {
+    auto [Line, Rest] = Text.split('\n');
+    if (!isASCII(Line))
+      Lines.emplace(Number, Line.str());
+    Text = Rest;
+  }
+  return Lines;
+}
+
+std::string describe(const EastConstSite &Site) {
+  return (Twine("West-positioned qualifier on ") +
+          getEastConstDeclKindName(Site.Kind) + "; move it east")
+      .str();
+}
+
+} // namespace
+
+bool parseEastConstReportFormat(StringRef Name,
+                                EastConstReportFormat &Format) {
+  if (Name == "text")
+    Format = EastConstReportFormat::Text;
+  else if (Name == "ndjson")
+    Format = EastConstReportFormat::Ndjson;
+  else if (Name == "sarif")
+    Format = EastConstReportFormat::Sarif;
+  else
+    return false;
+  return true;
+}
+
+std::string formatEastConstSiteRecord(const EastConstSite &Site) {
+  std::string Record;
+  raw_string_ostream OS(Record);
+  json::OStream J(OS);
+  J.object([&] {
+    J.attribute("file", Site.File);
+    J.attribute("line", Site.Line);
+    J.attribute("column", Site.Column);
+    J.attribute("kind", getEastConstDeclKindName(Site.Kind));
+    J.attributeArray("fix", [&] {
+      for (const Replacement &Rep : Site.Fix)
+        J.object([&] {
+          J.attribute("offset", Rep.getOffset());
+          J.attribute("length", Rep.getLength());
+          J.attribute("text", Rep.getReplacementText());
+        });
+    });
+  });
+  return OS.str();
+}
+
+bool parseEastConstSiteRecord(StringRef Record, EastConstSite &Site) {
+  Expected<json::Value> Value = json::parse(Record);
+  if (!Value) {
+    consumeError(Value.takeError());
+    return false;
+  }
+  const json::Object *Object = Value->getAsObject();
+  if (!Object)
+    return false;
+  std::optional<StringRef> File = Object->getString("file");
+  std::optional<int64_t> Line = Object->getInteger("line");
+  std::optional<int64_t> Column = Object->getInteger("column");
+  std::optional<StringRef> Kind = Object->getString("kind");
+  const json::Array *Fix = Object->getArray("fix");
+  if (!File || !Line || !Column || !Kind || !Fix)
+    return false;
+  bool KnownKind = false;
+  for (unsigned I = 0; I < static_cast<unsigned>(EastConstDeclKind::Count);
+       ++I)
+    if (*Kind == getEastConstDeclKindName(static_cast<EastConstDeclKind>(I))) {
+      Site.Kind = static_cast<EastConstDeclKind>(I);
+      KnownKind = true;
+    }
+  if (!KnownKind)
+    return false;
+  Site.File = File->str();
+  Site.Line = static_cast<unsigned>(*Line);
+  Site.Column = static_cast<unsigned>(*Column);
+  Site.Fix.clear();
+  for (const json::Value &Entry : *Fix) {
+    const json::Object *Rep = Entry.getAsObject();
+    if (!Rep)
+      return false;
+    std::optional<int64_t> Offset = Rep->getInteger("offset");
+    std::optional<int64_t> Length = Rep->getInteger("length");
+    std::optional<StringRef> Text = Rep->getString("text");
+    if (!Offset || !Length || !Text)
+      return false;
+    Site.Fix.emplace_back(Site.File, static_cast<unsigned>(*Offset),
+                          static_cast<unsigned>(*Length), *Text);
+  }
+  return true;
+}
+
+EastConstReportWriter::EastConstReportWriter(raw_ostream &OS,
+                                             EastConstReportFormat Format)
+    : OS(OS), Format(Format) {
+  if (Format != EastConstReportFormat::Sarif)
+    return;
+  // Everything up to the results array is written now; finish() closes
+  // what is still open.
+  Sarif = std::make_unique<json::OStream>(OS, /*IndentSize=*/0);
+  Sarif->objectBegin();
+  Sarif->attribute("$schema", "https://json.schemastore.org/sarif-2.1.0.json");
+  Sarif->attribute("version", "2.1.0");
+  Sarif->attributeBegin("runs");
+  Sarif->arrayBegin();
+  Sarif->objectBegin();
+  Sarif->attributeObject("tool", [&] {
+    Sarif->attributeObject("driver", [&] {
+      Sarif->attribute("name", "east-const-enforcer");
+      Sarif->attributeArray("rules", [&] {
+        Sarif->object([&] {
+          Sarif->attribute("id", RuleId);
+          Sarif->attributeObject("shortDescription", [&] {
+            Sarif->attribute("text", "Qualifiers should follow the type "
+                                     "they qualify (east const)");
+          });
+          Sarif->attributeObject("defaultConfiguration", [&] {
+            Sarif->attribute("level", "warning");
+          });
+        });
+      });
+    });
+  });
+  // The default, spelled out: readers must not take the columns as bytes.
+  Sarif->attribute("columnKind", "utf16CodeUnits");
+  Sarif->attributeBegin("results");
+  Sarif->arrayBegin();
+  // Worker processes forked later must not inherit the header unwritten.
+  Sarif->flush();
+}
+
+EastConstReportWriter::~EastConstReportWriter() { finish(); }
+
+unsigned EastConstReportWriter::utf16Column(const EastConstSite &Site) {
+  // Workers report their files interleaved, so each file is read once and
+  // only its non-ASCII lines are kept; on the rest, bytes are code units.
+  auto Cached = NonAsciiLines.find(Site.File);
+  if (Cached == NonAsciiLines.end()) {
+    auto Buffer = MemoryBuffer::getFile(Site.File, /*IsText=*/false,
+                                        /*RequiresNullTerminator=*/false);
+    // Without the file, its lines are taken to be ASCII.
+    Cached = NonAsciiLines
+                 .try_emplace(Site.File,
+                              Buffer ? nonAsciiLines((*Buffer)->getBuffer())
+                                     : std::map<unsigned, std::string>())
+                 .first;
+  }
+  auto Line = Cached->second.find(Site.Line);
+  if (Line == Cached->second.end() || Site.Column == 0)
+    return Site.Column;
+  StringRef Prefix = StringRef(Line->second).take_front(Site.Column - 1);
+  unsigned Column = 1;
+  for (std::size_t I = 0; I < Prefix.size();) {
+    unsigned Bytes = getNumBytesForUTF8(Prefix[I]);
+    // Characters beyond the BMP take a surrogate pair.
+    Column += Bytes == 4 ? 2 : 1;
+    I += Bytes;
+  }
+  return Column;
+}
+
+void EastConstReportWriter::add(const EastConstSite &Site) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  ++Results;
+  if (Format == EastConstReportFormat::Ndjson) {
+    OS << formatEastConstSiteRecord(Site) << "\n";
+    OS.flush();
+    return;
+  }
+  if (!Sarif)
+    return;
+  std::string Uri = fileUri(Site.File);
+  unsigned Column = utf16Column(Site);
+  json::OStream &J = *Sarif;
+  J.object([&] {
+    J.attribute("ruleId", RuleId);
+    J.attribute("level", "warning");
+    J.attributeObject("message", [&] { J.attribute("text", describe(Site)); });
+    J.attributeArray("locations", [&] {
+      J.object([&] {
+        J.attributeObject("physicalLocation", [&] {
+          J.attributeObject("artifactLocation",
+                            [&] { J.attribute("uri", Uri); });
+          J.attributeObject("region", [&] {
+            J.attribute("startLine", Site.Line);
+            J.attribute("startColumn", Column);
+          });
+        });
+      });
+    });
+    if (Site.Fix.empty())
+      return;
+    J.attributeArray("fixes", [&] {
+      J.object([&] {
+        J.attributeObject("description", [&] {
+          J.attribute("text", "Move the qualifiers east");
+        });
+        J.attributeArray("artifactChanges", [&] {
+          J.object([&] {
+            J.attributeObject("artifactLocation",
+                              [&] { J.attribute("uri", Uri); });
+            J.attributeArray("replacements", [&] {
+              for (const Replacement &Rep : Site.Fix)
+                J.object([&] {
+                  J.attributeObject("deletedRegion", [&] {
+                    J.attribute("byteOffset", Rep.getOffset());
+                    J.attribute("byteLength", Rep.getLength());
+                  });
+                  if (!Rep.getReplacementText().empty())
+                    J.attributeObject("insertedContent", [&] {
+                      J.attribute("text", Rep.getReplacementText());
+                    });
+                });
+            });
+          });
+        });
+      });
+    });
+  });
+  J.flush();
+}
+
+void EastConstReportWriter::finish() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (!Sarif)
+    return;
+  Sarif->arrayEnd();
+  Sarif->attributeEnd();
+  Sarif->objectEnd();
+  Sarif->arrayEnd();
+  Sarif->attributeEnd();
+  Sarif->objectEnd();
+  Sarif->flush();
+  OS << "\n";
+  OS.flush();
+  Sarif.reset();
+}
+
+unsigned EastConstReportWriter::size() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Results;
+}
@@ -0,0 +1,243 @@
+#include <EastConstRewriter.h>
+#include <EastConstAstEngine.h>
+
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+
+#include <algorithm>
+#include <utility>
+
+using namespace clang;
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+EastConstCheckerOptions quiet(EastConstCheckerOptions Options) {
+  Options.Quiet = true;
+  return Options;
+}
+
+} // namespace
+
+// What one thread parses with: the checker and matchers, and once the
+// driver has run, the invocation to copy and the ClangTool that owns the
+// FileManager.
+struct EastConstRewriter::Context {
+  Context(const EastConstRewriterOptions &Options,
+          std::shared_ptr<EastConstFileSystemCache> Cache,
+          IntrusiveRefCntPtr<vfs::FileSystem> FS, unsigned Generation)
+      : Cache(std::move(Cache)), FS(std::move(FS)), Generation(Generation),
+        Checker(
+            [this](const SourceManager &SM, CharSourceRange Range,
+                   StringRef NewText) {
+              Replacement Rep(SM, Range, NewText);
+              if (!Current || Rep.getFilePath().empty())
+                return;
+              // The checker only rewrites the main file; a conflict means
+              // one site was reached twice.
+              consumeError(Current->add(Rep));
+            },
+            quiet(Options.Checker)) {
+    registerEastConstMatchers(Finder, &Checker);
+    Factory = newEastConstActionFactory(Finder, Options.Frontend);
+  }
+
+  // Declared first so it outlives the FileManager holding its buffers.
+  std::shared_ptr<EastConstFileSystemCache> Cache;
+  IntrusiveRefCntPtr<vfs::FileSystem> FS;
+  unsigned Generation;
+  std::shared_ptr<PCHContainerOperations> PCHContainerOps =
+      std::make_shared<PCHContainerOperations>();
+  IgnoringDiagConsumer Diagnostics;
+  EastConstChecker Checker;
+  MatchFinder Finder;
+  std::unique_ptr<FrontendActionFactory> Factory;
+  // The replacements of the buffer being parsed.
+  Replacements *Current = nullptr;
+
+  // ClangTool keeps a reference to its database.
+  std::unique_ptr<CompilationDatabase> Compilations;
+  std::unique_ptr<ClangTool> Tool;
+  std::shared_ptr<CompilerInvocation> Invocation;
+  // The language Invocation was built for; a buffer in another language
+  // goes through the driver again.
+  std::string Language;
+  FileManager *Files = nullptr;
+};
+
+EastConstRewriter::EastConstRewriter(EastConstRewriterOptions Options)
+    : Options(std::move(Options)),
+      Mapped(makeIntrusiveRefCnt<vfs::InMemoryFileSystem>()),
+      Cache(std::make_shared<EastConstFileSystemCache>()) {
+  if (this->Options.Directory.empty()) {
+    SmallString<256> Cwd;
+    sys::fs::current_path(Cwd);
+    this->Options.Directory = Cwd.str().str();
+  }
+}
+
+EastConstRewriter::~EastConstRewriter() = default;
+
+void EastConstRewriter::mapFile(StringRef Path, StringRef Contents) {
+  std::string File = absolutePath(Path);
+  std::vector<std::unique_ptr<Context>> Retired;
+  std::lock_guard<std::mutex> Guard(Lock);
+  Mapped->addFile(File, 0, MemoryBuffer::getMemBufferCopy(Contents, File));
+  // Contexts that already looked for the file would not see it; the ones
+  // in use are dropped when they come back.
+  ++Generation;
+  Retired.swap(Idle);
+}
+
+std::string EastConstRewriter::absolutePath(StringRef FileName) const {
+  SmallString<256> Path(FileName);
+  if (!sys::path::is_absolute(Path))
+    sys::fs::make_absolute(Options.Directory, Path);
+  sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return Path.str().str();
+}
+
+std::unique_ptr<EastConstRewriter::Context> EastConstRewriter::acquire() {
+  std::shared_ptr<EastConstFileSystemCache> SharedCache;
+  unsigned CurrentGeneration;
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (!Idle.empty()) {
+      std::unique_ptr<Context> Reused = std::move(Idle.back());
+      Idle.pop_back();
+      return Reused;
+    }
+    SharedCache = Cache;
+    CurrentGeneration = Generation;
+  }
+  // Each context keeps its own working directory over the shared cache;
+  // mapped files shadow the disk.
+  auto FS = makeIntrusiveRefCnt<vfs::OverlayFileSystem>(
+      createEastConstCachingFileSystem(*SharedCache));
+  FS->pushOverlay(Mapped);
+  return std::make_unique<Context>(Options, std::move(SharedCache), FS,
+                                   CurrentGeneration);
+}
+
+void EastConstRewriter::release(std::unique_ptr<Context> Released) {
+  // Destroyed after the lock is dropped.
+  std::vector<std::unique_ptr<Context>> Retired;
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (Options.CacheEntryLimit != 0 &&
+      Cache->size() >= Options.CacheEntryLimit) {
+    // Start over; contexts still in use keep the old cache alive until
+    // they come back and are dropped.
+    Cache = std::make_shared<EastConstFileSystemCache>();
+    ++Generation;
+    Retired.swap(Idle);
+  }
+  if (Released->Generation != Generation) {
+    Retired.push_back(std::move(Released));
+    return;
+  }
+  Idle.push_back(std::move(Released));
+}
+
+EastConstRewriteResult EastConstRewriter::rewrite(StringRef FileName,
+                                                  StringRef Code) {
+  ++Buffers;
+  std::string Path = absolutePath(FileName);
+  std::unique_ptr<Context> Ctx = acquire();
+  Replacements Edits;
+  Ctx->Current = &Edits;
+  std::vector<std::string> CommandLine = {"clang-tool"};
+  CommandLine.insert(CommandLine.end(), Options.Flags.begin(),
+                     Options.Flags.end());
+  CommandLine.push_back(Path);
+  std::string Language = eastConstInputLanguage(
+      CompileCommand(Options.Directory, Path, std::move(CommandLine), ""));
+  bool Parsed;
+  if (Ctx->Invocation && Ctx->Language == Language) {
+    // Same flags and directory every time: copy the invocation and swap
+    // the main buffer.
+    Parsed = runEastConstInvocationFor(
+        *Ctx->Factory, *Ctx->Invocation, Path, Options.Directory, Ctx->Files,
+        Ctx->PCHContainerOps, &Ctx->Diagnostics,
+        MemoryBuffer::getMemBufferCopy(Code, Path));
+  } else {
+    // ClangTool keeps a reference to its database.
+    Ctx->Tool.reset();
+    Ctx->Compilations = std::make_unique<FixedCompilationDatabase>(
+        Options.Directory, Options.Flags);
+    Ctx->Tool = std::make_unique<ClangTool>(
+        *Ctx->Compilations, ArrayRef<std::string>(Path), Ctx->PCHContainerOps,
+        Ctx->FS);
+    Ctx->Tool->mapVirtualFile(Path, Code);
+    Ctx->Tool->setDiagnosticConsumer(&Ctx->Diagnostics);
+    EastConstCapturingFactory Capture(*Ctx->Factory);
+    Parsed = Ctx->Tool->run(&Capture) == 0;
+    ++DriverRuns;
+    // The driver may have failed before building an invocation; then the
+    // next buffer tries again.
+    if (Capture.captured()) {
+      Ctx->Invocation = std::move(Capture.Captured);
+      Ctx->Language = std::move(Language);
+      Ctx->Files = Capture.CapturedFiles;
+    } else {
+      Ctx->Invocation.reset();
+      Ctx->Tool.reset();
+    }
+  }
+  Ctx->Current = nullptr;
+  release(std::move(Ctx));
+
+  EastConstRewriteResult Result;
+  Result.Code = Code.str();
+  Expected<std::string> Fixed = Parsed
+                                    ? applyAllReplacements(Code, Edits)
+                                    : Expected<std::string>(Code.str());
+  if (!Parsed || !Fixed) {
+    if (!Fixed)
+      consumeError(Fixed.takeError());
+    ++Failed;
+    return Result;
+  }
+  Result.Success = true;
+  Result.Code = std::move(*Fixed);
+  Result.Edits.assign(Edits.begin(), Edits.end());
+  return Result;
+}
+
+std::vector<EastConstRewriteResult>
+EastConstRewriter::rewriteAll(ArrayRef<EastConstBuffer> Inputs,
+                              unsigned Jobs) {
+  std::vector<EastConstRewriteResult> Results(Inputs.size());
+  unsigned Workers = hardware_concurrency(Jobs).compute_thread_count();
+  Workers = std::max(1u, std::min<unsigned>(Workers, Inputs.size()));
+  std::atomic<std::size_t> Next{0};
+  DefaultThreadPool Pool(hardware_concurrency(Workers));
+  for (unsigned Worker = 0; Worker < Workers; ++Worker)
+    Pool.async([&] {
+      for (std::size_t I = Next++; I < Inputs.size(); I = Next++)
+        Results[I] = rewrite(Inputs[I].FileName, Inputs[I].Code);
+    });
+  Pool.wait();
+  return Results;
+}
+
+EastConstRewriterStats EastConstRewriter::getStats() const {
+  EastConstRewriterStats Stats;
+  Stats.Buffers = Buffers;
+  Stats.Failed = Failed;
+  Stats.DriverRuns = DriverRuns;
+  return Stats;
+}
@@ -0,0 +1,175 @@
+#include <EastConstSampling.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+using namespace llvm;
+
+std::size_t EastConstSampleSize::resolve(std::size_t Population) const {
+  if (Population == 0)
+    return 0;
+  std::size_t Size =
+      Count ? Count
+            : static_cast<std::size_t>(std::llround(Fraction * Population));
+  return std::clamp<std::size_t>(Size, 1, Population);
+}
+
+bool parseEastConstSampleSize(StringRef Spec, EastConstSampleSize &Size) {
+  Spec = Spec.trim();
+  Size = EastConstSampleSize();
+  if (Spec.consume_back("%")) {
+    double Percent;
+    if (Spec.getAsDouble(Percent) || !(Percent > 0) || Percent > 100)
+      return false;
+    Size.Fraction = Percent / 100;
+    return true;
+  }
+  if (!Spec.getAsInteger(10, Size.Count))
+    return Size.Count > 0;
+  double Fraction;
+  if (Spec.getAsDouble(Fraction) || !(Fraction > 0) || Fraction > 1)
+    return false;
+  Size.Fraction = Fraction;
+  return true;
+}
+
+std::string getEastConstSampleStratum(StringRef File, StringRef Root) {
+  StringRef Relative = File;
+  if (!Root.empty() && File.starts_with(Root)) {
+    Relative = File.drop_front(Root.size());
+    Relative = Relative.ltrim(sys::path::get_separator());
+  }
+  auto Component = sys::path::begin(Relative);
+  if (Component == sys::path::end(Relative))
+    return ".";
+  StringRef First = *Component;
+  // A file directly in Root is its own first component.
+  if (First == Relative)
+    return ".";
+  return First.str();
+}
+
+std::string getEastConstCommonDirectory(ArrayRef<std::string> Files) {
+  if (Files.empty())
+    return std::string();
+  StringRef Common = sys::path::parent_path(Files.front());
+  for (const std::string &File : Files.drop_front()) {
+    StringRef Directory = sys::path::parent_path(File);
+    // Shorten Common until it is a whole-component prefix of Directory.
+    while (!Common.empty() &&
+           !(Directory.starts_with(Common) &&
+             (Directory.size() == Common.size() ||
+              sys::path::is_separator(Directory[Common.size()]) ||
+              sys::path::is_separator(Common.back()))))
+      Common = sys::path::parent_path(Common);
+  }
+  return Common.str();
+}
+
+std::vector<std::size_t>
+pickEastConstStratifiedSample(ArrayRef<std::string> Files,
+                              ArrayRef<std::string> Strata, std::size_t Size,
+                              std::uint64_t Seed) {
+  StringMap<std::size_t> StratumIds;
+  std::vector<std::vector<std::size_t>> Members;
+  for (std::size_t I = 0; I < Files.size(); ++I) {
+    auto Inserted = StratumIds.try_emplace(Strata[I], Members.size());
+    if (Inserted.second)
+      Members.emplace_back();
+    Members[Inserted.first->getValue()].push_back(I);
+  }
+  Size = std::min(Size, Files.size());
+
+  // Two files per stratum first, when the sample can afford them...
+  std::vector<std::size_t> Allocated(Members.size(), 0);
+  std::size_t Floor = 0;
+  for (const std::vector<std::size_t> &Stratum : Members)
+    Floor += std::min<std::size_t>(Stratum.size(), 2);
+  if (Size >= Floor)
+    for (std::size_t S = 0; S < Members.size(); ++S)
+      Allocated[S] = std::min<std::size_t>(Members[S].size(), 2);
+
+  // ...then the rest in proportion to what each stratum has left, by largest
+  // remainder. Shares never exceed a stratum's size.
+  std::size_t Left = Size - std::accumulate(Allocated.begin(),
+                                            Allocated.end(), std::size_t(0));
+  std::size_t Room = Files.size() - (Size - Left);
+  std::vector<std::pair<double, std::size_t>> Remainders;
+  std::size_t Given = 0;
+  for (std::size_t S = 0; S < Members.size() && Room > 0; ++S) {
+    double Share = static_cast<double>(Left) *
+                   (Members[S].size() - Allocated[S]) / Room;
+    std::size_t Whole = static_cast<std::size_t>(Share);
+    Allocated[S] += Whole;
+    Given += Whole;
+    Remainders.push_back({Share - Whole, S});
+  }
+  std::stable_sort(Remainders.begin(), Remainders.end(),
+                   [](const auto &A, const auto &B) {
+                     return A.first > B.first;
+                   });
+  for (std::size_t I = 0; Given < Left && I < Remainders.size(); ++I) {
+    std::size_t S = Remainders[I].second;
+    if (Allocated[S] < Members[S].size()) {
+      ++Allocated[S];
+      ++Given;
+    }
+  }
+
+  std::string Salt = std::to_string(Seed) + "\n";
+  std::vector<std::size_t> Sample;
+  for (std::size_t S = 0; S < Members.size(); ++S) {
+    std::vector<std::pair<std::uint64_t, std::size_t>> Keyed;
+    for (std::size_t I : Members[S])
+      Keyed.push_back({xxh3_64bits(Salt + Files[I]), I});
+    std::sort(Keyed.begin(), Keyed.end());
+    for (std::size_t K = 0; K < Allocated[S]; ++K)
+      Sample.push_back(Keyed[K].second);
+  }
+  std::sort(Sample.begin(), Sample.end());
+  return Sample;
+}
+
+EastConstEstimate estimateEastConstTotal(
+    ArrayRef<EastConstStratumSample> Strata,
+    function_ref<double(const EastConstSiteCounts &)> Measure, double Z) {
+  EastConstEstimate Estimate;
+  double Variance = 0;
+  for (const EastConstStratumSample &Stratum : Strata) {
+    std::size_t N = Stratum.Population;
+    std::size_t Observed = Stratum.Observations.size();
+    if (N == 0)
+      continue;
+    if (Observed == 0) {
+      Estimate.Bounded = false;
+      continue;
+    }
+    double Sum = 0;
+    for (const EastConstSiteCounts &Counts : Stratum.Observations)
+      Sum += Measure(Counts);
+    double Mean = Sum / Observed;
+    Estimate.Total += Mean * N;
+    if (Observed >= N)
+      continue;
+    if (Observed < 2) {
+      Estimate.Bounded = false;
+      continue;
+    }
+    double Squares = 0;
+    for (const EastConstSiteCounts &Counts : Stratum.Observations)
+      Squares += (Measure(Counts) - Mean) * (Measure(Counts) - Mean);
+    double SampleVariance = Squares / (Observed - 1);
+    double Correction = 1 - static_cast<double>(Observed) / N;
+    Variance += static_cast<double>(N) * N * Correction * SampleVariance /
+                Observed;
+  }
+  Estimate.HalfWidth = Z * std::sqrt(Variance);
+  return Estimate;
+}
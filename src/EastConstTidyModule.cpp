@@ -7,6 +7,7 @@
 #include <clang-tidy/ClangTidyModuleRegistry.h>
 
 #include <optional>
+#include <string>
 
 using namespace clang;
 using namespace clang::tidy;
@@ -20,14 +21,25 @@ public:
         Checker([this](const SourceManager &, CharSourceRange Range,
                         llvm::StringRef NewText) {
           handleReplacement(Range, NewText);
-        }) {
-    setQuietMode(true);
+        },
+        readCheckerOptions()) {}
+
+  void storeOptions(ClangTidyOptions::OptionMap &Opts) override {
+    const EastConstCheckerOptions &CheckerOpts = Checker.getOptions();
+    Options.store(Opts, "LookbehindBytes", CheckerOpts.LookbehindBytes);
+    Options.store(Opts, "FallbackWindowBytes",
+                  CheckerOpts.FallbackWindowBytes);
+    Options.store(Opts, "DeclKinds", DeclKindsSpec);
   }
 
   void registerMatchers(MatchFinder *Finder) override {
     registerEastConstMatchers(*Finder, this);
   }
 
+  void onStartOfTranslationUnit() override {
+    Checker.onStartOfTranslationUnit();
+  }
+
   void check(const MatchFinder::MatchResult &Result) override {
     Checker.run(Result);
   }
@@ -37,6 +49,19 @@ public:
   }
 
 private:
+  EastConstCheckerOptions readCheckerOptions() {
+    EastConstCheckerOptions CheckerOpts;
+    CheckerOpts.Quiet = true;
+    CheckerOpts.LookbehindBytes =
+        Options.get("LookbehindBytes", CheckerOpts.LookbehindBytes);
+    CheckerOpts.FallbackWindowBytes =
+        Options.get("FallbackWindowBytes", CheckerOpts.FallbackWindowBytes);
+    DeclKindsSpec = Options.get("DeclKinds", "all").str();
+    if (!parseEastConstDeclKinds(DeclKindsSpec, CheckerOpts.EnabledDeclKinds))
+      configurationDiag("invalid DeclKinds '%0'") << DeclKindsSpec;
+    return CheckerOpts;
+  }
+
   void handleReplacement(CharSourceRange Range, llvm::StringRef NewText) {
     if (Range.isInvalid())
       return;
@@ -65,6 +90,7 @@ private:
     PendingRemoval.reset();
   }
 
+  std::string DeclKindsSpec;
   std::optional<CharSourceRange> PendingRemoval;
   EastConstChecker Checker;
 };
@@ -0,0 +1,153 @@
+#include <EastConstTimingHistory.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+bool EastConstTimingHistory::load(StringRef Path) {
+  if (!sys::fs::exists(Path))
+    return true;
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return false;
+
+  std::lock_guard<std::mutex> Guard(Lock);
+  SmallVector<StringRef, 0> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n', -1, /*KeepEmpty=*/false);
+  for (StringRef Line : Lines) {
+    auto [Time, Rest] = Line.split('\t');
+    Entry Loaded;
+    if (!to_float(Time, Loaded.Seconds) || Loaded.Seconds < 0)
+      continue;
+    auto [Peak, File] = Rest.split('\t');
+    if (File.empty() || Peak.getAsInteger(10, Loaded.PeakBytes)) {
+      // Written before peaks were recorded.
+      File = Rest;
+      Loaded.PeakBytes = 0;
+    }
+    if (File.empty())
+      continue;
+    Entries[File] = Loaded;
+  }
+  return true;
+}
+
+bool EastConstTimingHistory::save(StringRef Path) const {
+  std::vector<std::pair<std::string, Entry>> Sorted;
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    for (const auto &File : Entries)
+      Sorted.emplace_back(File.getKey().str(), File.getValue());
+  }
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const auto &A, const auto &B) { return A.first < B.first; });
+
+  SmallString<256> Temp(Path);
+  Temp += ".tmp";
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(Temp, EC, sys::fs::OF_None);
+    if (EC)
+      return false;
+    for (const auto &File : Sorted)
+      OS << format("%.4f", File.second.Seconds) << '\t'
+         << File.second.PeakBytes << '\t' << File.first << '\n';
+    OS.close();
+    if (OS.has_error())
+      return false;
+  }
+  return !sys::fs::rename(Temp, Path);
+}
+
+std::optional<double> EastConstTimingHistory::lookup(StringRef File) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Entries.find(File);
+  if (It == Entries.end())
+    return std::nullopt;
+  return It->getValue().Seconds;
+}
+
+std::optional<std::uint64_t>
+EastConstTimingHistory::lookupPeakBytes(StringRef File) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Entries.find(File);
+  if (It == Entries.end() || It->getValue().PeakBytes == 0)
+    return std::nullopt;
+  return It->getValue().PeakBytes;
+}
+
+void EastConstTimingHistory::record(StringRef File, double Seconds,
+                                    std::uint64_t PeakBytes) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Entry &Recorded = Entries[File];
+  Recorded.Seconds = Seconds;
+  if (PeakBytes != 0)
+    Recorded.PeakBytes = PeakBytes;
+}
+
+std::size_t EastConstTimingHistory::size() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Entries.size();
+}
+
+double estimateEastConstParseCost(StringRef Code) {
+  // An #include typically drags in far more text than the line itself;
+  // weigh each like 16 KiB of source.
+  constexpr double BytesPerInclude = 16 * 1024;
+  unsigned Includes = 0;
+  for (StringRef Rest = Code; !Rest.empty();) {
+    auto [Line, Next] = Rest.split('\n');
+    Rest = Next;
+    Line = Line.ltrim();
+    if (!Line.consume_front("#"))
+      continue;
+    if (Line.ltrim().starts_with("include") ||
+        Line.ltrim().starts_with("import"))
+      ++Includes;
+  }
+  return Code.size() + Includes * BytesPerInclude;
+}
+
+std::vector<double>
+expectEastConstParseSeconds(ArrayRef<std::string> Files,
+                            const EastConstTimingHistory &History,
+                            unsigned &Timed) {
+  std::vector<double> Expected(Files.size(), 0.0);
+  std::vector<bool> Known(Files.size(), false);
+  Timed = 0;
+  for (std::size_t I = 0; I < Files.size(); ++I) {
+    if (std::optional<double> Seconds = History.lookup(Files[I])) {
+      Expected[I] = *Seconds;
+      Known[I] = true;
+      ++Timed;
+    }
+  }
+  if (Timed == Files.size())
+    return Expected;
+
+  std::vector<double> Units(Files.size(), 0.0);
+  double TimedSeconds = 0, TimedUnits = 0;
+  for (std::size_t I = 0; I < Files.size(); ++I) {
+    if (auto Buffer = MemoryBuffer::getFile(Files[I]))
+      Units[I] = estimateEastConstParseCost((*Buffer)->getBuffer());
+    if (Known[I]) {
+      TimedSeconds += Expected[I];
+      TimedUnits += Units[I];
+    }
+  }
+  // With nothing timed yet only the ordering matters.
+  double SecondsPerUnit = TimedUnits > 0 ? TimedSeconds / TimedUnits : 1e-6;
+  for (std::size_t I = 0; I < Files.size(); ++I)
+    if (!Known[I])
+      Expected[I] = Units[I] * SecondsPerUnit;
+  return Expected;
+}
@@ -0,0 +1,308 @@
+#include <EastConstVerify.h>
+#include <EastConstAstEngine.h>
+
+#include <clang/AST/DeclTemplate.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <algorithm>
+#include <utility>
+
+using namespace clang;
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+class DeclTypeCollector : public RecursiveASTVisitor<DeclTypeCollector> {
+public:
+  explicit DeclTypeCollector(ASTContext &Context)
+      : Context(Context), SM(Context.getSourceManager()) {}
+
+  bool VisitDeclaratorDecl(DeclaratorDecl *D) {
+    add(D, D->getType());
+    return true;
+  }
+  bool VisitTypedefNameDecl(TypedefNameDecl *D) {
+    add(D, D->getUnderlyingType());
+    return true;
+  }
+  bool VisitClassTemplateSpecializationDecl(
+      ClassTemplateSpecializationDecl *D) {
+    if (D->isExplicitSpecialization())
+      add(D, Context.getTypeDeclType(D));
+    return true;
+  }
+
+  std::vector<EastConstDeclType> Types;
+
+private:
+  void add(const NamedDecl *D, QualType Type) {
+    SourceLocation Loc = D->getLocation();
+    if (D->isImplicit() || Loc.isInvalid() || Loc.isMacroID() ||
+        !SM.isWrittenInMainFile(Loc))
+      return;
+    SourceLocation Begin = SM.getFileLoc(D->getBeginLoc());
+    SourceLocation End = SM.getFileLoc(D->getEndLoc());
+    if (!SM.isWrittenInMainFile(Begin) || !SM.isWrittenInMainFile(End))
+      return;
+    EastConstDeclType Entry;
+    Entry.Name = D->getQualifiedNameAsString();
+    Entry.Type = Type.getCanonicalType().getAsString(
+        Context.getPrintingPolicy());
+    Entry.Begin = SM.getFileOffset(Begin);
+    Entry.End = SM.getFileOffset(End);
+    Types.push_back(std::move(Entry));
+  }
+
+  ASTContext &Context;
+  const SourceManager &SM;
+};
+
+// Parses File under Command over FS and records its declarations; with
+// Leftover, also counts the replacements a checker would still make. False
+// when the file does not compile.
+bool parseFile(const CompileCommand &Command, StringRef File,
+               IntrusiveRefCntPtr<vfs::FileSystem> FS,
+               const EastConstCheckerOptions &CheckerOptions,
+               const EastConstFrontendOptions &FrontendOptions,
+               std::vector<EastConstDeclType> &Types, unsigned *Leftover) {
+  EastConstSingleCommandDatabase Compilations(Command);
+  ClangTool Tool(Compilations, {File.str()},
+                 std::make_shared<PCHContainerOperations>(), std::move(FS));
+  IgnoringDiagConsumer Diagnostics;
+  Tool.setDiagnosticConsumer(&Diagnostics);
+
+  MatchFinder Finder;
+  EastConstDeclTypeRecorder Recorder;
+  registerEastConstDeclTypeRecorder(Finder, &Recorder);
+  EastConstCheckerOptions Options = CheckerOptions;
+  Options.Quiet = true;
+  Options.CheckOnly = false;
+  Options.FailFast = false;
+  Options.CountSites = false;
+  unsigned Replacements = 0;
+  EastConstChecker Checker(
+      [&](const SourceManager &, CharSourceRange, StringRef) {
+        ++Replacements;
+      },
+      Options);
+  if (Leftover)
+    registerEastConstMatchers(Finder, &Checker);
+
+  std::unique_ptr<FrontendActionFactory> Factory =
+      newEastConstActionFactory(Finder, FrontendOptions);
+  int Status = Tool.run(Factory.get());
+  if (Leftover)
+    *Leftover = Replacements;
+  std::optional<std::vector<EastConstDeclType>> Recorded = Recorder.take(File);
+  if (!Recorded)
+    return false;
+  Types = std::move(*Recorded);
+  return Status == 0;
+}
+
+std::string describe(const EastConstDeclType &Decl) {
+  if (!Decl.Name.empty())
+    return "'" + Decl.Name + "'";
+  return "the declaration at offset " + std::to_string(Decl.Begin);
+}
+
+} // namespace
+
+std::vector<EastConstDeclType> collectEastConstDeclTypes(ASTContext &Context) {
+  DeclTypeCollector Collector(Context);
+  Collector.TraverseAST(Context);
+  return std::move(Collector.Types);
+}
+
+void EastConstDeclTypeRecorder::run(const MatchFinder::MatchResult &Result) {
+  if (!Result.Context || !Result.SourceManager ||
+      !Result.Nodes.getNodeAs<TranslationUnitDecl>("translationUnit"))
+    return;
+  const SourceManager &SM = *Result.SourceManager;
+  OptionalFileEntryRef Main = SM.getFileEntryRefForID(SM.getMainFileID());
+  if (!Main)
+    return;
+  // Keyed like the replacements, so the two can be looked up together.
+  SmallString<256> Path(Main->getName());
+  SM.getFileManager().makeAbsolutePath(Path);
+  sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  Recorded[Path.str().str()] = collectEastConstDeclTypes(*Result.Context);
+}
+
+std::optional<std::vector<EastConstDeclType>>
+EastConstDeclTypeRecorder::take(StringRef File) {
+  auto It = Recorded.find(File.str());
+  if (It == Recorded.end())
+    return std::nullopt;
+  std::vector<EastConstDeclType> Types = std::move(It->second);
+  Recorded.erase(It);
+  return Types;
+}
+
+void registerEastConstDeclTypeRecorder(MatchFinder &Finder,
+                                       EastConstDeclTypeRecorder *Recorder) {
+  if (!Recorder)
+    return;
+  Finder.addMatcher(translationUnitDecl().bind("translationUnit"), Recorder);
+}
+
+EastConstVerification
+verifyEastConstFix(const CompilationDatabase &Compilations, StringRef File,
+                   ArrayRef<Replacement> Fix,
+                   const EastConstCheckerOptions &CheckerOptions,
+                   const EastConstFrontendOptions &FrontendOptions,
+                   const std::vector<EastConstDeclType> *Original) {
+  EastConstVerification Result;
+  Result.File = File.str();
+  auto Buffer = MemoryBuffer::getFile(File);
+  if (!Buffer) {
+    Result.Mismatches.push_back("cannot read the file: " +
+                                Buffer.getError().message());
+    return Result;
+  }
+  Replacements Replaces;
+  for (const Replacement &Rep : Fix)
+    if (Error Err = Replaces.add(Rep)) {
+      Result.Mismatches.push_back("conflicting fixes: " +
+                                  toString(std::move(Err)));
+      return Result;
+    }
+  Expected<std::string> Fixed =
+      applyAllReplacements((*Buffer)->getBuffer(), Replaces);
+  if (!Fixed) {
+    Result.Mismatches.push_back("cannot apply the fixes: " +
+                                toString(Fixed.takeError()));
+    return Result;
+  }
+
+  std::vector<CompileCommand> Commands = Compilations.getCompileCommands(File);
+  if (Commands.empty()) {
+    Result.Mismatches.push_back("no compile command");
+    return Result;
+  }
+  // A recorded AST is from whichever configuration parsed last, so it
+  // stands in for the original only when there is no other.
+  if (Commands.size() > 1)
+    Original = nullptr;
+
+  // Only the fixed file is shadowed; its headers still come from disk.
+  auto Memory = makeIntrusiveRefCnt<vfs::InMemoryFileSystem>();
+  Memory->addFile(File, 0, MemoryBuffer::getMemBufferCopy(*Fixed, File));
+  auto Overlay = makeIntrusiveRefCnt<vfs::OverlayFileSystem>(
+      vfs::createPhysicalFileSystem());
+  Overlay->pushOverlay(Memory);
+
+  // Each configuration is compared with itself: a declaration may have
+  // another type, or not exist, under other flags.
+  unsigned Compiled = 0;
+  for (std::size_t C = 0; C < Commands.size(); ++C) {
+    std::string Where;
+    if (Commands.size() > 1)
+      Where = "configuration " + std::to_string(C + 1) + " of " +
+              std::to_string(Commands.size()) + ": ";
+
+    std::vector<EastConstDeclType> Reparsed;
+    const std::vector<EastConstDeclType> *Before = Original;
+    if (!Before) {
+      // The fix cannot have changed a configuration that never compiled.
+      if (!parseFile(Commands[C], File, vfs::createPhysicalFileSystem(),
+                     CheckerOptions, FrontendOptions, Reparsed, nullptr))
+        continue;
+      Before = &Reparsed;
+    }
+    ++Compiled;
+
+    std::vector<EastConstDeclType> After;
+    unsigned Leftover = 0;
+    if (!parseFile(Commands[C], File, Overlay, CheckerOptions,
+                   FrontendOptions, After, &Leftover)) {
+      if (!Where.empty())
+        Result.Mismatches.push_back(Where + "does not compile once fixed");
+      return Result;
+    }
+    Result.Leftover = std::max(Result.Leftover, Leftover);
+
+    // Moving a qualifier adds and removes no declaration, so the two
+    // traversals pair up one to one.
+    if (After.size() != Before->size()) {
+      Result.Mismatches.push_back(
+          Where + "the fixed file declares " + std::to_string(After.size()) +
+          " entities instead of " + std::to_string(Before->size()));
+      continue;
+    }
+    for (std::size_t I = 0; I < After.size(); ++I) {
+      const EastConstDeclType &Decl = (*Before)[I];
+      bool Touched = any_of(Replaces, [&](const Replacement &Rep) {
+        return Rep.getOffset() >= Decl.Begin && Rep.getOffset() <= Decl.End;
+      });
+      if (!Touched)
+        continue;
+      ++Result.Compared;
+      if (Decl.Name != After[I].Name || Decl.Type != After[I].Type)
+        Result.Mismatches.push_back(Where + describe(Decl) + " of type '" +
+                                    Decl.Type + "' became " +
+                                    describe(After[I]) + " of type '" +
+                                    After[I].Type + "'");
+    }
+  }
+  if (Compiled == 0) {
+    Result.Mismatches.push_back("the original file does not compile");
+    return Result;
+  }
+  Result.Reparsed = true;
+  return Result;
+}
+
+EastConstVerifier::EastConstVerifier(
+    const CompilationDatabase &Compilations,
+    const EastConstCheckerOptions &CheckerOptions,
+    const EastConstFrontendOptions &FrontendOptions, unsigned Jobs)
+    : Compilations(Compilations), CheckerOptions(CheckerOptions),
+      FrontendOptions(FrontendOptions), Pool(hardware_concurrency(Jobs)) {}
+
+void EastConstVerifier::submit(
+    StringRef File, std::vector<Replacement> Fix,
+    std::optional<std::vector<EastConstDeclType>> Original) {
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (!Submitted.insert(File).second)
+      return;
+  }
+  Pool.async([this, File = File.str(), Fix = std::move(Fix),
+              Original = std::move(Original)] {
+    EastConstVerification Result =
+        verifyEastConstFix(Compilations, File, Fix, CheckerOptions,
+                           FrontendOptions, Original ? &*Original : nullptr);
+    std::lock_guard<std::mutex> Guard(Lock);
+    Results.push_back(std::move(Result));
+  });
+}
+
+bool EastConstVerifier::isSubmitted(StringRef File) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Submitted.contains(File);
+}
+
+std::vector<EastConstVerification> EastConstVerifier::wait() {
+  Pool.wait();
+  std::lock_guard<std::mutex> Guard(Lock);
+  std::vector<EastConstVerification> Done = std::move(Results);
+  Results.clear();
+  llvm::sort(Done, [](const EastConstVerification &A,
+                      const EastConstVerification &B) {
+    return A.File < B.File;
+  });
+  return Done;
+}
@@ -0,0 +1,446 @@
+#include <EastConstWatch.h>
+#include <EastConstAstEngine.h>
+#include <EastConstLogging.h>
+
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+#include <clang/Tooling/Core/Replacement.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace clang::ast_matchers;
+using namespace clang::tooling;
+using namespace llvm;
+
+namespace {
+
+std::string normalizedPath(StringRef Path) {
+  SmallString<256> Absolute(Path);
+  sys::fs::make_absolute(Absolute);
+  sys::path::remove_dots(Absolute, /*remove_dot_dot=*/true);
+  return Absolute.str().str();
+}
+
+// One worker's checker for a round; sites go to the session as found.
+struct WatchWorker {
+  WatchWorker(const EastConstCheckerOptions &CheckerOptions,
+              const EastConstFrontendOptions &FrontendOptions,
+              EastConstSiteHandler OnSite)
+      : Checker(nullptr, CheckerOptions, std::move(OnSite)) {
+    registerEastConstMatchers(Finder, &Checker);
+    Factory = newEastConstActionFactory(Finder, FrontendOptions);
+  }
+
+  EastConstChecker Checker;
+  MatchFinder Finder;
+  std::unique_ptr<FrontendActionFactory> Factory;
+};
+
+} // namespace
+
+#ifdef __linux__
+
+bool isEastConstFileWatchSupported() { return true; }
+
+EastConstFileWatcher::EastConstFileWatcher()
+    : FD(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+EastConstFileWatcher::~EastConstFileWatcher() {
+  if (FD >= 0)
+    ::close(FD);
+}
+
+bool EastConstFileWatcher::watch(ArrayRef<std::string> Paths) {
+  if (!isValid())
+    return false;
+  bool Success = true;
+  for (const std::string &Path : Paths) {
+    Files.insert(Path);
+    StringRef Directory = sys::path::parent_path(Path);
+    if (Directory.empty() || WatchedDirectories.contains(Directory))
+      continue;
+    int Watch = inotify_add_watch(FD, Directory.str().c_str(),
+                                  IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE |
+                                      IN_DELETE | IN_MOVED_FROM |
+                                      IN_MOVED_TO);
+    if (Watch < 0) {
+      int Errno = errno;
+      EAST_CONST_LOG(Warning, "Cannot watch " << Directory << ": "
+                                              << std::strerror(Errno));
+      Success = false;
+      continue;
+    }
+    WatchedDirectories.insert(Directory);
+    Directories[Watch] = Directory.str();
+  }
+  return Success;
+}
+
+bool EastConstFileWatcher::drain(std::set<std::string> &Changed) {
+  alignas(inotify_event) char Buffer[16 * 1024];
+  while (true) {
+    ssize_t Read = ::read(FD, Buffer, sizeof(Buffer));
+    if (Read <= 0)
+      return true;
+    for (char *Next = Buffer; Next < Buffer + Read;) {
+      const auto *Event = reinterpret_cast<const inotify_event *>(Next);
+      Next += sizeof(inotify_event) + Event->len;
+      if (Event->mask & IN_Q_OVERFLOW)
+        return false;
+      if (Event->mask & IN_IGNORED) {
+        // The directory went away; a new one of that name needs a new
+        // watch.
+        auto It = Directories.find(Event->wd);
+        if (It != Directories.end()) {
+          WatchedDirectories.erase(It->second);
+          Directories.erase(It);
+        }
+        continue;
+      }
+      auto It = Directories.find(Event->wd);
+      if (It == Directories.end() || Event->len == 0)
+        continue;
+      SmallString<256> Path(It->second);
+      sys::path::append(Path, Event->name);
+      if (Files.contains(Path))
+        Changed.insert(Path.str().str());
+    }
+  }
+}
+
+std::vector<std::string>
+EastConstFileWatcher::wait(std::chrono::milliseconds Settle,
+                           const std::atomic<bool> *Stop) {
+  std::set<std::string> Changed;
+  if (!isValid())
+    return {};
+  // Stop is looked at this often while nothing changes.
+  constexpr int IdleMilliseconds = 100;
+  while (true) {
+    if (Stop && *Stop)
+      return {};
+    pollfd Poll{FD, POLLIN, 0};
+    int Ready = ::poll(&Poll, 1,
+                       Changed.empty() ? IdleMilliseconds
+                                       : static_cast<int>(Settle.count()));
+    if (Ready < 0 && errno != EINTR) {
+      int Errno = errno;
+      EAST_CONST_LOG(Error, "Cannot wait for file changes: "
+                                << std::strerror(Errno));
+      return {};
+    }
+    if (Ready == 0 && !Changed.empty())
+      return std::vector<std::string>(Changed.begin(), Changed.end());
+    if (Ready > 0 && !drain(Changed)) {
+      EAST_CONST_LOG(Warning, "Lost file change events; treating every "
+                              "watched file as changed");
+      std::vector<std::string> All;
+      for (const auto &File : Files)
+        All.push_back(File.getKey().str());
+      std::sort(All.begin(), All.end());
+      return All;
+    }
+  }
+}
+
+#else
+
+bool isEastConstFileWatchSupported() { return false; }
+
+EastConstFileWatcher::EastConstFileWatcher() = default;
+EastConstFileWatcher::~EastConstFileWatcher() = default;
+
+bool EastConstFileWatcher::watch(ArrayRef<std::string>) { return false; }
+
+bool EastConstFileWatcher::drain(std::set<std::string> &) { return false; }
+
+std::vector<std::string>
+EastConstFileWatcher::wait(std::chrono::milliseconds,
+                           const std::atomic<bool> *) {
+  return {};
+}
+
+#endif
+
+void EastConstDependencyGraph::record(StringRef Source,
+                                      ArrayRef<std::string> Files) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  std::vector<std::string> &Read = Reads[Source.str()];
+  for (const std::string &File : Read)
+    ReadBy[File].erase(Source.str());
+  Read.assign(Files.begin(), Files.end());
+  for (const std::string &File : Read)
+    ReadBy[File].insert(Source.str());
+}
+
+std::vector<std::string>
+EastConstDependencyGraph::affected(ArrayRef<std::string> Changed) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  std::set<std::string> Sources;
+  for (const std::string &File : Changed) {
+    auto It = ReadBy.find(File);
+    if (It != ReadBy.end())
+      Sources.insert(It->second.begin(), It->second.end());
+  }
+  return std::vector<std::string>(Sources.begin(), Sources.end());
+}
+
+std::vector<std::string> EastConstDependencyGraph::files() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  std::vector<std::string> Files;
+  for (const auto &FileAndSources : ReadBy)
+    if (!FileAndSources.second.empty())
+      Files.push_back(FileAndSources.first);
+  return Files;
+}
+
+EastConstWatchSession::EastConstWatchSession(
+    const CompilationDatabase &Compilations, ArrayRef<std::string> Sources,
+    const EastConstCheckerOptions &CheckerOptions,
+    const EastConstFrontendOptions &FrontendOptions,
+    const EastConstWatchOptions &Options, raw_ostream &Out)
+    : Compilations(Compilations), CheckerOptions(CheckerOptions),
+      FrontendOptions(FrontendOptions), Options(Options), Out(Out) {
+  for (const std::string &Source : Sources)
+    this->Sources.push_back(normalizedPath(Source));
+  std::sort(this->Sources.begin(), this->Sources.end());
+  this->Sources.erase(
+      std::unique(this->Sources.begin(), this->Sources.end()),
+      this->Sources.end());
+  // Sites are printed by the session; fixes are only built to be written.
+  this->CheckerOptions.Quiet = true;
+  this->CheckerOptions.CheckOnly = !Options.Fix;
+  this->CheckerOptions.CountSites = false;
+  this->CheckerOptions.FailFast = false;
+  this->FrontendOptions.OnDependencies =
+      [this](StringRef MainFile, ArrayRef<std::string> Files) {
+        Dependencies.record(MainFile, Files);
+      };
+}
+
+bool EastConstWatchSession::analyze(ArrayRef<std::string> Batch) {
+  std::mutex Lock;
+  std::map<std::string, Result> Fresh;
+  for (const std::string &Source : Batch)
+    Fresh[Source];
+  EastConstSiteHandler OnSite = [&](const EastConstSite &Site) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Fresh[Site.File].Sites.push_back(Site);
+  };
+  std::vector<std::unique_ptr<WatchWorker>> Workers;
+  auto WorkerFactory = [&](unsigned Worker) -> FrontendActionFactory & {
+    while (Workers.size() <= Worker)
+      Workers.push_back(std::make_unique<WatchWorker>(
+          CheckerOptions, FrontendOptions, OnSite));
+    return *Workers[Worker]->Factory;
+  };
+  // Nothing read in an earlier round may be reused: that is what changed.
+  EastConstAstEngineOptions EngineOptions;
+  EngineOptions.Jobs = Options.Jobs;
+  EngineOptions.OnFileDone = [&](unsigned, StringRef, StringRef File,
+                                 bool Success) {
+    if (Success)
+      return;
+    std::lock_guard<std::mutex> Guard(Lock);
+    Fresh[File.str()].Success = false;
+  };
+  EastConstAstEngineStats EngineStats;
+  int Status = runEastConstAstEngine(Compilations, Batch, EngineOptions,
+                                     WorkerFactory, EngineStats);
+  ++Rounds;
+  Analyzed += Batch.size();
+
+  for (auto &SourceAndResult : Fresh) {
+    Result &Fresher = SourceAndResult.second;
+    std::sort(Fresher.Sites.begin(), Fresher.Sites.end(),
+              [](const EastConstSite &LHS, const EastConstSite &RHS) {
+                return std::tie(LHS.Line, LHS.Column) <
+                       std::tie(RHS.Line, RHS.Column);
+              });
+    // Each configuration of the file reports the sites they share again.
+    Fresher.Sites.erase(
+        std::unique(Fresher.Sites.begin(), Fresher.Sites.end(),
+                    [](const EastConstSite &LHS, const EastConstSite &RHS) {
+                      return std::tie(LHS.Line, LHS.Column) ==
+                             std::tie(RHS.Line, RHS.Column);
+                    }),
+        Fresher.Sites.end());
+    for (const EastConstSite &Site : Fresher.Sites)
+      Out << Site.File << ':' << Site.Line << ':' << Site.Column
+          << ": west const (" << getEastConstDeclKindName(Site.Kind)
+          << ")\n";
+    Results[SourceAndResult.first] = std::move(Fresher);
+  }
+  if (Options.Fix)
+    applyFixes(Batch);
+
+  EastConstWatchStats Stats = getStats();
+  Out << "Round " << Rounds << ": analyzed " << Batch.size() << " of "
+      << Sources.size() << " files";
+  if (EngineStats.Failed > 0)
+    Out << " (" << EngineStats.Failed << " failed)";
+  Out << "; " << Stats.Sites << " west-const sites in "
+      << Stats.FilesWithSites
+      << (Stats.FilesWithSites == 1 ? " file\n" : " files\n");
+  Out.flush();
+  return Status == 0;
+}
+
+void EastConstWatchSession::applyFixes(ArrayRef<std::string> Batch) {
+  for (const std::string &Source : Batch) {
+    auto It = Results.find(Source);
+    if (It == Results.end() || It->second.Sites.empty())
+      continue;
+    Replacements Fixes;
+    bool Complete = true;
+    for (const EastConstSite &Site : It->second.Sites)
+      for (const Replacement &Rep : Site.Fix)
+        if (Error Err = addEastConstFix(Fixes, Rep)) {
+          std::string Message = toString(std::move(Err));
+          EAST_CONST_LOG(Warning, "Dropped a conflicting fix in "
+                                      << Source << ": " << Message);
+          Complete = false;
+        }
+    auto FileOrError = MemoryBuffer::getFile(Source);
+    if (std::error_code EC = FileOrError.getError()) {
+      EAST_CONST_LOG(Error, "Error reading file " << Source << ": "
+                                                   << EC.message());
+      continue;
+    }
+    Expected<std::string> Fixed =
+        applyAllReplacements((*FileOrError)->getBuffer(), Fixes);
+    if (!Fixed) {
+      std::string Message = toString(Fixed.takeError());
+      EAST_CONST_LOG(Error, "Cannot apply the fixes to " << Source << ": "
+                                                         << Message);
+      continue;
+    }
+    std::error_code EC;
+    raw_fd_ostream OS(Source, EC);
+    if (EC) {
+      EAST_CONST_LOG(Error, "Error writing file " << Source << ": "
+                                                   << EC.message());
+      continue;
+    }
+    OS << *Fixed;
+    OS.close();
+    if (OS.has_error()) {
+      EAST_CONST_LOG(Error, "Error writing file " << Source << ": "
+                                                   << OS.error().message());
+      OS.clear_error();
+      continue;
+    }
+    // Every site is fixed, so the write needs no round of its own. With a
+    // fix dropped, the round the write triggers finds what is left.
+    if (Complete) {
+      It->second.Sites.clear();
+      Written[Source] = xxh3_64bits(*Fixed);
+    }
+    EAST_CONST_LOG(Info, "Applied " << Fixes.size() << " fixes to "
+                                    << Source);
+  }
+}
+
+std::vector<std::string>
+EastConstWatchSession::affected(ArrayRef<std::string> Changed) const {
+  std::vector<std::string> Affected = Dependencies.affected(Changed);
+  // A source that never got as far as the preprocessor read nothing.
+  for (const std::string &File : Changed)
+    if (std::binary_search(Sources.begin(), Sources.end(), File))
+      Affected.push_back(File);
+  std::sort(Affected.begin(), Affected.end());
+  Affected.erase(std::unique(Affected.begin(), Affected.end()),
+                 Affected.end());
+  return Affected;
+}
+
+void EastConstWatchSession::dropOwnWrites(std::vector<std::string> &Changed) {
+  auto IsOwnWrite = [&](const std::string &File) {
+    auto It = Written.find(File);
+    if (It == Written.end())
+      return false;
+    auto Buffer = MemoryBuffer::getFile(File);
+    bool Unchanged = Buffer && xxh3_64bits((*Buffer)->getBuffer()) ==
+                                   It->second;
+    // Either way, the next change to the file is someone else's.
+    Written.erase(It);
+    return Unchanged;
+  };
+  Changed.erase(std::remove_if(Changed.begin(), Changed.end(), IsOwnWrite),
+                Changed.end());
+}
+
+std::vector<std::string> EastConstWatchSession::watchedFiles() const {
+  std::vector<std::string> Files = Dependencies.files();
+  Files.insert(Files.end(), Sources.begin(), Sources.end());
+  std::sort(Files.begin(), Files.end());
+  Files.erase(std::unique(Files.begin(), Files.end()), Files.end());
+  return Files;
+}
+
+EastConstWatchStats EastConstWatchSession::getStats() const {
+  EastConstWatchStats Stats;
+  Stats.Rounds = Rounds;
+  Stats.Analyzed = Analyzed;
+  for (const auto &SourceAndResult : Results) {
+    const Result &Latest = SourceAndResult.second;
+    Stats.Sites += Latest.Sites.size();
+    Stats.FilesWithSites += !Latest.Sites.empty();
+    Stats.Failed += !Latest.Success;
+  }
+  return Stats;
+}
+
+int runEastConstWatch(const CompilationDatabase &Compilations,
+                      ArrayRef<std::string> Sources,
+                      const EastConstCheckerOptions &CheckerOptions,
+                      const EastConstFrontendOptions &FrontendOptions,
+                      const EastConstWatchOptions &Options,
+                      raw_ostream &Out) {
+  EastConstFileWatcher Watcher;
+  if (!isEastConstFileWatchSupported() || !Watcher.isValid()) {
+    EAST_CONST_LOG(Error, "--watch needs inotify, which is not available");
+    return 1;
+  }
+  EastConstWatchSession Session(Compilations, Sources, CheckerOptions,
+                                FrontendOptions, Options, Out);
+  Session.analyze(Session.sources());
+  unsigned Round = 0;
+  while (Options.MaxRounds == 0 || Round < Options.MaxRounds) {
+    // Newly included headers are watched from here on.
+    Watcher.watch(Session.watchedFiles());
+    std::vector<std::string> Changed =
+        Watcher.wait(Options.Settle, Options.Stop);
+    if (Changed.empty())
+      break;
+    Session.dropOwnWrites(Changed);
+    if (Changed.empty())
+      continue;
+    std::vector<std::string> Affected = Session.affected(Changed);
+    EAST_CONST_LOG(Info, Changed.size() << " files changed; re-analyzing "
+                                        << Affected.size() << " of "
+                                        << Session.sources().size());
+    if (Affected.empty())
+      continue;
+    Session.analyze(Affected);
+    ++Round;
+  }
+  return Session.getStats().Failed > 0 ? 1 : 0;
+}
@@ -1,4 +1,23 @@
+#include <EastConstAstEngine.h>
+#include <EastConstAstInputs.h>
+#include <EastConstCheckpoint.h>
+#include <EastConstDiff.h>
 #include <EastConstEnforcer.h>
+#include <EastConstFileSystemCache.h>
+#include <EastConstFilter.h>
+#include <EastConstFormat.h>
+#include <EastConstFrontend.h>
+#include <EastConstLexerEngine.h>
+#include <EastConstLogging.h>
+#include <EastConstLsp.h>
+#include <EastConstMemoryGovernor.h>
+#include <EastConstPchBatch.h>
+#include <EastConstProcessPool.h>
+#include <EastConstReport.h>
+#include <EastConstSampling.h>
+#include <EastConstTimingHistory.h>
+#include <EastConstVerify.h>
+#include <EastConstWatch.h>
 
 #include <clang/AST/ASTContext.h>
 #include <clang/ASTMatchers/ASTMatchFinder.h>
@@ -7,12 +26,37 @@
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Refactoring.h>
+#include <clang/Tooling/ReplacementsYaml.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/YAMLTraits.h>
+#include <llvm/Support/xxhash.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace {
 
@@ -20,103 +64,1604 @@ cl::OptionCategory EastConstCategory("east-const-enforcer options");
 cl::extrahelp CommonHelp(CommonOptionsParser::HelpMessage);
 cl::opt<bool> FixErrors("fix", cl::desc("Apply fixes to diagnosed warnings"),
                         cl::cat(EastConstCategory));
+cl::opt<bool> CheckOption(
+    "check",
+    cl::desc("Only count west-const sites, building no fixes, and exit with "
+             "status 1 if there are any"),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> FailFastOption(
+    "fail-fast", cl::ValueOptional,
+    cl::desc("Check mode that stops checking a file at its first site; "
+             "--fail-fast=run also starts no further files"),
+    cl::value_desc("file|run"), cl::cat(EastConstCategory));
+cl::opt<bool> DiffOption(
+    "diff",
+    cl::desc("Print the fixes as a unified diff instead of applying them; "
+             "each file is printed once it and every file before it are "
+             "done, so the patch is the same for any -j"),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> StdinOption(
+    "stdin", cl::ValueOptional,
+    cl::desc("Read source from standard input and write the fixed source to "
+             "standard output, touching no file; --stdin=framed reads and "
+             "answers a stream of \"<bytes> <file name>\\n<source>\" frames"),
+    cl::value_desc("framed"), cl::cat(EastConstCategory));
+cl::opt<std::string> AssumeFileNameOption(
+    "assume-filename",
+    cl::desc("File name standard input is compiled as (and frames without "
+             "a name are), for --stdin"),
+    cl::init("stdin.cpp"), cl::cat(EastConstCategory));
+cl::opt<bool> LspOption(
+    "lsp",
+    cl::desc("Serve diagnostics and \"move qualifier east\" quick fixes to "
+             "an editor over the Language Server Protocol on stdin/stdout"),
+    cl::cat(EastConstCategory));
+cl::opt<bool> WatchOption(
+    "watch",
+    cl::desc("Keep running: watch the sources and every header they include, "
+             "and on each change re-analyze only the sources it reaches, "
+             "printing their sites and the totals; with -fix, fix them too"),
+    cl::cat(EastConstCategory));
+cl::opt<bool> FormatFixedRangesOption(
+    "format-fixed-ranges",
+    cl::desc("With -fix or --diff, reformat (per .clang-format) only the "
+             "lines the fixes touch, in the same pass"),
+    cl::cat(EastConstCategory));
+cl::opt<bool> VerifyOption(
+    "verify",
+    cl::desc("Reparse every fixed file in memory, without writing it, and "
+             "check that each declaration a fix touched kept its canonical "
+             "type and that a second pass finds nothing to fix; with -fix, "
+             "files that fail are left alone"),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> FormatOption(
+    "format",
+    cl::desc("How to report west-const sites on stdout: text (default), "
+             "ndjson (one JSON record per site, as soon as it is found) or "
+             "sarif (a SARIF 2.1.0 log)"),
+    cl::init("text"), cl::cat(EastConstCategory));
 cl::opt<bool> QuietFlag("quiet", cl::desc("Suppress informational output"),
                         cl::cat(EastConstCategory));
+cl::opt<std::string> LogLevelOption(
+    "log-level",
+    cl::desc("Diagnostic verbosity: off, error, warning, info, debug or "
+             "trace (overrides -quiet)"),
+    cl::value_desc("level"), cl::cat(EastConstCategory));
+cl::opt<unsigned> LookbehindBytes(
+    "lookbehind-bytes",
+    cl::desc("Bytes scanned before a type when searching for west "
+             "qualifiers"),
+    cl::init(EastConstCheckerOptions().LookbehindBytes),
+    cl::cat(EastConstCategory));
+cl::opt<unsigned> FallbackWindowBytes(
+    "fallback-window-bytes",
+    cl::desc("Bytes of a qualified type inspected for auto/decltype before "
+             "using the spelling fallback"),
+    cl::init(EastConstCheckerOptions().FallbackWindowBytes),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> DeclKindsOption(
+    "decl-kinds",
+    cl::desc("Comma-separated declaration kinds to rewrite (variable, "
+             "parameter, return, field, typedef, alias, template-argument, "
+             "non-type-template-parameter, all)"),
+    cl::init("all"), cl::cat(EastConstCategory));
+cl::opt<bool> FastFrontend(
+    "fast-frontend",
+    cl::desc("Lean parse: skip function bodies outside the main file, ignore "
+             "warnings and leave the AST to process teardown"),
+    cl::cat(EastConstCategory));
+cl::opt<bool> SkipMainFileBodies(
+    "skip-main-file-bodies",
+    cl::desc("Also skip main-file function bodies; only signatures, members "
+             "and aliases are rewritten (implies --fast-frontend)"),
+    cl::cat(EastConstCategory));
+cl::opt<bool> PchBatch(
+    "pch-batch",
+    cl::desc("Group files by compile flags and leading #include block and "
+             "parse each group on a shared precompiled header"),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> PchCacheDir(
+    "pch-cache-dir",
+    cl::desc("Directory holding the --pch-batch headers (default: "
+             ".east-const-pch)"),
+    cl::init(".east-const-pch"), cl::cat(EastConstCategory));
+cl::opt<bool> AstFromBuild(
+    "ast-from-build",
+    cl::desc("Check the .ast file the build emitted next to each source's "
+             "object file instead of reparsing the source, when present"),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> EngineOption(
+    "engine",
+    cl::desc("Detection engine: 'ast' (semantic, default) or 'lexer' (raw "
+             "token heuristics, no compile commands needed)"),
+    cl::init("ast"), cl::cat(EastConstCategory));
+cl::opt<std::string> ConfirmSampleOption(
+    "confirm-sample",
+    cl::desc("With --engine=lexer, re-check N% of the files with the AST "
+             "engine and report how often the engines agree (e.g. 5%)"),
+    cl::value_desc("N%"), cl::cat(EastConstCategory));
+cl::opt<std::string> SampleOption(
+    "sample",
+    cl::desc("Estimate the west-const sites of the whole input from a "
+             "random sample of its files, stratified by top-level "
+             "directory: a fraction (0.05 or 5%) or a file count (200). "
+             "With no sources, samples the whole compilation database"),
+    cl::value_desc("fraction|count"), cl::cat(EastConstCategory));
+cl::opt<unsigned> SampleSeedOption(
+    "sample-seed",
+    cl::desc("Seed for --sample; the same seed and files pick the same "
+             "sample"),
+    cl::init(1), cl::cat(EastConstCategory));
+cl::opt<unsigned> JobsOption(
+    "j", cl::desc("Worker threads (0 = all cores)"), cl::init(0),
+    cl::cat(EastConstCategory));
+cl::opt<bool> FsCacheOption(
+    "fs-cache",
+    cl::desc("Share one stat and file-content cache between all workers for "
+             "the run (default: on; --fs-cache=false reads from disk)"),
+    cl::init(true), cl::cat(EastConstCategory));
+cl::opt<bool> DedupConfigsOption(
+    "dedup-configs",
+    cl::desc("Parse each file once per distinct preprocessor configuration, "
+             "skipping compile commands that differ only in code-generation "
+             "flags (default: on)"),
+    cl::init(true), cl::cat(EastConstCategory));
+cl::opt<bool> PoolInvocationsOption(
+    "pool-invocations",
+    cl::desc("Run the compiler driver once per group of files with the same "
+             "directory and flags and reuse its invocation for the rest of "
+             "the group (default: on)"),
+    cl::init(true), cl::cat(EastConstCategory));
+cl::opt<std::string> TimingHistoryOption(
+    "timing-history",
+    cl::desc("File recording each file's parse time; later runs start the "
+             "slowest files first (e.g. build/.east-const-timings; off by "
+             "default)"),
+    cl::value_desc("file"), cl::cat(EastConstCategory));
+cl::opt<std::string> WorkersOption(
+    "workers",
+    cl::desc("Where files are parsed: 'thread' (default) or 'process' "
+             "(forked worker processes; a crash costs one file instead of "
+             "the run, and recycling workers bounds memory)"),
+    cl::init("thread"), cl::cat(EastConstCategory));
+cl::opt<unsigned> RecycleAfterOption(
+    "recycle-after",
+    cl::desc("With --workers=process, replace a worker process after this "
+             "many files (0 = never; default: 200)"),
+    cl::init(200), cl::cat(EastConstCategory));
+cl::opt<unsigned> RecycleRssOption(
+    "recycle-rss-mb",
+    cl::desc("With --workers=process, replace a worker process once its "
+             "resident set exceeds this many MB (0 = never; default: 4096)"),
+    cl::init(4096), cl::cat(EastConstCategory));
+cl::opt<unsigned> UnitTimeoutOption(
+    "unit-timeout",
+    cl::desc("With --workers=process, kill a worker process still on one "
+             "file after this many seconds and count the file as crashed "
+             "(0 = no limit; default: 0)"),
+    cl::init(0), cl::value_desc("seconds"), cl::cat(EastConstCategory));
+cl::opt<bool> MemoryGovernorOption(
+    "memory-governor",
+    cl::desc("Hold back new files while the system is short of memory and "
+             "resume as it frees up (default: on)"),
+    cl::init(true), cl::cat(EastConstCategory));
+cl::opt<unsigned> MemoryReserveOption(
+    "memory-reserve-mb",
+    cl::desc("Memory the governor leaves to the rest of the machine "
+             "(default: 1024)"),
+    cl::init(1024), cl::cat(EastConstCategory));
+cl::opt<unsigned> FileMemoryOption(
+    "file-memory-mb",
+    cl::desc("Peak memory the governor assumes for a file with none "
+             "recorded in the timing history (default: 256)"),
+    cl::init(256), cl::cat(EastConstCategory));
+cl::opt<std::string> CheckpointOption(
+    "checkpoint",
+    cl::desc("Record each finished file and its fixes in this file as the "
+             "run goes, so an interrupted run can be resumed"),
+    cl::value_desc("file"), cl::cat(EastConstCategory));
+cl::opt<bool> ResumeOption(
+    "resume",
+    cl::desc("With --checkpoint, skip the files an earlier run finished and "
+             "keep their fixes"),
+    cl::cat(EastConstCategory));
+cl::opt<std::string> TimeBudgetOption(
+    "time-budget",
+    cl::desc("Start no new file after this long (e.g. 90m, 2h, 3600s) and "
+             "exit with status 2 if files were left; combine with "
+             "--checkpoint and --resume to continue in a later run"),
+    cl::value_desc("duration"), cl::cat(EastConstCategory));
 
+// Collects every worker's replacements into one map; workers call it
+// concurrently.
 class RefactoringReplacementHandler {
 public:
-  explicit RefactoringReplacementHandler(RefactoringTool &Tool) : Tool(Tool) {}
+  explicit RefactoringReplacementHandler(
+      std::map<std::string, Replacements> &ReplacementsMap)
+      : ReplacementsMap(ReplacementsMap) {}
 
   void operator()(const SourceManager &SM, CharSourceRange Range,
                   llvm::StringRef NewText) const {
     Replacement Rep(SM, Range, NewText);
+    if (Rep.getFilePath().empty())
+      return;
+    // Compile commands run in their own directories; key files by absolute
+    // path, as the engine and checkpoints name them.
+    llvm::SmallString<256> Path(Rep.getFilePath());
+    SM.getFileManager().makeAbsolutePath(Path);
+    llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+    Rep = Replacement(Path, Rep.getOffset(), Rep.getLength(),
+                      Rep.getReplacementText());
+    if (!add(Rep))
+      return;
+
+    if (!NewText.empty()) {
+      EAST_CONST_LOG(Info, "Inserted qualifier suffix '"
+                               << NewText << "' in " << Rep.getFilePath());
+    }
+  }
+
+  // Also used for replacements a worker process sent back.
+  bool add(const Replacement &Rep) const {
     std::string FilePath = Rep.getFilePath().str();
     if (FilePath.empty())
-      return;
+      return false;
 
-    auto &FileReplacements = Tool.getReplacements()[FilePath];
-    llvm::Error Err = FileReplacements.add(Rep);
+    std::unique_lock<std::mutex> Guard(Lock);
+    auto &FileReplacements = ReplacementsMap[FilePath];
+    llvm::Error Err = addEastConstFix(FileReplacements, Rep);
+    Guard.unlock();
     if (Err) {
-      if (!isQuietMode()) {
-        llvm::errs() << "Error adding replacement to "
-                     << FilePath << ": "
-                     << llvm::toString(std::move(Err)) << "\n";
-      }
-      return;
+      EAST_CONST_LOG(Warning, "Error adding replacement to "
+                                  << FilePath << ": "
+                                  << llvm::toString(std::move(Err)));
+      return false;
     }
+    return true;
+  }
 
-    if (!isQuietMode() && !NewText.empty()) {
-      llvm::errs() << "Inserted qualifier suffix '" << NewText << "' in "
-                   << FilePath << "\n";
-    }
+  std::vector<Replacement> replacementsFor(llvm::StringRef File) const {
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto It = ReplacementsMap.find(File.str());
+    if (It == ReplacementsMap.end())
+      return {};
+    return std::vector<Replacement>(It->second.begin(), It->second.end());
   }
 
 private:
-  RefactoringTool &Tool;
+  std::map<std::string, Replacements> &ReplacementsMap;
+  mutable std::mutex Lock;
+};
+
+// What one AST engine worker owns; checkers keep per-TU state, so workers
+// never share one.
+struct AstWorker {
+  AstWorker(ReplacementHandler Handler,
+            const EastConstCheckerOptions &CheckerOptions,
+            const EastConstFrontendOptions &FrontendOptions,
+            EastConstSiteHandler OnSite = nullptr,
+            bool RecordDeclTypes = false)
+      : Checker(std::move(Handler), CheckerOptions, std::move(OnSite)) {
+    registerEastConstMatchers(Finder, &Checker);
+    if (RecordDeclTypes)
+      registerEastConstDeclTypeRecorder(Finder, &Recorder);
+    Factory = newEastConstActionFactory(Finder, FrontendOptions);
+  }
+
+  EastConstChecker Checker;
+  // What --verify compares the fixed files against.
+  EastConstDeclTypeRecorder Recorder;
+  MatchFinder Finder;
+  std::unique_ptr<FrontendActionFactory> Factory;
 };
 
+// The sites the workers' checkers counted, by file. Configurations of one
+// file may parse on different workers, so each (file, offset) is kept once.
+std::map<std::string, EastConstSiteKinds>
+mergeCountedSites(const std::vector<std::unique_ptr<AstWorker>> &Workers) {
+  std::map<std::string, EastConstSiteKinds> Sites;
+  for (const std::unique_ptr<AstWorker> &Worker : Workers)
+    for (const auto &FileAndSites : Worker->Checker.getCountedSites())
+      Sites[FileAndSites.first].insert(FileAndSites.second.begin(),
+                                       FileAndSites.second.end());
+  return Sites;
+}
+
+// Adds the sites each worker's checker counted to Totals, by file, and
+// clears the checkers' counts. A site parsed in several configurations, on
+// one worker or several, counts once.
+void collectSiteTotals(const std::vector<std::unique_ptr<AstWorker>> &Workers,
+                       std::map<std::string, unsigned> &Totals) {
+  for (const auto &FileAndSites : mergeCountedSites(Workers))
+    Totals[FileAndSites.first] += FileAndSites.second.size();
+  for (const std::unique_ptr<AstWorker> &Worker : Workers)
+    Worker->Checker.clearSiteCounts();
+}
+
+// With a report, a worker process's output is "<payload bytes>\n<payload>"
+// followed by the NDJSON records of the sites it found.
+std::string appendSiteRecords(llvm::StringRef Payload,
+                              llvm::StringRef Records) {
+  return std::to_string(Payload.size()) + "\n" + Payload.str() + Records.str();
+}
+
+bool splitSiteRecords(llvm::StringRef Output, llvm::StringRef &Payload,
+                      llvm::StringRef &Records) {
+  auto [Size, Rest] = Output.split('\n');
+  std::size_t Bytes;
+  if (Size.getAsInteger(10, Bytes) || Rest.size() < Bytes)
+    return false;
+  Payload = Rest.take_front(Bytes);
+  Records = Rest.drop_front(Bytes);
+  return true;
+}
+
+// Worker processes send their replacements to the parent in the YAML format
+// clang-apply-replacements reads.
+std::string encodeReplacements(llvm::StringRef MainSourceFile,
+                               const std::map<std::string, Replacements> &Map) {
+  TranslationUnitReplacements TUR;
+  TUR.MainSourceFile = MainSourceFile.str();
+  for (const auto &FileAndReplacements : Map)
+    TUR.Replacements.insert(TUR.Replacements.end(),
+                            FileAndReplacements.second.begin(),
+                            FileAndReplacements.second.end());
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  llvm::yaml::Output YAML(OS);
+  YAML << TUR;
+  return OS.str();
+}
+
+bool decodeReplacements(llvm::StringRef Text,
+                        TranslationUnitReplacements &TUR) {
+  llvm::yaml::Input YAML(Text);
+  YAML >> TUR;
+  return !YAML.error();
+}
+
+std::string normalizedPath(llvm::StringRef Path) {
+  llvm::SmallString<256> Absolute(Path);
+  llvm::sys::fs::make_absolute(Absolute);
+  llvm::sys::path::remove_dots(Absolute, /*remove_dot_dot=*/true);
+  return Absolute.str().str();
+}
+
+// Accepts a number of seconds with an optional s, m or h suffix.
+bool parseDuration(llvm::StringRef Spec, std::chrono::seconds &Duration) {
+  Spec = Spec.trim();
+  unsigned Scale = 1;
+  if (Spec.consume_back("h"))
+    Scale = 3600;
+  else if (Spec.consume_back("m"))
+    Scale = 60;
+  else
+    Spec.consume_back("s");
+  unsigned Count;
+  if (Spec.getAsInteger(10, Count))
+    return false;
+  Duration = std::chrono::seconds(std::uint64_t(Count) * Scale);
+  return true;
+}
+
+bool parseSamplePercent(llvm::StringRef Spec, unsigned &Percent) {
+  Spec = Spec.trim();
+  Spec.consume_back("%");
+  return !Spec.getAsInteger(10, Percent) && Percent <= 100;
+}
+
+// Collects the qualifier removal offsets the semantic checker produces; those
+// are the positions the lexer engine reports as QualifierOffset.
+class RemovalOffsetCollector {
+public:
+  explicit RemovalOffsetCollector(
+      std::map<std::string, std::vector<unsigned>> &Offsets)
+      : Offsets(Offsets) {}
+
+  void operator()(const SourceManager &SM, CharSourceRange Range,
+                  llvm::StringRef NewText) const {
+    if (!NewText.empty())
+      return;
+    Replacement Rep(SM, Range, NewText);
+    if (Rep.getFilePath().empty())
+      return;
+    Offsets[normalizedPath(Rep.getFilePath())].push_back(Rep.getOffset());
+  }
+
+private:
+  std::map<std::string, std::vector<unsigned>> &Offsets;
+};
+
+struct LexerFileResult {
+  std::string Path;
+  std::vector<LexerEngineSite> Sites;
+  std::size_t Bytes = 0;
+  bool ReadFailed = false;
+};
+
+// Picks a deterministic Percent% subset of the files: ordering by a hash of
+// the path keeps the sample stable across runs without favouring any
+// directory.
+std::vector<std::size_t> pickSample(const std::vector<LexerFileResult> &Files,
+                                    unsigned Percent) {
+  std::vector<std::size_t> Order;
+  for (std::size_t I = 0; I < Files.size(); ++I)
+    if (!Files[I].ReadFailed)
+      Order.push_back(I);
+  std::sort(Order.begin(), Order.end(), [&](std::size_t A, std::size_t B) {
+    return llvm::xxh3_64bits(Files[A].Path) < llvm::xxh3_64bits(Files[B].Path);
+  });
+  std::size_t Count = (Order.size() * Percent + 99) / 100;
+  Order.resize(std::min(Count, Order.size()));
+  return Order;
+}
+
+bool writeFile(llvm::StringRef FilePath, llvm::StringRef Content) {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(FilePath, EC, llvm::sys::fs::OF_None);
+  if (EC) {
+    EAST_CONST_LOG(Error, "Error opening file for writing "
+                              << FilePath << ": " << EC.message());
+    return false;
+  }
+  OS << Content;
+  OS.close();
+  if (OS.has_error()) {
+    EAST_CONST_LOG(Error, "Error writing to " << FilePath);
+    return false;
+  }
+  return true;
+}
+
+int runLexerEngine(const CompilationDatabase &Compilations,
+                   const std::vector<std::string> &SourcePaths,
+                   const EastConstCheckerOptions &CheckerOptions,
+                   unsigned SamplePercent) {
+  const clang::LangOptions LangOpts = getLexerEngineLangOptions();
+  std::vector<LexerFileResult> Results(SourcePaths.size());
+
+  auto Start = std::chrono::steady_clock::now();
+  {
+    llvm::DefaultThreadPool Pool(llvm::hardware_concurrency(JobsOption));
+    for (std::size_t I = 0; I < SourcePaths.size(); ++I) {
+      Pool.async([&, I] {
+        LexerFileResult &Result = Results[I];
+        Result.Path = normalizedPath(SourcePaths[I]);
+        auto FileOrError = llvm::MemoryBuffer::getFile(Result.Path);
+        if (std::error_code EC = FileOrError.getError()) {
+          EAST_CONST_LOG(Error, "Error reading file " << Result.Path << ": "
+                                                       << EC.message());
+          Result.ReadFailed = true;
+          return;
+        }
+        // Only the sites are kept; -fix reads the files it changes again.
+        llvm::StringRef Content = FileOrError.get()->getBuffer();
+        Result.Bytes = Content.size();
+        Result.Sites = scanWestConstSites(Result.Path, Content, LangOpts,
+                                          CheckerOptions);
+      });
+    }
+    Pool.wait();
+  }
+  double Seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - Start)
+          .count();
+
+  std::size_t TotalBytes = 0;
+  std::size_t TotalSites = 0;
+  std::size_t AmbiguousSites = 0;
+  int Status = 0;
+  for (const LexerFileResult &Result : Results) {
+    if (Result.ReadFailed) {
+      Status = 1;
+      continue;
+    }
+    TotalBytes += Result.Bytes;
+    for (const LexerEngineSite &Site : Result.Sites) {
+      ++TotalSites;
+      llvm::outs() << Result.Path << ":" << Site.Line << ":" << Site.Column
+                   << ": west " << llvm::StringRef(Site.Suffix).ltrim()
+                   << " on " << getEastConstDeclKindName(Site.Kind);
+      if (Site.NeedsSemanticCheck) {
+        ++AmbiguousSites;
+        llvm::outs() << " [needs semantic check: " << Site.AmbiguityReason
+                     << "]";
+      }
+      llvm::outs() << "\n";
+    }
+  }
+  double Megabytes = TotalBytes / (1024.0 * 1024.0);
+  EAST_CONST_LOG(Info, "Lexer engine scanned "
+                           << Results.size() << " files ("
+                           << llvm::format("%.1f", Megabytes) << " MB) in "
+                           << llvm::format("%.3f", Seconds) << "s, "
+                           << llvm::format("%.1f", Seconds > 0
+                                                       ? Megabytes / Seconds
+                                                       : 0.0)
+                           << " MB/s; " << TotalSites << " sites, "
+                           << AmbiguousSites << " need a semantic check");
+
+  if (SamplePercent > 0) {
+    std::vector<std::size_t> Sample = pickSample(Results, SamplePercent);
+    std::vector<std::string> SamplePaths;
+    for (std::size_t Index : Sample)
+      SamplePaths.push_back(Results[Index].Path);
+
+    std::map<std::string, std::vector<unsigned>> CheckerOffsets;
+    RemovalOffsetCollector Collector(CheckerOffsets);
+    EastConstCheckerOptions SampleOptions = CheckerOptions;
+    SampleOptions.Quiet = true;
+    EastConstChecker Checker(Collector, SampleOptions);
+    MatchFinder Finder;
+    registerEastConstMatchers(Finder, &Checker);
+    ClangTool Tool(Compilations, SamplePaths);
+    if (Tool.run(newFrontendActionFactory(&Finder).get()) != 0)
+      EAST_CONST_LOG(Warning, "AST engine reported errors on the sample; "
+                              "agreement may be understated");
+
+    LexerEngineAgreement Total;
+    for (std::size_t Index : Sample) {
+      const LexerFileResult &Result = Results[Index];
+      LexerEngineAgreement FileAgreement =
+          compareLexerEngineSites(Result.Sites, CheckerOffsets[Result.Path]);
+      if (FileAgreement.FalsePositives != 0 || FileAgreement.Missed != 0)
+        EAST_CONST_LOG(Debug, "Engines disagree on "
+                                  << Result.Path << ": "
+                                  << FileAgreement.FalsePositives
+                                  << " false positives, "
+                                  << FileAgreement.Missed << " missed");
+      Total += FileAgreement;
+    }
+    llvm::outs() << "Confirmed " << Sample.size() << " of " << Results.size()
+                 << " files with the AST engine: "
+                 << llvm::format("%.1f", Total.agreementRatio() * 100.0)
+                 << "% agreement (" << Total.Confirmed << " confirmed, "
+                 << Total.FalsePositives << " false positives, "
+                 << Total.Missed << " missed, " << Total.AmbiguousConfirmed
+                 << "/" << Total.AmbiguousConfirmed + Total.AmbiguousRejected
+                 << " ambiguous confirmed)\n";
+  }
+
+  if (FixErrors) {
+    for (const LexerFileResult &Result : Results) {
+      if (Result.ReadFailed)
+        continue;
+      Replacements Replaces =
+          buildLexerEngineReplacements(Result.Path, Result.Sites);
+      if (Replaces.empty())
+        continue;
+      auto FileOrError = llvm::MemoryBuffer::getFile(Result.Path);
+      if (std::error_code EC = FileOrError.getError()) {
+        EAST_CONST_LOG(Error, "Error reading file " << Result.Path << ": "
+                                                     << EC.message());
+        Status = 1;
+        continue;
+      }
+      llvm::Expected<std::string> NewContent =
+          applyAllReplacements(FileOrError.get()->getBuffer(), Replaces);
+      if (!NewContent) {
+        EAST_CONST_LOG(Error, "Error applying replacements to "
+                                  << Result.Path << ": "
+                                  << llvm::toString(NewContent.takeError()));
+        Status = 1;
+        continue;
+      }
+      if (!writeFile(Result.Path, *NewContent))
+        Status = 1;
+      else
+        EAST_CONST_LOG(Info, "Successfully modified: " << Result.Path);
+    }
+  }
+
+  return Status;
+}
+
+void printEstimate(llvm::StringRef Label, const EastConstEstimate &Estimate) {
+  llvm::outs() << "  "
+               << llvm::format("%-24s %10.0f +/- %-8.0f",
+                               Label.str().c_str(), Estimate.Total,
+                               Estimate.HalfWidth)
+               << (Estimate.Bounded ? "" : " *");
+}
+
+// Parses a stratified sample of Population with counting checkers (no fix
+// is ever built) and extrapolates the sites of every file, by declaration
+// kind and by top-level directory.
+int runSampleEstimate(const CompilationDatabase &Compilations,
+                      const std::vector<std::string> &Population,
+                      const EastConstSampleSize &Size, std::uint64_t Seed,
+                      const EastConstCheckerOptions &CheckerOptions,
+                      const EastConstFrontendOptions &FrontendOptions,
+                      EastConstAstEngineOptions EngineOptions) {
+  std::vector<std::string> Files;
+  llvm::StringSet<> Seen;
+  for (const std::string &Source : Population) {
+    std::string File = normalizedPath(Source);
+    if (Seen.insert(File).second)
+      Files.push_back(File);
+  }
+  std::string Root = getEastConstCommonDirectory(Files);
+  std::vector<std::string> Strata;
+  for (const std::string &File : Files)
+    Strata.push_back(getEastConstSampleStratum(File, Root));
+  std::vector<std::size_t> Sample = pickEastConstStratifiedSample(
+      Files, Strata, Size.resolve(Files.size()), Seed);
+  std::vector<std::string> SampleFiles;
+  for (std::size_t Index : Sample)
+    SampleFiles.push_back(Files[Index]);
+
+  EastConstCheckerOptions CountingOptions = CheckerOptions;
+  CountingOptions.Quiet = true;
+  CountingOptions.CountSites = true;
+  std::vector<std::unique_ptr<AstWorker>> Workers;
+  auto WorkerFactory = [&](unsigned Worker) -> FrontendActionFactory & {
+    while (Workers.size() <= Worker)
+      Workers.push_back(std::make_unique<AstWorker>(nullptr, CountingOptions,
+                                                    FrontendOptions));
+    return *Workers[Worker]->Factory;
+  };
+  // The checkers key their counts by the compile command's file, which the
+  // engine reports next to the source it was given.
+  std::mutex Lock;
+  llvm::StringMap<std::pair<std::string, bool>> Parsed;
+  EngineOptions.OnFileDone = [&](unsigned, llvm::StringRef Source,
+                                 llvm::StringRef File, bool Success) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Parsed[Source] = {File.str(), Success};
+  };
+  EastConstAstEngineStats EngineStats;
+  int Status = runEastConstAstEngine(Compilations, SampleFiles, EngineOptions,
+                                     WorkerFactory, EngineStats);
+
+  // Each site once, however many configurations of its file were parsed.
+  std::map<std::string, EastConstSiteCounts> Counts;
+  for (const auto &FileAndSites : mergeCountedSites(Workers))
+    Counts[FileAndSites.first] = countEastConstSites(FileAndSites.second);
+
+  std::map<std::string, EastConstStratumSample> ByStratum;
+  for (const std::string &Stratum : Strata) {
+    EastConstStratumSample &Entry = ByStratum[Stratum];
+    Entry.Name = Stratum;
+    ++Entry.Population;
+  }
+  unsigned Failed = 0;
+  for (std::size_t Index : Sample) {
+    auto It = Parsed.find(Files[Index]);
+    if (It == Parsed.end() || !It->second.second) {
+      ++Failed;
+      continue;
+    }
+    auto CountsIt = Counts.find(It->second.first);
+    ByStratum[Strata[Index]].Observations.push_back(
+        CountsIt == Counts.end() ? EastConstSiteCounts{} : CountsIt->second);
+  }
+  std::vector<EastConstStratumSample> AllStrata;
+  for (auto &NameAndStratum : ByStratum)
+    AllStrata.push_back(NameAndStratum.second);
+
+  auto Total = [](const EastConstSiteCounts &Sites) {
+    return static_cast<double>(
+        std::accumulate(Sites.begin(), Sites.end(), 0u));
+  };
+  llvm::outs() << "Sampled " << Sample.size() << " of " << Files.size()
+               << " files ("
+               << llvm::format("%.1f", Files.empty()
+                                           ? 0.0
+                                           : 100.0 * Sample.size() /
+                                                 Files.size())
+               << "%) in " << AllStrata.size() << " directories under "
+               << Root << ", seed " << Seed << "; " << Failed
+               << " failed to parse\n";
+  llvm::outs() << "Estimated west-const sites (95% confidence):\n";
+  printEstimate("total", estimateEastConstTotal(AllStrata, Total));
+  llvm::outs() << "\n\nBy declaration kind:\n";
+  for (unsigned Kind = 0;
+       Kind < static_cast<unsigned>(EastConstDeclKind::Count); ++Kind) {
+    if (!CheckerOptions.isEnabled(static_cast<EastConstDeclKind>(Kind)))
+      continue;
+    printEstimate(
+        getEastConstDeclKindName(static_cast<EastConstDeclKind>(Kind)),
+        estimateEastConstTotal(AllStrata,
+                               [Kind](const EastConstSiteCounts &Sites) {
+                                 return static_cast<double>(Sites[Kind]);
+                               }));
+    llvm::outs() << "\n";
+  }
+  llvm::outs() << "\nBy directory:\n";
+  for (const EastConstStratumSample &Stratum : AllStrata) {
+    printEstimate(Stratum.Name, estimateEastConstTotal(Stratum, Total));
+    llvm::outs() << " (" << Stratum.Observations.size() << " of "
+                 << Stratum.Population << " files)\n";
+  }
+  llvm::outs() << "* fewer than two sampled files parsed in a directory; "
+                  "its spread is not in the interval\n";
+  EAST_CONST_LOG(Info, "Parsed " << EngineStats.TranslationUnits
+                                 << " sampled files on "
+                                 << EngineStats.Workers << " workers in "
+                                 << llvm::format("%.2f", EngineStats.Seconds)
+                                 << "s");
+  return Status;
+}
+
+bool isStdinArg(llvm::StringRef Arg) {
+  Arg.consume_front("-");
+  Arg.consume_front("-");
+  return Arg == "stdin" || Arg.starts_with("stdin=");
+}
+
+bool isLspArg(llvm::StringRef Arg) { return Arg == "-lsp" || Arg == "--lsp"; }
+
+bool isWatchArg(llvm::StringRef Arg) {
+  return Arg == "-watch" || Arg == "--watch";
+}
+
+// --sample and --watch with no sources take every file in the compilation
+// database; --stdin reads its one source from standard input and --lsp its
+// documents from the editor.
+cl::NumOccurrencesFlag sourceOccurrences(int argc, const char **argv) {
+  for (int I = 1; I < argc; ++I) {
+    if (std::strcmp(argv[I], "--") == 0)
+      break;
+    llvm::StringRef Arg(argv[I]);
+    if (Arg.starts_with("-sample=") || Arg.starts_with("--sample=") ||
+        isStdinArg(Arg) || isLspArg(Arg) || isWatchArg(Arg))
+      return cl::ZeroOrMore;
+  }
+  return cl::OneOrMore;
+}
+
+// The lexer engine, --stdin and --lsp need no compilation database; append
+// "--" so CommonOptionsParser falls back to an empty fixed database instead
+// of failing when none is found. A database named with -p is used as is:
+// the lexer engine's --confirm-sample and --stdin compile with it. Naming
+// one with -p and also passing "--" is rejected, since the fixed database
+// would silently win. Returns false after reporting that.
+bool withImplicitCompileCommands(int argc, const char **argv,
+                                 std::vector<const char *> &Args) {
+  Args.assign(argv, argv + argc);
+  bool NoDatabase = false;
+  bool BuildPath = false;
+  bool Separator = false;
+  for (int I = 1; I < argc && !Separator; ++I) {
+    if (std::strcmp(argv[I], "--") == 0) {
+      Separator = true;
+      continue;
+    }
+    llvm::StringRef Arg(argv[I]);
+    if (Arg == "-engine=lexer" || Arg == "--engine=lexer" || isStdinArg(Arg))
+      NoDatabase = true;
+    NoDatabase |= isLspArg(Arg);
+    BuildPath |= Arg == "-p" || Arg.starts_with("-p=") || Arg == "--p" ||
+                 Arg.starts_with("--p=");
+  }
+  if (NoDatabase && BuildPath && Separator) {
+    llvm::errs() << "-p cannot be combined with \"--\" for --engine=lexer, "
+                    "--stdin or --lsp; pass one of them\n";
+    return false;
+  }
+  if (NoDatabase && !BuildPath && !Separator)
+    Args.push_back("--");
+  return true;
+}
+
 } // namespace
 
 
 int main(int argc, const char **argv) {
-    auto ExpectedParser = CommonOptionsParser::create(argc, argv, EastConstCategory);
+    std::vector<const char *> Args;
+    if (!withImplicitCompileCommands(argc, argv, Args))
+      return 1;
+    int ArgCount = static_cast<int>(Args.size());
+    auto ExpectedParser =
+        CommonOptionsParser::create(ArgCount, Args.data(), EastConstCategory,
+                                    sourceOccurrences(argc, argv));
     if (!ExpectedParser) {
       llvm::errs() << ExpectedParser.takeError();
       return 1;
     }
     CommonOptionsParser& OptionsParser = ExpectedParser.get();
     
-    // Create the tool with the proper options
-    RefactoringTool Tool(OptionsParser.getCompilations(),
-                        OptionsParser.getSourcePathList());
-    
-    setQuietMode(QuietFlag);
+    // Serialized ASTs (given directly, or found next to object files with
+    // --ast-from-build) skip parsing; everything else goes through the tool.
+    std::vector<EastConstAstInput> AstInputs;
+    std::vector<std::string> ParseSources;
+    for (const std::string &Source : OptionsParser.getSourcePathList()) {
+      if (isEastConstAstFile(Source)) {
+        AstInputs.push_back({Source, std::string()});
+        continue;
+      }
+      if (AstFromBuild) {
+        std::string Ast =
+            findBuildAstFor(OptionsParser.getCompilations(), Source);
+        if (!Ast.empty()) {
+          AstInputs.push_back({Ast, Source});
+          continue;
+        }
+      }
+      ParseSources.push_back(Source);
+    }
+
+    setEastConstLogLevel(QuietFlag ? EastConstLogLevel::Error
+                                   : EastConstLogLevel::Info);
+    if (!LogLevelOption.empty()) {
+      EastConstLogLevel Level;
+      if (!parseEastConstLogLevel(LogLevelOption, Level)) {
+        llvm::errs() << "Unknown log level '" << LogLevelOption << "'\n";
+        return 1;
+      }
+      setEastConstLogLevel(Level);
+    }
 
     if (FixErrors) {
-      llvm::errs() << "Fix mode enabled\n";
+      EAST_CONST_LOG(Info, "Fix mode enabled");
     }
     
-    RefactoringReplacementHandler Handler(Tool);
-    EastConstChecker Checker(Handler);
-    MatchFinder Finder;
-    registerEastConstMatchers(Finder, &Checker);
-  
-    // Create custom factory
-    auto Factory = newFrontendActionFactory(&Finder);
+    EastConstCheckerOptions CheckerOptions;
+    CheckerOptions.Quiet = QuietFlag;
+    CheckerOptions.LookbehindBytes = LookbehindBytes;
+    CheckerOptions.FallbackWindowBytes = FallbackWindowBytes;
+    if (!parseEastConstDeclKinds(DeclKindsOption,
+                                 CheckerOptions.EnabledDeclKinds)) {
+      llvm::errs() << "Unknown declaration kind in '" << DeclKindsOption
+                   << "'\n";
+      return 1;
+    }
+
+    if (EngineOption != "ast" && EngineOption != "lexer") {
+      llvm::errs() << "Unknown engine '" << EngineOption << "'\n";
+      return 1;
+    }
+    if (WorkersOption != "thread" && WorkersOption != "process") {
+      llvm::errs() << "Unknown worker kind '" << WorkersOption << "'\n";
+      return 1;
+    }
+    if (WorkersOption == "process" && !isEastConstProcessPoolSupported()) {
+      llvm::errs() << "--workers=process is not supported on this platform\n";
+      return 1;
+    }
+    if (ResumeOption && CheckpointOption.empty()) {
+      llvm::errs() << "--resume needs --checkpoint=<file>\n";
+      return 1;
+    }
+    std::optional<std::chrono::steady_clock::time_point> Deadline;
+    if (!TimeBudgetOption.empty()) {
+      std::chrono::seconds Budget;
+      if (!parseDuration(TimeBudgetOption, Budget)) {
+        llvm::errs() << "Invalid --time-budget '" << TimeBudgetOption
+                     << "'; expected a duration such as 90m, 2h or 3600s\n";
+        return 1;
+      }
+      Deadline = std::chrono::steady_clock::now() + Budget;
+    }
+    unsigned SamplePercent = 0;
+    if (!ConfirmSampleOption.empty() &&
+        !parseSamplePercent(ConfirmSampleOption, SamplePercent)) {
+      llvm::errs() << "Invalid --confirm-sample '" << ConfirmSampleOption
+                   << "'; expected a percentage such as 5%\n";
+      return 1;
+    }
+
+    EastConstSampleSize SampleSize;
+    bool Sampling = !SampleOption.empty();
+    if (Sampling && !parseEastConstSampleSize(SampleOption, SampleSize)) {
+      llvm::errs() << "Invalid --sample '" << SampleOption
+                   << "'; expected a fraction such as 0.05 or 5%, or a file "
+                      "count\n";
+      return 1;
+    }
+    if (Sampling && (EngineOption == "lexer" || FixErrors)) {
+      llvm::errs() << "--sample only estimates, with the AST engine; it "
+                      "cannot be combined with --engine=lexer or -fix\n";
+      return 1;
+    }
+    bool FailFast = FailFastOption.getNumOccurrences() > 0;
+    bool FailFastRun = FailFast && FailFastOption == "run";
+    if (FailFast && !FailFastRun && !FailFastOption.empty() &&
+        FailFastOption != "file") {
+      llvm::errs() << "Invalid --fail-fast '" << FailFastOption
+                   << "'; expected 'file' or 'run'\n";
+      return 1;
+    }
+    // Check mode finds sites without building their fixes; each file's
+    // count comes from the checkers (or the worker processes) afterwards.
+    bool CheckMode = CheckOption || FailFast;
+    if (CheckMode && (FixErrors || Sampling || EngineOption == "lexer" ||
+                      !CheckpointOption.empty())) {
+      llvm::errs() << "--check and --fail-fast cannot be combined with -fix, "
+                      "--sample, --engine=lexer or --checkpoint\n";
+      return 1;
+    }
+    if (DiffOption && (FixErrors || CheckMode || Sampling ||
+                       EngineOption == "lexer")) {
+      llvm::errs() << "--diff cannot be combined with -fix, --check, "
+                      "--sample or --engine=lexer\n";
+      return 1;
+    }
+    if (FormatFixedRangesOption && !FixErrors && !DiffOption) {
+      llvm::errs() << "--format-fixed-ranges needs -fix or --diff\n";
+      return 1;
+    }
+    if (VerifyOption && (CheckMode || Sampling || EngineOption == "lexer")) {
+      llvm::errs() << "--verify cannot be combined with --check, --sample or "
+                      "--engine=lexer\n";
+      return 1;
+    }
+    EastConstReportFormat ReportFormat;
+    if (!parseEastConstReportFormat(FormatOption, ReportFormat)) {
+      llvm::errs() << "Unknown format '" << FormatOption
+                   << "'; expected text, ndjson or sarif\n";
+      return 1;
+    }
+    bool Reporting = ReportFormat != EastConstReportFormat::Text;
+    if (Reporting && (DiffOption || Sampling || EngineOption == "lexer")) {
+      llvm::errs() << "--format=" << FormatOption
+                   << " cannot be combined with --diff, --sample or "
+                      "--engine=lexer\n";
+      return 1;
+    }
+    bool StdinMode = StdinOption.getNumOccurrences() > 0;
+    if (StdinMode && !StdinOption.empty() && StdinOption != "framed") {
+      llvm::errs() << "Invalid --stdin '" << StdinOption
+                   << "'; expected no value or 'framed'\n";
+      return 1;
+    }
+    if (StdinMode &&
+        (!OptionsParser.getSourcePathList().empty() || FixErrors ||
+         DiffOption || CheckMode || Sampling || VerifyOption || Reporting ||
+         FormatFixedRangesOption || EngineOption == "lexer")) {
+      llvm::errs() << "--stdin takes no source files and cannot be combined "
+                      "with -fix, --diff, --check, --sample, --verify, "
+                      "--format, --format-fixed-ranges or --engine=lexer\n";
+      return 1;
+    }
+    if (LspOption &&
+        (!OptionsParser.getSourcePathList().empty() || StdinMode ||
+         FixErrors || DiffOption || CheckMode || Sampling || VerifyOption ||
+         Reporting || FormatFixedRangesOption || EngineOption == "lexer")) {
+      llvm::errs() << "--lsp takes no source files and cannot be combined "
+                      "with --stdin, -fix, --diff, --check, --sample, "
+                      "--verify, --format, --format-fixed-ranges or "
+                      "--engine=lexer\n";
+      return 1;
+    }
+    if (WatchOption &&
+        (!AstInputs.empty() || StdinMode || LspOption || DiffOption ||
+         CheckMode || Sampling || VerifyOption || Reporting ||
+         FormatFixedRangesOption || EngineOption == "lexer" ||
+         !CheckpointOption.empty() || FastFrontend || SkipMainFileBodies)) {
+      llvm::errs() << "--watch takes no serialized ASTs and cannot be "
+                      "combined with --stdin, --lsp, --diff, --check, "
+                      "--sample, --verify, --format, --format-fixed-ranges, "
+                      "--engine=lexer, --checkpoint, --fast-frontend or "
+                      "--skip-main-file-bodies\n";
+      return 1;
+    }
+    // A PCH batch parses its groups one after another on this thread and
+    // reports no per-file completion to checkpoint or stop at.
+    if (PchBatch &&
+        (!CheckpointOption.empty() || FailFastRun || Deadline ||
+         (JobsOption.getNumOccurrences() > 0 && JobsOption != 1) ||
+         WorkersOption == "process")) {
+      llvm::errs() << "--pch-batch cannot be combined with --checkpoint, "
+                      "--fail-fast=run, --time-budget, -j or "
+                      "--workers=process\n";
+      return 1;
+    }
+    CheckerOptions.CheckOnly = CheckMode;
+    CheckerOptions.CountSites = CheckMode;
+    CheckerOptions.FailFast = FailFast;
+    std::atomic<bool> StopRun{false};
+    std::map<std::string, unsigned> SiteTotals;
+
+    if (LspOption) {
+      // Standard output carries the protocol; nothing else may go there.
+      llvm::sys::ChangeStdinToBinary();
+      llvm::sys::ChangeStdoutToBinary();
+      int Status = runEastConstLspServer(stdin, llvm::outs(),
+                                         OptionsParser.getCompilations(),
+                                         CheckerOptions);
+      flushEastConstLog();
+      return Status;
+    }
+
+    if (EngineOption == "lexer") {
+      int Status = runLexerEngine(OptionsParser.getCompilations(),
+                                  OptionsParser.getSourcePathList(),
+                                  CheckerOptions, SamplePercent);
+      flushEastConstLog();
+      return Status;
+    }
+
+    std::map<std::string, Replacements> ReplacementsMap;
+    RefactoringReplacementHandler Handler(ReplacementsMap);
+    EastConstFrontendOptions FrontendOptions;
+    FrontendOptions.Fast = FastFrontend;
+    FrontendOptions.SkipMainFileBodies = SkipMainFileBodies;
+    if (StdinMode) {
+      // Standard output carries the source; nothing else may go there.
+      llvm::sys::ChangeStdinToBinary();
+      llvm::sys::ChangeStdoutToBinary();
+      int Status = runEastConstFilter(
+          stdin, llvm::outs(), OptionsParser.getCompilations(),
+          AssumeFileNameOption, StdinOption == "framed", CheckerOptions,
+          FrontendOptions);
+      flushEastConstLog();
+      return Status;
+    }
+    if (WatchOption) {
+      std::vector<std::string> Sources = ParseSources;
+      if (Sources.empty())
+        Sources = OptionsParser.getCompilations().getAllFiles();
+      EastConstWatchOptions WatchOptions;
+      WatchOptions.Jobs = JobsOption;
+      WatchOptions.Fix = FixErrors;
+      int Status = runEastConstWatch(OptionsParser.getCompilations(), Sources,
+                                     CheckerOptions, FrontendOptions,
+                                     WatchOptions, llvm::outs());
+      flushEastConstLog();
+      return Status;
+    }
+    if (Sampling) {
+      std::vector<std::string> Population;
+      for (const std::string &Source : OptionsParser.getSourcePathList())
+        if (!isEastConstAstFile(Source))
+          Population.push_back(Source);
+      if (Population.empty())
+        Population = OptionsParser.getCompilations().getAllFiles();
+      EastConstFileSystemCache FsCache;
+      EastConstAstEngineOptions EngineOptions;
+      EngineOptions.Jobs = JobsOption;
+      EngineOptions.FileSystemCache = FsCacheOption ? &FsCache : nullptr;
+      EngineOptions.PoolInvocations = PoolInvocationsOption;
+      EngineOptions.DeduplicateConfigurations = DedupConfigsOption;
+      int Status = runSampleEstimate(OptionsParser.getCompilations(),
+                                     Population, SampleSize, SampleSeedOption,
+                                     CheckerOptions, FrontendOptions,
+                                     EngineOptions);
+      flushEastConstLog();
+      return Status;
+    }
+    // Sites go out as they are found. Worker processes hold theirs until
+    // the file is done and hand them to the parent with its result; only
+    // fixes that are applied or checkpointed are also collected.
+    std::optional<EastConstReportWriter> Report;
+    std::string PendingSites;
+    bool HoldSites = false;
+    EastConstSiteHandler OnSite;
+    if (Reporting) {
+      Report.emplace(llvm::outs(), ReportFormat);
+      OnSite = [&](const EastConstSite &Site) {
+        if (!HoldSites) {
+          Report->add(Site);
+          return;
+        }
+        PendingSites += formatEastConstSiteRecord(Site);
+        PendingSites += '\n';
+      };
+    }
+    bool CollectFixes = !Reporting || FixErrors || VerifyOption ||
+                        !CheckpointOption.empty();
+    // Worker threads record the declarations of each file they parse, so
+    // its fixes are verified against that AST as soon as it is done.
+    bool RecordDeclTypes = VerifyOption && WorkersOption == "thread";
+    std::vector<std::unique_ptr<AstWorker>> Workers;
+    auto WorkerFactory = [&](unsigned Worker) -> FrontendActionFactory & {
+      while (Workers.size() <= Worker)
+        Workers.push_back(std::make_unique<AstWorker>(
+            CollectFixes ? ReplacementHandler(std::ref(Handler)) : nullptr,
+            CheckerOptions, FrontendOptions, OnSite, RecordDeclTypes));
+      return *Workers[Worker]->Factory;
+    };
     
-    int Result = Tool.run(Factory.get());
+    // Files an earlier run finished are skipped; their fixes are applied
+    // with this run's unless that run applied them already.
+    EastConstCheckpoint Checkpoint;
+    bool UseCheckpoint = !CheckpointOption.empty();
+    bool ResumedFailures = false;
+    if (UseCheckpoint) {
+      if (!Checkpoint.open(CheckpointOption, ResumeOption)) {
+        flushEastConstLog();
+        return 1;
+      }
+      for (const EastConstCheckpointEntry &Entry : Checkpoint.resumed()) {
+        ResumedFailures |= !Entry.Success;
+        if (!Entry.Applied)
+          for (const Replacement &Rep : Entry.Replacements)
+            Handler.add(Rep);
+      }
+      std::vector<std::string> Remaining;
+      for (const std::string &Source : ParseSources)
+        if (!Checkpoint.isDone(normalizedPath(Source)))
+          Remaining.push_back(Source);
+      if (ResumeOption)
+        EAST_CONST_LOG(Info, "Resuming from "
+                                 << CheckpointOption << ": "
+                                 << ParseSources.size() - Remaining.size()
+                                 << " files already done, "
+                                 << Remaining.size() << " left ("
+                                 << Checkpoint.staleFiles()
+                                 << " changed since they were recorded)"
+                                 << (Checkpoint.droppedBytes()
+                                         ? "; dropped a torn last record"
+                                         : ""));
+      ParseSources = std::move(Remaining);
+    }
+
+    // Files are printed in path order as they finish; paths are relative to
+    // the current directory, as git apply expects when run from there.
+    std::optional<EastConstRangeFormatter> Formatter;
+    if (FormatFixedRangesOption)
+      Formatter.emplace();
+    // The fixes as written out: with the touched lines reformatted when
+    // asked to, or as they are if that fails.
+    auto finalFixes = [&](llvm::StringRef File,
+                          std::vector<Replacement> Fixes) {
+      if (!Formatter || Fixes.empty())
+        return Fixes;
+      llvm::Expected<std::vector<Replacement>> Formatted =
+          Formatter->formatFile(File, Fixes);
+      if (!Formatted) {
+        std::string Message = llvm::toString(Formatted.takeError());
+        EAST_CONST_LOG(Warning, "Cannot format the fixed lines of "
+                                    << File << ": " << Message);
+        return Fixes;
+      }
+      return std::move(*Formatted);
+    };
+
+    std::optional<EastConstDiffWriter> Diff;
+    if (DiffOption) {
+      std::vector<std::string> Order = ParseSources;
+      llvm::sort(Order);
+      llvm::SmallString<256> Cwd;
+      llvm::sys::fs::current_path(Cwd);
+      Diff.emplace(llvm::outs(), std::move(Order), Cwd);
+    }
+
+    std::optional<EastConstVerifier> Verifier;
+    if (VerifyOption)
+      Verifier.emplace(OptionsParser.getCompilations(), CheckerOptions,
+                       FrontendOptions, JobsOption);
+
+    EastConstTimingHistory History;
+    bool UseHistory = !PchBatch && !TimingHistoryOption.empty();
+    if (UseHistory && !History.load(TimingHistoryOption))
+      EAST_CONST_LOG(Warning, "Cannot read timing history "
+                                  << TimingHistoryOption
+                                  << "; estimating every file");
+
+    std::optional<EastConstMemoryGovernorOptions> Memory;
+    if (MemoryGovernorOption) {
+      Memory.emplace();
+      Memory->ReserveBytes = static_cast<std::uint64_t>(MemoryReserveOption)
+                             << 20;
+      Memory->DefaultUnitBytes = static_cast<std::uint64_t>(FileMemoryOption)
+                                 << 20;
+    }
+
+    int Result = 0;
+    unsigned Unstarted = 0;
+    if (PchBatch) {
+      EastConstPchStats Stats;
+      Result = runEastConstPchBatch(OptionsParser.getCompilations(),
+                                    ParseSources,
+                                    PchCacheDir, WorkerFactory(0), Stats);
+      EAST_CONST_LOG(Info, "PCH batch: " << Stats.GroupedUnits << " of "
+                                         << Stats.TranslationUnits
+                                         << " files in " << Stats.Groups
+                                         << " groups, cache hit rate "
+                                         << llvm::format("%.0f",
+                                                         Stats.hitRate() * 100)
+                                         << "%, " << Stats.PchBuilt
+                                         << " built ("
+                                         << llvm::format("%.2f",
+                                                         Stats.BuildSeconds)
+                                         << "s), " << Stats.PchFailed
+                                         << " failed, ~"
+                                         << llvm::format(
+                                                "%.2f",
+                                                Stats.EstimatedSavedSeconds)
+                                         << "s of prefix parsing saved");
+    } else if (WorkersOption == "process") {
+      // Every worker process parses one file at a time with its own copy of
+      // the checker state set up above, and sends the replacements back.
+      std::vector<std::string> Units;
+      llvm::StringSet<> Seen;
+      for (const std::string &Source : ParseSources)
+        if (Seen.insert(normalizedPath(Source)).second)
+          Units.push_back(Source);
+      std::vector<std::uint64_t> UnitPeakBytes;
+      if (UseHistory) {
+        std::vector<std::string> Files;
+        for (const std::string &Unit : Units)
+          Files.push_back(normalizedPath(Unit));
+        unsigned Timed;
+        std::vector<double> Expected =
+            expectEastConstParseSeconds(Files, History, Timed);
+        std::vector<std::size_t> Order(Units.size());
+        std::iota(Order.begin(), Order.end(), 0);
+        std::stable_sort(Order.begin(), Order.end(),
+                         [&](std::size_t A, std::size_t B) {
+                           return Expected[A] > Expected[B];
+                         });
+        std::vector<std::string> Sorted;
+        for (std::size_t Index : Order) {
+          Sorted.push_back(std::move(Units[Index]));
+          UnitPeakBytes.push_back(
+              History.lookupPeakBytes(Files[Index]).value_or(0));
+        }
+        Units = std::move(Sorted);
+      }
+
+      EastConstFileSystemCache FsCache;
+      EastConstAstEngineOptions UnitOptions;
+      UnitOptions.Jobs = 1;
+      UnitOptions.FileSystemCache = FsCacheOption ? &FsCache : nullptr;
+      UnitOptions.PoolInvocations = PoolInvocationsOption;
+      UnitOptions.DeduplicateConfigurations = DedupConfigsOption;
+      auto Task = [&](llvm::StringRef Source, std::string &Output) {
+        // This is the worker's copy of the map; a worker forked late
+        // inherits whatever the parent had collected by then.
+        ReplacementsMap.clear();
+        PendingSites.clear();
+        std::string Unit = Source.str();
+        EastConstAstEngineStats UnitStats;
+        int Status = runEastConstAstEngine(OptionsParser.getCompilations(),
+                                           Unit, UnitOptions, WorkerFactory,
+                                           UnitStats);
+        if (CheckMode) {
+          std::map<std::string, unsigned> Totals;
+          collectSiteTotals(Workers, Totals);
+          unsigned Sites = 0;
+          for (const auto &FileAndSites : Totals)
+            Sites += FileAndSites.second;
+          Output = std::to_string(Sites);
+        } else {
+          Output = encodeReplacements(Unit, ReplacementsMap);
+        }
+        if (Report)
+          Output = appendSiteRecords(Output, PendingSites);
+        return Status == 0;
+      };
+      auto OnResult = [&](llvm::StringRef Source, bool Success,
+                          llvm::StringRef Output, double Seconds,
+                          std::uint64_t PeakBytes) {
+        if (UseHistory)
+          History.record(normalizedPath(Source), Seconds, PeakBytes);
+        if (Report) {
+          llvm::StringRef Records;
+          if (!splitSiteRecords(Output, Output, Records)) {
+            EAST_CONST_LOG(Error, "Unreadable sites from the worker for "
+                                      << Source);
+            return;
+          }
+          while (!Records.empty()) {
+            llvm::StringRef Record;
+            std::tie(Record, Records) = Records.split('\n');
+            EastConstSite Site;
+            if (parseEastConstSiteRecord(Record, Site))
+              Report->add(Site);
+            else
+              EAST_CONST_LOG(Error, "Unreadable site from the worker for "
+                                        << Source);
+          }
+        }
+        if (CheckMode) {
+          unsigned Sites = 0;
+          if (Output.getAsInteger(10, Sites))
+            EAST_CONST_LOG(Error, "Unreadable site count from the worker for "
+                                      << Source);
+          SiteTotals[normalizedPath(Source)] += Sites;
+          if (Sites > 0 && FailFastRun)
+            StopRun = true;
+          return;
+        }
+        TranslationUnitReplacements TUR;
+        if (!decodeReplacements(Output, TUR)) {
+          EAST_CONST_LOG(Error, "Unreadable replacements from the worker for "
+                                    << Source);
+          return;
+        }
+        for (const Replacement &Rep : TUR.Replacements)
+          Handler.add(Rep);
+        if (UseCheckpoint)
+          Checkpoint.record(normalizedPath(Source), Success, TUR.Replacements);
+        if (Diff) {
+          std::string File = TUR.Replacements.empty()
+                                 ? normalizedPath(Source)
+                                 : TUR.Replacements.front().getFilePath().str();
+          Diff->complete(Source, File, finalFixes(File, TUR.Replacements));
+        }
+      };
+
+      EastConstProcessPoolOptions PoolOptions;
+      PoolOptions.Workers = JobsOption;
+      PoolOptions.RecycleAfterUnits = RecycleAfterOption;
+      PoolOptions.RecycleAboveRssBytes =
+          static_cast<std::uint64_t>(RecycleRssOption) << 20;
+      PoolOptions.UnitTimeout = std::chrono::seconds(UnitTimeoutOption);
+      PoolOptions.Memory = Memory;
+      PoolOptions.UnitPeakBytes = std::move(UnitPeakBytes);
+      PoolOptions.Deadline = Deadline;
+      PoolOptions.Stop = &StopRun;
+      EastConstProcessPoolStats PoolStats;
+      HoldSites = true;
+      Result = runEastConstProcessPool(Units, PoolOptions, Task, OnResult,
+                                       PoolStats);
+      HoldSites = false;
+      Unstarted = PoolStats.Unstarted;
+      EAST_CONST_LOG(Info, "Parsed " << PoolStats.Units << " files on "
+                                     << PoolStats.Workers
+                                     << " worker processes in "
+                                     << llvm::format("%.2f", PoolStats.Seconds)
+                                     << "s (" << PoolStats.Failed
+                                     << " failed); " << PoolStats.WorkersStarted
+                                     << " processes started, "
+                                     << PoolStats.Recycled << " recycled, "
+                                     << PoolStats.Crashes << " crashed ("
+                                     << PoolStats.TimedOut << " timed out), "
+                                     << PoolStats.MemoryThrottled
+                                     << " starts held back for memory");
+      for (const EastConstCrashedUnit &Crashed : PoolStats.CrashedUnits)
+        EAST_CONST_LOG(Warning, "Worker crashed on "
+                                    << Crashed.Unit << " (" << Crashed.Reason
+                                    << "): "
+                                    << (Crashed.Recovered
+                                            ? "succeeded on retry"
+                                            : "not checked"));
+    } else {
+      EastConstFileSystemCache FsCache;
+      EastConstAstEngineOptions EngineOptions;
+      EngineOptions.Jobs = JobsOption;
+      EngineOptions.FileSystemCache = FsCacheOption ? &FsCache : nullptr;
+      EngineOptions.PoolInvocations = PoolInvocationsOption;
+      EngineOptions.DeduplicateConfigurations = DedupConfigsOption;
+      EngineOptions.History = UseHistory ? &History : nullptr;
+      EngineOptions.Memory = Memory;
+      EngineOptions.Deadline = Deadline;
+      EngineOptions.Stop = &StopRun;
+      if (UseCheckpoint || FailFastRun || Diff || Verifier)
+        EngineOptions.OnFileDone = [&](unsigned Worker, llvm::StringRef Source,
+                                       llvm::StringRef File, bool Success) {
+          // Each worker only touches its own checker.
+          if (FailFastRun && !Workers[Worker]->Checker.getSiteCounts().empty())
+            StopRun = true;
+          if (UseCheckpoint)
+            Checkpoint.record(File, Success, Handler.replacementsFor(File));
+          if (Diff)
+            Diff->complete(Source, File,
+                           finalFixes(File, Handler.replacementsFor(File)));
+          if (Verifier) {
+            std::optional<std::vector<EastConstDeclType>> Original =
+                Workers[Worker]->Recorder.take(File);
+            std::vector<Replacement> Fix = Handler.replacementsFor(File);
+            if (Success && !Fix.empty())
+              Verifier->submit(File, std::move(Fix), std::move(Original));
+          }
+        };
+      EastConstAstEngineStats EngineStats;
+      Result = runEastConstAstEngine(OptionsParser.getCompilations(),
+                                     ParseSources, EngineOptions,
+                                     WorkerFactory, EngineStats);
+      Unstarted = EngineStats.Unstarted;
+      if (UseHistory)
+        EAST_CONST_LOG(Info, "Scheduled "
+                                 << EngineStats.TimedUnits << " of "
+                                 << EngineStats.TranslationUnits
+                                 << " files from recorded timings; workers "
+                                 << llvm::format("%.0f",
+                                                 EngineStats.utilization() *
+                                                     100)
+                                 << "% busy");
+      EAST_CONST_LOG(Info, "Parsed " << EngineStats.TranslationUnits
+                                     << " files on " << EngineStats.Workers
+                                     << " workers in "
+                                     << llvm::format("%.2f",
+                                                     EngineStats.Seconds)
+                                     << "s (" << EngineStats.Failed
+                                     << " failed); " << EngineStats.DriverRuns
+                                     << " driver runs, "
+                                     << EngineStats.PooledUnits
+                                     << " files on pooled invocations from "
+                                     << EngineStats.InvocationGroups
+                                     << " groups, "
+                                     << EngineStats.MemoryThrottled
+                                     << " starts held back for memory");
+      if (EngineStats.DuplicateSources + EngineStats.DuplicateCommands > 0)
+        EAST_CONST_LOG(Info, "Avoided "
+                                 << EngineStats.DuplicateSources +
+                                        EngineStats.DuplicateCommands
+                                 << " parses: " << EngineStats.DuplicateSources
+                                 << " repeated files, "
+                                 << EngineStats.DuplicateCommands
+                                 << " equivalent compile commands");
+      if (FsCacheOption) {
+        EastConstFileSystemCacheStats FsStats = FsCache.getStats();
+        EAST_CONST_LOG(Info, "File system cache: stat "
+                                 << FsStats.StatHits << " hits ("
+                                 << FsStats.NegativeHits << " negative), "
+                                 << FsStats.StatMisses << " misses; contents "
+                                 << FsStats.ContentHits << " hits, "
+                                 << FsStats.ContentMisses << " misses, "
+                                 << llvm::format("%.1f",
+                                                 FsStats.ContentBytes /
+                                                     (1024.0 * 1024.0))
+                                 << " MB cached, " << FsStats.UncachedReads
+                                 << " main-file reads uncached");
+      }
+    }
+
+    if (Unstarted > 0 && StopRun)
+      EAST_CONST_LOG(Info, "Stopped at the first west-const site; "
+                               << Unstarted << " parses not started");
+    else if (Unstarted > 0)
+      EAST_CONST_LOG(Warning, "Time budget used up; "
+                                  << Unstarted << " parses not started"
+                                  << (UseCheckpoint
+                                          ? " (rerun with --resume to "
+                                            "continue)"
+                                          : ""));
+
+    if (UseHistory && !History.save(TimingHistoryOption))
+      EAST_CONST_LOG(Warning, "Cannot write timing history "
+                                  << TimingHistoryOption);
+
+    if (!AstInputs.empty()) {
+      EastConstAstStats AstStats;
+      if (runEastConstAstInputs(AstInputs, OptionsParser.getCompilations(),
+                                WorkerFactory(0), AstStats) != 0)
+        Result = 1;
+      EAST_CONST_LOG(Info, "Serialized ASTs: " << AstStats.Loaded
+                                               << " checked, "
+                                               << AstStats.Stale
+                                               << " out of date ("
+                                               << AstStats.Reparsed
+                                               << " reparsed from source)");
+    }
+
+    llvm::StringSet<> Unverified;
+    if (Verifier) {
+      // Files without a per-file completion are verified now, against a
+      // fresh parse of the original unless a worker recorded it.
+      for (const auto &FileAndReplacements : ReplacementsMap) {
+        const std::string &File = FileAndReplacements.first;
+        if (File.empty() || Verifier->isSubmitted(File))
+          continue;
+        std::optional<std::vector<EastConstDeclType>> Original;
+        for (const std::unique_ptr<AstWorker> &Worker : Workers)
+          if (!Original)
+            Original = Worker->Recorder.take(File);
+        Verifier->submit(File,
+                         std::vector<Replacement>(
+                             FileAndReplacements.second.begin(),
+                             FileAndReplacements.second.end()),
+                         std::move(Original));
+      }
+      unsigned Verified = 0;
+      unsigned Compared = 0;
+      for (const EastConstVerification &Verification : Verifier->wait()) {
+        ++Verified;
+        Compared += Verification.Compared;
+        if (Verification.passed())
+          continue;
+        Unverified.insert(Verification.File);
+        for (const std::string &Mismatch : Verification.Mismatches)
+          EAST_CONST_LOG(Error, Verification.File << ": " << Mismatch);
+        if (!Verification.Reparsed && Verification.Mismatches.empty())
+          EAST_CONST_LOG(Error, Verification.File
+                                    << ": does not compile once fixed");
+        if (Verification.Leftover > 0)
+          EAST_CONST_LOG(Error, Verification.File
+                                    << ": a second pass still makes "
+                                    << Verification.Leftover
+                                    << " replacements");
+      }
+      EAST_CONST_LOG(Info, "Verified " << Verified << " fixed files ("
+                                       << Compared
+                                       << " declarations compared); "
+                                       << Unverified.size() << " failed");
+      if (!Unverified.empty())
+        Result = 1;
+    }
+
+    if (Diff) {
+      Diff->finish();
+      // PCH batches, serialized ASTs and resumed files report no per-file
+      // completion; their fixes come last, by path.
+      for (const auto &FileAndReplacements : ReplacementsMap)
+        if (!Diff->isWritten(FileAndReplacements.first))
+          Diff->write(FileAndReplacements.first,
+                      finalFixes(FileAndReplacements.first,
+                                 std::vector<Replacement>(
+                                     FileAndReplacements.second.begin(),
+                                     FileAndReplacements.second.end())));
+      EAST_CONST_LOG(Info, "Printed fixes for " << Diff->filesWritten()
+                                                << " files as a diff");
+      if (Diff->failures() > 0)
+        Result = 1;
+    }
+
+    if (Report) {
+      Report->finish();
+      EAST_CONST_LOG(Info, "Reported " << Report->size()
+                                       << " west-const sites as "
+                                       << FormatOption);
+    }
+
+    if (CheckMode) {
+      collectSiteTotals(Workers, SiteTotals);
+      unsigned Sites = 0;
+      unsigned FilesWithSites = 0;
+      // With a report on stdout the summary goes to the log instead.
+      llvm::raw_ostream &Summary = Report ? llvm::errs() : llvm::outs();
+      for (const auto &FileAndSites : SiteTotals) {
+        if (FileAndSites.second == 0)
+          continue;
+        Summary << FileAndSites.first << ": " << FileAndSites.second
+                     << (FailFast ? "+" : "") << " west-const sites\n";
+        Sites += FileAndSites.second;
+        ++FilesWithSites;
+      }
+      Summary << (FailFast ? "At least " : "") << Sites
+                   << " west-const sites in " << FilesWithSites
+                   << (FilesWithSites == 1 ? " file\n" : " files\n");
+      if (Sites > 0)
+        Result = 1;
+    }
     
     if (FixErrors) {
-      // Get the replacements map
-      auto &ReplacementsMap = Tool.getReplacements();
-      
       // Remove any entries with empty file paths
       ReplacementsMap.erase("");
       
       // Apply the replacements to each file
-      llvm::errs() << "Applying fixes to " << ReplacementsMap.size() << " files\n";
+      EAST_CONST_LOG(Info, "Applying fixes to " << ReplacementsMap.size()
+                                                 << " files");
       
       for (const auto &FileAndReplacements : ReplacementsMap) {
         const std::string &FilePath = FileAndReplacements.first;
         const Replacements &Replaces = FileAndReplacements.second;
+        if (Unverified.contains(FilePath)) {
+          EAST_CONST_LOG(Warning, "Not applying the fixes to "
+                                      << FilePath << ": they failed --verify");
+          continue;
+        }
         
-        llvm::errs() << "Processing file: " << FilePath << " with "
-                     << Replaces.size() << " replacements\n";
+        EAST_CONST_LOG(Info, "Processing file: " << FilePath << " with "
+                                                  << Replaces.size()
+                                                  << " replacements");
         
         // Read the file content using LLVM's file system functions
         auto FileOrError = llvm::MemoryBuffer::getFile(FilePath);
         if (std::error_code EC = FileOrError.getError()) {
-          llvm::errs() << "Error reading file " << FilePath << ": " << EC.message() << "\n";
+          EAST_CONST_LOG(Error, "Error reading file " << FilePath << ": "
+                                                       << EC.message());
           continue;
         }
         
         std::string FileContent = FileOrError.get()->getBuffer().str();
         
-        // Apply replacements to the file content
-        llvm::Expected<std::string> NewContent = applyAllReplacements(FileContent, Replaces);
+        // Apply replacements to the file content, with the lines they touch
+        // reformatted when asked to
+        const Replacements *Edits = &Replaces;
+        Replacements Formatted;
+        if (Formatter) {
+          llvm::Expected<Replacements> Reformatted =
+              Formatter->format(FilePath, FileContent, Replaces);
+          if (Reformatted) {
+            Formatted = std::move(*Reformatted);
+            Edits = &Formatted;
+          } else {
+            std::string Message = llvm::toString(Reformatted.takeError());
+            EAST_CONST_LOG(Warning, "Cannot format the fixed lines of "
+                                        << FilePath << ": " << Message);
+          }
+        }
+        llvm::Expected<std::string> NewContent =
+            applyAllReplacements(FileContent, *Edits);
         if (!NewContent) {
-          llvm::errs() << "Error applying replacements to " << FilePath << ": "
-                       << llvm::toString(NewContent.takeError()) << "\n";
+          EAST_CONST_LOG(Error, "Error applying replacements to "
+                                    << FilePath << ": "
+                                    << llvm::toString(NewContent.takeError()));
           continue;
         }
         
@@ -124,7 +1669,8 @@ int main(int argc, const char **argv) {
         std::error_code EC;
         llvm::raw_fd_ostream OS(FilePath, EC, llvm::sys::fs::OF_None);
         if (EC) {
-          llvm::errs() << "Error opening file for writing " << FilePath << ": " << EC.message() << "\n";
+          EAST_CONST_LOG(Error, "Error opening file for writing "
+                                    << FilePath << ": " << EC.message());
           continue;
         }
         
@@ -132,12 +1678,19 @@ int main(int argc, const char **argv) {
         OS.close();
         
         if (OS.has_error()) {
-          llvm::errs() << "Error writing to " << FilePath << "\n";
+          EAST_CONST_LOG(Error, "Error writing to " << FilePath);
         } else {
-          llvm::errs() << "Successfully modified: " << FilePath << "\n";
+          EAST_CONST_LOG(Info, "Successfully modified: " << FilePath);
+          if (UseCheckpoint)
+            Checkpoint.markApplied(FilePath, *NewContent);
         }
       }
     }
-    
+
+    if (Result == 0 && ResumedFailures)
+      Result = 1;
+    if (Result == 0 && Unstarted > 0)
+      Result = 2;
+    flushEastConstLog();
     return Result;
   }
\ No newline at end of file
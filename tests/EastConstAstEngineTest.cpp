@@ -0,0 +1,284 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstAstEngine.h>
+#include <EastConstEnforcer.h>
+#include <EastConstTimingHistory.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Lists every file under a fixed set of flag variants, as build systems do
+// for shared/static or test/prod targets.
+class VariantDatabase : public clang::tooling::CompilationDatabase {
+public:
+  VariantDatabase(std::string Directory,
+                  std::vector<std::vector<std::string>> Variants)
+      : Directory(std::move(Directory)), Variants(std::move(Variants)) {}
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override {
+    std::vector<clang::tooling::CompileCommand> Commands;
+    for (const std::vector<std::string> &Flags : Variants) {
+      std::vector<std::string> CommandLine = {"clang++"};
+      CommandLine.insert(CommandLine.end(), Flags.begin(), Flags.end());
+      CommandLine.push_back("-c");
+      CommandLine.push_back(FilePath.str());
+      Commands.emplace_back(Directory, FilePath, CommandLine, "out.o");
+    }
+    return Commands;
+  }
+
+private:
+  std::string Directory;
+  std::vector<std::vector<std::string>> Variants;
+};
+
+class EastConstAstEngineTest : public EastConstTempDirTest {
+protected:
+  // Runs the engine with one checker per worker and returns the number of
+  // qualifier removals per file; the fixes themselves are left in Fixes.
+  std::map<std::string, unsigned> run(const std::vector<std::string> &Sources,
+                                      const EastConstAstEngineOptions &Options,
+                                      EastConstAstEngineStats &Stats) {
+    clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                          {"-std=c++17"});
+    return run(Compilations, Sources, Options, Stats);
+  }
+
+  std::map<std::string, unsigned>
+  run(const clang::tooling::CompilationDatabase &Compilations,
+      const std::vector<std::string> &Sources,
+      const EastConstAstEngineOptions &Options,
+      EastConstAstEngineStats &Stats) {
+    std::mutex Lock;
+    std::map<std::string, unsigned> Removals;
+    Fixes.clear();
+    ReplacementHandler Handler = [&](const clang::SourceManager &SM,
+                                     clang::CharSourceRange Range,
+                                     llvm::StringRef NewText) {
+      clang::tooling::Replacement Rep(SM, Range, NewText);
+      std::string Name = llvm::sys::path::filename(Rep.getFilePath()).str();
+      std::lock_guard<std::mutex> Guard(Lock);
+      EXPECT_FALSE(llvm::errorToBool(addEastConstFix(Fixes[Name], Rep)));
+      if (NewText.empty())
+        ++Removals[Name];
+    };
+    std::vector<std::unique_ptr<Worker>> Workers;
+    EXPECT_EQ(runEastConstAstEngine(
+                  Compilations, Sources, Options,
+                  [&](unsigned) -> clang::tooling::FrontendActionFactory & {
+                    Workers.push_back(std::make_unique<Worker>(Handler));
+                    return *Workers.back()->Factory;
+                  },
+                  Stats),
+              0);
+    return Removals;
+  }
+
+  // The file as the last run's fixes would leave it.
+  std::string rewritten(llvm::StringRef Path) {
+    auto Buffer = llvm::MemoryBuffer::getFile(Path);
+    EXPECT_TRUE(Buffer);
+    if (!Buffer)
+      return std::string();
+    llvm::Expected<std::string> Code = clang::tooling::applyAllReplacements(
+        (*Buffer)->getBuffer(),
+        Fixes[llvm::sys::path::filename(Path).str()]);
+    EXPECT_TRUE(static_cast<bool>(Code));
+    if (!Code) {
+      llvm::consumeError(Code.takeError());
+      return std::string();
+    }
+    return *Code;
+  }
+
+  struct Worker {
+    explicit Worker(ReplacementHandler Handler)
+        : Checker(std::move(Handler), quietOptions()) {
+      registerEastConstMatchers(Finder, &Checker);
+      Factory = clang::tooling::newFrontendActionFactory(&Finder);
+    }
+    static EastConstCheckerOptions quietOptions() {
+      EastConstCheckerOptions Options;
+      Options.Quiet = true;
+      return Options;
+    }
+    EastConstChecker Checker;
+    clang::ast_matchers::MatchFinder Finder;
+    std::unique_ptr<clang::tooling::FrontendActionFactory> Factory;
+  };
+
+  std::map<std::string, clang::tooling::Replacements> Fixes;
+};
+
+} // namespace
+
+TEST(EastConstCompileFlagsTest, DropsInputsOutputsAndDependencyFiles) {
+  clang::tooling::CompileCommand Command(
+      "/build", "/src/a.cpp",
+      {"clang++", "-std=c++17", "-DX=1", "-c", "/src/a.cpp", "-o", "a.o",
+       "-MD", "-MF", "a.d", "-I../inc"},
+      "a.o");
+  EXPECT_EQ(normalizeEastConstCompileFlags(Command),
+            (std::vector<std::string>{"-std=c++17", "-DX=1", "-I../inc"}));
+}
+
+TEST_F(EastConstAstEngineTest, PoolsTheInvocationForIdenticalFlags) {
+  std::vector<std::string> Sources;
+  for (char Name = 'a'; Name <= 'd'; ++Name)
+    Sources.push_back(writeFile(std::string(1, Name) + ".cpp",
+                                "const int " + std::string(1, Name) +
+                                    " = 1;\nvoid f(const int p);\n"));
+
+  EastConstAstEngineOptions Options;
+  Options.Jobs = 1;
+  EastConstAstEngineStats Stats;
+  std::map<std::string, unsigned> Removals = run(Sources, Options, Stats);
+  EXPECT_EQ(Stats.InvocationGroups, 1u);
+  EXPECT_EQ(Stats.DriverRuns, 1u);
+  EXPECT_EQ(Stats.PooledUnits, 3u);
+  for (char Name = 'a'; Name <= 'd'; ++Name)
+    EXPECT_EQ(Removals[std::string(1, Name) + ".cpp"], 2u);
+
+  // Results must not depend on pooling.
+  Options.PoolInvocations = false;
+  EastConstAstEngineStats Unpooled;
+  EXPECT_EQ(run(Sources, Options, Unpooled), Removals);
+  EXPECT_EQ(Unpooled.DriverRuns, 4u);
+  EXPECT_EQ(Unpooled.PooledUnits, 0u);
+}
+
+TEST_F(EastConstAstEngineTest, PooledFilesDoNotShareAsts) {
+  // b.cpp would fail to compile if it saw a.cpp's declarations.
+  std::vector<std::string> Sources = {
+      writeFile("a.cpp", "struct S { const int V = 1; };\n"),
+      writeFile("b.cpp", "struct S { const long V = 2; };\nconst S s;\n")};
+
+  EastConstAstEngineOptions Options;
+  Options.Jobs = 1;
+  EastConstAstEngineStats Stats;
+  std::map<std::string, unsigned> Removals = run(Sources, Options, Stats);
+  EXPECT_EQ(Stats.Failed, 0u);
+  EXPECT_EQ(Stats.PooledUnits, 1u);
+  EXPECT_EQ(Removals["a.cpp"], 1u);
+  EXPECT_EQ(Removals["b.cpp"], 2u);
+}
+
+TEST_F(EastConstAstEngineTest, PoolsCAndCxxFilesSeparately) {
+  // `new` and `class` are identifiers in C; `&` declarators need C++.
+  std::vector<std::string> Sources = {
+      writeFile("a.c", "int new = 1;\nconst int *a;\n"),
+      writeFile("b.cpp", "const int &b = 1;\n"),
+      writeFile("c.c", "int class = 2;\nconst char *c;\n"),
+      writeFile("d.cpp", "namespace n { const int d = 1; }\n")};
+  clang::tooling::FixedCompilationDatabase Compilations(
+      Root.str(), std::vector<std::string>());
+
+  EastConstAstEngineOptions Options;
+  Options.Jobs = 1;
+  EastConstAstEngineStats Stats;
+  std::map<std::string, unsigned> Removals =
+      run(Compilations, Sources, Options, Stats);
+  EXPECT_EQ(Stats.Failed, 0u);
+  EXPECT_EQ(Stats.InvocationGroups, 2u);
+  EXPECT_EQ(Stats.PooledUnits, 2u);
+  for (const char *Name : {"a.c", "b.cpp", "c.c", "d.cpp"})
+    EXPECT_EQ(Removals[Name], 1u) << Name;
+}
+
+TEST(EastConstCompileFlagsTest, ReadsTheLanguageFromTheDriverAndFlags) {
+  auto language = [](std::vector<std::string> CommandLine) {
+    return eastConstInputLanguage(clang::tooling::CompileCommand(
+        "/build", "/src/a.c", std::move(CommandLine), "a.o"));
+  };
+  EXPECT_EQ(language({"clang", "-c", "/src/a.c"}), "c");
+  EXPECT_EQ(language({"clang++", "-c", "/src/a.c"}), "c++");
+  EXPECT_EQ(language({"clang", "-x", "c++", "-c", "/src/a.c"}), "c++");
+  EXPECT_EQ(language({"clang", "--driver-mode=g++", "/src/a.c"}), "c++");
+}
+
+TEST_F(EastConstAstEngineTest, ParsesEachConfigurationOnce) {
+  std::string Source = writeFile("v.cpp", "#ifdef VARIANT\n"
+                                          "const int v = 1;\n"
+                                          "#endif\n"
+                                          "const int a = 2;\n");
+  // Shared and static builds differ only in code-generation flags; the
+  // VARIANT build really sees different code.
+  VariantDatabase Compilations(
+      Root.str().str(), {{"-std=c++17", "-O2", "-fPIC", "-g"},
+                         {"-std=c++17", "-O0", "-Wall"},
+                         {"-std=c++17", "-DVARIANT"}});
+
+  EastConstAstEngineOptions Options;
+  Options.Jobs = 1;
+  EastConstAstEngineStats Stats;
+  run(Compilations, {Source, Source}, Options, Stats);
+  EXPECT_EQ(Stats.TranslationUnits, 2u);
+  EXPECT_EQ(Stats.DuplicateSources, 1u);
+  EXPECT_EQ(Stats.DuplicateCommands, 1u);
+  // Both configurations fix `a`; its fix is applied once.
+  const char *Fixed = "#ifdef VARIANT\n"
+                      "int const v = 1;\n"
+                      "#endif\n"
+                      "int const a = 2;\n";
+  EXPECT_EQ(rewritten(Source), Fixed);
+
+  Options.DeduplicateConfigurations = false;
+  EastConstAstEngineStats All;
+  run(Compilations, {Source}, Options, All);
+  EXPECT_EQ(All.TranslationUnits, 3u);
+  EXPECT_EQ(rewritten(Source), Fixed);
+}
+
+TEST_F(EastConstAstEngineTest, RecordsEveryFileInTheTimingHistory) {
+  std::vector<std::string> Sources = {
+      writeFile("a.cpp", "const int a = 1;\n"),
+      writeFile("b.cpp", "#include \"a.h\"\nconst int b = 2;\n"),
+      writeFile("c.cpp", "const int c = 3;\n")};
+  writeFile("a.h", "const int h = 0;\n");
+
+  EastConstTimingHistory History;
+  History.record(Sources[2], 4.0);
+  EastConstAstEngineOptions Options;
+  Options.Jobs = 2;
+  Options.History = &History;
+  EastConstAstEngineStats Stats;
+  std::map<std::string, unsigned> Removals = run(Sources, Options, Stats);
+  EXPECT_EQ(Stats.TimedUnits, 1u);
+  EXPECT_GT(Stats.BusySeconds, 0.0);
+  for (const std::string &Source : Sources) {
+    ASSERT_TRUE(History.lookup(Source)) << Source;
+    EXPECT_LT(*History.lookup(Source), 4.0);
+  }
+  EXPECT_EQ(Removals["a.cpp"], 1u);
+  EXPECT_EQ(Removals["b.cpp"], 1u);
+  EXPECT_EQ(Removals["c.cpp"], 1u);
+}
+
+TEST_F(EastConstAstEngineTest, RecordsAFileOnceOverAllItsConfigurations) {
+  std::string Source = writeFile("a.cpp", "const int a = 1;\n");
+  VariantDatabase Compilations(Root.str().str(),
+                               {{"-std=c++17", "-DFIRST"},
+                                {"-std=c++17", "-DSECOND"}});
+  EastConstTimingHistory History;
+  EastConstAstEngineOptions Options;
+  Options.Jobs = 2;
+  Options.History = &History;
+  EastConstAstEngineStats Stats;
+  run(Compilations, {Source}, Options, Stats);
+  EXPECT_EQ(Stats.TranslationUnits, 2u);
+  EXPECT_EQ(History.size(), 1u);
+  ASSERT_TRUE(History.lookup(Source));
+  // Both parses, not whichever finished last.
+  EXPECT_NEAR(*History.lookup(Source), Stats.BusySeconds, 1e-5);
+}
@@ -0,0 +1,153 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstAstInputs.h>
+#include <EastConstEnforcer.h>
+#include <gtest/gtest.h>
+
+#include <clang/Frontend/ASTUnit.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Process.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Reports one compile command whose object file is Output.
+class SingleCommandDatabase : public clang::tooling::CompilationDatabase {
+public:
+  SingleCommandDatabase(std::string Directory, std::string Output)
+      : Directory(std::move(Directory)), Output(std::move(Output)) {}
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override {
+    return {clang::tooling::CompileCommand(
+        Directory, FilePath,
+        {"clang++", "-std=c++17", "-c", FilePath.str(), "-o", Output},
+        Output)};
+  }
+
+private:
+  std::string Directory;
+  std::string Output;
+};
+
+class EastConstAstInputsTest : public EastConstTempDirTest {
+protected:
+  // Builds Source and serializes the AST to AstPath, as -emit-ast would.
+  void emitAst(const std::string &Source, const std::string &AstPath,
+               std::vector<std::string> Flags = {"-std=c++17"}) {
+    clang::tooling::FixedCompilationDatabase Compilations(Root.str(), Flags);
+    clang::tooling::ClangTool Tool(Compilations, {Source});
+    std::vector<std::unique_ptr<clang::ASTUnit>> ASTs;
+    ASSERT_EQ(Tool.buildASTs(ASTs), 0);
+    ASSERT_EQ(ASTs.size(), 1u);
+    ASSERT_FALSE(ASTs.front()->Save(AstPath));
+  }
+
+  unsigned countRemovals(const std::vector<EastConstAstInput> &Inputs,
+                         EastConstAstStats &Stats, int &Status) {
+    unsigned Removals = 0;
+    EastConstCheckerOptions Options;
+    Options.Quiet = true;
+    EastConstChecker Checker(
+        [&Removals](const clang::SourceManager &, clang::CharSourceRange,
+                    llvm::StringRef NewText) {
+          if (NewText.empty())
+            ++Removals;
+        },
+        Options);
+    clang::ast_matchers::MatchFinder Finder;
+    registerEastConstMatchers(Finder, &Checker);
+    clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                          {"-std=c++17"});
+    auto Factory = clang::tooling::newFrontendActionFactory(&Finder);
+    Status = runEastConstAstInputs(Inputs, Compilations, *Factory, Stats);
+    return Removals;
+  }
+
+  llvm::SmallString<256> Root;
+};
+
+} // namespace
+
+TEST_F(EastConstAstInputsTest, ChecksASerializedAst) {
+  std::string Source =
+      writeFile("a.cpp", "const int a = 1;\nvoid f(const int p);\n");
+  std::string Ast = path("a.ast");
+  emitAst(Source, Ast);
+
+  EastConstAstStats Stats;
+  int Status = 1;
+  EXPECT_EQ(countRemovals({{Ast, std::string()}}, Stats, Status), 2u);
+  EXPECT_EQ(Status, 0);
+  EXPECT_EQ(Stats.Loaded, 1u);
+  EXPECT_EQ(Stats.Stale, 0u);
+}
+
+TEST_F(EastConstAstInputsTest, ReparsesWhenTheSourceChanged) {
+  std::string Source = writeFile("b.cpp", "const int b = 1;\n");
+  std::string Ast = path("b.ast");
+  emitAst(Source, Ast);
+  writeFile("b.cpp", "const int b = 1;\nconst int c = 2;\n");
+
+  EastConstAstStats Stats;
+  int Status = 1;
+  EXPECT_EQ(countRemovals({{Ast, Source}}, Stats, Status), 2u);
+  EXPECT_EQ(Status, 0);
+  EXPECT_EQ(Stats.Loaded, 0u);
+  EXPECT_EQ(Stats.Stale, 1u);
+  EXPECT_EQ(Stats.Reparsed, 1u);
+}
+
+TEST_F(EastConstAstInputsTest, KeepsAnAstWhoseInputWasOnlyTouched) {
+  std::string Source = writeFile("t.cpp", "const int t = 1;\n");
+  std::string Ast = path("t.ast");
+  emitAst(Source, Ast,
+          {"-std=c++17", "-fvalidate-ast-input-files-content"});
+  // As a checkout does: same bytes, new modification time.
+  int FD;
+  ASSERT_FALSE(llvm::sys::fs::openFileForWrite(
+      Source, FD, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_Append));
+  EXPECT_FALSE(llvm::sys::fs::setLastAccessAndModificationTime(
+      FD, std::chrono::system_clock::now() + std::chrono::hours(1)));
+  llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+
+  EastConstAstStats Stats;
+  int Status = 1;
+  EXPECT_EQ(countRemovals({{Ast, Source}}, Stats, Status), 1u);
+  EXPECT_EQ(Status, 0);
+  EXPECT_EQ(Stats.Loaded, 1u);
+  EXPECT_EQ(Stats.Stale, 0u);
+}
+
+TEST_F(EastConstAstInputsTest, StaleAstWithoutSourceIsAnError) {
+  std::string Source = writeFile("c.cpp", "const int c = 1;\n");
+  std::string Ast = path("c.ast");
+  emitAst(Source, Ast);
+  writeFile("c.cpp", "const int c = 1;\nint d;\n");
+
+  EastConstAstStats Stats;
+  int Status = 0;
+  countRemovals({{Ast, std::string()}}, Stats, Status);
+  EXPECT_NE(Status, 0);
+  EXPECT_EQ(Stats.Stale, 1u);
+}
+
+TEST_F(EastConstAstInputsTest, FindsAstsNextToObjectFiles) {
+  std::string Source = writeFile("d.cpp", "int d;\n");
+  SingleCommandDatabase Compilations(Root.str().str(), "obj/d.o");
+  EXPECT_EQ(findBuildAstFor(Compilations, Source), "");
+
+  ASSERT_FALSE(llvm::sys::fs::create_directories(path("obj")));
+  writeFile("obj/d.o.ast", "");
+  EXPECT_EQ(findBuildAstFor(Compilations, Source), path("obj/d.o.ast"));
+  writeFile("obj/d.ast", "");
+  EXPECT_EQ(findBuildAstFor(Compilations, Source), path("obj/d.ast"));
+
+  EXPECT_TRUE(isEastConstAstFile("x/y.ast"));
+  EXPECT_FALSE(isEastConstAstFile("x/y.cpp"));
+}
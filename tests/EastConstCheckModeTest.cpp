@@ -0,0 +1,95 @@
+#include <EastConstEnforcer.h>
+#include <EastConstFrontend.h>
+#include <gtest/gtest.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char *const kSites = R"cpp(
+    const int Global = 1;
+    const int Other = 2;
+    typedef const char *CString;
+    struct Holder {
+      const int Member = 2;
+    };
+    const int &pick(const int &Value);
+  )cpp";
+
+unsigned total(const EastConstSiteCounts &Counts) {
+  unsigned Sum = 0;
+  for (unsigned Count : Counts)
+    Sum += Count;
+  return Sum;
+}
+
+std::map<std::string, EastConstSiteCounts>
+countSites(const EastConstCheckerOptions &Options,
+           ReplacementHandler Handler = nullptr,
+           std::map<std::string, EastConstSiteKinds> *Counted = nullptr) {
+  clang::tooling::FixedCompilationDatabase Compilations(".", {"-std=c++20"});
+  std::vector<std::string> Sources = {"sites.cpp"};
+  clang::tooling::ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("sites.cpp", kSites);
+
+  EastConstChecker Checker(std::move(Handler), Options);
+  clang::ast_matchers::MatchFinder Finder;
+  registerEastConstMatchers(Finder, &Checker);
+  std::unique_ptr<clang::tooling::FrontendActionFactory> Factory =
+      newEastConstActionFactory(Finder, EastConstFrontendOptions());
+  EXPECT_EQ(Tool.run(Factory.get()), 0);
+  if (Counted)
+    *Counted = Checker.getCountedSites();
+  return Checker.getSiteCounts();
+}
+
+EastConstCheckerOptions checkOnly() {
+  EastConstCheckerOptions Options;
+  Options.Quiet = true;
+  Options.CountSites = true;
+  Options.CheckOnly = true;
+  return Options;
+}
+
+} // namespace
+
+TEST(EastConstCheckModeTest, CountsEverySiteWithoutBuildingFixes) {
+  bool Called = false;
+  std::map<std::string, EastConstSiteCounts> Counts = countSites(
+      checkOnly(), [&](const clang::SourceManager &, clang::CharSourceRange,
+                       llvm::StringRef) { Called = true; });
+  EXPECT_FALSE(Called);
+  ASSERT_EQ(Counts.size(), 1u);
+  EXPECT_EQ(total(Counts.begin()->second), 6u);
+}
+
+TEST(EastConstCheckModeTest, WorkersReportTheSameSitesByOffset) {
+  // Two workers parsing the same file, as two configurations of it may,
+  // find the same offsets, so merging them counts each site once.
+  std::map<std::string, EastConstSiteKinds> First;
+  std::map<std::string, EastConstSiteKinds> Second;
+  countSites(checkOnly(), nullptr, &First);
+  countSites(checkOnly(), nullptr, &Second);
+  ASSERT_EQ(First.size(), 1u);
+  EXPECT_EQ(First, Second);
+
+  EastConstSiteKinds Merged = First.begin()->second;
+  Merged.insert(Second.begin()->second.begin(), Second.begin()->second.end());
+  EXPECT_EQ(Merged.size(), 6u);
+  EXPECT_EQ(total(countEastConstSites(Merged)), 6u);
+}
+
+TEST(EastConstCheckModeTest, FailFastStopsAtTheFirstSite) {
+  EastConstCheckerOptions Options = checkOnly();
+  Options.FailFast = true;
+  std::map<std::string, EastConstSiteCounts> Counts = countSites(Options);
+  ASSERT_EQ(Counts.size(), 1u);
+  EXPECT_EQ(total(Counts.begin()->second), 1u);
+}
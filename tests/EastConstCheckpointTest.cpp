@@ -0,0 +1,159 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstCheckpoint.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+
+using clang::tooling::Replacement;
+
+namespace {
+
+class EastConstCheckpointTest : public EastConstTempDirTest {
+protected:
+  void SetUp() override {
+    ASSERT_NO_FATAL_FAILURE(EastConstTempDirTest::SetUp());
+    Path = path("checkpoint");
+    for (const char *Name : {"a.cpp", "b.cpp", "c.cpp"})
+      writeFile(Name, "const int x = 1;\n");
+  }
+
+  std::string contents() {
+    auto Buffer = llvm::MemoryBuffer::getFile(Path);
+    return Buffer ? (*Buffer)->getBuffer().str() : std::string();
+  }
+
+  void append(llvm::StringRef Bytes) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::OF_Append);
+    ASSERT_FALSE(EC);
+    OS << Bytes;
+  }
+
+  std::string Path;
+};
+
+} // namespace
+
+TEST_F(EastConstCheckpointTest, ResumesRecordedFiles) {
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/false));
+    EXPECT_TRUE(Checkpoint.record(
+        path("a.cpp"), true,
+        {Replacement(path("a.cpp"), 4, 6, "int const")}));
+    EXPECT_TRUE(Checkpoint.record(path("b.cpp"), false, {}));
+  }
+  EastConstCheckpoint Checkpoint;
+  ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/true));
+  EXPECT_EQ(Checkpoint.droppedBytes(), 0u);
+  EXPECT_TRUE(Checkpoint.isDone(path("a.cpp")));
+  EXPECT_TRUE(Checkpoint.isDone(path("b.cpp")));
+  EXPECT_FALSE(Checkpoint.isDone(path("c.cpp")));
+  ASSERT_EQ(Checkpoint.resumed().size(), 2u);
+  const EastConstCheckpointEntry &A = Checkpoint.resumed()[0];
+  EXPECT_EQ(A.File, path("a.cpp"));
+  EXPECT_TRUE(A.Success);
+  EXPECT_FALSE(A.Applied);
+  ASSERT_EQ(A.Replacements.size(), 1u);
+  EXPECT_EQ(A.Replacements[0].getOffset(), 4u);
+  EXPECT_EQ(A.Replacements[0].getReplacementText(), "int const");
+  EXPECT_FALSE(Checkpoint.resumed()[1].Success);
+}
+
+TEST_F(EastConstCheckpointTest, CutsOffATornRecord) {
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/false));
+    EXPECT_TRUE(Checkpoint.record(path("a.cpp"), true, {}));
+  }
+  std::string Complete = contents();
+  append("0123abcd 500 ok 0\n---\nMainSourceFile: /src/b");
+
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/true));
+    EXPECT_GT(Checkpoint.droppedBytes(), 0u);
+    EXPECT_TRUE(Checkpoint.isDone(path("a.cpp")));
+    EXPECT_FALSE(Checkpoint.isDone("/src/b"));
+    EXPECT_EQ(contents(), Complete);
+    EXPECT_TRUE(Checkpoint.record(path("c.cpp"), true, {}));
+  }
+  EastConstCheckpoint Checkpoint;
+  ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/true));
+  EXPECT_EQ(Checkpoint.droppedBytes(), 0u);
+  EXPECT_EQ(Checkpoint.resumed().size(), 2u);
+  EXPECT_TRUE(Checkpoint.isDone(path("c.cpp")));
+}
+
+TEST_F(EastConstCheckpointTest, MarksOnlyTheFilesWritten) {
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/false));
+    EXPECT_TRUE(Checkpoint.record(path("a.cpp"), true, {}));
+    EXPECT_TRUE(Checkpoint.record(path("b.cpp"), true, {}));
+    // Killed after writing a.cpp, before b.cpp.
+    writeFile("a.cpp", "int const x = 1;\n");
+    EXPECT_TRUE(
+        Checkpoint.markApplied(path("a.cpp"), "int const x = 1;\n"));
+  }
+  EastConstCheckpoint Checkpoint;
+  ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/true));
+  EXPECT_EQ(Checkpoint.staleFiles(), 0u);
+  ASSERT_EQ(Checkpoint.resumed().size(), 2u);
+  EXPECT_TRUE(Checkpoint.resumed()[0].Applied);
+  EXPECT_FALSE(Checkpoint.resumed()[1].Applied);
+}
+
+TEST_F(EastConstCheckpointTest, ParsesFilesChangedSinceAgain) {
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/false));
+    EXPECT_TRUE(Checkpoint.record(
+        path("a.cpp"), true,
+        {Replacement(path("a.cpp"), 0, 6, "")}));
+    EXPECT_TRUE(Checkpoint.record(path("b.cpp"), true, {}));
+    EXPECT_TRUE(Checkpoint.record(path("c.cpp"), true, {}));
+    EXPECT_TRUE(
+        Checkpoint.markApplied(path("c.cpp"), "int const x = 1;\n"));
+  }
+  // a.cpp was edited after it was parsed, c.cpp after its fixes were
+  // written; the recorded offsets no longer fit either.
+  writeFile("a.cpp", "// edited\nconst int x = 1;\n");
+  writeFile("c.cpp", "// edited\nint const x = 1;\n");
+  EastConstCheckpoint Checkpoint;
+  ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/true));
+  EXPECT_EQ(Checkpoint.staleFiles(), 2u);
+  EXPECT_FALSE(Checkpoint.isDone(path("a.cpp")));
+  EXPECT_TRUE(Checkpoint.isDone(path("b.cpp")));
+  EXPECT_FALSE(Checkpoint.isDone(path("c.cpp")));
+  ASSERT_EQ(Checkpoint.resumed().size(), 1u);
+  EXPECT_EQ(Checkpoint.resumed()[0].File, path("b.cpp"));
+}
+
+TEST_F(EastConstCheckpointTest, StartsOverWithoutResume) {
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/false));
+    EXPECT_TRUE(Checkpoint.record(path("a.cpp"), true, {}));
+  }
+  {
+    EastConstCheckpoint Checkpoint;
+    ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/false));
+    EXPECT_TRUE(Checkpoint.resumed().empty());
+    EXPECT_FALSE(Checkpoint.isDone(path("a.cpp")));
+  }
+  EastConstCheckpoint Checkpoint;
+  ASSERT_TRUE(Checkpoint.open(Path, /*Resume=*/true));
+  EXPECT_TRUE(Checkpoint.resumed().empty());
+}
+
+TEST_F(EastConstCheckpointTest, RejectsForeignFiles) {
+  append("not a checkpoint\n");
+  EastConstCheckpoint Checkpoint;
+  EXPECT_FALSE(Checkpoint.open(Path, /*Resume=*/true));
+}
@@ -0,0 +1,96 @@
+#include "EastConstTestHarness.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EastConstConcurrencyTest : public EastConstTestHarness {};
+
+namespace {
+
+const char *const kInput = R"cpp(
+    const int Global = 1;
+    typedef const char *CString;
+    struct Holder {
+      const int Member = 2;
+    };
+    const int &pick(const int &Value);
+  )cpp";
+
+const char *const kAllKindsExpected = R"cpp(
+    int const Global = 1;
+    typedef char const *CString;
+    struct Holder {
+      int const Member = 2;
+    };
+    int const &pick(int const &Value);
+  )cpp";
+
+const char *const kVariablesOnlyExpected = R"cpp(
+    int const Global = 1;
+    typedef const char *CString;
+    struct Holder {
+      const int Member = 2;
+    };
+    const int &pick(const int &Value);
+  )cpp";
+
+} // namespace
+
+// Each worker owns a checker with its own options; none of them touch
+// process-wide state, so the run must be race-free under
+// -DEAST_CONST_SANITIZE_THREAD=ON.
+TEST_F(EastConstConcurrencyTest, CheckersWithDifferentOptionsRunInParallel) {
+  constexpr unsigned kWorkers = 8;
+  constexpr unsigned kIterations = 4;
+
+  const std::string input = addStandardIncludes(kInput);
+  const std::string allKinds = addStandardIncludes(kAllKindsExpected);
+  const std::string variablesOnly =
+      addStandardIncludes(kVariablesOnlyExpected);
+
+  std::atomic<unsigned> mismatches{0};
+  std::vector<std::thread> workers;
+  for (unsigned worker = 0; worker < kWorkers; ++worker) {
+    workers.emplace_back([&, worker] {
+      EastConstCheckerOptions options;
+      options.Quiet = (worker % 2) == 0;
+      const bool restrictKinds = (worker % 3) == 0;
+      if (restrictKinds) {
+        options.EnabledDeclKinds = 0;
+        options.setEnabled(EastConstDeclKind::Variable, true);
+      }
+      const std::string &expected = restrictKinds ? variablesOnly : allKinds;
+      for (unsigned iteration = 0; iteration < kIterations; ++iteration) {
+        if (runToolOnCode(input, options) != expected)
+          ++mismatches;
+      }
+    });
+  }
+  for (std::thread &worker : workers)
+    worker.join();
+
+  EXPECT_EQ(mismatches.load(), 0u);
+}
+
+TEST_F(EastConstConcurrencyTest, DisabledDeclKindsAreLeftUntouched) {
+  EastConstCheckerOptions options;
+  options.Quiet = true;
+  ASSERT_TRUE(parseEastConstDeclKinds("variable", options.EnabledDeclKinds));
+  EXPECT_EQ(runToolOnCode(addStandardIncludes(kInput), options),
+            addStandardIncludes(kVariablesOnlyExpected));
+}
+
+TEST_F(EastConstConcurrencyTest, ParsesDeclKindLists) {
+  unsigned mask = 0;
+  EXPECT_TRUE(parseEastConstDeclKinds("parameter, return", mask));
+  EastConstCheckerOptions options;
+  options.EnabledDeclKinds = mask;
+  EXPECT_TRUE(options.isEnabled(EastConstDeclKind::Parameter));
+  EXPECT_TRUE(options.isEnabled(EastConstDeclKind::ReturnType));
+  EXPECT_FALSE(options.isEnabled(EastConstDeclKind::Variable));
+  EXPECT_TRUE(parseEastConstDeclKinds("all", mask));
+  EXPECT_EQ(mask, EastConstCheckerOptions::AllDeclKinds);
+  EXPECT_FALSE(parseEastConstDeclKinds("variable,bogus", mask));
+}
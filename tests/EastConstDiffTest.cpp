@@ -0,0 +1,132 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstDiff.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+#include <vector>
+
+using clang::tooling::Replacement;
+
+namespace {
+
+std::string diff(llvm::StringRef Original,
+                 const std::vector<Replacement> &Replaces,
+                 unsigned Context = 3) {
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  writeEastConstUnifiedDiff(OS, "f.cpp", Original, Replaces, Context);
+  return OS.str();
+}
+
+class EastConstDiffWriterTest : public EastConstTempDirTest {};
+
+} // namespace
+
+TEST(EastConstDiffTest, RewritesOneLine) {
+  EXPECT_EQ(diff("a\nconst int x;\nb\n", {Replacement("f.cpp", 2, 6, ""),
+                                          Replacement("f.cpp", 11, 0,
+                                                      " const")}),
+            "--- a/f.cpp\n"
+            "+++ b/f.cpp\n"
+            "@@ -1,3 +1,3 @@\n"
+            " a\n"
+            "-const int x;\n"
+            "+int const x;\n"
+            " b\n");
+}
+
+TEST(EastConstDiffTest, SplitsDistantChangesIntoHunks) {
+  std::string Original;
+  for (unsigned I = 0; I < 10; ++I)
+    Original += "l" + std::to_string(I) + "\n";
+  EXPECT_EQ(diff(Original,
+                 {Replacement("f.cpp", 0, 2, "L0"),
+                  Replacement("f.cpp", 27, 2, "L9")},
+                 /*Context=*/1),
+            "--- a/f.cpp\n"
+            "+++ b/f.cpp\n"
+            "@@ -1,2 +1,2 @@\n"
+            "-l0\n"
+            "+L0\n"
+            " l1\n"
+            "@@ -9,2 +9,2 @@\n"
+            " l8\n"
+            "-l9\n"
+            "+L9\n");
+  // With more context the two changes share one hunk.
+  EXPECT_EQ(diff(Original,
+                 {Replacement("f.cpp", 0, 2, "L0"),
+                  Replacement("f.cpp", 27, 2, "L9")},
+                 /*Context=*/4)
+                .find("\n@@", 24),
+            std::string::npos);
+}
+
+TEST(EastConstDiffTest, TracksLineCountChanges) {
+  EXPECT_EQ(diff("a\nb\nc\n", {Replacement("f.cpp", 2, 2, "")}),
+            "--- a/f.cpp\n"
+            "+++ b/f.cpp\n"
+            "@@ -1,3 +1,2 @@\n"
+            " a\n"
+            "-b\n"
+            " c\n");
+  EXPECT_EQ(diff("a\n", {Replacement("f.cpp", 2, 0, "b\n")}),
+            "--- a/f.cpp\n"
+            "+++ b/f.cpp\n"
+            "@@ -1,1 +1,2 @@\n"
+            "-a\n"
+            "+a\n"
+            "+b\n");
+}
+
+TEST(EastConstDiffTest, MarksMissingFinalNewline) {
+  EXPECT_EQ(diff("x", {Replacement("f.cpp", 0, 1, "y")}),
+            "--- a/f.cpp\n"
+            "+++ b/f.cpp\n"
+            "@@ -1,1 +1,1 @@\n"
+            "-x\n"
+            "\\ No newline at end of file\n"
+            "+y\n"
+            "\\ No newline at end of file\n");
+  EXPECT_EQ(diff("x", {}), "");
+}
+
+TEST_F(EastConstDiffWriterTest, KeepsTheGivenOrder) {
+  std::vector<std::string> Files;
+  for (const char *Name : {"a.cpp", "b.cpp", "c.cpp"})
+    Files.push_back(
+        writeFile(Name, "const int " + std::string(1, Name[0]) + " = 0;\n"));
+  auto fix = [](const std::string &File) {
+    return std::vector<Replacement>{Replacement(File, 0, 6, ""),
+                                    Replacement(File, 9, 0, " const")};
+  };
+
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  {
+    EastConstDiffWriter Writer(OS, {"a", "b", "c"}, Root);
+    Writer.complete("c", Files[2], fix(Files[2]));
+    Writer.complete("b", Files[1], fix(Files[1]));
+    EXPECT_TRUE(OS.str().empty());
+    Writer.complete("a", Files[0], {});
+    EXPECT_EQ(Writer.filesWritten(), 2u);
+    Writer.finish();
+    // Already written; not repeated.
+    EXPECT_TRUE(Writer.write(Files[1], fix(Files[1])));
+    EXPECT_EQ(Writer.filesWritten(), 2u);
+  }
+
+  EXPECT_EQ(OS.str(), "--- a/b.cpp\n"
+                      "+++ b/b.cpp\n"
+                      "@@ -1,1 +1,1 @@\n"
+                      "-const int b = 0;\n"
+                      "+int const b = 0;\n"
+                      "--- a/c.cpp\n"
+                      "+++ b/c.cpp\n"
+                      "@@ -1,1 +1,1 @@\n"
+                      "-const int c = 0;\n"
+                      "+int const c = 0;\n");
+}
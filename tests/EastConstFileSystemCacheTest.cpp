@@ -0,0 +1,156 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstAstEngine.h>
+#include <EastConstEnforcer.h>
+#include <EastConstFileSystemCache.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/VirtualFileSystem.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> makeDisk() {
+  auto Disk = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  Disk->addFile("/src/a.h", 0, llvm::MemoryBuffer::getMemBuffer("int a;"));
+  Disk->addFile("/src/sub/b.h", 0,
+                llvm::MemoryBuffer::getMemBuffer("int b;"));
+  return Disk;
+}
+
+class EastConstFileSystemCacheEngineTest : public EastConstTempDirTest {};
+
+} // namespace
+
+TEST(EastConstFileSystemCacheTest, CachesStatsIncludingMisses) {
+  EastConstFileSystemCache Cache;
+  auto FS = createEastConstCachingFileSystem(Cache, makeDisk());
+
+  EXPECT_TRUE(FS->status("/src/a.h"));
+  EXPECT_TRUE(FS->status("/src/a.h"));
+  EXPECT_FALSE(FS->status("/src/missing.h"));
+  EXPECT_FALSE(FS->status("/src/missing.h"));
+  EXPECT_FALSE(FS->openFileForRead("/src/missing.h"));
+
+  EastConstFileSystemCacheStats Stats = Cache.getStats();
+  EXPECT_EQ(Stats.StatMisses, 2u);
+  EXPECT_EQ(Stats.StatHits, 2u);
+  EXPECT_EQ(Stats.NegativeHits, 2u);
+}
+
+TEST(EastConstFileSystemCacheTest, SharesContentsAcrossWorkingDirectories) {
+  EastConstFileSystemCache Cache;
+  auto Disk = makeDisk();
+  auto First = createEastConstCachingFileSystem(Cache, Disk);
+  auto Second = createEastConstCachingFileSystem(Cache, Disk);
+  ASSERT_FALSE(First->setCurrentWorkingDirectory("/src"));
+  ASSERT_FALSE(Second->setCurrentWorkingDirectory("/src/sub"));
+
+  auto FirstBuffer = First->getBufferForFile("a.h");
+  ASSERT_TRUE(FirstBuffer);
+  EXPECT_EQ((*FirstBuffer)->getBuffer(), "int a;");
+  auto SecondBuffer = Second->getBufferForFile("../a.h");
+  ASSERT_TRUE(SecondBuffer);
+  EXPECT_EQ((*SecondBuffer)->getBuffer(), "int a;");
+
+  // The status keeps the name it was requested under.
+  auto Status = Second->status("../a.h");
+  ASSERT_TRUE(Status);
+  EXPECT_EQ(Status->getName(), "../a.h");
+
+  EastConstFileSystemCacheStats Stats = Cache.getStats();
+  EXPECT_EQ(Stats.ContentMisses, 1u);
+  EXPECT_EQ(Stats.ContentHits, 1u);
+  EXPECT_EQ(Stats.ContentBytes, 6u);
+}
+
+TEST(EastConstFileSystemCacheTest, ReadsSkippedFilesFromTheFileSystem) {
+  EastConstFileSystemCache Cache;
+  auto Disk = makeDisk();
+  auto FS = createEastConstCachingFileSystem(Cache, Disk);
+  Cache.skipContents("/src/a.h");
+
+  for (int Read = 0; Read < 2; ++Read) {
+    auto Buffer = FS->getBufferForFile("/src/a.h");
+    ASSERT_TRUE(Buffer);
+    EXPECT_EQ((*Buffer)->getBuffer(), "int a;");
+  }
+  EXPECT_TRUE(FS->getBufferForFile("/src/sub/b.h"));
+
+  EastConstFileSystemCacheStats Stats = Cache.getStats();
+  EXPECT_EQ(Stats.UncachedReads, 2u);
+  EXPECT_EQ(Stats.ContentHits, 0u);
+  EXPECT_EQ(Stats.ContentMisses, 1u);
+  EXPECT_EQ(Stats.ContentBytes, 6u);
+}
+
+TEST_F(EastConstFileSystemCacheEngineTest, WorkersShareTheCache) {
+  std::string Common = "#pragma once\nstruct Common { int V; };\n";
+  writeFile("common.h", Common);
+  std::vector<std::string> Sources;
+  for (char Name = 'a'; Name <= 'f'; ++Name)
+    Sources.push_back(writeFile(std::string(1, Name) + ".cpp",
+                                "#include \"common.h\"\nconst int " +
+                                    std::string(1, Name) + " = 2;\n"));
+
+  std::mutex Lock;
+  std::map<std::string, unsigned> Removals;
+  EastConstCheckerOptions Options;
+  Options.Quiet = true;
+  ReplacementHandler Handler = [&](const clang::SourceManager &SM,
+                                   clang::CharSourceRange Range,
+                                   llvm::StringRef NewText) {
+    if (!NewText.empty())
+      return;
+    clang::tooling::Replacement Rep(SM, Range, NewText);
+    std::lock_guard<std::mutex> Guard(Lock);
+    ++Removals[llvm::sys::path::filename(Rep.getFilePath()).str()];
+  };
+  struct Worker {
+    Worker(ReplacementHandler Handler, EastConstCheckerOptions Options)
+        : Checker(std::move(Handler), Options) {
+      registerEastConstMatchers(Finder, &Checker);
+      Factory = clang::tooling::newFrontendActionFactory(&Finder);
+    }
+    EastConstChecker Checker;
+    clang::ast_matchers::MatchFinder Finder;
+    std::unique_ptr<clang::tooling::FrontendActionFactory> Factory;
+  };
+  std::vector<std::unique_ptr<Worker>> Workers;
+
+  EastConstFileSystemCache Cache;
+  EastConstAstEngineOptions EngineOptions;
+  EngineOptions.Jobs = 3;
+  EngineOptions.FileSystemCache = &Cache;
+  EastConstAstEngineStats Stats;
+  clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                        {"-std=c++17"});
+  EXPECT_EQ(runEastConstAstEngine(
+                Compilations, Sources, EngineOptions,
+                [&](unsigned) -> clang::tooling::FrontendActionFactory & {
+                  Workers.push_back(std::make_unique<Worker>(Handler, Options));
+                  return *Workers.back()->Factory;
+                },
+                Stats),
+            0);
+
+  EXPECT_EQ(Stats.Workers, 3u);
+  EXPECT_EQ(Stats.TranslationUnits, 6u);
+  EXPECT_EQ(Stats.Failed, 0u);
+  for (char Name = 'a'; Name <= 'f'; ++Name)
+    EXPECT_EQ(Removals[std::string(1, Name) + ".cpp"], 1u);
+  // Only workers racing for the first read of the header miss the cache.
+  EastConstFileSystemCacheStats FsStats = Cache.getStats();
+  EXPECT_GE(FsStats.ContentHits, Sources.size() - Stats.Workers);
+  EXPECT_GT(FsStats.StatHits, 0u);
+  // The sources themselves are read past the cache; only the header stays.
+  EXPECT_GE(FsStats.UncachedReads, Sources.size());
+  EXPECT_EQ(FsStats.ContentBytes, Common.size());
+}
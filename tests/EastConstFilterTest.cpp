@@ -0,0 +1,133 @@
+#include <EastConstFilter.h>
+#include <gtest/gtest.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+clang::tooling::FixedCompilationDatabase makeCompilations() {
+  return clang::tooling::FixedCompilationDatabase(
+      ".", std::vector<std::string>{"-std=c++17"});
+}
+
+EastConstCheckerOptions quietOptions() {
+  EastConstCheckerOptions Options;
+  Options.Quiet = true;
+  return Options;
+}
+
+// A stdin stand-in holding Contents.
+std::FILE *makeInput(llvm::StringRef Contents) {
+  std::FILE *In = std::tmpfile();
+  if (!In)
+    return nullptr;
+  std::fwrite(Contents.data(), 1, Contents.size(), In);
+  std::rewind(In);
+  return In;
+}
+
+} // namespace
+
+TEST(EastConstFilterTest, RewritesABufferWithoutAFile) {
+  auto Compilations = makeCompilations();
+  std::string Output;
+  EXPECT_TRUE(rewriteEastConstBuffer(Compilations, "not-on-disk.cpp",
+                                     "const int *p;\n", quietOptions(), {},
+                                     Output));
+  EXPECT_EQ(Output, "int const *p;\n");
+}
+
+TEST(EastConstFilterTest, StripsARelativelySpelledInput) {
+  // The command names the input relative to its directory; Filename is
+  // absolute, as compile_commands.json files often have it.
+  class RelativeInputDatabase : public clang::tooling::CompilationDatabase {
+  public:
+    std::vector<clang::tooling::CompileCommand>
+    getCompileCommands(llvm::StringRef) const override {
+      llvm::SmallString<256> Directory;
+      llvm::sys::fs::current_path(Directory);
+      llvm::SmallString<256> File(Directory);
+      llvm::sys::path::append(File, "sub", "gen.cpp");
+      return {clang::tooling::CompileCommand(
+          Directory, File,
+          {"clang++", "-std=c++17", "-c", "sub/gen.cpp", "-o", "gen.o"},
+          "gen.o")};
+    }
+  } Compilations;
+  std::string Output;
+  EXPECT_TRUE(rewriteEastConstBuffer(Compilations, "sub/gen.cpp",
+                                     "const int *p;\n", quietOptions(), {},
+                                     Output));
+  EXPECT_EQ(Output, "int const *p;\n");
+}
+
+TEST(EastConstFilterTest, PassesBrokenSourceThrough) {
+  auto Compilations = makeCompilations();
+  std::string Output;
+  EXPECT_FALSE(rewriteEastConstBuffer(Compilations, "broken.cpp",
+                                      "const int *p = ;\n", quietOptions(),
+                                      {}, Output));
+  EXPECT_EQ(Output, "const int *p = ;\n");
+}
+
+TEST(EastConstFilterTest, FiltersAllOfTheInput) {
+  auto Compilations = makeCompilations();
+  std::FILE *In = makeInput("const char *Name;\n");
+  ASSERT_TRUE(In);
+  std::string Text;
+  llvm::raw_string_ostream Out(Text);
+  EXPECT_EQ(runEastConstFilter(In, Out, Compilations, "gen.cpp",
+                               /*Framed=*/false, quietOptions(), {}),
+            0);
+  std::fclose(In);
+  EXPECT_EQ(Out.str(), "char const *Name;\n");
+}
+
+TEST(EastConstFilterTest, AnswersEachFrame) {
+  auto Compilations = makeCompilations();
+  std::string Stream;
+  llvm::raw_string_ostream Frames(Stream);
+  writeEastConstFrame(Frames, "a.cpp", "const int a = 1;\n");
+  writeEastConstFrame(Frames, "", "int b;\n");
+  writeEastConstFrame(Frames, "c.cpp", "");
+  std::FILE *In = makeInput(Frames.str());
+  ASSERT_TRUE(In);
+  std::string Text;
+  llvm::raw_string_ostream Out(Text);
+  EXPECT_EQ(runEastConstFilter(In, Out, Compilations, "gen.cpp",
+                               /*Framed=*/true, quietOptions(), {}),
+            0);
+  std::fclose(In);
+  EXPECT_EQ(Out.str(), "17 a.cpp\nint const a = 1;\n"
+                       "7\nint b;\n"
+                       "0 c.cpp\n");
+}
+
+TEST(EastConstFilterTest, RejectsATruncatedFrame) {
+  std::FILE *In = makeInput("100 a.cpp\nint a;\n");
+  ASSERT_TRUE(In);
+  std::string FileName, Contents, Error;
+  EXPECT_FALSE(readEastConstFrame(In, FileName, Contents, Error));
+  EXPECT_FALSE(Error.empty());
+  std::fclose(In);
+
+  In = makeInput("x a.cpp\n");
+  ASSERT_TRUE(In);
+  EXPECT_FALSE(readEastConstFrame(In, FileName, Contents, Error));
+  EXPECT_NE(Error.find("malformed"), std::string::npos);
+  std::fclose(In);
+
+  In = makeInput("");
+  ASSERT_TRUE(In);
+  EXPECT_FALSE(readEastConstFrame(In, FileName, Contents, Error));
+  EXPECT_TRUE(Error.empty());
+  std::fclose(In);
+}
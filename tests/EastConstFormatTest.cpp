@@ -0,0 +1,80 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstFormat.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using clang::tooling::Replacement;
+using clang::tooling::Replacements;
+
+namespace {
+
+class EastConstFormatTest : public EastConstTempDirTest {
+protected:
+  void SetUp() override {
+    ASSERT_NO_FATAL_FAILURE(EastConstTempDirTest::SetUp());
+    // Pin the style so the host's configuration does not leak in.
+    writeFile(".clang-format", "BasedOnStyle: LLVM\n");
+  }
+};
+
+// The middle line is the only one touched; its leftover spacing goes, the
+// badly formatted lines around it stay.
+constexpr llvm::StringLiteral Code = "int   a ;\n"
+                                     "const int   *p;\n"
+                                     "int    b ;\n";
+
+} // namespace
+
+TEST_F(EastConstFormatTest, ReformatsOnlyTheFixedLines) {
+  std::string File = writeFile("a.cpp", Code);
+  Replacements Fixes;
+  ASSERT_FALSE(static_cast<bool>(Fixes.add(Replacement(File, 10, 6, ""))));
+  ASSERT_FALSE(
+      static_cast<bool>(Fixes.add(Replacement(File, 19, 0, " const"))));
+  EastConstRangeFormatter Formatter;
+  llvm::Expected<Replacements> Formatted =
+      Formatter.format(File, Code, Fixes);
+  ASSERT_TRUE(static_cast<bool>(Formatted))
+      << llvm::toString(Formatted.takeError());
+  llvm::Expected<std::string> Result =
+      clang::tooling::applyAllReplacements(Code, *Formatted);
+  ASSERT_TRUE(static_cast<bool>(Result)) << llvm::toString(Result.takeError());
+  EXPECT_EQ(*Result, "int   a ;\n"
+                     "int const *p;\n"
+                     "int    b ;\n");
+}
+
+TEST_F(EastConstFormatTest, FormatsFixesAgainstTheFileOnDisk) {
+  std::string File = writeFile("a.cpp", Code);
+  EastConstRangeFormatter Formatter;
+  llvm::Expected<std::vector<Replacement>> Formatted = Formatter.formatFile(
+      File, {Replacement(File, 10, 6, ""), Replacement(File, 19, 0, " const")});
+  ASSERT_TRUE(static_cast<bool>(Formatted))
+      << llvm::toString(Formatted.takeError());
+  Replacements Edits;
+  for (const Replacement &Rep : *Formatted)
+    ASSERT_FALSE(static_cast<bool>(Edits.add(Rep)));
+  llvm::Expected<std::string> Result =
+      clang::tooling::applyAllReplacements(Code, Edits);
+  ASSERT_TRUE(static_cast<bool>(Result)) << llvm::toString(Result.takeError());
+  EXPECT_EQ(*Result, "int   a ;\n"
+                     "int const *p;\n"
+                     "int    b ;\n");
+
+  llvm::Expected<std::vector<Replacement>> Nothing =
+      Formatter.formatFile(File, {});
+  ASSERT_TRUE(static_cast<bool>(Nothing));
+  EXPECT_TRUE(Nothing->empty());
+}
+
+TEST_F(EastConstFormatTest, RejectsConflictingFixes) {
+  std::string File = writeFile("a.cpp", Code);
+  EastConstRangeFormatter Formatter;
+  llvm::Expected<std::vector<Replacement>> Formatted = Formatter.formatFile(
+      File, {Replacement(File, 10, 6, ""), Replacement(File, 12, 2, "x")});
+  EXPECT_FALSE(static_cast<bool>(Formatted));
+  llvm::consumeError(Formatted.takeError());
+}
@@ -0,0 +1,68 @@
+#include "EastConstTestHarness.h"
+
+#include <string>
+
+class EastConstFrontendTest : public EastConstTestHarness {
+protected:
+  static EastConstCheckerOptions quietOptions() {
+    EastConstCheckerOptions options;
+    options.Quiet = true;
+    return options;
+  }
+};
+
+namespace {
+
+const char *const kSource = R"cpp(
+struct Widget {
+  const int id;
+  const std::string &name() const;
+};
+
+int count(const std::vector<int> &items, const Widget *w) {
+  const int local = 0;
+  for (const auto &item : items) {
+    const Widget *other = w;
+  }
+  return local;
+}
+
+template <typename T> const T &first(const std::vector<T> &items) {
+  const T *data = nullptr;
+  return *data;
+}
+)cpp";
+
+} // namespace
+
+TEST_F(EastConstFrontendTest, FastProfileMatchesFullParse) {
+  const std::string input = addStandardIncludes(kSource);
+  EastConstFrontendOptions fast;
+  fast.Fast = true;
+  EXPECT_EQ(runToolOnCode(input, quietOptions(), fast),
+            runToolOnCode(input, quietOptions(), EastConstFrontendOptions()));
+}
+
+TEST_F(EastConstFrontendTest, SkippingMainFileBodiesKeepsTheApiSurface) {
+  EastConstFrontendOptions apiOnly;
+  apiOnly.SkipMainFileBodies = true;
+  const std::string input = addStandardIncludes(R"cpp(
+struct Widget {
+  const int id;
+};
+const int limit(const Widget &w) {
+  const int local = w.id;
+  return local;
+}
+)cpp");
+  const std::string expected = addStandardIncludes(R"cpp(
+struct Widget {
+  int const id;
+};
+int const limit(Widget const &w) {
+  const int local = w.id;
+  return local;
+}
+)cpp");
+  EXPECT_EQ(runToolOnCode(input, quietOptions(), apiOnly), expected);
+}
@@ -1,5 +1,7 @@
 #include "EastConstTestHarness.h"
 
+#include <EastConstLogging.h>
+
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
@@ -15,14 +17,20 @@ namespace {
 
 std::optional<std::string> gDumpConstGridPath;
 bool gHarnessVerboseFlag = false;
+bool gHarnessFastFrontendFlag = false;
 
 bool HandleCustomFlag(std::string_view arg) {
   constexpr std::string_view kDumpPrefix = "--dump-const-grid=";
   constexpr std::string_view kHarnessVerbose = "--east-const-test-verbose";
+  constexpr std::string_view kHarnessFastFrontend = "--fast-frontend";
   if (arg == kHarnessVerbose) {
     gHarnessVerboseFlag = true;
     return true;
   }
+  if (arg == kHarnessFastFrontend) {
+    gHarnessFastFrontendFlag = true;
+    return true;
+  }
 
   const bool hasPrefix = arg.size() >= kDumpPrefix.size() &&
                          arg.substr(0, kDumpPrefix.size()) == kDumpPrefix;
@@ -513,6 +521,9 @@ TEST_F(EastConstGridCodeGenTest, GeneratedConstGrid) {
 int main(int argc, char **argv) {
   StripCustomFlags(argc, argv);
   setEastConstHarnessVerbose(gHarnessVerboseFlag);
+  eastConstHarnessFrontendOptions().Fast = gHarnessFastFrontendFlag;
+  if (gHarnessVerboseFlag)
+    setEastConstLogLevel(EastConstLogLevel::Trace);
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
 }
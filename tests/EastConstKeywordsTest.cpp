@@ -0,0 +1,43 @@
+#include <EastConstKeywords.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(EastConstKeywordsTest, ClassifiesEveryKeyword) {
+  for (const auto &Entry : east_const_detail::Keywords) {
+    EXPECT_EQ(classifyEastConstKeyword(Entry.Spelling), Entry.Class)
+        << Entry.Spelling;
+  }
+}
+
+TEST(EastConstKeywordsTest, QualifierSpellings) {
+  EXPECT_EQ(classifyEastConstKeyword("const"), EastConstKeywordClass::Const);
+  EXPECT_EQ(classifyEastConstKeyword("__const__"),
+            EastConstKeywordClass::Const);
+  EXPECT_EQ(classifyEastConstKeyword("__volatile"),
+            EastConstKeywordClass::Volatile);
+  EXPECT_EQ(classifyEastConstKeyword("__restrict__"),
+            EastConstKeywordClass::Restrict);
+  EXPECT_EQ(classifyEastConstKeyword("thread_local"),
+            EastConstKeywordClass::IgnorableSpecifier);
+}
+
+TEST(EastConstKeywordsTest, RejectsLookalikes) {
+  for (const char *Text :
+       {"", "T", "int", "cons", "Const", "consts", "constant", "const_",
+        "_const", "__const_", "volatile_t", "restricted", "statics",
+        "inline_", "externs", "thread_locals", "__restrict___", "typedefs",
+        "constexpr1", "xxxxx", "#####"}) {
+    EXPECT_EQ(classifyEastConstKeyword(Text), EastConstKeywordClass::Other)
+        << Text;
+  }
+}
+
+TEST(EastConstKeywordsTest, ReadsOnlyTheGivenRange) {
+  // A prefix of a longer buffer must be judged on its own length.
+  std::string Buffer = "constexpr";
+  EXPECT_EQ(classifyEastConstKeyword(llvm::StringRef(Buffer.data(), 5)),
+            EastConstKeywordClass::Const);
+  EXPECT_EQ(classifyEastConstKeyword(llvm::StringRef(Buffer.data(), 6)),
+            EastConstKeywordClass::Other);
+}
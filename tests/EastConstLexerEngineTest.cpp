@@ -0,0 +1,197 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstLexerEngine.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+class EastConstLexerEngineTest : public EastConstTestHarness {
+protected:
+  static std::vector<LexerEngineSite>
+  scan(const std::string &Code, const EastConstCheckerOptions &Options = {}) {
+    return scanWestConstSites("test.cpp", Code, getLexerEngineLangOptions(),
+                              Options);
+  }
+
+  static std::string rewrite(const std::string &Code,
+                             const EastConstCheckerOptions &Options = {}) {
+    std::vector<LexerEngineSite> Sites = scan(Code, Options);
+    llvm::Expected<std::string> Result = clang::tooling::applyAllReplacements(
+        Code, buildLexerEngineReplacements("test.cpp", Sites));
+    if (!Result) {
+      ADD_FAILURE() << llvm::toString(Result.takeError());
+      return Code;
+    }
+    return *Result;
+  }
+};
+
+TEST_F(EastConstLexerEngineTest, RewritesSimpleDeclarations) {
+  EXPECT_EQ(rewrite("const int a = 1;\n"
+                    "static const char *const name = \"x\";\n"
+                    "const static int b = 2;\n"
+                    "const volatile unsigned long c = 3;\n"),
+            "int const a = 1;\n"
+            "static char const *const name = \"x\";\n"
+            "static int const b = 2;\n"
+            "unsigned long const volatile c = 3;\n");
+}
+
+TEST_F(EastConstLexerEngineTest, KeepsSpecifiersBetweenQualifiers) {
+  EXPECT_EQ(rewrite("const static volatile int x = 1;\n"),
+            "static int const volatile x = 1;\n");
+}
+
+TEST_F(EastConstLexerEngineTest, MovesFromTheFirstConst) {
+  EXPECT_EQ(rewrite("volatile const int x = 1;\n"),
+            "volatile int const x = 1;\n");
+}
+
+TEST_F(EastConstLexerEngineTest, ClassifiesDeclKinds) {
+  std::vector<LexerEngineSite> Sites =
+      scan("const int v = 0;\n"
+           "const int &f(const int p);\n"
+           "struct S { const int m; static const int s = 1; };\n"
+           "typedef const int T;\n"
+           "using A = const int;\n"
+           "template <const int N> struct Q {};\n"
+           "template <> struct Q2<const int> {};\n");
+  std::vector<EastConstDeclKind> Kinds;
+  for (const LexerEngineSite &Site : Sites)
+    Kinds.push_back(Site.Kind);
+  EXPECT_EQ(Kinds, (std::vector<EastConstDeclKind>{
+                       EastConstDeclKind::Variable,
+                       EastConstDeclKind::ReturnType,
+                       EastConstDeclKind::Parameter,
+                       EastConstDeclKind::Field,
+                       EastConstDeclKind::Variable,
+                       EastConstDeclKind::Typedef,
+                       EastConstDeclKind::TypeAlias,
+                       EastConstDeclKind::NonTypeTemplateParm,
+                       EastConstDeclKind::TemplateArgument,
+                   }));
+}
+
+TEST_F(EastConstLexerEngineTest, TemplateArgumentsTakeTheOwningDeclKind) {
+  std::vector<LexerEngineSite> Sites =
+      scan("void f(vector<vector<const int>> p);\n");
+  ASSERT_EQ(Sites.size(), 1u);
+  EXPECT_EQ(Sites[0].Kind, EastConstDeclKind::Parameter);
+  EXPECT_EQ(rewrite("void f(vector<vector<const int>> p);\n"),
+            "void f(vector<vector<int const>> p);\n");
+  EXPECT_EQ(rewrite("void f(vector<const vector<int>> p);\n"),
+            "void f(vector<vector<int> const> p);\n");
+}
+
+TEST_F(EastConstLexerEngineTest, AmbiguousSitesAreReportedButNotRewritten) {
+  const std::string Code = "void g() {\n"
+                           "  auto c = const_cast<const int *>(p);\n"
+                           "  int w = (const int)3;\n"
+                           "  MACRO const int q = 1;\n"
+                           "}\n";
+  std::vector<LexerEngineSite> Sites = scan(Code);
+  ASSERT_EQ(Sites.size(), 3u);
+  for (const LexerEngineSite &Site : Sites) {
+    EXPECT_TRUE(Site.NeedsSemanticCheck);
+    EXPECT_FALSE(Site.AmbiguityReason.empty());
+  }
+  EXPECT_EQ(rewrite(Code), Code);
+}
+
+TEST_F(EastConstLexerEngineTest, IgnoresEastConstDirectivesAndMethodQualifiers) {
+  const std::string Code = "#define X const int\n"
+                           "int const a = 0;\n"
+                           "struct S { int get() const; };\n"
+                           "const_iterator it;\n";
+  EXPECT_TRUE(scan(Code).empty());
+}
+
+TEST_F(EastConstLexerEngineTest, ReportsLinesAndColumns) {
+  std::vector<LexerEngineSite> Sites = scan("int x;\n  const int y = 0;\n");
+  ASSERT_EQ(Sites.size(), 1u);
+  EXPECT_EQ(Sites[0].Line, 2u);
+  EXPECT_EQ(Sites[0].Column, 3u);
+}
+
+TEST_F(EastConstLexerEngineTest, HonoursDisabledDeclKinds) {
+  EastConstCheckerOptions Options;
+  Options.setEnabled(EastConstDeclKind::Parameter, false);
+  EXPECT_EQ(rewrite("const int f(const int p);\n", Options),
+            "int const f(const int p);\n");
+}
+
+TEST_F(EastConstLexerEngineTest, AgreesWithTheAstEngine) {
+  const std::string Code =
+      addStandardIncludes("const int global = 1;\n"
+                          "struct Widget {\n"
+                          "  const int id;\n"
+                          "  const std::string &name() const;\n"
+                          "};\n"
+                          "typedef const char *CStr;\n"
+                          "using Ref = const Widget &;\n"
+                          "int count(const std::vector<int> &items,\n"
+                          "          const Widget *w) {\n"
+                          "  const int local = 0;\n"
+                          "  for (const auto &item : items) {}\n"
+                          "  return local;\n"
+                          "}\n");
+  EXPECT_EQ(rewrite(Code), runToolOnCode(Code));
+}
+
+TEST_F(EastConstLexerEngineTest, AgreesWithTheAstEngineOnQualifierRuns) {
+  const std::string Code =
+      addStandardIncludes("volatile const int a = 1;\n"
+                          "const static volatile int b = 2;\n"
+                          "const volatile int c = 3;\n");
+  EXPECT_EQ(rewrite(Code), runToolOnCode(Code));
+}
+
+TEST(EastConstLexerEngineAgreementTest, CountsEachOutcome) {
+  std::vector<LexerEngineSite> Sites(3);
+  Sites[0].QualifierOffset = 10;
+  Sites[1].QualifierOffset = 20;
+  Sites[2].QualifierOffset = 30;
+  Sites[2].NeedsSemanticCheck = true;
+
+  LexerEngineAgreement Agreement =
+      compareLexerEngineSites(Sites, std::vector<unsigned>{10, 30, 40});
+  EXPECT_EQ(Agreement.Confirmed, 1u);
+  EXPECT_EQ(Agreement.FalsePositives, 1u);
+  EXPECT_EQ(Agreement.AmbiguousConfirmed, 1u);
+  EXPECT_EQ(Agreement.AmbiguousRejected, 0u);
+  EXPECT_EQ(Agreement.Missed, 1u);
+  EXPECT_DOUBLE_EQ(Agreement.agreementRatio(), 0.5);
+}
+
+TEST(EastConstLexerEngineAgreementTest, MatchesEveryRunOfASite) {
+  // `const static volatile int`: the checker removes both runs.
+  std::vector<LexerEngineSite> Sites(1);
+  Sites[0].QualifierOffset = 0;
+  Sites[0].Removals = {{0, 6}, {13, 9}};
+
+  LexerEngineAgreement Agreement =
+      compareLexerEngineSites(Sites, std::vector<unsigned>{0, 13});
+  EXPECT_EQ(Agreement.Confirmed, 1u);
+  EXPECT_EQ(Agreement.Missed, 0u);
+}
+
+TEST(EastConstLexerEngineReplacementsTest, AddsASiteWholeOrNotAtAll) {
+  std::vector<LexerEngineSite> Sites(2);
+  Sites[0].Removals = {{0, 6}};
+  Sites[0].InsertOffset = 9;
+  Sites[0].Suffix = " const";
+  // Its second removal overlaps the first site's.
+  Sites[1].Removals = {{20, 6}, {2, 2}};
+  Sites[1].InsertOffset = 30;
+  Sites[1].Suffix = " const";
+
+  clang::tooling::Replacements Result =
+      buildLexerEngineReplacements("test.cpp", Sites);
+  EXPECT_EQ(Result.size(), 2u);
+  for (const clang::tooling::Replacement &Rep : Result)
+    EXPECT_LT(Rep.getOffset(), 10u);
+}
+
+} // namespace
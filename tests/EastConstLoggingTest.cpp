@@ -0,0 +1,72 @@
+#include <EastConstLogging.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+namespace {
+
+class EastConstLoggingTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    SavedLevel = getEastConstLogLevel();
+    setEastConstLogSink(&Sink);
+  }
+
+  void TearDown() override {
+    setEastConstLogSink(nullptr);
+    setEastConstLogLevel(SavedLevel);
+  }
+
+  std::string Captured;
+  llvm::raw_string_ostream Sink{Captured};
+  EastConstLogLevel SavedLevel = EastConstLogLevel::Info;
+};
+
+int countedValue(int &Evaluations) {
+  ++Evaluations;
+  return 42;
+}
+
+} // namespace
+
+TEST_F(EastConstLoggingTest, DisabledLevelsDoNotEvaluateArguments) {
+  setEastConstLogLevel(EastConstLogLevel::Info);
+  int Evaluations = 0;
+  EAST_CONST_LOG(Trace, "value " << countedValue(Evaluations));
+  EAST_CONST_LOG(Debug, "value " << countedValue(Evaluations));
+  flushEastConstLog();
+  EXPECT_EQ(Evaluations, 0);
+  EXPECT_TRUE(Captured.empty());
+}
+
+TEST_F(EastConstLoggingTest, BuffersUntilFlushed) {
+  setEastConstLogLevel(EastConstLogLevel::Info);
+  EAST_CONST_LOG(Info, "first " << 1);
+  EAST_CONST_LOG(Info, "second " << 2);
+  EXPECT_TRUE(Captured.empty());
+  flushEastConstLog();
+  EXPECT_EQ(Captured, "first 1\nsecond 2\n");
+}
+
+TEST_F(EastConstLoggingTest, ErrorsFlushImmediately) {
+  setEastConstLogLevel(EastConstLogLevel::Warning);
+  EAST_CONST_LOG(Info, "hidden");
+  EAST_CONST_LOG(Error, "broken " << "file");
+  EXPECT_EQ(Captured, "broken file\n");
+}
+
+TEST_F(EastConstLoggingTest, WorkerThreadBuffersFlushOnExit) {
+  setEastConstLogLevel(EastConstLogLevel::Info);
+  std::thread Worker([] { EAST_CONST_LOG(Info, "from worker"); });
+  Worker.join();
+  EXPECT_EQ(Captured, "from worker\n");
+}
+
+TEST_F(EastConstLoggingTest, ParsesLevelNames) {
+  EastConstLogLevel Level = EastConstLogLevel::Info;
+  EXPECT_TRUE(parseEastConstLogLevel("TRACE", Level));
+  EXPECT_EQ(Level, EastConstLogLevel::Trace);
+  EXPECT_FALSE(parseEastConstLogLevel("verbose", Level));
+  EXPECT_EQ(Level, EastConstLogLevel::Trace);
+}
@@ -0,0 +1,259 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstLsp.h>
+#include <gtest/gtest.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A stdin stand-in holding Contents.
+std::FILE *makeInput(llvm::StringRef Contents) {
+  std::FILE *In = std::tmpfile();
+  if (!In)
+    return nullptr;
+  std::fwrite(Contents.data(), 1, Contents.size(), In);
+  std::rewind(In);
+  return In;
+}
+
+// Splits what the server wrote into its messages and clears it.
+std::vector<llvm::json::Value> takeMessages(std::string &Stream) {
+  std::vector<llvm::json::Value> Messages;
+  llvm::StringRef Rest(Stream);
+  while (!Rest.empty()) {
+    auto [Header, Body] = Rest.split("\r\n\r\n");
+    std::size_t Length = 0;
+    EXPECT_TRUE(Header.consume_front("Content-Length: "));
+    EXPECT_FALSE(Header.getAsInteger(10, Length));
+    llvm::Expected<llvm::json::Value> Message =
+        llvm::json::parse(Body.take_front(Length));
+    if (!Message) {
+      ADD_FAILURE() << llvm::toString(Message.takeError());
+      break;
+    }
+    Messages.push_back(std::move(*Message));
+    Rest = Body.drop_front(Length);
+  }
+  Stream.clear();
+  return Messages;
+}
+
+// The start lines of the diagnostics in a publishDiagnostics message.
+std::vector<std::int64_t> diagnosticLines(const llvm::json::Value &Message) {
+  std::vector<std::int64_t> Lines;
+  const llvm::json::Object *Params =
+      Message.getAsObject()->getObject("params");
+  for (const llvm::json::Value &Diagnostic :
+       *Params->getArray("diagnostics"))
+    Lines.push_back(*Diagnostic.getAsObject()
+                         ->getObject("range")
+                         ->getObject("start")
+                         ->getInteger("line"));
+  return Lines;
+}
+
+// Applies single-line ASCII edits, as an editor would.
+std::string applyEdits(std::string Text, const llvm::json::Array &Edits) {
+  struct Edit {
+    std::size_t Offset;
+    std::size_t Length;
+    std::string NewText;
+  };
+  auto Offset = [&](const llvm::json::Object &Position) {
+    std::size_t Start = 0;
+    for (std::int64_t Line = *Position.getInteger("line"); Line > 0; --Line)
+      Start = Text.find('\n', Start) + 1;
+    return Start + *Position.getInteger("character");
+  };
+  std::vector<Edit> Sorted;
+  for (const llvm::json::Value &Value : Edits) {
+    const llvm::json::Object &Object = *Value.getAsObject();
+    const llvm::json::Object *Range = Object.getObject("range");
+    std::size_t Begin = Offset(*Range->getObject("start"));
+    Sorted.push_back({Begin, Offset(*Range->getObject("end")) - Begin,
+                      Object.getString("newText")->str()});
+  }
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const Edit &A, const Edit &B) { return A.Offset > B.Offset; });
+  for (const Edit &E : Sorted)
+    Text.replace(E.Offset, E.Length, E.NewText);
+  return Text;
+}
+
+llvm::json::Value insertion(llvm::StringRef Uri, std::int64_t Version, int Line,
+                            llvm::StringRef Text) {
+  llvm::json::Object Position{{"line", Line}, {"character", 0}};
+  return llvm::json::Object{
+      {"jsonrpc", "2.0"},
+      {"method", "textDocument/didChange"},
+      {"params",
+       llvm::json::Object{
+           {"textDocument",
+            llvm::json::Object{{"uri", Uri.str()}, {"version", Version}}},
+           {"contentChanges",
+            llvm::json::Array{llvm::json::Object{
+                {"range", llvm::json::Object{{"start", Position},
+                                             {"end", Position}}},
+                {"text", Text.str()}}}}}}};
+}
+
+class EastConstLspTest : public EastConstTempDirTest {
+protected:
+  void SetUp() override {
+    ASSERT_NO_FATAL_FAILURE(EastConstTempDirTest::SetUp());
+    writeFile("types.h", "using Id = int;\n");
+  }
+};
+
+} // namespace
+
+TEST(EastConstLspMessageTest, FramesMessages) {
+  std::string Stream;
+  llvm::raw_string_ostream Out(Stream);
+  writeEastConstLspMessage(Out, llvm::json::Object{{"id", 1}});
+  writeEastConstLspMessage(Out, llvm::json::Object{{"id", 2}});
+  std::FILE *In = makeInput(Out.str());
+  ASSERT_TRUE(In);
+  std::string Body, Error;
+  ASSERT_TRUE(readEastConstLspMessage(In, Body, Error));
+  EXPECT_EQ(Body, "{\"id\":1}");
+  ASSERT_TRUE(readEastConstLspMessage(In, Body, Error));
+  EXPECT_EQ(Body, "{\"id\":2}");
+  EXPECT_FALSE(readEastConstLspMessage(In, Body, Error));
+  EXPECT_TRUE(Error.empty());
+  std::fclose(In);
+
+  In = makeInput("Content-Length: 100\r\n\r\n{}");
+  ASSERT_TRUE(In);
+  EXPECT_FALSE(readEastConstLspMessage(In, Body, Error));
+  EXPECT_FALSE(Error.empty());
+  std::fclose(In);
+
+  In = makeInput("Content-Type: text/plain\r\n\r\n{}");
+  ASSERT_TRUE(In);
+  EXPECT_FALSE(readEastConstLspMessage(In, Body, Error));
+  EXPECT_NE(Error.find("Content-Length"), std::string::npos);
+  std::fclose(In);
+}
+
+TEST_F(EastConstLspTest, ReanalyzesOnlyEditedDeclarations) {
+  clang::tooling::FixedCompilationDatabase Compilations(
+      Root.str(), std::vector<std::string>{"-std=c++17"});
+  std::string Stream;
+  llvm::raw_string_ostream Out(Stream);
+  EastConstLspServer Server(Compilations, {}, Out);
+
+  EXPECT_TRUE(Server.handle(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"id", 1}, {"method", "initialize"}}));
+  std::vector<llvm::json::Value> Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  EXPECT_TRUE(Messages[0]
+                  .getAsObject()
+                  ->getObject("result")
+                  ->getObject("capabilities")
+                  ->get("codeActionProvider"));
+
+  llvm::SmallString<256> Path(Root);
+  llvm::sys::path::append(Path, "doc.cpp");
+  std::string Uri = "file://" + Path.str().str();
+  std::string Text = "#include \"types.h\"\nconst Id a = 1;\nint b;\n";
+  EXPECT_TRUE(Server.handle(llvm::json::Object{
+      {"jsonrpc", "2.0"},
+      {"method", "textDocument/didOpen"},
+      {"params",
+       llvm::json::Object{
+           {"textDocument", llvm::json::Object{{"uri", Uri},
+                                               {"languageId", "cpp"},
+                                               {"version", 1},
+                                               {"text", Text}}}}}}));
+  Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  EXPECT_EQ(diagnosticLines(Messages[0]), std::vector<std::int64_t>{1});
+
+  llvm::json::Object Start{{"line", 1}, {"character", 0}};
+  EXPECT_TRUE(Server.handle(llvm::json::Object{
+      {"jsonrpc", "2.0"},
+      {"id", 2},
+      {"method", "textDocument/codeAction"},
+      {"params",
+       llvm::json::Object{
+           {"textDocument", llvm::json::Object{{"uri", Uri}}},
+           {"range", llvm::json::Object{{"start", Start}, {"end", Start}}},
+           {"context", llvm::json::Object{}}}}}));
+  Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  const llvm::json::Array *Actions =
+      Messages[0].getAsObject()->getArray("result");
+  ASSERT_TRUE(Actions);
+  ASSERT_EQ(Actions->size(), 1u);
+  const llvm::json::Array *Edits = (*Actions)[0]
+                                       .getAsObject()
+                                       ->getObject("edit")
+                                       ->getObject("changes")
+                                       ->getArray(Uri);
+  ASSERT_TRUE(Edits);
+  EXPECT_EQ(applyEdits(Text, *Edits),
+            "#include \"types.h\"\nId const a = 1;\nint b;\n");
+
+  // A new declaration at the end is matched on its own.
+  EXPECT_TRUE(Server.handle(insertion(Uri, 2, 3, "const int c = 2;\n")));
+  Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  EXPECT_EQ(diagnosticLines(Messages[0]), (std::vector<std::int64_t>{1, 3}));
+
+  // A line inserted above moves the site below it without matching it.
+  EXPECT_TRUE(Server.handle(insertion(Uri, 3, 1, "\n")));
+  Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  EXPECT_EQ(diagnosticLines(Messages[0]), (std::vector<std::int64_t>{2, 4}));
+
+  // While the document does not parse, the last diagnostics stay.
+  EXPECT_TRUE(Server.handle(insertion(Uri, 4, 5, "int = ;\n")));
+  Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  EXPECT_EQ(diagnosticLines(Messages[0]), (std::vector<std::int64_t>{2, 4}));
+
+  EastConstLspStats Stats = Server.getStats();
+  EXPECT_EQ(Stats.Analyses, 4u);
+  EXPECT_EQ(Stats.FullAnalyses, 1u);
+  EXPECT_EQ(Stats.PreamblesBuilt, 1u);
+  EXPECT_EQ(Stats.Unparsed, 1u);
+
+  EXPECT_TRUE(Server.handle(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"id", 3}, {"method", "shutdown"}}));
+  EXPECT_FALSE(Server.handle(
+      llvm::json::Object{{"jsonrpc", "2.0"}, {"method", "exit"}}));
+  EXPECT_EQ(Server.exitCode(), 0);
+}
+
+TEST_F(EastConstLspTest, RejectsUnknownRequests) {
+  clang::tooling::FixedCompilationDatabase Compilations(
+      Root.str(), std::vector<std::string>{"-std=c++17"});
+  std::string Stream;
+  llvm::raw_string_ostream Out(Stream);
+  EastConstLspServer Server(Compilations, {}, Out);
+  EXPECT_TRUE(Server.handle(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"id", 7}, {"method", "textDocument/hover"}}));
+  EXPECT_TRUE(Server.handle(llvm::json::Object{
+      {"jsonrpc", "2.0"}, {"method", "initialized"}}));
+  std::vector<llvm::json::Value> Messages = takeMessages(Out.str());
+  ASSERT_EQ(Messages.size(), 1u);
+  EXPECT_EQ(*Messages[0]
+                 .getAsObject()
+                 ->getObject("error")
+                 ->getInteger("code"),
+            -32601);
+  EXPECT_FALSE(Server.handle(
+      llvm::json::Object{{"jsonrpc", "2.0"}, {"method", "exit"}}));
+  EXPECT_EQ(Server.exitCode(), 1);
+}
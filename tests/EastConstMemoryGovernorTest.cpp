@@ -0,0 +1,80 @@
+#include <EastConstMemoryGovernor.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+namespace {
+
+constexpr std::uint64_t MB = std::uint64_t(1) << 20;
+
+EastConstMemoryGovernorOptions withAvailable(std::atomic<std::uint64_t> &Free) {
+  EastConstMemoryGovernorOptions Options;
+  Options.ReserveBytes = 100 * MB;
+  Options.DefaultUnitBytes = 200 * MB;
+  Options.RecheckInterval = std::chrono::milliseconds(5);
+  Options.AvailableBytes = [&Free] {
+    return std::optional<std::uint64_t>(Free.load());
+  };
+  return Options;
+}
+
+} // namespace
+
+TEST(EastConstMemoryGovernorTest, AlwaysAdmitsTheFirstUnit) {
+  std::atomic<std::uint64_t> Free{0};
+  EastConstMemoryGovernor Governor(withAvailable(Free));
+  EXPECT_TRUE(Governor.tryStart(10 * 1024 * MB));
+  EXPECT_EQ(Governor.running(), 1u);
+  EXPECT_FALSE(Governor.tryStart(MB));
+  Governor.finish(10 * 1024 * MB);
+  EXPECT_TRUE(Governor.tryStart(MB));
+}
+
+TEST(EastConstMemoryGovernorTest, CountsExpectedGrowthOfRunningUnits) {
+  std::atomic<std::uint64_t> Free{1000 * MB};
+  std::atomic<std::uint64_t> Resident{0};
+  EastConstMemoryGovernor Governor(withAvailable(Free),
+                                   [&Resident] { return Resident.load(); });
+  // 1000 free: 100 reserve + 400 still to come + 400 fits; a third does not.
+  EXPECT_TRUE(Governor.tryStart(400 * MB));
+  EXPECT_TRUE(Governor.tryStart(400 * MB));
+  EXPECT_FALSE(Governor.tryStart(400 * MB));
+  // The running units reached their peaks, and the system reports it.
+  Resident = 800 * MB;
+  Free = 600 * MB;
+  EXPECT_TRUE(Governor.tryStart(400 * MB));
+  EXPECT_EQ(Governor.getStats().Throttled, 1u);
+  EXPECT_EQ(Governor.getStats().PeakRunning, 3u);
+}
+
+TEST(EastConstMemoryGovernorTest, UnknownAvailabilityNeverThrottles) {
+  EastConstMemoryGovernorOptions Options;
+  Options.AvailableBytes = [] { return std::optional<std::uint64_t>(); };
+  EastConstMemoryGovernor Governor(Options);
+  for (int I = 0; I < 64; ++I)
+    EXPECT_TRUE(Governor.tryStart(1024 * MB));
+  EXPECT_EQ(Governor.getStats().Throttled, 0u);
+}
+
+TEST(EastConstMemoryGovernorTest, StartWaitsForMemoryToFreeUp) {
+  std::atomic<std::uint64_t> Free{150 * MB};
+  EastConstMemoryGovernor Governor(withAvailable(Free));
+  Governor.start(Governor.expectedBytes(std::nullopt));
+  std::atomic<bool> Started{false};
+  std::thread Second([&] {
+    Governor.start(200 * MB);
+    Started = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  EXPECT_FALSE(Started);
+  // Memory freed elsewhere is noticed without any unit finishing.
+  Free = 4096 * MB;
+  Second.join();
+  EXPECT_TRUE(Started);
+  EXPECT_EQ(Governor.running(), 2u);
+  EXPECT_EQ(Governor.getStats().Throttled, 1u);
+}
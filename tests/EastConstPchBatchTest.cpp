@@ -0,0 +1,151 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstEnforcer.h>
+#include <EastConstPchBatch.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Support/Path.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+class EastConstPchBatchTest : public EastConstTempDirTest {
+protected:
+  std::string cacheDir() const { return path("cache"); }
+
+  // Runs the checker over Sources and returns the number of qualifier
+  // removals per file.
+  std::map<std::string, unsigned> run(const std::vector<std::string> &Sources,
+                                      EastConstPchStats &Stats) {
+    std::map<std::string, unsigned> Removals;
+    EastConstCheckerOptions Options;
+    Options.Quiet = true;
+    EastConstChecker Checker(
+        [&Removals](const clang::SourceManager &SM,
+                    clang::CharSourceRange Range, llvm::StringRef NewText) {
+          if (!NewText.empty())
+            return;
+          clang::tooling::Replacement Rep(SM, Range, NewText);
+          ++Removals[llvm::sys::path::filename(Rep.getFilePath()).str()];
+        },
+        Options);
+    clang::ast_matchers::MatchFinder Finder;
+    registerEastConstMatchers(Finder, &Checker);
+    clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                          {"-std=c++17"});
+    auto Factory = clang::tooling::newFrontendActionFactory(&Finder);
+    EXPECT_EQ(runEastConstPchBatch(Compilations, Sources, cacheDir(),
+                                   *Factory, Stats),
+              0);
+    return Removals;
+  }
+};
+
+} // namespace
+
+TEST(EastConstPchIncludesTest, ExtractsTheLeadingIncludeBlock) {
+  EXPECT_EQ(extractLeadingIncludes("// Copyright\n"
+                                   "/* multi\n   line */\n"
+                                   "#pragma once\n"
+                                   "#include <vector>\n"
+                                   "\n"
+                                   "#  include \"common.h\" // local\n"
+                                   "#include <map>\n"
+                                   "int x;\n"
+                                   "#include <set>\n"),
+            (std::vector<std::string>{"#include <vector>",
+                                      "#include \"common.h\"",
+                                      "#include <map>"}));
+}
+
+TEST(EastConstPchIncludesTest, StopsAtConditionalsAndMacroIncludes) {
+  EXPECT_EQ(extractLeadingIncludes("#include <a.h>\n#ifdef X\n#include <b.h>\n"),
+            std::vector<std::string>{"#include <a.h>"});
+  EXPECT_EQ(extractLeadingIncludes("#include HEADER\n#include <b.h>\n"),
+            std::vector<std::string>{});
+}
+
+TEST_F(EastConstPchBatchTest, GroupsBySharedPrefixAndFlags) {
+  writeFile("common.h", "#pragma once\nstruct Common { int V; };\n");
+  std::string A = writeFile("a.cpp", "#include \"common.h\"\nint a;\n");
+  std::string B = writeFile("b.cpp", "#include \"common.h\"\nint b;\n");
+  std::string C = writeFile("c.cpp", "int c;\n");
+
+  clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                        {"-std=c++17"});
+  std::vector<std::string> Ungrouped;
+  std::vector<EastConstPchGroup> Groups =
+      planEastConstPchGroups(Compilations, {A, B, C}, Ungrouped);
+  ASSERT_EQ(Groups.size(), 1u);
+  EXPECT_EQ(Groups[0].Sources, (std::vector<std::string>{A, B}));
+  EXPECT_EQ(Groups[0].IncludeLines,
+            std::vector<std::string>{"#include \"common.h\""});
+  EXPECT_EQ(Ungrouped, std::vector<std::string>{C});
+}
+
+TEST_F(EastConstPchBatchTest, GroupsEachLanguageOnItsOwnHeaderType) {
+  writeFile("common.h", "#pragma once\nstruct Common { int V; };\n");
+  std::string A = writeFile("a.c", "#include \"common.h\"\nint a;\n");
+  std::string B = writeFile("b.c", "#include \"common.h\"\nint b;\n");
+  std::string C = writeFile("c.cpp", "#include \"common.h\"\nint c;\n");
+  std::string D = writeFile("d.cpp", "#include \"common.h\"\nint d;\n");
+
+  clang::tooling::FixedCompilationDatabase Compilations(Root.str(), {});
+  std::vector<std::string> Ungrouped;
+  std::vector<EastConstPchGroup> Groups =
+      planEastConstPchGroups(Compilations, {A, B, C, D}, Ungrouped);
+  ASSERT_EQ(Groups.size(), 2u);
+  std::map<std::string, std::vector<std::string>> ByLanguage;
+  for (const EastConstPchGroup &Group : Groups)
+    ByLanguage[Group.HeaderLanguage] = Group.Sources;
+  EXPECT_EQ(ByLanguage["c-header"], (std::vector<std::string>{A, B}));
+  EXPECT_EQ(ByLanguage["c++-header"], (std::vector<std::string>{C, D}));
+  EXPECT_TRUE(Ungrouped.empty());
+}
+
+TEST_F(EastConstPchBatchTest, BuildsOncePerGroupAndReusesTheCache) {
+  writeFile("common.h", "#pragma once\nstruct Common { int V; };\n");
+  std::vector<std::string> Sources = {
+      writeFile("a.cpp", "#include \"common.h\"\nconst Common a{1};\n"),
+      writeFile("b.cpp", "#include \"common.h\"\nconst int b = 2;\n"),
+      writeFile("c.cpp", "const int c = 3;\n")};
+
+  EastConstPchStats First;
+  std::map<std::string, unsigned> Removals = run(Sources, First);
+  EXPECT_EQ(First.Groups, 1u);
+  EXPECT_EQ(First.GroupedUnits, 2u);
+  EXPECT_EQ(First.PchBuilt, 1u);
+  EXPECT_EQ(First.PchFailed, 0u);
+  EXPECT_EQ(First.CachedUnits, 0u);
+  EXPECT_EQ(Removals["a.cpp"], 1u);
+  EXPECT_EQ(Removals["b.cpp"], 1u);
+  EXPECT_EQ(Removals["c.cpp"], 1u);
+
+  EastConstPchStats Second;
+  EXPECT_EQ(run(Sources, Second), Removals);
+  EXPECT_EQ(Second.PchBuilt, 0u);
+  EXPECT_EQ(Second.CachedUnits, 2u);
+  EXPECT_DOUBLE_EQ(Second.hitRate(), 1.0);
+}
+
+TEST_F(EastConstPchBatchTest, RebuildsWhenAHeaderChanges) {
+  std::string Header =
+      writeFile("common.h", "#pragma once\nstruct Common { int V; };\n");
+  std::vector<std::string> Sources = {
+      writeFile("a.cpp", "#include \"common.h\"\nconst int a = 1;\n"),
+      writeFile("b.cpp", "#include \"common.h\"\nconst int b = 2;\n")};
+
+  EastConstPchStats First;
+  run(Sources, First);
+  ASSERT_EQ(First.PchBuilt, 1u);
+
+  writeFile("common.h",
+            "#pragma once\nstruct Common { int V; int W; };\n");
+  EastConstPchStats Second;
+  run(Sources, Second);
+  EXPECT_EQ(Second.PchBuilt, 1u);
+  EXPECT_EQ(Second.CachedUnits, 0u);
+}
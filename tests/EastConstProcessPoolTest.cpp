@@ -0,0 +1,195 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstProcessPool.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Process.h>
+
+#include <chrono>
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if LLVM_ON_UNIX
+
+namespace {
+
+struct Result {
+  bool Success;
+  std::string Output;
+};
+
+int runPool(const std::vector<std::string> &Units,
+            const EastConstProcessPoolOptions &Options,
+            const EastConstProcessTask &Task,
+            std::map<std::string, Result> &Results,
+            EastConstProcessPoolStats &Stats) {
+  return runEastConstProcessPool(
+      Units, Options, Task,
+      [&](llvm::StringRef Unit, bool Success, llvm::StringRef Output, double,
+          std::uint64_t) {
+        EXPECT_FALSE(Results.count(Unit.str())) << Unit.str();
+        Results[Unit.str()] = {Success, Output.str()};
+      },
+      Stats);
+}
+
+class EastConstProcessPoolCrashTest : public EastConstTempDirTest {};
+
+} // namespace
+
+TEST(EastConstProcessPoolTest, RunsEveryUnitInAWorker) {
+  std::vector<std::string> Units = {"a", "b", "c", "d", "e"};
+  EastConstProcessPoolOptions Options;
+  Options.Workers = 2;
+  std::string ParentPid = std::to_string(llvm::sys::Process::getProcessId());
+  std::map<std::string, Result> Results;
+  EastConstProcessPoolStats Stats;
+  EXPECT_EQ(runPool(Units, Options,
+                    [](llvm::StringRef Unit, std::string &Output) {
+                      Output = Unit.upper() + " " +
+                               std::to_string(
+                                   llvm::sys::Process::getProcessId());
+                      return Unit != "c";
+                    },
+                    Results, Stats),
+            1);
+  EXPECT_EQ(Stats.Workers, 2u);
+  EXPECT_EQ(Stats.Failed, 1u);
+  EXPECT_EQ(Stats.Crashes, 0u);
+  ASSERT_EQ(Results.size(), Units.size());
+  for (const std::string &Unit : Units) {
+    llvm::StringRef Output = Results[Unit].Output;
+    EXPECT_TRUE(Output.starts_with(llvm::StringRef(Unit).upper() + " "));
+    EXPECT_NE(Output.split(' ').second, ParentPid);
+    EXPECT_EQ(Results[Unit].Success, Unit != "c");
+  }
+}
+
+TEST(EastConstProcessPoolTest, RecyclesWorkersAfterUnitLimit) {
+  std::vector<std::string> Units = {"a", "b", "c", "d", "e"};
+  EastConstProcessPoolOptions Options;
+  Options.Workers = 1;
+  Options.RecycleAfterUnits = 2;
+  std::map<std::string, Result> Results;
+  EastConstProcessPoolStats Stats;
+  EXPECT_EQ(runPool(Units, Options,
+                    [](llvm::StringRef, std::string &Output) {
+                      Output = std::to_string(
+                          llvm::sys::Process::getProcessId());
+                      return true;
+                    },
+                    Results, Stats),
+            0);
+  std::set<std::string> Pids;
+  for (const auto &UnitAndResult : Results)
+    Pids.insert(UnitAndResult.second.Output);
+  EXPECT_EQ(Pids.size(), 3u);
+  EXPECT_EQ(Stats.WorkersStarted, 3u);
+  EXPECT_EQ(Stats.Recycled, 2u);
+  EXPECT_EQ(Results["a"].Output, Results["b"].Output);
+  EXPECT_NE(Results["b"].Output, Results["c"].Output);
+}
+
+TEST_F(EastConstProcessPoolCrashTest, RetriesAUnitOnceAfterACrash) {
+  std::string Marker = path("crashed-once");
+
+  std::vector<std::string> Units = {"flaky", "broken", "fine"};
+  EastConstProcessPoolOptions Options;
+  Options.Workers = 1;
+  std::map<std::string, Result> Results;
+  EastConstProcessPoolStats Stats;
+  int Status = runPool(
+      Units, Options,
+      [&](llvm::StringRef Unit, std::string &Output) {
+        if (Unit == "broken")
+          std::abort();
+        if (Unit == "flaky" && !llvm::sys::fs::exists(Marker)) {
+          int FD;
+          if (!llvm::sys::fs::openFileForWrite(Marker, FD))
+            llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+          std::abort();
+        }
+        Output = Unit.str();
+        return true;
+      },
+      Results, Stats);
+
+  EXPECT_EQ(Status, 1);
+  EXPECT_EQ(Stats.Crashes, 3u);
+  EXPECT_EQ(Stats.Failed, 1u);
+  EXPECT_EQ(Results.size(), 2u);
+  EXPECT_EQ(Results["flaky"].Output, "flaky");
+  EXPECT_EQ(Results["fine"].Output, "fine");
+  ASSERT_EQ(Stats.CrashedUnits.size(), 2u);
+  EXPECT_EQ(Stats.CrashedUnits[0].Unit, "flaky");
+  EXPECT_TRUE(Stats.CrashedUnits[0].Recovered);
+  EXPECT_EQ(Stats.CrashedUnits[1].Unit, "broken");
+  EXPECT_FALSE(Stats.CrashedUnits[1].Recovered);
+  EXPECT_TRUE(llvm::StringRef(Stats.CrashedUnits[1].Reason)
+                  .starts_with("signal "));
+}
+
+TEST(EastConstProcessPoolTest, KillsAWorkerStuckOnAUnit) {
+  std::vector<std::string> Units = {"hangs", "fine"};
+  EastConstProcessPoolOptions Options;
+  Options.Workers = 1;
+  Options.UnitTimeout = std::chrono::milliseconds(200);
+  std::map<std::string, Result> Results;
+  EastConstProcessPoolStats Stats;
+  int Status = runPool(
+      Units, Options,
+      [](llvm::StringRef Unit, std::string &Output) {
+        if (Unit == "hangs")
+          std::this_thread::sleep_for(std::chrono::hours(1));
+        Output = Unit.str();
+        return true;
+      },
+      Results, Stats);
+
+  // Killed on both attempts, like a unit that crashes every time.
+  EXPECT_EQ(Status, 1);
+  EXPECT_EQ(Stats.TimedOut, 2u);
+  EXPECT_EQ(Stats.Crashes, 2u);
+  EXPECT_EQ(Stats.Failed, 1u);
+  EXPECT_EQ(Results.size(), 1u);
+  EXPECT_EQ(Results["fine"].Output, "fine");
+  ASSERT_EQ(Stats.CrashedUnits.size(), 1u);
+  EXPECT_EQ(Stats.CrashedUnits[0].Unit, "hangs");
+  EXPECT_FALSE(Stats.CrashedUnits[0].Recovered);
+  EXPECT_EQ(Stats.CrashedUnits[0].Reason, "timed out after 200 ms");
+}
+
+TEST(EastConstProcessPoolTest, HoldsUnitsBackWhenMemoryIsShort) {
+  std::vector<std::string> Units = {"a", "b", "c", "d"};
+  EastConstProcessPoolOptions Options;
+  Options.Workers = 2;
+  EastConstMemoryGovernorOptions Memory;
+  Memory.AvailableBytes = [] { return std::optional<std::uint64_t>(0); };
+  Memory.RecheckInterval = std::chrono::milliseconds(5);
+  Options.Memory = Memory;
+  std::map<std::string, Result> Results;
+  EastConstProcessPoolStats Stats;
+  EXPECT_EQ(runPool(Units, Options,
+                    [](llvm::StringRef Unit, std::string &Output) {
+                      std::this_thread::sleep_for(
+                          std::chrono::milliseconds(20));
+                      Output = Unit.str();
+                      return true;
+                    },
+                    Results, Stats),
+            0);
+  // With no memory to spare only one unit runs at a time, but every unit
+  // still runs.
+  EXPECT_EQ(Results.size(), Units.size());
+  EXPECT_GE(Stats.MemoryThrottled, 1u);
+}
+
+#endif
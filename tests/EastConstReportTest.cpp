@@ -0,0 +1,177 @@
+#include <EastConstReport.h>
+#include <gtest/gtest.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+
+using clang::tooling::Replacement;
+
+namespace {
+
+EastConstSite makeSite() {
+  EastConstSite Site;
+  Site.File = "/src/a b.cpp";
+  Site.Line = 3;
+  Site.Column = 5;
+  Site.Kind = EastConstDeclKind::Parameter;
+  Site.Fix = {Replacement(Site.File, 40, 6, ""),
+              Replacement(Site.File, 49, 0, " const")};
+  return Site;
+}
+
+} // namespace
+
+TEST(EastConstReportTest, ParsesFormats) {
+  EastConstReportFormat Format;
+  ASSERT_TRUE(parseEastConstReportFormat("sarif", Format));
+  EXPECT_EQ(Format, EastConstReportFormat::Sarif);
+  ASSERT_TRUE(parseEastConstReportFormat("ndjson", Format));
+  EXPECT_EQ(Format, EastConstReportFormat::Ndjson);
+  EXPECT_FALSE(parseEastConstReportFormat("json", Format));
+}
+
+TEST(EastConstReportTest, SiteRecordsRoundTrip) {
+  EastConstSite Site = makeSite();
+  std::string Record = formatEastConstSiteRecord(Site);
+  EXPECT_EQ(Record.find('\n'), std::string::npos);
+  EastConstSite Parsed;
+  ASSERT_TRUE(parseEastConstSiteRecord(Record, Parsed));
+  EXPECT_EQ(Parsed.File, Site.File);
+  EXPECT_EQ(Parsed.Line, 3u);
+  EXPECT_EQ(Parsed.Column, 5u);
+  EXPECT_EQ(Parsed.Kind, EastConstDeclKind::Parameter);
+  EXPECT_EQ(Parsed.Fix, Site.Fix);
+  EXPECT_FALSE(parseEastConstSiteRecord("{\"file\":\"x\"}", Parsed));
+  EXPECT_FALSE(parseEastConstSiteRecord("not json", Parsed));
+}
+
+TEST(EastConstReportTest, WritesOneLinePerSite) {
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  EastConstReportWriter Writer(OS, EastConstReportFormat::Ndjson);
+  EastConstSite Site = makeSite();
+  Writer.add(Site);
+  Site.Fix.clear();
+  Writer.add(Site);
+  Writer.finish();
+  EXPECT_EQ(Writer.size(), 2u);
+  llvm::StringRef Rest = OS.str();
+  for (unsigned I = 0; I < 2; ++I) {
+    auto [Line, Next] = Rest.split('\n');
+    EastConstSite Parsed;
+    ASSERT_TRUE(parseEastConstSiteRecord(Line, Parsed));
+    EXPECT_EQ(Parsed.Fix.size(), I == 0 ? 2u : 0u);
+    Rest = Next;
+  }
+  EXPECT_TRUE(Rest.empty());
+}
+
+TEST(EastConstReportTest, WritesASarifLog) {
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  {
+    EastConstReportWriter Writer(OS, EastConstReportFormat::Sarif);
+    Writer.add(makeSite());
+  }
+  llvm::Expected<llvm::json::Value> Log = llvm::json::parse(OS.str());
+  ASSERT_TRUE(static_cast<bool>(Log)) << llvm::toString(Log.takeError());
+  const llvm::json::Object *Root = Log->getAsObject();
+  ASSERT_TRUE(Root);
+  EXPECT_EQ(Root->getString("version"), "2.1.0");
+  const llvm::json::Object *Run = (*Root->getArray("runs"))[0].getAsObject();
+  EXPECT_EQ(Run->getObject("tool")->getObject("driver")->getString("name"),
+            "east-const-enforcer");
+  const llvm::json::Array *Results = Run->getArray("results");
+  ASSERT_EQ(Results->size(), 1u);
+  const llvm::json::Object *Result = (*Results)[0].getAsObject();
+  EXPECT_EQ(Result->getString("ruleId"), "east-const");
+  const llvm::json::Object *Location =
+      (*Result->getArray("locations"))[0].getAsObject()->getObject(
+          "physicalLocation");
+  EXPECT_EQ(Location->getObject("artifactLocation")->getString("uri"),
+            "file:///src/a%20b.cpp");
+  EXPECT_EQ(Location->getObject("region")->getInteger("startLine"), 3);
+  const llvm::json::Object *Change =
+      (*(*Result->getArray("fixes"))[0].getAsObject()->getArray(
+          "artifactChanges"))[0]
+          .getAsObject();
+  const llvm::json::Array *Replacements = Change->getArray("replacements");
+  ASSERT_EQ(Replacements->size(), 2u);
+  const llvm::json::Object *Insert = (*Replacements)[1].getAsObject();
+  EXPECT_EQ(Insert->getObject("deletedRegion")->getInteger("byteOffset"), 49);
+  EXPECT_EQ(Insert->getObject("deletedRegion")->getInteger("byteLength"), 0);
+  EXPECT_EQ(Run->getString("columnKind"), "utf16CodeUnits");
+  EXPECT_EQ(Insert->getObject("insertedContent")->getString("text"),
+            " const");
+}
+
+TEST(EastConstReportTest, CountsSarifColumnsInUtf16CodeUnits) {
+  llvm::SmallString<256> Path;
+  int FD;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("east-const-report", "cpp",
+                                                  FD, Path));
+  {
+    llvm::raw_fd_ostream Source(FD, /*shouldClose=*/true);
+    // "\xc3\xa9" is two bytes and one code unit, "\xf0\x9f\x99\x82" four
+    // bytes and two.
+    Source << "int a;\n/* \xc3\xa9 \xf0\x9f\x99\x82 */ const int b = 1;\n";
+  }
+  EastConstSite Site;
+  Site.File = Path.str().str();
+  Site.Line = 2;
+  Site.Column = 15;
+  // Under -j, another file's sites come in between.
+  EastConstSite Other;
+  Other.File = "/nonexistent/b.cpp";
+  Other.Line = 2;
+  Other.Column = 15;
+  EastConstSite Ascii = Site;
+  Ascii.Line = 1;
+  Ascii.Column = 5;
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  {
+    EastConstReportWriter Writer(OS, EastConstReportFormat::Sarif);
+    Writer.add(Site);
+    Writer.add(Other);
+    Writer.add(Site);
+    Writer.add(Ascii);
+  }
+  llvm::sys::fs::remove(Path);
+  llvm::Expected<llvm::json::Value> Log = llvm::json::parse(OS.str());
+  ASSERT_TRUE(static_cast<bool>(Log)) << llvm::toString(Log.takeError());
+  const llvm::json::Array &Results =
+      *(*Log->getAsObject()->getArray("runs"))[0].getAsObject()->getArray(
+          "results");
+  ASSERT_EQ(Results.size(), 4u);
+  auto StartColumn = [&](std::size_t I) {
+    return (*Results[I].getAsObject()->getArray("locations"))[0]
+        .getAsObject()
+        ->getObject("physicalLocation")
+        ->getObject("region")
+        ->getInteger("startColumn");
+  };
+  EXPECT_EQ(StartColumn(0), 12);
+  // Without the file, the line is taken to be ASCII.
+  EXPECT_EQ(StartColumn(1), 15);
+  EXPECT_EQ(StartColumn(2), 12);
+  EXPECT_EQ(StartColumn(3), 5);
+}
+
+TEST(EastConstReportTest, EmptySarifLogIsValid) {
+  std::string Text;
+  llvm::raw_string_ostream OS(Text);
+  EastConstReportWriter Writer(OS, EastConstReportFormat::Sarif);
+  Writer.finish();
+  Writer.finish();
+  llvm::Expected<llvm::json::Value> Log = llvm::json::parse(OS.str());
+  ASSERT_TRUE(static_cast<bool>(Log)) << llvm::toString(Log.takeError());
+  EXPECT_TRUE((*Log->getAsObject()->getArray("runs"))[0]
+                  .getAsObject()
+                  ->getArray("results")
+                  ->empty());
+}
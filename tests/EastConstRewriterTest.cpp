@@ -0,0 +1,105 @@
+#include <EastConstRewriter.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+TEST(EastConstRewriterTest, RunsTheDriverOncePerThread) {
+  EastConstRewriter Rewriter;
+  EastConstRewriteResult First =
+      Rewriter.rewrite("a.cpp", "const int a = 1;\n");
+  EastConstRewriteResult Second =
+      Rewriter.rewrite("b.cpp", "const char *b;\nint const c = 2;\n");
+  EastConstRewriteResult Third = Rewriter.rewrite("a.cpp", "int d;\n");
+
+  EXPECT_TRUE(First.Success);
+  EXPECT_EQ(First.Code, "int const a = 1;\n");
+  EXPECT_FALSE(First.Edits.empty());
+  EXPECT_TRUE(Second.Success);
+  EXPECT_EQ(Second.Code, "char const *b;\nint const c = 2;\n");
+  EXPECT_TRUE(Third.Success);
+  EXPECT_EQ(Third.Code, "int d;\n");
+  EXPECT_TRUE(Third.Edits.empty());
+
+  EastConstRewriterStats Stats = Rewriter.getStats();
+  EXPECT_EQ(Stats.Buffers, 3u);
+  EXPECT_EQ(Stats.Failed, 0u);
+  EXPECT_EQ(Stats.DriverRuns, 1u);
+}
+
+TEST(EastConstRewriterTest, SeesMappedHeaders) {
+  EastConstRewriterOptions Options;
+  Options.Flags = {"-std=c++17", "-Igenerated"};
+  EastConstRewriter Rewriter(Options);
+  Rewriter.mapFile("generated/types.h", "using Id = int;\n");
+  EastConstRewriteResult Result =
+      Rewriter.rewrite("user.cpp", "#include <types.h>\nconst Id *id;\n");
+  EXPECT_TRUE(Result.Success);
+  EXPECT_EQ(Result.Code, "#include <types.h>\nId const *id;\n");
+}
+
+TEST(EastConstRewriterTest, SeesAHeaderMappedAfterALookupMissedIt) {
+  EastConstRewriterOptions Options;
+  Options.Flags = {"-std=c++17", "-Igenerated"};
+  EastConstRewriter Rewriter(Options);
+  const char *Code = "#include <late.h>\nconst Id *id;\n";
+  EXPECT_FALSE(Rewriter.rewrite("user.cpp", Code).Success);
+  Rewriter.mapFile("generated/late.h", "using Id = int;\n");
+  EastConstRewriteResult Result = Rewriter.rewrite("user.cpp", Code);
+  EXPECT_TRUE(Result.Success);
+  EXPECT_EQ(Result.Code, "#include <late.h>\nId const *id;\n");
+  EXPECT_EQ(Rewriter.getStats().DriverRuns, 2u);
+}
+
+TEST(EastConstRewriterTest, StartsOverPastTheCacheEntryLimit) {
+  EastConstRewriterOptions Options;
+  Options.CacheEntryLimit = 1;
+  EastConstRewriter Rewriter(Options);
+  for (int I = 0; I < 3; ++I)
+    EXPECT_EQ(Rewriter.rewrite("buffer" + std::to_string(I) + ".cpp",
+                               "const int v = 0;\n")
+                  .Code,
+              "int const v = 0;\n");
+  // Every context was retired with the cache it filled.
+  EXPECT_EQ(Rewriter.getStats().DriverRuns, 3u);
+}
+
+TEST(EastConstRewriterTest, PassesBrokenSourceThrough) {
+  EastConstRewriter Rewriter;
+  EastConstRewriteResult Broken =
+      Rewriter.rewrite("broken.cpp", "const int *p = ;\n");
+  EXPECT_FALSE(Broken.Success);
+  EXPECT_EQ(Broken.Code, "const int *p = ;\n");
+  EXPECT_TRUE(Broken.Edits.empty());
+  // The context still rewrites the next buffer.
+  EXPECT_EQ(Rewriter.rewrite("fine.cpp", "const int *p;\n").Code,
+            "int const *p;\n");
+  EXPECT_EQ(Rewriter.getStats().Failed, 1u);
+}
+
+TEST(EastConstRewriterTest, RewritesABatchInOrder) {
+  std::vector<EastConstBuffer> Inputs;
+  for (int I = 0; I < 16; ++I)
+    Inputs.push_back({"gen" + std::to_string(I) + ".cpp",
+                      "const int v" + std::to_string(I) + " = 0;\n"});
+  Inputs[5].Code = "const int = ;\n";
+
+  EastConstRewriter Rewriter;
+  std::vector<EastConstRewriteResult> Results =
+      Rewriter.rewriteAll(Inputs, /*Jobs=*/4);
+  ASSERT_EQ(Results.size(), Inputs.size());
+  for (int I = 0; I < 16; ++I) {
+    if (I == 5) {
+      EXPECT_FALSE(Results[I].Success);
+      EXPECT_EQ(Results[I].Code, Inputs[I].Code);
+      continue;
+    }
+    EXPECT_TRUE(Results[I].Success) << I;
+    EXPECT_EQ(Results[I].Code,
+              "int const v" + std::to_string(I) + " = 0;\n");
+  }
+  EastConstRewriterStats Stats = Rewriter.getStats();
+  EXPECT_EQ(Stats.Buffers, 16u);
+  EXPECT_EQ(Stats.Failed, 1u);
+  EXPECT_LE(Stats.DriverRuns, 4u);
+}
@@ -0,0 +1,187 @@
+#include <EastConstFrontend.h>
+#include <EastConstSampling.h>
+#include <gtest/gtest.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+EastConstSiteCounts withVariables(unsigned Count) {
+  EastConstSiteCounts Counts{};
+  Counts[static_cast<std::size_t>(EastConstDeclKind::Variable)] = Count;
+  return Counts;
+}
+
+double variables(const EastConstSiteCounts &Counts) {
+  return Counts[static_cast<std::size_t>(EastConstDeclKind::Variable)];
+}
+
+} // namespace
+
+TEST(EastConstSamplingTest, ParsesSampleSizes) {
+  EastConstSampleSize Size;
+  ASSERT_TRUE(parseEastConstSampleSize("5%", Size));
+  EXPECT_DOUBLE_EQ(Size.Fraction, 0.05);
+  ASSERT_TRUE(parseEastConstSampleSize("0.25", Size));
+  EXPECT_DOUBLE_EQ(Size.Fraction, 0.25);
+  EXPECT_EQ(Size.resolve(10), 3u);
+  ASSERT_TRUE(parseEastConstSampleSize("200", Size));
+  EXPECT_EQ(Size.Count, 200u);
+  EXPECT_EQ(Size.resolve(50), 50u);
+  EXPECT_FALSE(parseEastConstSampleSize("0", Size));
+  EXPECT_FALSE(parseEastConstSampleSize("1.5", Size));
+  EXPECT_FALSE(parseEastConstSampleSize("150%", Size));
+  EXPECT_FALSE(parseEastConstSampleSize("some", Size));
+}
+
+TEST(EastConstSamplingTest, StratifiesByTopLevelDirectory) {
+  std::vector<std::string> Files = {"/repo/lib/a.cpp", "/repo/lib/x/b.cpp",
+                                    "/repo/tools/c.cpp", "/repo/main.cpp"};
+  std::string Root = getEastConstCommonDirectory(Files);
+  EXPECT_EQ(Root, "/repo");
+  EXPECT_EQ(getEastConstSampleStratum(Files[0], Root), "lib");
+  EXPECT_EQ(getEastConstSampleStratum(Files[1], Root), "lib");
+  EXPECT_EQ(getEastConstSampleStratum(Files[2], Root), "tools");
+  EXPECT_EQ(getEastConstSampleStratum(Files[3], Root), ".");
+  EXPECT_EQ(getEastConstCommonDirectory({"/repo/libx/a.cpp",
+                                         "/repo/lib/b.cpp"}),
+            "/repo");
+}
+
+TEST(EastConstSamplingTest, AllocatesEveryStratumAndIsSeeded) {
+  std::vector<std::string> Files, Strata;
+  for (unsigned I = 0; I < 90; ++I) {
+    Files.push_back("/repo/big/" + std::to_string(I) + ".cpp");
+    Strata.push_back("big");
+  }
+  for (unsigned I = 0; I < 10; ++I) {
+    Files.push_back("/repo/small/" + std::to_string(I) + ".cpp");
+    Strata.push_back("small");
+  }
+
+  std::vector<std::size_t> Sample =
+      pickEastConstStratifiedSample(Files, Strata, 12, /*Seed=*/1);
+  ASSERT_EQ(Sample.size(), 12u);
+  unsigned Small = 0;
+  for (std::size_t Index : Sample)
+    Small += Strata[Index] == "small";
+  // Two up front, then 8 more split 88:8.
+  EXPECT_EQ(Small, 3u);
+
+  EXPECT_EQ(pickEastConstStratifiedSample(Files, Strata, 12, 1), Sample);
+  EXPECT_NE(pickEastConstStratifiedSample(Files, Strata, 12, 2), Sample);
+  EXPECT_EQ(pickEastConstStratifiedSample(Files, Strata, 500, 1).size(),
+            Files.size());
+}
+
+TEST(EastConstSamplingTest, CensusHasNoUncertainty) {
+  EastConstStratumSample Stratum;
+  Stratum.Name = "lib";
+  Stratum.Population = 3;
+  Stratum.Observations = {withVariables(1), withVariables(4),
+                          withVariables(7)};
+  EastConstEstimate Estimate = estimateEastConstTotal(Stratum, variables);
+  EXPECT_DOUBLE_EQ(Estimate.Total, 12);
+  EXPECT_DOUBLE_EQ(Estimate.HalfWidth, 0);
+  EXPECT_TRUE(Estimate.Bounded);
+}
+
+TEST(EastConstSamplingTest, ExtrapolatesWithFinitePopulationCorrection) {
+  EastConstStratumSample Stratum;
+  Stratum.Population = 10;
+  Stratum.Observations = {withVariables(1), withVariables(3)};
+  EastConstEstimate Estimate = estimateEastConstTotal(Stratum, variables);
+  // Mean 2, sample variance 2: 10^2 * (1 - 2/10) * 2 / 2 = 80.
+  EXPECT_DOUBLE_EQ(Estimate.Total, 20);
+  EXPECT_NEAR(Estimate.HalfWidth, 1.96 * std::sqrt(80.0), 1e-9);
+  EXPECT_TRUE(Estimate.Bounded);
+
+  Stratum.Observations.pop_back();
+  EXPECT_FALSE(estimateEastConstTotal(Stratum, variables).Bounded);
+}
+
+TEST(EastConstSamplingTest, CheckerCountsSitesByKindWithoutAHandler) {
+  clang::tooling::FixedCompilationDatabase Compilations(".", {"-std=c++20"});
+  std::vector<std::string> Sources = {"sites.cpp"};
+  clang::tooling::ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("sites.cpp", R"cpp(
+    const int Global = 1;
+    const int Other = 2;
+    typedef const char *CString;
+    struct Holder {
+      const int Member = 2;
+    };
+    const int &pick(const int &Value);
+  )cpp");
+
+  EastConstCheckerOptions Options;
+  Options.Quiet = true;
+  Options.CountSites = true;
+  EastConstChecker Checker(nullptr, Options);
+  clang::ast_matchers::MatchFinder Finder;
+  registerEastConstMatchers(Finder, &Checker);
+  std::unique_ptr<clang::tooling::FrontendActionFactory> Factory =
+      newEastConstActionFactory(Finder, EastConstFrontendOptions());
+  ASSERT_EQ(Tool.run(Factory.get()), 0);
+
+  ASSERT_EQ(Checker.getSiteCounts().size(), 1u);
+  const auto &FileAndCounts = *Checker.getSiteCounts().begin();
+  EXPECT_TRUE(llvm::StringRef(FileAndCounts.first).ends_with("sites.cpp"));
+  auto count = [&](EastConstDeclKind Kind) {
+    return FileAndCounts.second[static_cast<std::size_t>(Kind)];
+  };
+  EXPECT_EQ(count(EastConstDeclKind::Variable), 2u);
+  EXPECT_EQ(count(EastConstDeclKind::Typedef), 1u);
+  EXPECT_EQ(count(EastConstDeclKind::Field), 1u);
+  EXPECT_EQ(count(EastConstDeclKind::ReturnType), 1u);
+  EXPECT_EQ(count(EastConstDeclKind::Parameter), 1u);
+}
+
+TEST(EastConstSamplingTest, CheckerCountsASiteOnceAcrossConfigurations) {
+  // Two compile commands for the same file, as a database lists them for
+  // a file built in two configurations.
+  class TwoConfigurationDatabase
+      : public clang::tooling::CompilationDatabase {
+  public:
+    std::vector<clang::tooling::CompileCommand>
+    getCompileCommands(llvm::StringRef FilePath) const override {
+      std::vector<clang::tooling::CompileCommand> Commands;
+      for (const char *Define : {"-UVARIANT", "-DVARIANT"})
+        Commands.emplace_back(".", FilePath,
+                              std::vector<std::string>{"clang++", "-std=c++20",
+                                                       Define, FilePath.str()},
+                              "");
+      return Commands;
+    }
+  } Compilations;
+  std::vector<std::string> Sources = {"twice.cpp"};
+  clang::tooling::ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("twice.cpp", "const int Shared = 1;\n"
+                                   "#ifdef VARIANT\n"
+                                   "const int Variant = 2;\n"
+                                   "#endif\n");
+
+  EastConstCheckerOptions Options;
+  Options.Quiet = true;
+  Options.CountSites = true;
+  EastConstChecker Checker(nullptr, Options);
+  clang::ast_matchers::MatchFinder Finder;
+  registerEastConstMatchers(Finder, &Checker);
+  std::unique_ptr<clang::tooling::FrontendActionFactory> Factory =
+      newEastConstActionFactory(Finder, EastConstFrontendOptions());
+  ASSERT_EQ(Tool.run(Factory.get()), 0);
+
+  ASSERT_EQ(Checker.getCountedSites().size(), 1u);
+  const EastConstSiteKinds &Sites = Checker.getCountedSites().begin()->second;
+  EXPECT_EQ(Sites.size(), 2u);
+  EXPECT_EQ(countEastConstSites(Sites),
+            Checker.getSiteCounts().begin()->second);
+  EXPECT_DOUBLE_EQ(variables(countEastConstSites(Sites)), 2.0);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <EastConstEnforcer.h>
+#include <EastConstFrontend.h>
 #include <gtest/gtest.h>
 
 #include <string>
@@ -12,7 +13,11 @@
 #include "clang/Tooling/CompilationDatabase.h"
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/Tooling.h"
+#include <llvm/ADT/SmallString.h>
 #include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
 
 inline bool &eastConstHarnessVerboseFlag() {
   static bool flag = false;
@@ -24,12 +29,54 @@ inline void setEastConstHarnessVerbose(bool enabled) {
   eastConstHarnessVerboseFlag() = enabled;
 }
 
+// Frontend profile used by runToolOnCode() when none is passed explicitly.
+inline EastConstFrontendOptions &eastConstHarnessFrontendOptions() {
+  static EastConstFrontendOptions options;
+  return options;
+}
+
+// Gives each test a fresh directory, Root, removed when the test ends.
+class EastConstTempDirTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("east-const-test", Root));
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(Root); }
+
+  // Name under Root.
+  std::string path(llvm::StringRef Name) const {
+    llvm::SmallString<256> Path(Root);
+    llvm::sys::path::append(Path, Name);
+    return Path.str().str();
+  }
+
+  // Writes Name under Root, creating its directories, and returns its path.
+  std::string writeFile(llvm::StringRef Name, llvm::StringRef Content) {
+    std::string Path = path(Name);
+    std::error_code EC =
+        llvm::sys::fs::create_directories(llvm::sys::path::parent_path(Path));
+    EXPECT_FALSE(EC) << EC.message();
+    llvm::raw_fd_ostream OS(Path, EC);
+    EXPECT_FALSE(EC) << EC.message();
+    OS << Content;
+    return Path;
+  }
+
+  llvm::SmallString<256> Root;
+};
+
 class EastConstTestHarness : public ::testing::Test {
 protected:
   static const std::string &getFakeStdHeader();
   static std::string addStandardIncludes(const std::string &code);
 
   std::string runToolOnCode(const std::string &code);
+  std::string runToolOnCode(const std::string &code,
+                            const EastConstCheckerOptions &options);
+  std::string runToolOnCode(const std::string &code,
+                            const EastConstCheckerOptions &options,
+                            const EastConstFrontendOptions &frontendOptions);
   void testTransformation(const std::string &input,
                           const std::string &expected);
 };
@@ -190,12 +237,24 @@ inline std::string EastConstTestHarness::addStandardIncludes(
 }
 
 inline std::string EastConstTestHarness::runToolOnCode(const std::string &code) {
+  EastConstCheckerOptions options;
+  options.Quiet = !eastConstHarnessVerbose();
+  return runToolOnCode(code, options);
+}
+
+inline std::string
+EastConstTestHarness::runToolOnCode(const std::string &code,
+                                    const EastConstCheckerOptions &options) {
+  return runToolOnCode(code, options, eastConstHarnessFrontendOptions());
+}
+
+inline std::string EastConstTestHarness::runToolOnCode(
+    const std::string &code, const EastConstCheckerOptions &options,
+    const EastConstFrontendOptions &frontendOptions) {
   clang::tooling::FixedCompilationDatabase compilations(
       ".", {"-std=c++20"});
   std::vector<std::string> sources = {"test.cpp"};
 
-  setQuietMode(!eastConstHarnessVerbose());
-
   clang::tooling::RefactoringTool tool(compilations, sources);
   tool.mapVirtualFile("test.cpp", code);
   tool.mapVirtualFile("fake_std.h", getFakeStdHeader());
@@ -213,13 +272,14 @@ inline std::string EastConstTestHarness::runToolOnCode(const std::string &code)
           llvm::errs() << "Test replacement error for " << FilePath << ": "
                        << llvm::toString(std::move(Err)) << "\n";
         }
-      });
+      },
+      options);
 
   clang::ast_matchers::MatchFinder finder;
   registerEastConstMatchers(finder, &checker);
 
   std::unique_ptr<clang::tooling::FrontendActionFactory> factory =
-      clang::tooling::newFrontendActionFactory(&finder);
+      newEastConstActionFactory(finder, frontendOptions);
   int runResult = tool.run(factory.get());
   EXPECT_EQ(runResult, 0);
 
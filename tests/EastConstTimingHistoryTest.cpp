@@ -0,0 +1,87 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstTimingHistory.h>
+#include <gtest/gtest.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+
+namespace {
+
+class EastConstTimingHistoryTest : public EastConstTempDirTest {
+protected:
+  void SetUp() override {
+    ASSERT_NO_FATAL_FAILURE(EastConstTempDirTest::SetUp());
+    Path = path("timings");
+  }
+
+  std::string Path;
+};
+
+} // namespace
+
+TEST_F(EastConstTimingHistoryTest, MissingFileLoadsEmpty) {
+  EastConstTimingHistory History;
+  EXPECT_TRUE(History.load(Path));
+  EXPECT_EQ(History.size(), 0u);
+  EXPECT_FALSE(History.lookup("/src/a.cpp"));
+}
+
+TEST_F(EastConstTimingHistoryTest, RoundTripsThroughSave) {
+  EastConstTimingHistory History;
+  History.record("/src/a.cpp", 1.5);
+  History.record("/src/b c.cpp", 0.25);
+  History.record("/src/a.cpp", 2.0);
+  ASSERT_TRUE(History.save(Path));
+
+  EastConstTimingHistory Loaded;
+  ASSERT_TRUE(Loaded.load(Path));
+  EXPECT_EQ(Loaded.size(), 2u);
+  EXPECT_DOUBLE_EQ(*Loaded.lookup("/src/a.cpp"), 2.0);
+  EXPECT_DOUBLE_EQ(*Loaded.lookup("/src/b c.cpp"), 0.25);
+}
+
+TEST_F(EastConstTimingHistoryTest, SkipsDamagedLines) {
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC);
+    ASSERT_FALSE(EC) << EC.message();
+    OS << "0.5000\t/src/a.cpp\n"
+       << "garbage\n"
+       << "x\t/src/b.cpp\n"
+       << "-1\t/src/c.cpp\n"
+       << "0.7500\t/src/d.cpp";
+  }
+  EastConstTimingHistory History;
+  ASSERT_TRUE(History.load(Path));
+  EXPECT_EQ(History.size(), 2u);
+  EXPECT_DOUBLE_EQ(*History.lookup("/src/a.cpp"), 0.5);
+  EXPECT_DOUBLE_EQ(*History.lookup("/src/d.cpp"), 0.75);
+}
+
+TEST_F(EastConstTimingHistoryTest, KeepsPeakMemoryAcrossRuns) {
+  EastConstTimingHistory History;
+  History.record("/src/a.cpp", 1.0, 300u << 20);
+  History.record("/src/b.cpp", 2.0);
+  ASSERT_TRUE(History.save(Path));
+
+  EastConstTimingHistory Loaded;
+  ASSERT_TRUE(Loaded.load(Path));
+  EXPECT_EQ(*Loaded.lookupPeakBytes("/src/a.cpp"), 300u << 20);
+  EXPECT_FALSE(Loaded.lookupPeakBytes("/src/b.cpp"));
+  // A run that could not measure the peak keeps the recorded one.
+  Loaded.record("/src/a.cpp", 1.5);
+  EXPECT_EQ(*Loaded.lookupPeakBytes("/src/a.cpp"), 300u << 20);
+  EXPECT_DOUBLE_EQ(*Loaded.lookup("/src/a.cpp"), 1.5);
+}
+
+TEST(EastConstParseCostTest, WeighsIncludesAboveBytes) {
+  std::string Plain(200, ' ');
+  std::string WithIncludes = "#include <vector>\n  #  include \"a.h\"\n";
+  EXPECT_GT(estimateEastConstParseCost(WithIncludes),
+            estimateEastConstParseCost(Plain));
+  EXPECT_DOUBLE_EQ(estimateEastConstParseCost(Plain), 200.0);
+  // Only directives count.
+  EXPECT_DOUBLE_EQ(estimateEastConstParseCost("// #include <x>\n"), 16.0);
+}
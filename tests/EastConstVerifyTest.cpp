@@ -0,0 +1,138 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstVerify.h>
+#include <gtest/gtest.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using clang::tooling::Replacement;
+
+namespace {
+
+// Compiles every file twice: as is and with -DVARIANT.
+class TwoConfigurationDatabase : public clang::tooling::CompilationDatabase {
+public:
+  explicit TwoConfigurationDatabase(std::string Directory)
+      : Directory(std::move(Directory)) {}
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override {
+    std::vector<clang::tooling::CompileCommand> Commands;
+    for (const char *Define : {"-UVARIANT", "-DVARIANT"})
+      Commands.emplace_back(
+          Directory, FilePath,
+          std::vector<std::string>{"clang++", "-std=c++17", Define, "-c",
+                                   FilePath.str()},
+          "out.o");
+    return Commands;
+  }
+
+private:
+  std::string Directory;
+};
+
+class EastConstVerifyTest : public EastConstTempDirTest {
+protected:
+  EastConstVerification verify(llvm::StringRef File,
+                               const std::vector<Replacement> &Fix) {
+    clang::tooling::FixedCompilationDatabase Compilations(
+        Root.str(), std::vector<std::string>{"-std=c++17"});
+    return verifyEastConstFix(Compilations, File, Fix, {}, {});
+  }
+};
+
+} // namespace
+
+TEST_F(EastConstVerifyTest, AcceptsAnEastFix) {
+  std::string File = writeFile("a.cpp", "const int *p;\n");
+  EastConstVerification Result =
+      verify(File, {Replacement(File, 0, 6, ""),
+                    Replacement(File, 9, 0, " const")});
+  EXPECT_TRUE(Result.passed());
+  EXPECT_TRUE(Result.Reparsed);
+  EXPECT_EQ(Result.Compared, 1u);
+  EXPECT_EQ(Result.Leftover, 0u);
+  // The fixed buffer only ever lived in memory.
+  auto Buffer = llvm::MemoryBuffer::getFile(File);
+  ASSERT_TRUE(static_cast<bool>(Buffer));
+  EXPECT_EQ((*Buffer)->getBuffer(), "const int *p;\n");
+}
+
+TEST_F(EastConstVerifyTest, ReportsAChangedType) {
+  // "int *const p;" makes the pointer const instead of the pointee.
+  std::string File = writeFile("a.cpp", "const int *p;\n");
+  EastConstVerification Result =
+      verify(File, {Replacement(File, 0, 6, ""),
+                    Replacement(File, 11, 0, "const ")});
+  EXPECT_FALSE(Result.passed());
+  ASSERT_EQ(Result.Mismatches.size(), 1u);
+  EXPECT_NE(Result.Mismatches[0].find("'p'"), std::string::npos)
+      << Result.Mismatches[0];
+}
+
+TEST_F(EastConstVerifyTest, ReportsSitesASecondPassWouldFix) {
+  std::string File = writeFile("a.cpp", "const int a = 1;\n"
+                                        "const int b = 2;\n");
+  EastConstVerification Result =
+      verify(File, {Replacement(File, 0, 6, ""),
+                    Replacement(File, 9, 0, " const")});
+  EXPECT_TRUE(Result.Mismatches.empty());
+  EXPECT_EQ(Result.Compared, 1u);
+  EXPECT_EQ(Result.Leftover, 2u);
+  EXPECT_FALSE(Result.passed());
+}
+
+TEST_F(EastConstVerifyTest, ReportsAFixThatDoesNotCompile) {
+  std::string File = writeFile("a.cpp", "const int *p;\n");
+  EastConstVerification Result =
+      verify(File, {Replacement(File, 0, 6, ""),
+                    Replacement(File, 9, 0, " const )")});
+  EXPECT_FALSE(Result.Reparsed);
+  EXPECT_FALSE(Result.passed());
+}
+
+TEST_F(EastConstVerifyTest, ComparesEachConfigurationWithItself) {
+  // Only the first configuration sees the declaration the fix breaks.
+  std::string File = writeFile("a.cpp", "#ifndef VARIANT\n"
+                                        "const int *p;\n"
+                                        "#endif\n"
+                                        "const int q = 0;\n");
+  TwoConfigurationDatabase Compilations(Root.str().str());
+  EastConstVerification Result = verifyEastConstFix(
+      Compilations, File,
+      {Replacement(File, 16, 6, ""), Replacement(File, 27, 0, "const ")}, {},
+      {});
+  EXPECT_TRUE(Result.Reparsed);
+  EXPECT_FALSE(Result.passed());
+  ASSERT_EQ(Result.Mismatches.size(), 1u);
+  EXPECT_NE(Result.Mismatches[0].find("configuration 1 of 2"),
+            std::string::npos)
+      << Result.Mismatches[0];
+  EXPECT_NE(Result.Mismatches[0].find("'p'"), std::string::npos)
+      << Result.Mismatches[0];
+}
+
+TEST_F(EastConstVerifyTest, VerifierRunsEachFileOnce) {
+  std::string A = writeFile("a.cpp", "const int *p;\n");
+  std::string B = writeFile("b.cpp", "typedef const char *Name;\n");
+  clang::tooling::FixedCompilationDatabase Compilations(
+      Root.str(), std::vector<std::string>{"-std=c++17"});
+  EastConstVerifier Verifier(Compilations, {}, {}, 2);
+  Verifier.submit(B, {Replacement(B, 8, 6, ""),
+                      Replacement(B, 18, 0, " const")});
+  Verifier.submit(A, {Replacement(A, 0, 6, ""),
+                      Replacement(A, 9, 0, " const")});
+  Verifier.submit(A, {});
+  EXPECT_TRUE(Verifier.isSubmitted(A));
+  std::vector<EastConstVerification> Results = Verifier.wait();
+  ASSERT_EQ(Results.size(), 2u);
+  EXPECT_EQ(Results[0].File, A);
+  EXPECT_EQ(Results[1].File, B);
+  for (const EastConstVerification &Result : Results)
+    EXPECT_TRUE(Result.passed()) << Result.File;
+}
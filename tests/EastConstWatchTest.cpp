@@ -0,0 +1,176 @@
+#include "EastConstTestHarness.h"
+
+#include <EastConstWatch.h>
+#include <gtest/gtest.h>
+
+#include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Compiles every file twice: as is and with -DVARIANT.
+class TwoConfigurationDatabase : public clang::tooling::CompilationDatabase {
+public:
+  explicit TwoConfigurationDatabase(std::string Directory)
+      : Directory(std::move(Directory)) {}
+
+  std::vector<clang::tooling::CompileCommand>
+  getCompileCommands(llvm::StringRef FilePath) const override {
+    std::vector<clang::tooling::CompileCommand> Commands;
+    for (const char *Define : {"-UVARIANT", "-DVARIANT"})
+      Commands.emplace_back(
+          Directory, FilePath,
+          std::vector<std::string>{"clang++", "-std=c++17", Define, "-c",
+                                   FilePath.str()},
+          "out.o");
+    return Commands;
+  }
+
+private:
+  std::string Directory;
+};
+
+class EastConstWatchTest : public EastConstTempDirTest {};
+
+} // namespace
+
+TEST(EastConstDependencyGraphTest, MapsFilesBackToTheSourcesReadingThem) {
+  EastConstDependencyGraph Graph;
+  Graph.record("/src/a.cpp", {"/src/a.cpp", "/src/common.h", "/src/a.h"});
+  Graph.record("/src/b.cpp", {"/src/b.cpp", "/src/common.h"});
+
+  EXPECT_EQ(Graph.affected({"/src/a.h"}),
+            std::vector<std::string>({"/src/a.cpp"}));
+  EXPECT_EQ(Graph.affected({"/src/common.h"}),
+            std::vector<std::string>({"/src/a.cpp", "/src/b.cpp"}));
+  EXPECT_TRUE(Graph.affected({"/src/unrelated.h"}).empty());
+
+  // A later parse replaces what a source read.
+  Graph.record("/src/a.cpp", {"/src/a.cpp", "/src/a.h"});
+  EXPECT_EQ(Graph.affected({"/src/common.h"}),
+            std::vector<std::string>({"/src/b.cpp"}));
+  EXPECT_EQ(Graph.files(),
+            std::vector<std::string>({"/src/a.cpp", "/src/a.h",
+                                      "/src/b.cpp", "/src/common.h"}));
+}
+
+TEST_F(EastConstWatchTest, ReanalyzesOnlyTheSourcesAHeaderReaches) {
+  std::string Header = writeFile("shared.h", "const int shared = 1;\n");
+  std::string User =
+      writeFile("user.cpp", "#include \"shared.h\"\nconst int *u;\n");
+  std::string Other = writeFile("other.cpp", "const char *o;\nint x;\n");
+  clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                        {"-std=c++17"});
+  std::string Output;
+  llvm::raw_string_ostream Out(Output);
+  EastConstWatchSession Session(Compilations, {User, Other},
+                                EastConstCheckerOptions(),
+                                EastConstFrontendOptions(),
+                                EastConstWatchOptions(), Out);
+
+  EXPECT_TRUE(Session.analyze(Session.sources()));
+  EastConstWatchStats Stats = Session.getStats();
+  EXPECT_EQ(Stats.Rounds, 1u);
+  EXPECT_EQ(Stats.Analyzed, 2u);
+  EXPECT_EQ(Stats.Sites, 2u);
+  EXPECT_EQ(Stats.FilesWithSites, 2u);
+  std::vector<std::string> Watched = Session.watchedFiles();
+  EXPECT_NE(std::find(Watched.begin(), Watched.end(), Header),
+            Watched.end());
+
+  std::vector<std::string> Affected = Session.affected({Header});
+  ASSERT_EQ(Affected, std::vector<std::string>({User}));
+  EXPECT_EQ(Session.affected({Other}), std::vector<std::string>({Other}));
+
+  // Fixing user.cpp by hand clears its site; other.cpp keeps its cached one.
+  writeFile("user.cpp", "#include \"shared.h\"\nint const *u;\n");
+  Output.clear();
+  EXPECT_TRUE(Session.analyze(Affected));
+  Stats = Session.getStats();
+  EXPECT_EQ(Stats.Rounds, 2u);
+  EXPECT_EQ(Stats.Analyzed, 3u);
+  EXPECT_EQ(Stats.Sites, 1u);
+  EXPECT_EQ(Stats.FilesWithSites, 1u);
+  EXPECT_NE(Out.str().find("Round 2: analyzed 1 of 2 files; 1 west-const "
+                           "sites in 1 file"),
+            std::string::npos)
+      << Output;
+}
+
+TEST_F(EastConstWatchTest, FixesTheAnalyzedSources) {
+  std::string Source = writeFile("fix.cpp", "const int *p;\n");
+  clang::tooling::FixedCompilationDatabase Compilations(Root.str(),
+                                                        {"-std=c++17"});
+  std::string Output;
+  llvm::raw_string_ostream Out(Output);
+  EastConstWatchOptions Options;
+  Options.Fix = true;
+  EastConstWatchSession Session(Compilations, {Source},
+                                EastConstCheckerOptions(),
+                                EastConstFrontendOptions(), Options, Out);
+  EXPECT_TRUE(Session.analyze(Session.sources()));
+  EXPECT_EQ(Session.getStats().Sites, 0u);
+
+  auto Buffer = llvm::MemoryBuffer::getFile(Source);
+  ASSERT_TRUE(Buffer);
+  EXPECT_EQ((*Buffer)->getBuffer(), "int const *p;\n");
+  // The session's own write starts no round; a later edit does.
+  std::vector<std::string> Changed = {Source};
+  Session.dropOwnWrites(Changed);
+  EXPECT_TRUE(Changed.empty());
+  writeFile("fix.cpp", "const int *q;\n");
+  Changed = {Source};
+  Session.dropOwnWrites(Changed);
+  EXPECT_EQ(Changed, std::vector<std::string>({Source}));
+}
+
+TEST_F(EastConstWatchTest, FixesASiteSharedByConfigurationsOnce) {
+  std::string Source = writeFile("v.cpp", "#ifdef VARIANT\n"
+                                          "const int v = 1;\n"
+                                          "#endif\n"
+                                          "const int a = 2;\n");
+  TwoConfigurationDatabase Compilations(Root.str().str());
+  std::string Output;
+  llvm::raw_string_ostream Out(Output);
+  EastConstWatchOptions Options;
+  Options.Fix = true;
+  EastConstWatchSession Session(Compilations, {Source},
+                                EastConstCheckerOptions(),
+                                EastConstFrontendOptions(), Options, Out);
+  EXPECT_TRUE(Session.analyze(Session.sources()));
+  // `a` is printed once, not once per configuration.
+  EXPECT_EQ(Out.str().find(":4:"), Out.str().rfind(":4:")) << Output;
+
+  auto Buffer = llvm::MemoryBuffer::getFile(Source);
+  ASSERT_TRUE(Buffer);
+  EXPECT_EQ((*Buffer)->getBuffer(), "#ifdef VARIANT\n"
+                                    "int const v = 1;\n"
+                                    "#endif\n"
+                                    "int const a = 2;\n");
+}
+
+#ifdef __linux__
+TEST_F(EastConstWatchTest, ReportsAFileReplacedByRename) {
+  ASSERT_TRUE(isEastConstFileWatchSupported());
+  std::string Watched = writeFile("watched.h", "int a;\n");
+  writeFile("unwatched.h", "int b;\n");
+  EastConstFileWatcher Watcher;
+  ASSERT_TRUE(Watcher.isValid());
+  ASSERT_TRUE(Watcher.watch({Watched}));
+
+  // Editors save by writing a temporary file and renaming it over.
+  std::string Temporary = writeFile("watched.h.tmp", "int c;\n");
+  writeFile("unwatched.h", "int d;\n");
+  ASSERT_FALSE(llvm::sys::fs::rename(Temporary, Watched));
+  EXPECT_EQ(Watcher.wait(std::chrono::milliseconds(50)),
+            std::vector<std::string>({Watched}));
+}
+#endif
@@ -39,10 +39,11 @@ class RunnerConfig:
   default_tool_args: List[str]
   default_clang_tidy_args: List[str]
   clang_tidy_path: Optional[str]
+  clang_path: Optional[str]
 
   @classmethod
   def empty(cls) -> RunnerConfig:
-    return cls([], [], [], None)
+    return cls([], [], [], None, None)
 
 
 def load_cases(cases_path: Path) -> list[IntegrationCase]:
@@ -75,6 +76,7 @@ def load_runner_config(config_path: Path) -> RunnerConfig:
       default_tool_args=data.get("default_tool_args", []),
       default_clang_tidy_args=data.get("default_clang_tidy_args", []),
       clang_tidy_path=data.get("clang_tidy_path"),
+      clang_path=data.get("clang_path"),
   )
 
 
@@ -96,6 +98,19 @@ def locate_plugin(build_dir: Path) -> Path:
   )
 
 
+def locate_compiler_plugin(build_dir: Path) -> Optional[Path]:
+  candidate_names = [
+      "libeast-const-plugin.so",
+      "libeast-const-plugin.dylib",
+      "east-const-plugin.dll",
+  ]
+  for root in [build_dir, build_dir / "lib", build_dir / "bin"]:
+    for name in candidate_names:
+      if (root / name).exists():
+        return root / name
+  return None
+
+
 def ensure_artifact(path: Path, description: str) -> None:
   if not path.exists():
     raise CaseFailure(f"Missing {description} at {path}")
@@ -182,7 +197,9 @@ def build_command(
     *,
     tool_path: Path,
     plugin_path: Path,
+    compiler_plugin_path: Optional[Path],
     clang_tidy: str,
+    clang: str,
     source: Path,
     compile_flags: List[str],
     standalone_args: List[str],
@@ -213,6 +230,16 @@ def build_command(
         "--",
         *compile_flags,
     ]
+  if case.mode == "clang-plugin-lint":
+    if compiler_plugin_path is None:
+      raise CaseFailure("Unable to locate the east-const-plugin compiler plugin")
+    return [
+        clang,
+        "-fsyntax-only",
+        f"-fplugin={compiler_plugin_path}",
+        *compile_flags,
+        str(source),
+    ]
   raise CaseFailure(f"Unsupported mode '{case.mode}' in case '{case.name}'")
 
 
@@ -239,7 +266,9 @@ def run_case(
     fixtures_dir: Path,
     tool_path: Path,
     plugin_path: Path,
+    compiler_plugin_path: Optional[Path],
     clang_tidy: str,
+    clang: str,
     config: RunnerConfig,
   verbose: bool,
 ) -> None:
@@ -262,7 +291,9 @@ def run_case(
         case,
         tool_path=tool_path,
         plugin_path=plugin_path,
+        compiler_plugin_path=compiler_plugin_path,
         clang_tidy=clang_tidy,
+        clang=clang,
         source=work_file,
         compile_flags=effective_compile_flags,
         standalone_args=effective_tool_args,
@@ -303,6 +334,11 @@ def parse_args() -> argparse.Namespace:
       default=None,
       help="Path to the clang-tidy executable (defaults to value from config or clang-tidy on PATH).",
   )
+  parser.add_argument(
+      "--clang",
+      default=None,
+      help="Path to the clang++ executable used to load the compiler plugin (defaults to value from config or clang++ on PATH).",
+  )
   parser.add_argument(
       "--case",
       action="append",
@@ -349,6 +385,7 @@ def main() -> int:
     tool_path = tool_path.with_suffix(".exe")
   ensure_artifact(tool_path, "standalone tool")
   plugin_path = locate_plugin(build_dir)
+  compiler_plugin_path = locate_compiler_plugin(build_dir)
 
   clang_tidy_path: str
   if args.clang_tidy:
@@ -358,6 +395,8 @@ def main() -> int:
   else:
     clang_tidy_path = "clang-tidy"
 
+  clang_path = args.clang or runner_config.clang_path or "clang++"
+
   if args.selected_cases:
     requested = set(args.selected_cases)
     cases_by_name = {case.name: case for case in cases}
@@ -377,7 +416,9 @@ def main() -> int:
           fixtures_dir=fixtures_dir,
           tool_path=tool_path,
           plugin_path=plugin_path,
+          compiler_plugin_path=compiler_plugin_path,
           clang_tidy=clang_tidy_path,
+          clang=clang_path,
           config=runner_config,
           verbose=args.verbose,
         )